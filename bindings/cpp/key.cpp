@@ -125,6 +125,35 @@ void key::transform(const session &sess) const
 	}
 }
 
+void key::transform(const session &sess, const std::vector<key> &keys)
+{
+	std::vector<const key *> pending;
+	std::vector<iovec> names;
+
+	for (const auto &k : keys) {
+		if (k.m_by_id || k.inited())
+			continue;
+
+		pending.push_back(&k);
+		names.push_back(iovec{const_cast<char *>(k.m_remote.data()), k.m_remote.size()});
+	}
+
+	if (pending.empty())
+		return;
+
+	std::vector<dnet_raw_id> ids(pending.size());
+	dnet_transform_raw_batch(const_cast<dnet_session *>(sess.get_native()), names.data(), names.size(),
+	                         reinterpret_cast<char *>(ids.data()), sizeof(ids.front().id));
+
+	for (size_t i = 0; i < pending.size(); ++i) {
+		auto &k = *const_cast<key *>(pending[i]);
+
+		memset(&k.m_id, 0, sizeof(k.m_id));
+		memcpy(k.m_id.id, ids[i].id, sizeof(k.m_id.id));
+		k.set_inited(true);
+	}
+}
+
 bool key::inited() const
 {
 	return (m_reserved & KEY_INITED);
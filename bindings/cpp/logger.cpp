@@ -17,6 +17,7 @@
 
 #include "example/config.hpp"
 #include "elliptics/session.hpp"
+#include "library/access_ring.h"
 
 namespace ioremap { namespace elliptics {
 
@@ -261,6 +262,10 @@ void dnet_logger_unset_trace_id() {
 	ioremap::elliptics::attributes::trace::pop();
 }
 
+uint64_t dnet_logger_get_trace_id() {
+	return ioremap::elliptics::attributes::trace::id();
+}
+
 uint64_t dnet_logger_get_trace_bit() {
 	return ioremap::elliptics::attributes::trace::bit() ? (1ll << 63) : 0;
 }
@@ -362,26 +367,29 @@ void dnet_trans_log(struct dnet_node *node, struct dnet_trans *t) {
 		return DIFF_TIMESPEC(t->start_ts, ts);
 	}();
 
-	dnet_log_access(node,
-	                {{"cmd", std::string(dnet_cmd_string(cmd->cmd))},
-	                 {"id", std::string(dnet_dump_id_str(cmd->id.id))},
-	                 {"group", cmd->id.group_id},
-	                 {"trans", t->trans},
-	                 {"st", std::string(dnet_state_dump_addr(t->st))},
-	                 {"trace_id", ioremap::elliptics::to_hex_string(cmd->trace_id)},
-	                 {"backend_id", std::to_string(cmd->backend_id)},
-	                 {"request_size", request_size},
-	                 {"request_cflags", std::string(dnet_flags_dump_cflags(cmd->flags))},
-	                 {"wait_ts", t->wait_ts.tv_sec},
-	                 {"stall", t->st->stall},
-	                 {"send_queue_time", t->stats.send_queue_time},
-	                 {"send_time", t->stats.send_time},
-	                 {"status", int(t->cmd.status)},
-	                 {"replies", t->stats.recv_replies},
-	                 {"replies_size", t->stats.recv_size},
-	                 {"recv_time", t->stats.recv_time},
-	                 {"recv_queue_time", t->stats.recv_queue_time},
-	                 {"total_time", total_time},
-	                 {"access", "transaction"},
-	});
+	// every attribute is copied into the record at once, so there is no need to copy strings
+	// returned by dnet_*_dump*() functions which reuse thread-local buffers
+	dnet_access_record record;
+	record.append({"cmd", dnet_cmd_string(cmd->cmd)});
+	record.append({"id", dnet_dump_id_str(cmd->id.id)});
+	record.append({"group", cmd->id.group_id});
+	record.append({"trans", t->trans});
+	record.append({"st", dnet_state_dump_addr(t->st)});
+	record.append({"trace_id", ioremap::elliptics::to_hex_string(cmd->trace_id)});
+	record.append({"backend_id", std::to_string(cmd->backend_id)});
+	record.append({"request_size", request_size});
+	record.append({"request_cflags", dnet_flags_dump_cflags(cmd->flags)});
+	record.append({"wait_ts", t->wait_ts.tv_sec});
+	record.append({"stall", t->st->stall});
+	record.append({"send_queue_time", t->stats.send_queue_time});
+	record.append({"send_time", t->stats.send_time});
+	record.append({"status", int(t->cmd.status)});
+	record.append({"replies", t->stats.recv_replies});
+	record.append({"replies_size", t->stats.recv_size});
+	record.append({"recv_time", t->stats.recv_time});
+	record.append({"recv_queue_time", t->stats.recv_queue_time});
+	record.append({"total_time", total_time});
+	record.append({"access", "transaction"});
+
+	dnet_access_ring_publish(node, record);
 }
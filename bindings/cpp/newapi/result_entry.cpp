@@ -3,8 +3,10 @@
 #include "library/elliptics.h"
 
 #include <algorithm>
+#include <atomic>
 #include <fcntl.h>
 #include <queue>
+#include <thread>
 
 namespace ioremap { namespace elliptics { namespace newapi {
 
@@ -128,6 +130,13 @@ uint64_t iterator_result_entry::total_keys() const {
 	return response.total_keys;
 }
 
+uint64_t iterator_result_entry::filtered_keys() const {
+	dnet_iterator_response response;
+	deserialize(raw_data(), response);
+
+	return response.filtered_keys;
+}
+
 int iterator_result_entry::status() const {
 	dnet_iterator_response response;
 	deserialize(raw_data(), response);
@@ -186,25 +195,102 @@ data_pointer iterator_result_entry::data() const {
 
 static const size_t MAX_ITERATOR_RESULT_CHUNK_SIZE = 500 * 1024 * 1024; // 500 Mb
 static const size_t MAX_ITERATOR_RESULT_ITEMS_IN_CHUNK = MAX_ITERATOR_RESULT_CHUNK_SIZE / sizeof(struct iterator_container_item);
+static const size_t ITERATOR_RESULT_WRITE_BUFFER_SIZE = 4 * 1024 * 1024; // 4 Mb
+static const size_t ITERATOR_RESULT_ITEMS_IN_WRITE_BUFFER = ITERATOR_RESULT_WRITE_BUFFER_SIZE / sizeof(struct iterator_container_item);
+static const size_t ITERATOR_RESULT_READ_BUFFER_SIZE = 64 * 1024 * 1024; // 64 Mb
+// number of leading key bytes used by radix pass of the sort
+static const size_t ITERATOR_RESULT_RADIX_BYTES = 2;
+static const size_t ITERATOR_RESULT_RADIX_BUCKETS = 1 << (8 * ITERATOR_RESULT_RADIX_BYTES);
+// containers smaller than this are sorted by single std::sort
+static const size_t MIN_ITERATOR_RESULT_ITEMS_FOR_RADIX_SORT = 64 * 1024;
+
+/*
+ * Compares records of the same key from different containers, returns true if @lhs wins:
+ * newer data timestamp, then smaller data size, then greater user flags.
+ * It's the order used by python recovery (elliptics_recovery.iterator.MergeData).
+ */
+static inline bool compare_merged_items(const struct iterator_container_item &lhs, const struct iterator_container_item &rhs)
+{
+	const int diff = dnet_time_cmp(&lhs.data_timestamp, &rhs.data_timestamp);
+	if (diff != 0)
+		return diff > 0;
+	if (lhs.data_size != rhs.data_size)
+		return lhs.data_size < rhs.data_size;
+	return lhs.user_flags > rhs.user_flags;
+}
 
+/*
+ * Records of the same key are ordered by compare_merged_items(), so the first record of a key
+ * in a sorted container is the one which wins the merge. Newer json timestamp breaks remaining ties.
+ */
 static inline bool compare_iterator_container_items(const struct iterator_container_item &lhs, const struct iterator_container_item &rhs)
 {
-	int diff = dnet_id_cmp_str(lhs.key.id, rhs.key.id);
-
-	if (diff == 0) {
-		diff = dnet_time_cmp(&rhs.data_timestamp, &lhs.data_timestamp);
-		if (diff == 0) {
-			diff = dnet_time_cmp(&rhs.json_timestamp, &lhs.json_timestamp);
-			if (diff == 0) {
-				if (lhs.data_size > rhs.data_size)
-					diff = -1;
-				if (lhs.data_size < rhs.data_size)
-					diff = 1;
-			}
+	const int diff = dnet_id_cmp_str(lhs.key.id, rhs.key.id);
+	if (diff != 0)
+		return diff < 0;
+	if (compare_merged_items(lhs, rhs))
+		return true;
+	if (compare_merged_items(rhs, lhs))
+		return false;
+	return dnet_time_cmp(&lhs.json_timestamp, &rhs.json_timestamp) > 0;
+}
+
+static inline size_t iterator_container_item_bucket(const struct iterator_container_item &item)
+{
+	size_t bucket = 0;
+	for (size_t i = 0; i < ITERATOR_RESULT_RADIX_BYTES; ++i)
+		bucket = (bucket << 8) | item.key.id[i];
+	return bucket;
+}
+
+/*
+ * Sorts @items by compare_iterator_container_items().
+ *
+ * Items are distributed in-place into buckets by leading bytes of the key (one pass of MSD radix sort),
+ * since keys are compared bytewise, buckets are already ordered relative to each other. After that
+ * buckets are sorted independently by a pool of threads.
+ */
+static void sort_iterator_container_items(std::vector<struct iterator_container_item> &items)
+{
+	const size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+	if (items.size() < MIN_ITERATOR_RESULT_ITEMS_FOR_RADIX_SORT || num_threads == 1) {
+		std::sort(items.begin(), items.end(), compare_iterator_container_items);
+		return;
+	}
+
+	std::vector<size_t> begins(ITERATOR_RESULT_RADIX_BUCKETS + 1, 0);
+	for (const auto &item : items)
+		++begins[iterator_container_item_bucket(item) + 1];
+	for (size_t i = 1; i < begins.size(); ++i)
+		begins[i] += begins[i - 1];
+
+	/* american flag sort: move each item to its bucket by cyclic swaps */
+	std::vector<size_t> positions(begins.begin(), begins.end() - 1);
+	for (size_t bucket = 0; bucket < ITERATOR_RESULT_RADIX_BUCKETS; ++bucket) {
+		while (positions[bucket] < begins[bucket + 1]) {
+			auto &item = items[positions[bucket]];
+			const size_t item_bucket = iterator_container_item_bucket(item);
+			if (item_bucket == bucket)
+				++positions[bucket];
+			else
+				std::swap(item, items[positions[item_bucket]++]);
 		}
 	}
 
-	return diff == -1;
+	std::atomic<size_t> next_bucket{0};
+	auto worker = [&] () {
+		for (size_t bucket = next_bucket++; bucket < ITERATOR_RESULT_RADIX_BUCKETS; bucket = next_bucket++) {
+			std::sort(items.begin() + begins[bucket], items.begin() + begins[bucket + 1],
+			          compare_iterator_container_items);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < num_threads; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (auto &thread : threads)
+		thread.join();
 }
 
 class iterator_result_chunk
@@ -227,7 +313,7 @@ public:
 		if (err)
 			return err;
 
-		std::sort(items.begin(), items.end(), compare_iterator_container_items);
+		sort_iterator_container_items(items);
 
 		return dnet_write_ll(m_fd, reinterpret_cast<char *>(items.data()), items_size, m_offset);
 	}
@@ -327,19 +413,38 @@ void iterator_result_container::append_old(const ioremap::elliptics::iterator_re
 
 void iterator_result_container::append_item(const iterator_container_item &item)
 {
-	int err = dnet_write_ll(m_fd, reinterpret_cast<const char *>(&item), sizeof(item), m_write_position);
+	if (m_buffer.capacity() < ITERATOR_RESULT_ITEMS_IN_WRITE_BUFFER)
+		m_buffer.reserve(ITERATOR_RESULT_ITEMS_IN_WRITE_BUFFER);
+
+	m_buffer.push_back(item);
+	m_count++;
+
+	if (m_buffer.size() >= ITERATOR_RESULT_ITEMS_IN_WRITE_BUFFER)
+		flush();
+}
+
+//* Write buffered items to the container file
+void iterator_result_container::flush()
+{
+	if (m_buffer.empty())
+		return;
+
+	const size_t size = m_buffer.size() * sizeof(iterator_container_item);
+	int err = dnet_write_ll(m_fd, reinterpret_cast<const char *>(m_buffer.data()), size, m_write_position);
 	if (err != 0)
 		throw_error(err, "dnet_write_ll failed");
-	m_write_position += sizeof(item);
-	m_count++;
+	m_write_position += size;
+	m_buffer.clear();
 }
 
-//* Sort container by (key, data_timestamp, json_timestamp, data_size) tuple
+//* Sort container by (key, data_timestamp, data_size, user_flags, json_timestamp) tuple
 void iterator_result_container::sort()
 {
 	if (m_sorted)
 		return;
 
+	flush();
+
 	if (m_write_position % sizeof(iterator_container_item) != 0)
 		throw_error(-EINVAL, "invalid container size");
 
@@ -384,22 +489,21 @@ void iterator_result_container::sort()
 		if (fd == -1)
 			throw_error(-errno, "create result file failed");
 
-		offset = 0;
-		while (!pq.empty()) {
-			auto chunk = pq.top();
-
-			err = dnet_write_ll(fd, reinterpret_cast<const char *>(&chunk->get_item()),
-					    sizeof(iterator_container_item), offset);
-			if (err) {
-				close(fd);
-				throw_error(err, "write result failed");
-			}
-			offset += sizeof(iterator_container_item);
+		try {
+			iterator_result_container result(fd);
+			while (!pq.empty()) {
+				auto chunk = pq.top();
+				result.append_item(chunk->get_item());
 
-			pq.pop();
-			if (chunk->next()) {
-				pq.push(chunk);
+				pq.pop();
+				if (chunk->next()) {
+					pq.push(chunk);
+				}
 			}
+			result.flush();
+		} catch (...) {
+			close(fd);
+			throw;
 		}
 
 		if (dup2(fd, m_fd) == -1) {
@@ -418,6 +522,10 @@ void iterator_result_container::sort()
 //* Extract n-th item from container
 iterator_container_item iterator_result_container::operator [](size_t n) const
 {
+	const size_t num_written_items = m_write_position / sizeof(iterator_container_item);
+	if (n >= num_written_items && n - num_written_items < m_buffer.size())
+		return m_buffer[n - num_written_items];
+
 	iterator_container_item item;
 	int err;
 
@@ -427,4 +535,154 @@ iterator_container_item iterator_result_container::operator [](size_t n) const
 	return item;
 }
 
+/*
+ * Walks over several sorted containers simultaneously in key order.
+ * For every key it provides the newest record of the key in each container which has the key.
+ */
+class iterator_result_merger
+{
+public:
+	iterator_result_merger(const std::vector<iterator_result_container *> &containers)
+	: m_newest(0)
+	, m_items(containers.size())
+	, m_has_items(containers.size(), false)
+	{
+		if (containers.empty())
+			return;
+
+		const size_t num_buffer_items = std::max<size_t>(1,
+			ITERATOR_RESULT_READ_BUFFER_SIZE / sizeof(iterator_container_item) / containers.size());
+
+		m_chunks.reserve(containers.size());
+		for (auto container : containers) {
+			if (!container->m_sorted)
+				throw_error(-EINVAL, "can't merge unsorted container");
+
+			container->flush();
+
+			m_chunks.emplace_back(container->m_fd, 0, container->m_count);
+			if (container->m_count == 0)
+				continue;
+
+			int err = m_chunks.back().set_num_buffer_items(std::min<size_t>(num_buffer_items, container->m_count));
+			if (err != 0)
+				throw_error(err, "read container failed");
+			m_pq.push(&m_chunks.back());
+		}
+	}
+
+	/*
+	 * Moves to the next key. Returns false if all containers are exhausted.
+	 * @item(i) is the newest record of the key in i-th container if @has_item(i) is true,
+	 * @newest() is the index of the container which has the newest record of the key among all containers.
+	 */
+	bool next()
+	{
+		std::fill(m_has_items.begin(), m_has_items.end(), false);
+		if (m_pq.empty())
+			return false;
+
+		const dnet_raw_id key = m_pq.top()->get_item().key;
+		m_newest = m_items.size();
+		while (!m_pq.empty() && !dnet_id_cmp_str(m_pq.top()->get_item().key.id, key.id)) {
+			auto chunk = m_pq.top();
+			m_pq.pop();
+
+			const size_t index = chunk - m_chunks.data();
+			if (!m_has_items[index]) {
+				/* containers are sorted, so the first record of the key is the newest one */
+				m_items[index] = chunk->get_item();
+				m_has_items[index] = true;
+			}
+
+			if (chunk->next())
+				m_pq.push(chunk);
+		}
+
+		for (size_t index = 0; index < m_items.size(); ++index) {
+			if (!m_has_items[index])
+				continue;
+			if (m_newest == m_items.size() || compare_merged_items(m_items[index], m_items[m_newest]))
+				m_newest = index;
+		}
+		return true;
+	}
+
+	size_t newest() const
+	{
+		return m_newest;
+	}
+
+	const iterator_container_item &item(size_t index) const
+	{
+		return m_items[index];
+	}
+
+	bool has_item(size_t index) const
+	{
+		return m_has_items[index];
+	}
+
+private:
+	std::vector<iterator_result_chunk> m_chunks;
+	std::priority_queue<iterator_result_chunk *, std::vector<iterator_result_chunk *>, ChunksComparator> m_pq;
+	size_t m_newest;
+	std::vector<iterator_container_item> m_items;
+	std::vector<bool> m_has_items;
+};
+
+static void check_merge_destinations(const std::vector<iterator_result_container *> &sources,
+                                     const std::vector<iterator_result_container *> &destinations)
+{
+	if (sources.size() != destinations.size())
+		throw_error(-EINVAL, "number of sources and destinations differs: %zu vs %zu",
+		            sources.size(), destinations.size());
+
+	for (auto destination : destinations) {
+		if (destination->m_sorted || destination->m_count != 0)
+			throw_error(-EINVAL, "destination container must be empty");
+	}
+}
+
+static void finish_merge_destinations(const std::vector<iterator_result_container *> &destinations)
+{
+	for (auto destination : destinations) {
+		destination->flush();
+		/* records were appended in key order */
+		destination->m_sorted = true;
+	}
+}
+
+void iterator_result_container::merge(const std::vector<iterator_result_container *> &sources,
+                                      const std::vector<iterator_result_container *> &destinations)
+{
+	check_merge_destinations(sources, destinations);
+
+	iterator_result_merger merger(sources);
+	while (merger.next()) {
+		const size_t newest = merger.newest();
+		destinations[newest]->append_item(merger.item(newest));
+	}
+
+	finish_merge_destinations(destinations);
+}
+
+void iterator_result_container::diff(const std::vector<iterator_result_container *> &sources,
+                                     const std::vector<iterator_result_container *> &destinations)
+{
+	check_merge_destinations(sources, destinations);
+
+	iterator_result_merger merger(sources);
+	while (merger.next()) {
+		const size_t newest = merger.newest();
+		const auto &item = merger.item(newest);
+		for (size_t i = 0; i < sources.size(); ++i) {
+			if (!merger.has_item(i) || (i != newest && compare_merged_items(item, merger.item(i))))
+				destinations[i]->append_item(item);
+		}
+	}
+
+	finish_merge_destinations(destinations);
+}
+
 }}} // namespace ioremap::elliptics::newapi
@@ -3,6 +3,9 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
+#include <atomic>
+#include <chrono>
+
 #include <blackhole/attribute.hpp>
 
 #include "elliptics/async_result_cast.hpp"
@@ -439,14 +442,102 @@ private:
 	std::unique_ptr<dnet_access_context> m_context;
 };
 
+/* Read buffered by read_coalescer until it is sent within BULK_READ_NEW */
+struct coalesced_read {
+	session sess;
+	dnet_id id;
+	dnet_read_request request;
+	std::vector<int> groups;
+	async_result_handler<read_result_entry> handler;
+	/* access log of the read, it is printed when the last reference is dropped */
+	std::shared_ptr<dnet_access_context> context;
+};
+
+struct read_coalescing_counters {
+	std::atomic<uint64_t> reads{0};
+	std::atomic<uint64_t> batches{0};
+	std::atomic<uint64_t> keys{0};
+	std::atomic<uint64_t> failovers{0};
+};
+
+/*
+ * Buffers reads per node and request parameters, see session::set_read_coalescing().
+ * Buffer is sent when it has max_keys reads, buffers with expired window are sent by background thread.
+ */
+class read_coalescer {
+public:
+	read_coalescer(size_t max_keys, uint64_t window_us);
+	~read_coalescer();
+
+	/* Buffers read of \a id from \a groups which result should be reported to \a result.
+	 * Returns false if the read can't be coalesced and should be sent by ordinary request.
+	 */
+	bool read(const session &sess, const key &id, const dnet_read_request &request,
+	          const std::vector<int> &groups, const async_read_result &result);
+
+	read_coalescing_stats stats() const;
+
+private:
+	struct batch_key {
+		dnet_addr addr;
+		uint64_t cflags;
+		uint64_t ioflags;
+		uint64_t read_flags;
+
+		bool operator <(const batch_key &other) const {
+			const int cmp = dnet_addr_cmp(&addr, &other.addr);
+			if (cmp)
+				return cmp < 0;
+			return std::tie(cflags, ioflags, read_flags) <
+			       std::tie(other.cflags, other.ioflags, other.read_flags);
+		}
+	};
+
+	struct batch {
+		std::vector<coalesced_read> reads;
+		std::chrono::steady_clock::time_point expires;
+	};
+
+	/* State shared with background thread, which may outlive the coalescer
+	 * if the last session referring the coalescer is destroyed by the thread
+	 */
+	struct state {
+		state(size_t max_keys, uint64_t window_us)
+		: max_keys(std::max<size_t>(max_keys, 1))
+		, window(window_us)
+		, counters(std::make_shared<read_coalescing_counters>())
+		, stop(false) {}
+
+		const size_t max_keys;
+		const std::chrono::microseconds window;
+		std::shared_ptr<read_coalescing_counters> counters;
+
+		std::mutex lock;
+		std::condition_variable wait;
+		bool stop;
+		std::map<batch_key, batch> batches;
+	};
+
+	static void flush_expired(const std::shared_ptr<state> &state);
+	static void send(const std::shared_ptr<state> &state, const batch_key &key,
+	                 std::vector<coalesced_read> &&reads);
+
+	std::shared_ptr<state> m_state;
+	std::thread m_flusher;
+};
+
 async_read_result send_read(const session &orig_sess, const key &id, const dnet_read_request &request,
-                            std::vector<int> &&groups) {
+                            std::vector<int> &&groups,
+                            const std::shared_ptr<read_coalescer> &coalescer = nullptr) {
+	async_read_result result(orig_sess);
+	if (coalescer && coalescer->read(orig_sess, id, request, groups, result))
+		return result;
+
 	transport_control control;
 	control.set_key(id.id());
 	control.set_command(DNET_CMD_READ_NEW);
 	control.set_cflags(orig_sess.get_cflags() | DNET_FLAGS_NEED_ACK);
 
-	async_read_result result(orig_sess);
 	auto handler = std::make_shared<read_handler>(orig_sess, result, id);
 	handler->start(std::move(groups), control.get_native(), request);
 	return result;
@@ -466,7 +557,7 @@ async_read_result session::read_json(const key &id) {
 	dnet_current_time(&request.deadline);
 	request.deadline.tsec += get_timeout();
 
-	return send_read(*this, id, request, std::move(groups));
+	return send_read(*this, id, request, std::move(groups), m_data->read_coalescer);
 }
 
 async_read_result session::read_data(const key &id, uint64_t offset, uint64_t size) {
@@ -485,7 +576,7 @@ async_read_result session::read_data(const key &id, uint64_t offset, uint64_t si
 	dnet_current_time(&request.deadline);
 	request.deadline.tsec += get_timeout();
 
-	return send_read(*this, id, request, std::move(groups));
+	return send_read(*this, id, request, std::move(groups), m_data->read_coalescer);
 }
 
 async_read_result session::read(const key &id, uint64_t offset, uint64_t size) {
@@ -504,7 +595,7 @@ async_read_result session::read(const key &id, uint64_t offset, uint64_t size) {
 	dnet_current_time(&request.deadline);
 	request.deadline.tsec += get_timeout();
 
-	return send_read(*this, id, request, std::move(groups));
+	return send_read(*this, id, request, std::move(groups), m_data->read_coalescer);
 }
 
 /* TODO: refactor read_handler/write_handler because they have a lot in common */
@@ -903,6 +994,7 @@ public:
 			                {"type", request.type},
 			                {"flags", request.flags},
 			                {"key_ranges", request.key_ranges.size()},
+			                {"predicate", request.predicate.size()},
 			                {"time_range", [&] {
 				        	std::ostringstream result;
 				        	result << dnet_print_time(&std::get<0>(request.time_range)) << " - "
@@ -971,6 +1063,14 @@ async_iterator_result session::start_iterator(const address &addr, uint32_t back
                                               uint64_t flags,
                                               const std::vector<dnet_iterator_range> &key_ranges,
                                               const std::tuple<dnet_time, dnet_time> &time_range) {
+	return start_iterator(addr, backend_id, flags, key_ranges, time_range, iterator_predicate{});
+}
+
+async_iterator_result session::start_iterator(const address &addr, uint32_t backend_id,
+                                              uint64_t flags,
+                                              const std::vector<dnet_iterator_range> &key_ranges,
+                                              const std::tuple<dnet_time, dnet_time> &time_range,
+                                              const iterator_predicate &predicate) {
 	trace_scope scope{*this};
 	if (key_ranges.empty()) {
 		flags &= ~DNET_IFLAGS_KEY_RANGE;
@@ -984,6 +1084,17 @@ async_iterator_result session::start_iterator(const address &addr, uint32_t back
 		key_ranges,
 		time_range,
 	};
+	request.predicate.reserve(predicate.size());
+	for (const auto &condition : predicate) {
+		request.predicate.emplace_back(dnet_iterator_condition{
+			condition.field,
+			condition.op,
+			condition.value,
+			condition.timestamp,
+			condition.json_key,
+			condition.json_value,
+		});
+	}
 
 	auto packet = serialize(request);
 
@@ -1080,8 +1191,8 @@ public:
 		std::map<remote, std::vector<dnet_raw_id>> remotes_ids;
 		dnet_addr address;
 		int backend_id;
+		m_session.transform(keys);
 		for (const auto &key: keys) {
-			m_session.transform(key);
 			const int err = dnet_lookup_addr(m_session.get_native(), nullptr, 0, &key.id(), src_group,
 			                                 &address, &backend_id);
 			if (err) {
@@ -1467,4 +1578,316 @@ async_read_result session::bulk_read(const std::vector<dnet_id> &keys) {
 	return send_bulk_read(*this, keys, DNET_READ_FLAGS_JSON | DNET_READ_FLAGS_DATA);
 }
 
+/*
+ * Sends reads buffered by read_coalescer within single BULK_READ_NEW and
+ * demultiplexes its replies back to results of the reads
+ */
+class coalesced_read_handler : public std::enable_shared_from_this<coalesced_read_handler> {
+public:
+	explicit coalesced_read_handler(std::vector<coalesced_read> &&reads,
+	                                const std::shared_ptr<read_coalescing_counters> &counters)
+	: m_reads(std::move(reads))
+	, m_replied(m_reads.size(), false)
+	, m_counters(counters) {
+		std::sort(m_reads.begin(), m_reads.end(), [] (const coalesced_read &lhs, const coalesced_read &rhs) {
+			return dnet_id_cmp(&lhs.id, &rhs.id) < 0;
+		});
+	}
+
+	void start(const dnet_addr &addr, uint64_t cflags, uint64_t ioflags, uint64_t read_flags) {
+		std::vector<dnet_id> keys;
+		keys.reserve(m_reads.size());
+
+		dnet_time deadline = m_reads.front().request.deadline;
+		long timeout = 0;
+		for (const auto &read : m_reads) {
+			if (keys.empty() || dnet_id_cmp(&keys.back(), &read.id))
+				keys.emplace_back(read.id);
+			if (dnet_time_cmp(&read.request.deadline, &deadline) > 0)
+				deadline = read.request.deadline;
+			timeout = std::max(timeout, read.sess.get_timeout());
+		}
+
+		m_counters->reads += m_reads.size();
+		m_counters->batches += 1;
+		m_counters->keys += keys.size();
+
+		for (const auto &read : m_reads) {
+			if (read.context) {
+				read.context->add({{"cflags", std::string(dnet_flags_dump_cflags(
+				                                cflags | DNET_FLAGS_NEED_ACK | DNET_FLAGS_NOLOCK))},
+				                   {"bulk_keys", keys.size()},
+				                  });
+			}
+		}
+
+		auto session = m_reads.front().sess.clean_clone();
+		session.set_direct_id(addr);
+		session.set_timeout(timeout);
+
+		std::unique_ptr<dnet_logger> log(session.get_logger());
+		DNET_LOG_INFO(log, "{}: coalesced: address: {}, reads: {}, keys: {}, read_flags: {}, ioflags: {}",
+		              dnet_cmd_string(DNET_CMD_BULK_READ_NEW), dnet_addr_string(&addr), m_reads.size(),
+		              keys.size(), dnet_dump_read_flags(read_flags), dnet_flags_dump_ioflags(ioflags));
+
+		const dnet_bulk_read_request request{
+			std::move(keys),
+			ioflags,
+			read_flags,
+			deadline
+		};
+		const auto packet = serialize(request);
+
+		transport_control control;
+		control.set_command(DNET_CMD_BULK_READ_NEW);
+		control.set_cflags(cflags | DNET_FLAGS_NEED_ACK | DNET_FLAGS_NOLOCK);
+		control.set_data(packet.data(), packet.size());
+
+		async_read_result result(session);
+		auto handler = std::make_shared<single_bulk_read_handler>(result, session, addr);
+		handler->start(control, request);
+
+		result.connect(
+			std::bind(&coalesced_read_handler::process, shared_from_this(), std::placeholders::_1),
+			std::bind(&coalesced_read_handler::complete, shared_from_this(), std::placeholders::_1)
+		);
+	}
+
+private:
+	void process(const read_result_entry &entry) {
+		const auto *cmd = entry.command();
+
+		auto it = std::lower_bound(m_reads.begin(), m_reads.end(), cmd->id,
+			[] (const coalesced_read &read, const dnet_id &id) {
+				return dnet_id_cmp(&read.id, &id) < 0;
+			});
+		for (; it != m_reads.end() && !dnet_id_cmp(&it->id, &cmd->id); ++it) {
+			const auto index = std::distance(m_reads.begin(), it);
+			if (m_replied[index])
+				continue;
+
+			m_replied[index] = true;
+			finish(*it, entry.error(), &entry);
+		}
+	}
+
+	void complete(const error_info &error) {
+		for (size_t i = 0; i < m_reads.size(); ++i) {
+			if (m_replied[i])
+				continue;
+
+			m_replied[i] = true;
+			finish(m_reads[i], error ? error :
+			       create_error(-ENXIO, "coalesced read: no reply for key: %s", dnet_dump_id(&m_reads[i].id)),
+			       nullptr);
+		}
+	}
+
+	/* Reports reply of the first group to the read's result and, if it failed, goes on with the rest of groups
+	 * like ordinary read does
+	 */
+	void finish(coalesced_read &read, const error_info &error, const read_result_entry *entry) {
+		if (entry) {
+			read.handler.process(*entry);
+			add_entry_to_context(read.context, *entry);
+		}
+
+		if (!error || read.groups.size() <= 1) {
+			read.handler.complete(entry ? error_info() : error);
+			read.context.reset(); // drop context to print access log
+			return;
+		}
+
+		++m_counters->failovers;
+		if (read.context)
+			read.context->add({"failover", 1});
+
+		auto handler = read.handler;
+		auto context = std::move(read.context);
+		std::vector<int> groups(read.groups.begin() + 1, read.groups.end());
+		send_read(read.sess, read.id, read.request, std::move(groups)).connect(
+			[handler, context] (const read_result_entry &entry) mutable {
+				handler.process(entry);
+				add_entry_to_context(context, entry);
+			},
+			[handler, context] (const error_info &) mutable {
+				handler.complete(error_info());
+				context.reset(); // drop context to print access log
+			}
+		);
+	}
+
+	static void add_entry_to_context(const std::shared_ptr<dnet_access_context> &context,
+	                                 const read_result_entry &entry) {
+		if (!context)
+			return;
+
+		const auto *cmd = entry.command();
+		context->add({{"group", cmd->id.group_id},
+		              {"status", cmd->status},
+		             });
+		if (!entry.error()) {
+			context->add({{"read_json_size", entry.io_info().json_size},
+			              {"read_data_size", entry.io_info().data_size},
+			             });
+		}
+	}
+
+	std::vector<coalesced_read> m_reads;
+	std::vector<bool> m_replied;
+	std::shared_ptr<read_coalescing_counters> m_counters;
+};
+
+read_coalescer::read_coalescer(size_t max_keys, uint64_t window_us)
+: m_state(std::make_shared<state>(max_keys, window_us))
+, m_flusher(&read_coalescer::flush_expired, m_state) {
+}
+
+read_coalescer::~read_coalescer() {
+	decltype(m_state->batches) batches;
+	{
+		std::lock_guard<std::mutex> guard(m_state->lock);
+		m_state->stop = true;
+		batches.swap(m_state->batches);
+	}
+	m_state->wait.notify_one();
+
+	if (m_flusher.get_id() == std::this_thread::get_id())
+		m_flusher.detach();
+	else
+		m_flusher.join();
+
+	for (auto &pair : batches) {
+		send(m_state, pair.first, std::move(pair.second.reads));
+	}
+}
+
+bool read_coalescer::read(const session &sess, const key &id, const dnet_read_request &request,
+                          const std::vector<int> &groups, const async_read_result &result) {
+	if (groups.empty() || request.data_offset || request.data_size ||
+	    (request.ioflags & (DNET_IO_FLAGS_CACHE | DNET_IO_FLAGS_CACHE_ONLY)) ||
+	    (sess.get_cflags() & (DNET_FLAGS_DIRECT | DNET_FLAGS_DIRECT_BACKEND)))
+		return false;
+
+	/* the read is sent by session which doesn't refer the coalescer, so pending reads don't keep it alive */
+	auto clone = sess.clone();
+	clone.reset_read_coalescing();
+
+	dnet_id raw = id.id();
+	raw.group_id = groups.front();
+
+	batch_key key;
+	memset(&key, 0, sizeof(key));
+	if (dnet_lookup_addr(clone.get_native(), nullptr, 0, &raw, raw.group_id, &key.addr, nullptr))
+		return false;
+	key.cflags = sess.get_cflags();
+	key.ioflags = request.ioflags;
+	key.read_flags = request.read_flags;
+
+	async_result_handler<read_result_entry> handler(result);
+	handler.set_total(1);
+
+	std::shared_ptr<dnet_access_context> context(new dnet_access_context(clone.get_native_node()));
+	context->add({{"cmd", std::string(dnet_cmd_string(DNET_CMD_READ_NEW))},
+	              {"id", std::string(dnet_dump_id_str(raw.id))},
+	              {"access", "client"},
+	              {"coalesced", std::string(dnet_cmd_string(DNET_CMD_BULK_READ_NEW))},
+	              {"ioflags", std::string(dnet_flags_dump_ioflags(request.ioflags))},
+	              {"read_flags", std::string(dnet_dump_read_flags(request.read_flags))},
+	              {"deadline", std::string(dnet_print_time(&request.deadline))},
+	              {"trace_id", to_hex_string(clone.get_trace_id())},
+	             });
+
+	std::vector<coalesced_read> ready;
+	{
+		std::lock_guard<std::mutex> guard(m_state->lock);
+
+		auto &batch = m_state->batches[key];
+		if (batch.reads.empty()) {
+			batch.expires = std::chrono::steady_clock::now() + m_state->window;
+			m_state->wait.notify_one();
+		}
+
+		batch.reads.emplace_back(coalesced_read{std::move(clone), raw, request, groups, handler,
+		                                        std::move(context)});
+		if (batch.reads.size() >= m_state->max_keys) {
+			ready.swap(batch.reads);
+			m_state->batches.erase(key);
+		}
+	}
+
+	send(m_state, key, std::move(ready));
+	return true;
+}
+
+read_coalescing_stats read_coalescer::stats() const {
+	const auto &counters = *m_state->counters;
+
+	read_coalescing_stats ret;
+	ret.reads = counters.reads;
+	ret.batches = counters.batches;
+	ret.keys = counters.keys;
+	ret.failovers = counters.failovers;
+	return ret;
+}
+
+void read_coalescer::flush_expired(const std::shared_ptr<state> &state) {
+	dnet_set_name("dnet_coalescer");
+
+	std::unique_lock<std::mutex> guard(state->lock);
+	while (!state->stop) {
+		const auto now = std::chrono::steady_clock::now();
+		auto next = std::chrono::steady_clock::time_point::max();
+
+		std::vector<std::pair<batch_key, std::vector<coalesced_read>>> expired;
+		for (auto it = state->batches.begin(); it != state->batches.end();) {
+			if (it->second.expires <= now) {
+				expired.emplace_back(it->first, std::move(it->second.reads));
+				it = state->batches.erase(it);
+			} else {
+				next = std::min(next, it->second.expires);
+				++it;
+			}
+		}
+
+		if (!expired.empty()) {
+			guard.unlock();
+			for (auto &pair : expired) {
+				send(state, pair.first, std::move(pair.second));
+			}
+			expired.clear();
+			guard.lock();
+			continue;
+		}
+
+		if (next == std::chrono::steady_clock::time_point::max())
+			state->wait.wait(guard);
+		else
+			state->wait.wait_until(guard, next);
+	}
+}
+
+void read_coalescer::send(const std::shared_ptr<state> &state, const batch_key &key,
+                          std::vector<coalesced_read> &&reads) {
+	if (reads.empty())
+		return;
+
+	auto handler = std::make_shared<coalesced_read_handler>(std::move(reads), state->counters);
+	handler->start(key.addr, key.cflags, key.ioflags, key.read_flags);
+}
+
+void session::set_read_coalescing(size_t max_keys, uint64_t window_us) {
+	m_data->read_coalescer = std::make_shared<read_coalescer>(max_keys, window_us);
+}
+
+void session::reset_read_coalescing() {
+	m_data->read_coalescer.reset();
+}
+
+read_coalescing_stats session::get_read_coalescing_stats() const {
+	if (!m_data->read_coalescer)
+		return read_coalescing_stats{0, 0, 0, 0};
+	return m_data->read_coalescer->stats();
+}
+
 }}} // ioremap::elliptics::newapi
@@ -22,6 +22,10 @@
 
 namespace ioremap { namespace elliptics {
 
+namespace newapi {
+class read_coalescer;
+}
+
 class node_data {
 public:
 	node_data(std::unique_ptr<dnet_logger> logger, std::unique_ptr<dnet_logger> access_logger_)
@@ -59,6 +63,7 @@ public:
 	result_checker checker;
 	result_error_handler error_handler;
 	uint32_t policy;
+	std::shared_ptr<newapi::read_coalescer> read_coalescer;
 };
 
 }} // namespace ioremap::elliptics
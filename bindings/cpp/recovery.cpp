@@ -0,0 +1,588 @@
+#include "elliptics/recovery.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "elliptics/interface.h"
+
+#include "library/logger.hpp"
+
+namespace ioremap { namespace elliptics { namespace recovery {
+
+merge_config::merge_config()
+: group(0)
+, one_node(false)
+, timestamp{0, 0}
+, batch_size(1024)
+, max_pending_batches(16)
+, iterator_threads(1)
+, sender_threads(4)
+, attempts(1)
+, safe(false)
+, dry_run(false)
+, timeout(60)
+, trace_id(0) {
+}
+
+namespace {
+
+typedef std::pair<address, uint32_t> backend_address;
+
+static std::string backend_prefix(const backend_address &backend) {
+	return "node_" + backend.first.to_string_with_family() + "/" + std::to_string(backend.second);
+}
+
+static std::string raw_id_string(const dnet_raw_id &id) {
+	char buffer[2 * DNET_ID_SIZE + 1] = {0};
+	return dnet_dump_id_len_raw(id.id, DNET_ID_SIZE, buffer);
+}
+
+struct raw_id_less {
+	bool operator ()(const dnet_raw_id &lhs, const dnet_raw_id &rhs) const {
+		return dnet_id_cmp_str(lhs.id, rhs.id) < 0;
+	}
+};
+
+/*
+ * Queue with limited capacity: push() blocks while the queue is full,
+ * pop() blocks while the queue is empty and not closed.
+ */
+template <typename T>
+class bounded_queue {
+public:
+	explicit bounded_queue(size_t limit)
+	: m_limit(std::max<size_t>(1, limit))
+	, m_closed(false) {
+	}
+
+	void push(T item) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_not_full.wait(lock, [this] () { return m_items.size() < m_limit; });
+		m_items.emplace_back(std::move(item));
+		m_not_empty.notify_one();
+	}
+
+	// returns false if the queue is closed and empty
+	bool pop(T &item) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_not_empty.wait(lock, [this] () { return !m_items.empty() || m_closed; });
+		if (m_items.empty())
+			return false;
+
+		item = std::move(m_items.front());
+		m_items.pop_front();
+		m_not_full.notify_one();
+		return true;
+	}
+
+	void close() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_not_empty.notify_all();
+	}
+
+private:
+	const size_t m_limit;
+	bool m_closed;
+	std::deque<T> m_items;
+	std::mutex m_mutex;
+	std::condition_variable m_not_full;
+	std::condition_variable m_not_empty;
+};
+
+/*
+ * DHT ring of one group built from the route list.
+ */
+class group_ring {
+public:
+	group_ring(std::vector<dnet_route_entry> routes, int group) {
+		routes.erase(std::remove_if(routes.begin(), routes.end(),
+		                            [group] (const dnet_route_entry &route) {
+			                            return route.group_id != group;
+		                            }),
+		             routes.end());
+		std::sort(routes.begin(), routes.end(), [] (const dnet_route_entry &lhs, const dnet_route_entry &rhs) {
+			return dnet_id_cmp_str(lhs.id.id, rhs.id.id) < 0;
+		});
+		m_routes = std::move(routes);
+
+		for (const auto &route : m_routes) {
+			const backend_address backend{address(route.addr), route.backend_id};
+			if (std::find(m_backends.begin(), m_backends.end(), backend) == m_backends.end())
+				m_backends.push_back(backend);
+		}
+	}
+
+	const std::vector<backend_address> &backends() const {
+		return m_backends;
+	}
+
+	// the key belongs to the route with the greatest id which is not greater than the key
+	bool owns(const backend_address &backend, const dnet_raw_id &key) const {
+		auto it = std::upper_bound(m_routes.begin(), m_routes.end(), key,
+		                           [] (const dnet_raw_id &id, const dnet_route_entry &route) {
+			                           return dnet_id_cmp_str(id.id, route.id.id) < 0;
+		                           });
+		const auto &route = (it == m_routes.begin()) ? m_routes.back() : *(it - 1);
+		return route.backend_id == backend.second && address(route.addr) == backend.first;
+	}
+
+	// returns id which can be used for sending commands to @backend
+	dnet_id route_id(const backend_address &backend) const {
+		dnet_id id;
+		memset(&id, 0, sizeof(id));
+		for (const auto &route : m_routes) {
+			if (route.backend_id == backend.second && address(route.addr) == backend.first) {
+				dnet_setup_id(&id, route.group_id, route.id.id);
+				break;
+			}
+		}
+		return id;
+	}
+
+	// returns key ranges which don't belong to @backend
+	std::vector<dnet_iterator_range> foreign_ranges(const backend_address &backend) const {
+		std::vector<dnet_iterator_range> ranges;
+		if (m_routes.empty())
+			return ranges;
+
+		dnet_raw_id begin;
+		memset(begin.id, 0, sizeof(begin.id));
+		/* keys less than the first route belong to the last one */
+		bool foreign = !is_backend(m_routes.back(), backend);
+
+		for (const auto &route : m_routes) {
+			const bool route_foreign = !is_backend(route, backend);
+			if (route_foreign == foreign)
+				continue;
+
+			if (foreign)
+				ranges.push_back(make_range(begin, route.id));
+			begin = route.id;
+			foreign = route_foreign;
+		}
+
+		if (foreign) {
+			dnet_raw_id end;
+			memset(end.id, 0xff, sizeof(end.id));
+			ranges.push_back(make_range(begin, end));
+		}
+
+		return ranges;
+	}
+
+private:
+	static bool is_backend(const dnet_route_entry &route, const backend_address &backend) {
+		return route.backend_id == backend.second && address(route.addr) == backend.first;
+	}
+
+	static dnet_iterator_range make_range(const dnet_raw_id &begin, const dnet_raw_id &end) {
+		dnet_iterator_range range;
+		range.key_begin = begin;
+		range.key_end = end;
+		return range;
+	}
+
+	std::vector<dnet_route_entry> m_routes;
+	std::vector<backend_address> m_backends;
+};
+
+/*
+ * Keys which couldn't be moved by copy iterator from @source.
+ */
+struct key_batch {
+	backend_address source;
+	std::vector<dnet_raw_id> keys;
+};
+
+struct key_response {
+	int status;
+	backend_address backend;
+};
+
+typedef std::map<dnet_raw_id, std::vector<key_response>, raw_id_less> key_responses;
+
+/*
+ * Merge recovery pipeline: iterator threads run copy iterators over foreign ranges of source backends
+ * and push batches of keys which weren't moved into bounded queue, sender threads pop batches and
+ * recover them by server-send from every backend like ServerSendRecovery from types/merge.py does.
+ */
+class merge_recovery {
+public:
+	merge_recovery(const session &sess, const merge_config &config, stats_sink &stats)
+	: m_session(sess.clean_clone())
+	, m_config(config)
+	, m_stats(stats)
+	, m_ring(m_session.get_routes(), config.group)
+	, m_batch_size(std::max<size_t>(1, config.batch_size))
+	, m_next_source(0)
+	, m_batches(config.max_pending_batches)
+	, m_result(true) {
+		m_session.set_groups({m_config.group});
+		m_session.set_trace_id(m_config.trace_id);
+		m_session.set_exceptions_policy(session::no_exceptions);
+
+		// filtered recovery with no matched backends recovers nothing, not the whole group
+		m_sources = (m_config.backends.empty() && !m_config.one_node) ? m_ring.backends() : m_config.backends;
+		m_senders = m_config.one_node ? m_sources : m_ring.backends();
+
+		if (!m_config.corrupted_keys_path.empty())
+			m_corrupted_keys.open(m_config.corrupted_keys_path, std::ios::app);
+	}
+
+	bool run() {
+		auto log = m_session.get_logger();
+
+		if (m_ring.backends().size() < 2) {
+			DNET_LOG_ERROR(log, "merge recovery: group {} hasn't enough backends for recovery: {}",
+			               m_config.group, m_ring.backends().size());
+			return true;
+		}
+
+		if (m_sources.empty()) {
+			DNET_LOG_WARNING(log, "merge recovery: group {} has no backends matched for recovery", m_config.group);
+			return true;
+		}
+
+		DNET_LOG_INFO(log, "merge recovery: group: {}, sources: {}, senders: {}",
+		              m_config.group, m_sources.size(), m_senders.size());
+
+		std::vector<std::thread> senders;
+		for (size_t i = 0; i < std::max<size_t>(1, m_config.sender_threads); ++i)
+			senders.emplace_back(&merge_recovery::send_batches, this);
+
+		std::vector<std::thread> iterators;
+		for (size_t i = 0; i < std::max<size_t>(1, m_config.iterator_threads); ++i)
+			iterators.emplace_back(&merge_recovery::iterate_sources, this);
+
+		for (auto &thread : iterators)
+			thread.join();
+
+		m_batches.close();
+		for (auto &thread : senders)
+			thread.join();
+
+		return m_result;
+	}
+
+private:
+	void iterate_sources() {
+		for (size_t index = m_next_source++; index < m_sources.size(); index = m_next_source++) {
+			if (!iterate_source(m_sources[index]))
+				m_result = false;
+		}
+	}
+
+	bool iterate_source(const backend_address &source) {
+		auto log = m_session.get_logger();
+		const auto prefix = backend_prefix(source);
+
+		m_stats.timer(prefix, "process", "started");
+		m_stats.timer(prefix, "process", "iterate");
+
+		const auto ranges = m_ring.foreign_ranges(source);
+		if (ranges.empty()) {
+			DNET_LOG_INFO(log, "merge recovery: {}: no foreign ranges, skipping", prefix);
+			m_stats.timer(prefix, "process", "finished");
+			return true;
+		}
+
+		std::ofstream dump;
+		if (!m_config.tmp_dir.empty()) {
+			dump.open(m_config.tmp_dir + "/dump_" + source.first.to_string_with_family() + "." +
+			          std::to_string(source.second));
+		}
+
+		const dnet_time time_end{UINT64_MAX, UINT64_MAX};
+		const uint64_t flags = DNET_IFLAGS_KEY_RANGE | DNET_IFLAGS_TS_RANGE | DNET_IFLAGS_MOVE;
+
+		auto sess = m_session.clone();
+		auto async = sess.start_copy_iterator(m_ring.route_id(source), ranges, flags,
+		                                      m_config.timestamp, time_end, {m_config.group});
+
+		const auto start = std::chrono::steady_clock::now();
+		uint64_t iterated_keys = 0, total_keys = 0;
+		int64_t positive = 0, negative = 0;
+		// parts of @positive and @negative already added to recovered_keys
+		int64_t reported_positive = 0, reported_negative = 0;
+		std::map<int, int64_t> statuses;
+		key_batch batch{source, {}};
+
+		auto update_stats = [&] () {
+			const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start).count();
+			m_stats.set_counter(prefix, "recovery_speed", elapsed ? iterated_keys * 1000 / elapsed : 0);
+			/* recovered_keys is also incremented by server-send of the backend's keys, so it is only accumulated */
+			for (const auto &value : {positive - reported_positive, reported_negative - negative}) {
+				if (value) {
+					m_stats.counter(prefix, "recovered_keys", value);
+					m_stats.counter("", "recovered_keys", value);
+				}
+			}
+			reported_positive = positive;
+			reported_negative = negative;
+			m_stats.set_counter(prefix, "total_keys", total_keys);
+
+			for (const auto &status : statuses)
+				m_stats.counter("commands", "iterate." + std::to_string(status.first), status.second);
+			statuses.clear();
+		};
+
+		for (const auto &entry : async) {
+			if (entry.status() != 0)
+				continue;
+
+			const auto reply = entry.reply();
+			const int status = reply->status;
+			const dnet_raw_id key = reply->key;
+			iterated_keys = reply->iterated_keys;
+			total_keys = reply->total_keys;
+
+			if (status == 0) {
+				++positive;
+			} else {
+				++negative;
+				++statuses[status];
+
+				DNET_LOG_ERROR(log, "merge recovery: {}: key recovery failed: {}, key: {}",
+				               prefix, status, raw_id_string(key));
+				if (dump.is_open())
+					dump << raw_id_string(key) << '\n';
+
+				batch.keys.push_back(key);
+				if (batch.keys.size() >= m_batch_size) {
+					m_batches.push(std::move(batch));
+					batch = key_batch{source, {}};
+				}
+			}
+
+			if ((positive + negative) % m_batch_size == 0)
+				update_stats();
+		}
+		update_stats();
+
+		if (!batch.keys.empty())
+			m_batches.push(std::move(batch));
+
+		const auto error = async.error();
+		if (error) {
+			DNET_LOG_ERROR(log, "merge recovery: {}: iteration failed: {}", prefix, error.message());
+			m_stats.set_counter(prefix, "iterations", -1);
+			m_stats.timer(prefix, "process", "finished");
+			return false;
+		}
+
+		DNET_LOG_INFO(log, "merge recovery: {}: iterated: {}, not moved: {}", prefix, iterated_keys, negative);
+		m_stats.set_counter(prefix, "iterations", 1);
+		m_stats.timer(prefix, "process", "finished");
+		return true;
+	}
+
+	void send_batches() {
+		key_batch batch;
+		while (m_batches.pop(batch)) {
+			if (!recover(batch))
+				m_result = false;
+		}
+	}
+
+	/*
+	 * Tries to recover keys from every backend via server-send.
+	 * Then it removes keys with older timestamp or invalid checksum.
+	 * Returns false if some key was not recovered.
+	 */
+	bool recover(const key_batch &batch) {
+		const auto prefix = backend_prefix(batch.source);
+
+		key_responses responses;
+		for (const auto &key : batch.keys)
+			responses[key];
+
+		for (const auto &backend : m_senders) {
+			std::vector<dnet_raw_id> candidates;
+			for (const auto &key : batch.keys) {
+				if (!m_ring.owns(backend, key))
+					candidates.push_back(key);
+			}
+
+			for (int attempt = 0; attempt < m_config.attempts && !candidates.empty(); ++attempt)
+				candidates = server_send(prefix, candidates, backend, responses);
+
+			if (!candidates.empty()) {
+				m_stats.counter(prefix, "recovered_keys", -static_cast<int64_t>(candidates.size()));
+				m_stats.counter("", "recovered_keys", -static_cast<int64_t>(candidates.size()));
+			}
+		}
+
+		remove_bad_keys(responses);
+
+		for (const auto &key : responses) {
+			for (const auto &response : key.second) {
+				if (response.status < 0 && response.status != -ENOENT && !is_bad_key(response))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * Calls server-send with a given list of keys to the specific backend.
+	 * Returns list of timed out keys.
+	 */
+	std::vector<dnet_raw_id> server_send(const std::string &prefix, const std::vector<dnet_raw_id> &keys,
+	                                     const backend_address &backend, key_responses &responses) {
+		auto log = m_session.get_logger();
+		DNET_LOG_DEBUG(log, "merge recovery: server-send: {}, num keys: {}", backend_prefix(backend), keys.size());
+
+		if (m_config.dry_run)
+			return {};
+
+		auto sess = m_session.clone();
+		sess.set_filter(filters::all);
+		sess.set_timeout(m_config.timeout);
+		sess.set_direct_id(backend.first, backend.second);
+
+		const uint64_t flags = m_config.safe ? 0 : DNET_IFLAGS_MOVE;
+		auto async = sess.server_send(keys, flags, {m_config.group});
+
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<dnet_raw_id> timeouted_keys;
+		std::map<int, int64_t> statuses;
+		int64_t recovered = 0, failed = 0;
+		size_t processed = 0;
+
+		for (const auto &entry : async) {
+			const auto reply = entry.reply();
+			if (!reply)
+				continue;
+
+			++processed;
+			const int status = reply->status;
+			const dnet_raw_id key = reply->key;
+
+			if (status)
+				++statuses[status];
+
+			if (status == -ETIMEDOUT) {
+				timeouted_keys.push_back(key);
+				continue;
+			}
+
+			status ? ++failed : ++recovered;
+			responses[key].push_back(key_response{status, backend});
+		}
+
+		if (processed == 0) {
+			DNET_LOG_ERROR(log, "merge recovery: server-send operation failed: {}", backend_prefix(backend));
+			timeouted_keys = keys;
+		}
+
+		const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start).count();
+		m_stats.set_counter(prefix, "recovery_speed", elapsed ? processed * 1000 / elapsed : 0);
+		for (const auto &status : statuses)
+			m_stats.counter("commands", "server_send." + std::to_string(status.first), status.second);
+		for (const auto &value : {recovered, -failed}) {
+			if (value) {
+				m_stats.counter(prefix, "recovered_keys", value);
+				m_stats.counter("", "recovered_keys", value);
+			}
+		}
+
+		return timeouted_keys;
+	}
+
+	static bool is_bad_key(const key_response &response) {
+		return response.status == -EBADFD || response.status == -EILSEQ;
+	}
+
+	/*
+	 * Removes invalid keys with older timestamp or invalid checksum.
+	 */
+	void remove_bad_keys(const key_responses &responses) {
+		auto log = m_session.get_logger();
+
+		std::vector<std::pair<dnet_raw_id, backend_address>> bad_keys;
+		for (const auto &key : responses) {
+			for (const auto &response : key.second) {
+				if (!is_bad_key(response))
+					continue;
+
+				bad_keys.emplace_back(key.first, response.backend);
+				if (response.status == -EILSEQ && m_corrupted_keys.is_open()) {
+					std::lock_guard<std::mutex> guard(m_corrupted_keys_mutex);
+					m_corrupted_keys << raw_id_string(key.first) << ' ' << m_config.group << ' '
+					                 << response.backend.first.to_string_with_family() << '/'
+					                 << response.backend.second << '\n';
+					m_corrupted_keys.flush();
+				}
+			}
+		}
+
+		for (int attempt = 0; attempt < m_config.attempts && !bad_keys.empty(); ++attempt) {
+			std::vector<async_remove_result> results;
+			results.reserve(bad_keys.size());
+
+			for (const auto &bad_key : bad_keys) {
+				auto sess = m_session.clone();
+				sess.set_filter(filters::all_final);
+				sess.set_timeout(m_config.timeout);
+				sess.set_direct_id(bad_key.second.first, bad_key.second.second);
+
+				dnet_id id;
+				memset(&id, 0, sizeof(id));
+				dnet_setup_id(&id, m_config.group, bad_key.first.id);
+				results.emplace_back(sess.remove(id));
+			}
+
+			decltype(bad_keys) timeouted_keys;
+			for (size_t i = 0; i < results.size(); ++i) {
+				results[i].wait();
+				const int status = results[i].error().code();
+
+				DNET_LOG_INFO(log, "merge recovery: removing key: {} from {}, status: {}, last attempt: {}",
+				              raw_id_string(bad_keys[i].first), backend_prefix(bad_keys[i].second), status,
+				              attempt == m_config.attempts - 1);
+
+				if (status)
+					m_stats.counter("commands", "remove." + std::to_string(status), 1);
+				if (status == -ETIMEDOUT)
+					timeouted_keys.push_back(bad_keys[i]);
+			}
+			bad_keys.swap(timeouted_keys);
+		}
+	}
+
+	session m_session;
+	const merge_config &m_config;
+	stats_sink &m_stats;
+	const group_ring m_ring;
+	const size_t m_batch_size;
+
+	std::vector<backend_address> m_sources;
+	std::vector<backend_address> m_senders;
+	std::atomic<size_t> m_next_source;
+
+	bounded_queue<key_batch> m_batches;
+	std::atomic<bool> m_result;
+
+	std::mutex m_corrupted_keys_mutex;
+	std::ofstream m_corrupted_keys;
+};
+
+} /* namespace */
+
+bool run_merge_recovery(const session &sess, const merge_config &config, stats_sink &stats) {
+	merge_recovery recovery(sess, config, stats);
+	return recovery.run();
+}
+
+}}} /* namespace ioremap::elliptics::recovery */
@@ -360,6 +360,7 @@ session_data::session_data(session_data &other)
 , checker(other.checker)
 , error_handler(other.error_handler)
 , policy(other.policy)
+, read_coalescer(other.read_coalescer)
 {
 	session_ptr = dnet_session_copy(other.session_ptr);
 	if (!session_ptr)
@@ -1335,6 +1336,11 @@ void session::transform(const key &id) const
 	id.transform(*this);
 }
 
+void session::transform(const std::vector<key> &keys) const
+{
+	key::transform(*this, keys);
+}
+
 class lookup_handler : public multigroup_handler<lookup_handler, lookup_result_entry>
 {
 public:
@@ -2438,13 +2444,8 @@ async_iterator_result session::server_send(const std::vector<dnet_raw_id> &ids,
 async_iterator_result session::server_send(const std::vector<std::string> &strs, uint64_t iflags, const std::vector<int> &groups)
 {
 	trace_scope scope{*this};
-	std::vector<key> keys;
-	for (auto s = strs.begin(), send = strs.end(); s != send; ++s) {
-		key k(*s);
-		k.transform(*this);
-
-		keys.emplace_back(k);
-	}
+	std::vector<key> keys(strs.begin(), strs.end());
+	transform(keys);
 
 	return server_send(keys, iflags, groups);
 }
@@ -2634,11 +2635,18 @@ async_read_result session::bulk_read(const std::vector<std::string> &keys)
 
 	ios.reserve(keys.size());
 
-	for (size_t i = 0; i < keys.size(); ++i) {
-		dnet_id id;
+	std::vector<iovec> names;
+	names.reserve(keys.size());
+	for (const auto &name : keys) {
+		names.push_back(iovec{const_cast<char *>(name.data()), name.size()});
+	}
 
-		transform(keys[i], id);
-		memcpy(io.id, id.id, sizeof(io.id));
+	std::vector<dnet_raw_id> ids(keys.size());
+	dnet_transform_raw_batch(m_data->session_ptr, names.data(), names.size(),
+	                         reinterpret_cast<char *>(ids.data()), sizeof(ids.front().id));
+
+	for (size_t i = 0; i < keys.size(); ++i) {
+		memcpy(io.id, ids[i].id, sizeof(io.id));
 		ios.push_back(io);
 	}
 
@@ -2656,9 +2664,8 @@ async_read_result session::bulk_read(const std::vector<key> &keys)
 
 	ios.reserve(keys.size());
 
+	transform(keys);
 	for (size_t i = 0; i < keys.size(); ++i) {
-		transform(keys[i]);
-
 		memcpy(io.id, keys[i].id().id, sizeof(io.id));
 		ios.push_back(io);
 	}
@@ -78,11 +78,46 @@ typename python_async_result<T>::iterator python_async_result<T>::iterator::oper
 	return tmp;
 }
 
+/*
+ * Defines methods which make sense only for some types of results
+ */
+template <typename T>
+struct def_async_result_extras {
+	static void init(bp::class_<python_async_result<T>> &) {}
+};
+
+template <typename T>
+struct def_iterator_result_extras {
+	static void init(bp::class_<python_async_result<T>> &result) {
+		result
+			.def("connect_container", &python_async_result<T>::connect_container,
+			     (bp::arg("container"), bp::arg("final_handler")),
+			     "connect_container(container, final_handler)\n"
+			     "    Appends iterated records with zero status to elliptics.core.newapi.IteratorResultContainer\n"
+			     "    natively without passing them to python. The container shouldn't be used\n"
+			     "    until final_handler is called, it is flushed right before final_handler is called\n"
+			     "    so its file already contains all appended records there.\n\n"
+			     "    def fhandler(error):\n"
+			     "        print 'Iterated {0} keys, error: {1}'\n"
+			     "              .format(len(container), error)\n"
+			     "    async_result.connect_container(container, fhandler)")
+		;
+	}
+};
+
+template <>
+struct def_async_result_extras<iterator_result_entry> : def_iterator_result_extras<iterator_result_entry> {};
+
+template <>
+struct def_async_result_extras<newapi::iterator_result_entry> : def_iterator_result_extras<newapi::iterator_result_entry> {};
+
 template <typename T>
 struct def_async_result<T> {
 	static void init() {
-		bp::class_<python_async_result<T>>(
-		        "AsyncResult", "Future for waiting/getting results from asynchronous execution of operation")
+		bp::class_<python_async_result<T>> result(
+		        "AsyncResult", "Future for waiting/getting results from asynchronous execution of operation");
+
+		result
 			.def("__iter__", bp::iterator<python_async_result<T>>(),
 			     "x.__iter__() <==> iter(x)\n"
 			     "    Allows iterates though the operation results.\n"
@@ -164,6 +199,24 @@ struct def_async_result<T> {
 			     "            print 'The operation results: {0}'\n"
 			     "                  .format(results)\n"
 			     "    async_result.connect(handler)")
+			.def("connect_batch", &python_async_result<T>::connect_batch,
+			     (bp::arg("result_handler"), bp::arg("final_handler"),
+			      bp::arg("count") = 1000, bp::arg("window") = 0.1),
+			     "connect_batch(result_handler, final_handler, count=1000, window=0.1)\n"
+			     "    Sets callbacks which receive results by batches:\n"
+			     "        result_handler will be called with list of results when @count results\n"
+			     "        are accumulated or @window seconds are passed since the first result of the batch\n"
+			     "        (the window is checked when results arrive, 0 disables it)\n"
+			     "        final_handler will be called once after all results\n"
+			     "    It's much faster than connect() for operations with many results\n"
+			     "    (iterators, bulk reads) since GIL is acquired once per batch.\n\n"
+			     "    def rhandler(results):\n"
+			     "        for result in results:\n"
+			     "            print 'The operation result:', result\n"
+			     "    def fhandler(error):\n"
+			     "        print 'The operation completed: {0}'\n"
+			     "              .format(error)\n"
+			     "    async_result.connect_batch(rhandler, fhandler, count=100)")
 			.def("error", get_async_result_error<T>,
 			     "error()\n"
 			     "     Returns error information about operation failure\n"
@@ -176,6 +229,8 @@ struct def_async_result<T> {
 			     "         print 'The operation results: {0}'\n"
 			     "               .format(results)\n")
 		;
+
+		def_async_result_extras<T>::init(result);
 	}
 };
 
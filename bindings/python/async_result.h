@@ -16,6 +16,10 @@
 #ifndef ELLIPTICS_PYTHON_ASYNC_RESULTS_HPP
 #define ELLIPTICS_PYTHON_ASYNC_RESULTS_HPP
 
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
 #include <boost/python/list.hpp>
 #include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
@@ -89,6 +93,162 @@ struct callback_one_handlers {
 	std::unique_ptr<bp::api::object> final_handler;
 };
 
+/*
+ * Accumulates results and passes them to python by lists, so GIL is acquired once per batch instead of once per result.
+ * The batch is delivered when @count results are accumulated or @window seconds are passed since the first result
+ * of the batch has been received. The window is checked when results arrive, so the tail of results is delivered
+ * right before the final handler is called.
+ */
+template <typename T>
+struct callback_batch_handlers {
+	ELLIPTICS_DISABLE_COPY(callback_batch_handlers)
+
+	callback_batch_handlers(bp::api::object &result, bp::api::object &final, size_t count, double window)
+	: count(std::max<size_t>(count, 1))
+	, window(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(window))) {
+		result_handler.reset(new bp::api::object(result));
+		final_handler.reset(new bp::api::object(final));
+		results.reserve(this->count);
+	}
+
+	~callback_batch_handlers() {
+		gil_guard gstate;
+		result_handler.reset();
+		final_handler.reset();
+	}
+
+	void on_result(const T &result) {
+		const auto now = std::chrono::steady_clock::now();
+		std::vector<T> batch;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (results.empty())
+				batch_start = now;
+
+			results.push_back(result);
+			if (results.size() < count && (window == window.zero() || now - batch_start < window))
+				return;
+
+			batch.reserve(count);
+			batch.swap(results);
+		}
+
+		gil_guard gstate;
+		deliver(batch);
+	}
+
+	void on_final(const error_info &err) {
+		std::vector<T> batch;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			batch.swap(results);
+		}
+
+		gil_guard gstate;
+		if (!batch.empty())
+			deliver(batch);
+
+		try {
+			(*final_handler)(error(err.code(), err.message()));
+		} catch (const bp::error_already_set& e) {}
+	}
+
+	void deliver(const std::vector<T> &batch) {
+		try {
+			(*result_handler)(convert_to_list(batch));
+		} catch (const bp::error_already_set& e) {}
+	}
+
+	const size_t count;
+	const std::chrono::steady_clock::duration window;
+
+	std::mutex lock;
+	std::vector<T> results;
+	std::chrono::steady_clock::time_point batch_start;
+
+	std::unique_ptr<bp::api::object> result_handler;
+	std::unique_ptr<bp::api::object> final_handler;
+};
+
+/*
+ * Appends iterated records with zero status to iterator result container natively, python isn't entered
+ * until the final handler is called. The container shouldn't be used from python before that,
+ * it is flushed right before the final handler is called.
+ */
+static inline void append_to_container(newapi::iterator_result_container &container,
+                                       const newapi::iterator_result_entry &result) {
+	if (result.status() == 0)
+		container.append(result);
+}
+
+static inline void append_to_container(newapi::iterator_result_container &container,
+                                       const iterator_result_entry &result) {
+	if (result.reply()->status == 0)
+		container.append_old(result);
+}
+
+template <typename T>
+struct callback_container_handlers {
+	ELLIPTICS_DISABLE_COPY(callback_container_handlers)
+
+	callback_container_handlers(bp::api::object &container, bp::api::object &final)
+	: container(bp::extract<newapi::iterator_result_container &>(container)) {
+		container_object.reset(new bp::api::object(container));
+		final_handler.reset(new bp::api::object(final));
+	}
+
+	~callback_container_handlers() {
+		gil_guard gstate;
+		container_object.reset();
+		final_handler.reset();
+	}
+
+	void on_result(const T &result) {
+		if (result.error() || !result.is_valid())
+			return;
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (append_error)
+			return;
+
+		try {
+			append_to_container(container, result);
+		} catch (const error &e) {
+			append_error = error_info(e.error_code(), e.error_message());
+		}
+	}
+
+	void on_final(const error_info &err) {
+		error_info final_error = err;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (!append_error) {
+				// the container is handed to python, so its file should contain all appended records
+				try {
+					container.flush();
+				} catch (const error &e) {
+					append_error = error_info(e.error_code(), e.error_message());
+				}
+			}
+			if (!final_error)
+				final_error = append_error;
+		}
+
+		gil_guard gstate;
+		try {
+			(*final_handler)(error(final_error.code(), final_error.message()));
+		} catch (const bp::error_already_set& e) {}
+	}
+
+	newapi::iterator_result_container &container;
+
+	std::mutex lock;
+	error_info append_error;
+
+	std::unique_ptr<bp::api::object> container_object;
+	std::unique_ptr<bp::api::object> final_handler;
+};
+
 template <typename T>
 struct python_async_result {
 	class iterator : public std::iterator<std::input_iterator_tag, T, std::ptrdiff_t, T *, T> {
@@ -173,6 +333,18 @@ struct python_async_result {
 		scope->connect(boost::bind(&callback_all_handler<T>::on_results, callback, _1, _2));
 	}
 
+	void connect_batch(bp::api::object &result_handler, bp::api::object &final_handler, size_t count, double window) {
+		auto callback = boost::make_shared<callback_batch_handlers<T>>(result_handler, final_handler, count, window);
+		scope->connect(boost::bind(&callback_batch_handlers<T>::on_result, callback, _1),
+		               boost::bind(&callback_batch_handlers<T>::on_final, callback, _1));
+	}
+
+	void connect_container(bp::api::object &container, bp::api::object &final_handler) {
+		auto callback = boost::make_shared<callback_container_handlers<T>>(container, final_handler);
+		scope->connect(boost::bind(&callback_container_handlers<T>::on_result, callback, _1),
+		               boost::bind(&callback_container_handlers<T>::on_final, callback, _1));
+	}
+
 	std::shared_ptr<async_result<T>> scope;
 };
 
@@ -0,0 +1,78 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# =============================================================================
+# This file is part of Elliptics.
+#
+# Elliptics is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Elliptics is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+# =============================================================================
+
+"""
+Measures throughput of writing and reading large objects via python bindings:
+writes from str and from bytearray/memoryview (without copying),
+reads via result.data (copied into str) and via result.data_view (memoryview without copying).
+"""
+
+import argparse
+import os
+import time
+
+import elliptics
+
+
+def measure(func, size, iterations):
+    start = time.time()
+    for _ in xrange(iterations):
+        func()
+    elapsed = time.time() - start
+    return size * iterations / elapsed / (1 << 20)
+
+
+def bench(session, size, iterations):
+    key = 'bench_buffers_{0}'.format(size)
+    data = os.urandom(size)
+    array = bytearray(data)
+
+    write_str = measure(lambda: session.write_data(key, data).wait(), size, iterations)
+    write_buffer = measure(lambda: session.write_data(key, memoryview(array)).wait(), size, iterations)
+
+    read_data = measure(lambda: len(session.read_data(key).get()[0].data), size, iterations)
+    read_view = measure(lambda: len(session.read_data(key).get()[0].data_view), size, iterations)
+
+    print '{0:>4} MB: write str: {1:8.1f} MB/s, write memoryview: {2:8.1f} MB/s, ' \
+          'read data: {3:8.1f} MB/s, read data_view: {4:8.1f} MB/s' \
+          .format(size >> 20, write_str, write_buffer, read_data, read_view)
+
+    session.remove(key).wait()
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Benchmark of python bindings data buffers.')
+    parser.add_argument('remotes', metavar='N', type=str, nargs='+',
+        help='Remote nodes to connect. Format: addr:port:family, where family = 2 for ipv4 and 10 for ipv6')
+    parser.add_argument('--groups', default='1', help='comma-separated groups to write to')
+    parser.add_argument('--sizes', default='1,4,16,64', help='comma-separated sizes of objects in megabytes')
+    parser.add_argument('--iterations', type=int, default=10, help='number of iterations for each size')
+    parser.add_argument('--log', default='/dev/stderr', help='log file')
+    parser.add_argument('--log-level', type=int, default=elliptics.log_level.error,
+        help='log level: %d-%d' % (elliptics.log_level.error, elliptics.log_level.debug))
+
+    args = parser.parse_args()
+
+    log = elliptics.Logger(args.log, args.log_level)
+    n = elliptics.Node(log)
+    n.add_remotes(args.remotes)
+
+    s = elliptics.Session(n)
+    s.groups = [int(g) for g in args.groups.split(',')]
+
+    for size in args.sizes.split(','):
+        bench(s, int(size) << 20, args.iterations)
@@ -0,0 +1,114 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data_buffer.h"
+
+#include <new>
+
+namespace bp = boost::python;
+
+namespace ioremap { namespace elliptics { namespace python {
+
+/*
+ * Python object which owns a reference to data_pointer and exports it via buffer protocol,
+ * memoryviews are built on top of it
+ */
+struct data_buffer_object {
+	PyObject_HEAD
+	data_pointer data;
+};
+
+static PyTypeObject data_buffer_type;
+
+static PyBufferProcs data_buffer_procs;
+
+static int data_buffer_getbuffer(PyObject *self, Py_buffer *view, int flags) {
+	static char empty[1];
+	auto &data = reinterpret_cast<data_buffer_object *>(self)->data;
+
+	void *buffer = data.size() ? data.data() : empty;
+	return PyBuffer_FillInfo(view, self, buffer, data.size(), 1, flags);
+}
+
+static void data_buffer_dealloc(PyObject *self) {
+	reinterpret_cast<data_buffer_object *>(self)->data.~data_pointer();
+	PyObject_Del(self);
+}
+
+bp::object data_pointer_view(const data_pointer &data) {
+	auto object = PyObject_New(data_buffer_object, &data_buffer_type);
+	if (!object)
+		bp::throw_error_already_set();
+
+	new (&object->data) data_pointer(data);
+	bp::handle<> buffer(reinterpret_cast<PyObject *>(object));
+
+	return bp::object(bp::handle<>(PyMemoryView_FromObject(buffer.get())));
+}
+
+python_data::python_data(const bp::api::object &object)
+: m_has_view(false) {
+	if (PyObject_CheckBuffer(object.ptr())) {
+		if (PyObject_GetBuffer(object.ptr(), &m_view, PyBUF_SIMPLE))
+			bp::throw_error_already_set();
+		m_has_view = true;
+	} else {
+		m_string = bp::extract<std::string>(object);
+	}
+}
+
+python_data::~python_data() {
+	if (m_has_view)
+		PyBuffer_Release(&m_view);
+}
+
+const void *python_data::data() const {
+	return m_has_view ? m_view.buf : m_string.data();
+}
+
+size_t python_data::size() const {
+	return m_has_view ? m_view.len : m_string.size();
+}
+
+argument_data python_data::argument() const {
+	return data_pointer::from_raw(const_cast<void *>(data()), size());
+}
+
+data_pointer python_data::copy() const {
+	return data_pointer::copy(data(), size());
+}
+
+void init_data_buffer() {
+	data_buffer_procs.bf_getbuffer = data_buffer_getbuffer;
+
+	data_buffer_type.tp_name = "elliptics.core.DataBuffer";
+	data_buffer_type.tp_doc = "Read-only buffer of data received from elliptics";
+	data_buffer_type.tp_basicsize = sizeof(data_buffer_object);
+	data_buffer_type.tp_dealloc = data_buffer_dealloc;
+	data_buffer_type.tp_as_buffer = &data_buffer_procs;
+	data_buffer_type.tp_flags = Py_TPFLAGS_DEFAULT;
+#if PY_MAJOR_VERSION < 3
+	data_buffer_type.tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+
+	if (PyType_Ready(&data_buffer_type) < 0)
+		bp::throw_error_already_set();
+	// the type is static, it should never be freed
+	Py_INCREF(&data_buffer_type);
+}
+
+} } } // namespace ioremap::elliptics::python
@@ -0,0 +1,71 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ELLIPTICS_PYTHON_DATA_BUFFER_HPP
+#define ELLIPTICS_PYTHON_DATA_BUFFER_HPP
+
+#include <boost/python.hpp>
+
+#include <elliptics/utils.hpp>
+
+namespace ioremap { namespace elliptics { namespace python {
+
+/*
+ * Returns read-only memoryview of @data without copying it,
+ * the memoryview holds a reference to @data, so the buffer is alive while the memoryview is.
+ */
+boost::python::object data_pointer_view(const data_pointer &data);
+
+/*
+ * Payload of write requests taken from python object without copying:
+ * objects supporting buffer protocol (str/bytes, bytearray, memoryview etc.) are referenced directly,
+ * other objects (e.g. unicode) are converted to std::string.
+ * The object is held and can't be resized until python_data is destroyed,
+ * so it should live until the request has copied the payload into its packet.
+ */
+class python_data {
+public:
+	explicit python_data(const boost::python::api::object &object);
+	~python_data();
+
+	python_data(const python_data &) = delete;
+	python_data &operator=(const python_data &) = delete;
+
+	const void *data() const;
+	size_t size() const;
+
+	/*
+	 * Returns argument referencing the payload, it's valid only while python_data is alive
+	 */
+	argument_data argument() const;
+
+	/*
+	 * Returns copy of the payload which may outlive python_data
+	 */
+	data_pointer copy() const;
+
+private:
+	Py_buffer m_view;
+	bool m_has_view;
+	std::string m_string;
+};
+
+void init_data_buffer();
+
+} } } // namespace ioremap::elliptics::python
+
+#endif // ELLIPTICS_PYTHON_DATA_BUFFER_HPP
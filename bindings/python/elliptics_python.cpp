@@ -35,9 +35,11 @@
 #include "elliptics_id.h"
 #include "async_result.h"
 #include "result_entry.h"
+#include "data_buffer.h"
 #include "elliptics_time.h"
 #include "elliptics_io_attr.h"
 #include "elliptics_session.h"
+#include "elliptics_recovery.h"
 
 namespace bp = boost::python;
 
@@ -56,7 +58,30 @@ enum elliptics_iterator_flags {
 	iflag_no_meta		= DNET_IFLAGS_NO_META,
 	iflags_move		= DNET_IFLAGS_MOVE,
 	iflags_overwrite	= DNET_IFLAGS_OVERWRITE,
-	iflags_json		= DNET_IFLAGS_JSON
+	iflags_json		= DNET_IFLAGS_JSON,
+	iflags_parallel		= DNET_IFLAGS_PARALLEL,
+	iflags_ordered		= DNET_IFLAGS_ORDERED
+};
+
+enum elliptics_iterator_predicate_fields {
+	ipred_field_record_flags	= DNET_IPRED_FIELD_RECORD_FLAGS,
+	ipred_field_user_flags		= DNET_IPRED_FIELD_USER_FLAGS,
+	ipred_field_data_size		= DNET_IPRED_FIELD_DATA_SIZE,
+	ipred_field_json_size		= DNET_IPRED_FIELD_JSON_SIZE,
+	ipred_field_data_timestamp	= DNET_IPRED_FIELD_DATA_TIMESTAMP,
+	ipred_field_json_timestamp	= DNET_IPRED_FIELD_JSON_TIMESTAMP,
+	ipred_field_json		= DNET_IPRED_FIELD_JSON
+};
+
+enum elliptics_iterator_predicate_ops {
+	ipred_op_eq		= DNET_IPRED_OP_EQ,
+	ipred_op_ne		= DNET_IPRED_OP_NE,
+	ipred_op_lt		= DNET_IPRED_OP_LT,
+	ipred_op_le		= DNET_IPRED_OP_LE,
+	ipred_op_gt		= DNET_IPRED_OP_GT,
+	ipred_op_ge		= DNET_IPRED_OP_GE,
+	ipred_op_all_bits	= DNET_IPRED_OP_ALL_BITS,
+	ipred_op_any_bits	= DNET_IPRED_OP_ANY_BITS
 };
 
 enum elliptics_cflags {
@@ -65,7 +90,9 @@ enum elliptics_cflags {
 	cflags_nolock	= DNET_FLAGS_NOLOCK,
 	cflags_checksum = DNET_FLAGS_CHECKSUM,
 	cflags_nocache  = DNET_FLAGS_NOCACHE,
-	cflags_no_queue_timeout	= DNET_FLAGS_NO_QUEUE_TIMEOUT
+	cflags_no_queue_timeout	= DNET_FLAGS_NO_QUEUE_TIMEOUT,
+	cflags_prio_iterator	= DNET_FLAGS_PRIO_ITERATOR,
+	cflags_prio_recovery	= DNET_FLAGS_PRIO_RECOVERY
 };
 
 enum elliptics_ioflags {
@@ -408,7 +435,9 @@ BOOST_PYTHON_MODULE(core) {
 	    "overwrite\n    Overwrite data. If this flag is NOT set, we only write data if remote timestamp is less\n"
 	    "               than in data being written. When NOT set, data will still be transferred over the network,\n"
 	    "               even if remote timestamp doesn't allow us to overwrite data.\n"
-	    "json\n    Iteration results should also includes objects json")
+	    "json\n    Iteration results should also includes objects json\n"
+	    "parallel\n    Backend is iterated by several workers in parallel, results are not ordered\n"
+	    "ordered\n    Used with parallel: results are sent sorted by key")
 		.value("default", iflag_default)
 		.value("data", iflag_data)
 		.value("key_range", iflag_key_range)
@@ -417,6 +446,41 @@ BOOST_PYTHON_MODULE(core) {
 		.value("move", iflags_move)
 		.value("overwrite", iflags_overwrite)
 		.value("json", iflags_json)
+		.value("parallel", iflags_parallel)
+		.value("ordered", iflags_ordered)
+	;
+
+	bp::enum_<elliptics_iterator_predicate_fields>("iterator_predicate_fields",
+	    "Fields of iterated record which can be used in iterator predicate:\n\n"
+	    "record_flags\n    Record flags of the key\n"
+	    "user_flags\n    User-defined flags of the key\n"
+	    "data_size\n    Size of key's data\n"
+	    "json_size\n    Size of key's json\n"
+	    "data_timestamp\n    Timestamp of key's data, compared with elliptics.Time\n"
+	    "json_timestamp\n    Timestamp of key's json, compared with elliptics.Time\n"
+	    "json\n    Top-level member of key's json, supports only eq and ne")
+		.value("record_flags", ipred_field_record_flags)
+		.value("user_flags", ipred_field_user_flags)
+		.value("data_size", ipred_field_data_size)
+		.value("json_size", ipred_field_json_size)
+		.value("data_timestamp", ipred_field_data_timestamp)
+		.value("json_timestamp", ipred_field_json_timestamp)
+		.value("json", ipred_field_json)
+	;
+
+	bp::enum_<elliptics_iterator_predicate_ops>("iterator_predicate_ops",
+	    "Operations which can be used in iterator predicate:\n\n"
+	    "eq, ne, lt, le, gt, ge\n    Compare field with the value\n"
+	    "all_bits\n    All bits of the value are set in the field\n"
+	    "any_bits\n    Any bit of the value is set in the field")
+		.value("eq", ipred_op_eq)
+		.value("ne", ipred_op_ne)
+		.value("lt", ipred_op_lt)
+		.value("le", ipred_op_le)
+		.value("gt", ipred_op_gt)
+		.value("ge", ipred_op_ge)
+		.value("all_bits", ipred_op_all_bits)
+		.value("any_bits", ipred_op_any_bits)
 	;
 
 	bp::enum_<elliptics_iterator_types>("iterator_types",
@@ -436,13 +500,17 @@ BOOST_PYTHON_MODULE(core) {
 	    "            The operation will be handled in separated io thread pool\n"
 	    "checksum\n  Only valid flag for LOOKUP command - when set, return checksum in file_info structure\n"
 	    "nocache\n   Currently only valid flag for LOOKUP command - when set, don't check fileinfo in cache\n"
-	    "no_queue_timeout\n Do not check queue timeout for this operation\n")
+	    "no_queue_timeout\n Do not check queue timeout for this operation\n"
+	    "prio_iterator\n Server will queue the operation in iterator priority class\n"
+	    "prio_recovery\n Server will queue the operation in recovery priority class\n")
 		.value("default", cflags_default)
 		.value("direct", cflags_direct)
 		.value("nolock", cflags_nolock)
 		.value("checksum", cflags_checksum)
 		.value("nocache", cflags_nocache)
 		.value("no_queue_timeout", cflags_no_queue_timeout)
+		.value("prio_iterator", cflags_prio_iterator)
+		.value("prio_recovery", cflags_prio_recovery)
 	;
 
 	bp::enum_<elliptics_ioflags>("io_flags",
@@ -571,10 +639,12 @@ BOOST_PYTHON_MODULE(core) {
 
 	init_elliptics_id();
 	init_async_results();
+	init_data_buffer();
 	init_result_entry();
 	init_elliptics_time();
 	init_elliptics_io_attr();
 	init_elliptics_session();
+	init_elliptics_recovery();
 };
 
 } } } // namespace ioremap::elliptics::python
@@ -0,0 +1,120 @@
+#include "elliptics_recovery.h"
+
+#include <boost/python.hpp>
+
+#include <elliptics/recovery.hpp>
+
+#include "elliptics_time.h"
+#include "gil_guard.h"
+
+namespace bp = boost::python;
+
+namespace ioremap { namespace elliptics { namespace python {
+
+struct python_merge_config : public recovery::merge_config {
+	void add_backend(const std::string &host, int port, int family, uint32_t backend_id) {
+		backends.emplace_back(address(host, port, family), backend_id);
+	}
+
+	elliptics_time get_timestamp() const {
+		return elliptics_time(timestamp);
+	}
+
+	void set_timestamp(const elliptics_time &time) {
+		timestamp = time.m_time;
+	}
+};
+
+/*
+ * Forwards progress of native recovery to elliptics_recovery.monitor.StatsProxy.
+ */
+class python_stats_sink : public recovery::stats_sink {
+public:
+	explicit python_stats_sink(const bp::api::object &stats)
+	: m_stats(stats) {
+	}
+
+	void counter(const std::string &prefix, const std::string &name, int64_t value) override {
+		gil_guard gstate;
+		get(prefix).attr("counter")(name, value);
+	}
+
+	void set_counter(const std::string &prefix, const std::string &name, int64_t value) override {
+		gil_guard gstate;
+		get(prefix).attr("set_counter")(name, value);
+	}
+
+	void timer(const std::string &prefix, const std::string &name, const std::string &milestone) override {
+		gil_guard gstate;
+		get(prefix).attr("timer")(name, milestone);
+	}
+
+private:
+	bp::api::object get(const std::string &prefix) {
+		if (prefix.empty())
+			return m_stats;
+		return m_stats[prefix];
+	}
+
+	bp::api::object m_stats;
+};
+
+static bool merge_recovery(node &n, const python_merge_config &config, const bp::api::object &stats) {
+	session sess(n);
+	python_stats_sink sink(stats);
+
+	py_allow_threads_scoped pythr;
+	return recovery::run_merge_recovery(sess, config, sink);
+}
+
+void init_elliptics_recovery() {
+	bp::class_<python_merge_config>(
+		"MergeRecoveryConfig",
+		"Parameters of native merge recovery, see elliptics.core.merge_recovery",
+		bp::init<>())
+		.def_readwrite("group", &python_merge_config::group,
+		               "Group which should be recovered")
+		.def("add_backend", &python_merge_config::add_backend,
+		     (bp::arg("host"), bp::arg("port"), bp::arg("family"), bp::arg("backend_id")),
+		     "add_backend(host, port, family, backend_id)\n"
+		     "    Adds backend which keys should be moved to proper backends.\n"
+		     "    All backends of the group are processed if no backend was added and one_node is False")
+		.def_readwrite("one_node", &python_merge_config::one_node,
+		               "If True, keys are server-sent only from added backends,\n"
+		               "nothing is recovered if no backend was added")
+		.add_property("timestamp", &python_merge_config::get_timestamp, &python_merge_config::set_timestamp,
+		              "Only keys modified after this elliptics.Time are recovered")
+		.def_readwrite("batch_size", &python_merge_config::batch_size,
+		               "Number of keys server-sent by one command")
+		.def_readwrite("max_pending_batches", &python_merge_config::max_pending_batches,
+		               "Maximum number of batches waiting for server-send")
+		.def_readwrite("iterator_threads", &python_merge_config::iterator_threads,
+		               "Number of backends iterated simultaneously")
+		.def_readwrite("sender_threads", &python_merge_config::sender_threads,
+		               "Number of simultaneous server-send batches")
+		.def_readwrite("attempts", &python_merge_config::attempts,
+		               "Number of attempts of timed out server-send and remove")
+		.def_readwrite("safe", &python_merge_config::safe,
+		               "If True, keys are copied instead of moving")
+		.def_readwrite("dry_run", &python_merge_config::dry_run,
+		               "If True, keys are only iterated")
+		.def_readwrite("timeout", &python_merge_config::timeout,
+		               "Timeout of server-send and remove commands in seconds")
+		.def_readwrite("trace_id", &python_merge_config::trace_id,
+		               "Trace id of recovery commands")
+		.def_readwrite("tmp_dir", &python_merge_config::tmp_dir,
+		               "Directory for dump of not moved keys")
+		.def_readwrite("corrupted_keys_path", &python_merge_config::corrupted_keys_path,
+		               "File where corrupted keys are written to")
+	;
+
+	bp::def("merge_recovery", merge_recovery,
+	        (bp::arg("node"), bp::arg("config"), bp::arg("stats")),
+	        "merge_recovery(node, config, stats)\n"
+	        "    Runs merge recovery of config.group natively, without GIL.\n"
+	        "    Progress is reported to stats which should provide counter, set_counter, timer and []\n"
+	        "    like elliptics_recovery.monitor.StatsProxy. Returns True if all keys were recovered.\n"
+	        "    node must be created with route list.");
+}
+
+} } } // namespace ioremap::elliptics::python
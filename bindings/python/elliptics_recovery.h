@@ -0,0 +1,10 @@
+#ifndef ELLIPTICS_PYTHON_ELLIPTICS_RECOVERY_HPP
+#define ELLIPTICS_PYTHON_ELLIPTICS_RECOVERY_HPP
+
+namespace ioremap { namespace elliptics { namespace python {
+
+void init_elliptics_recovery();
+
+} } } // namespace ioremap::elliptics::python
+
+#endif // ELLIPTICS_PYTHON_ELLIPTICS_RECOVERY_HPP
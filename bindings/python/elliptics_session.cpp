@@ -38,6 +38,7 @@
 #include "gil_guard.h"
 #include "py_converters.h"
 #include "elliptics_io_attr.h"
+#include "data_buffer.h"
 
 namespace bp = boost::python;
 
@@ -70,13 +71,15 @@ enum elliptics_monitor_categories {
 	elliptics_monitor_categories_stats = DNET_MONITOR_STATS,
 	elliptics_monitor_categories_procfs = DNET_MONITOR_PROCFS,
 	elliptics_monitor_categories_top = DNET_MONITOR_TOP,
+	elliptics_monitor_categories_slow_requests = DNET_MONITOR_SLOW_REQUESTS,
 	elliptics_monitor_categories_all = DNET_MONITOR_CACHE |
 	                                   DNET_MONITOR_IO |
 	                                   DNET_MONITOR_COMMANDS |
 	                                   DNET_MONITOR_BACKEND |
 	                                   DNET_MONITOR_STATS |
 	                                   DNET_MONITOR_PROCFS |
-	                                   DNET_MONITOR_TOP
+	                                   DNET_MONITOR_TOP |
+	                                   DNET_MONITOR_SLOW_REQUESTS
 };
 
 struct write_cas_converter {
@@ -391,33 +394,42 @@ public:
 		return create_result(std::move(session::read_latest(io_attr.id.id(), io_attr.offset, io_attr.size)));
 	}
 
-	python_write_result write_data(const bp::api::object &id, const std::string &data, uint64_t offset) {
+	/*
+	 * Payload is passed to session without copying, session copies it into request packets
+	 * before returning. Chunked writes send chunks later, so they keep their own copy of the payload.
+	 */
+	python_write_result write_data(const bp::api::object &id, const bp::api::object &data, uint64_t offset) {
+		python_data payload(data);
+
 		bp::extract<elliptics_io_attr&> get_io_attr(id);
 		if (!get_io_attr.check())
-			return create_result(std::move(session::write_data(transform(id).id(), data_pointer::copy(data), offset)));
+			return create_result(std::move(session::write_data(transform(id).id(), payload.argument(), offset)));
 
 		elliptics_io_attr &io_attr = get_io_attr;
 		transform_io_attr(io_attr);
 
-		return create_result(std::move(session::write_data(io_attr, data_pointer::copy(data))));
+		return create_result(std::move(session::write_data(io_attr, payload.argument())));
 	}
 
-	python_write_result write_data_by_chunks(const bp::api::object &id, const std::string &data, uint64_t offset, uint64_t chunk_size) {
+	python_write_result write_data_by_chunks(const bp::api::object &id, const bp::api::object &data, uint64_t offset, uint64_t chunk_size) {
 		if (chunk_size == 0)
 			return write_data(id, data, offset);
 
+		python_data payload(data);
+
 		bp::extract<elliptics_io_attr&> get_io_attr(id);
 		if (!get_io_attr.check())
-			return create_result(std::move(session::write_data(transform(id).id(), data_pointer::copy(data), offset, chunk_size)));
+			return create_result(std::move(session::write_data(transform(id).id(), payload.copy(), offset, chunk_size)));
 
 		elliptics_io_attr &io_attr = get_io_attr;
 		transform_io_attr(io_attr);
 
-		return create_result(std::move(session::write_data(io_attr.id.id(), data_pointer::copy(data), io_attr.offset, chunk_size)));
+		return create_result(std::move(session::write_data(io_attr.id.id(), payload.copy(), io_attr.offset, chunk_size)));
 	}
 
-	python_write_result write_cas(const bp::api::object &id, const std::string &data, const elliptics_id &old_csum, uint64_t remote_offset) {
-		return create_result(std::move(session::write_cas(transform(id).id(), data_pointer::copy(data), old_csum.id(), remote_offset)));
+	python_write_result write_cas(const bp::api::object &id, const bp::api::object &data, const elliptics_id &old_csum, uint64_t remote_offset) {
+		python_data payload(data);
+		return create_result(std::move(session::write_cas(transform(id).id(), payload.argument(), old_csum.id(), remote_offset)));
 	}
 
 	python_write_result write_cas_callback(const bp::api::object &id, bp::api::object &converter, uint64_t remote_offset, int count) {
@@ -428,20 +440,24 @@ public:
 		                     count)));
 	}
 
-	python_write_result write_prepare(const bp::api::object &id, const std::string &data, uint64_t remote_offset, uint64_t psize) {
-		return create_result(std::move(session::write_prepare(transform(id).id(), data_pointer::copy(data), remote_offset, psize)));
+	python_write_result write_prepare(const bp::api::object &id, const bp::api::object &data, uint64_t remote_offset, uint64_t psize) {
+		python_data payload(data);
+		return create_result(std::move(session::write_prepare(transform(id).id(), payload.argument(), remote_offset, psize)));
 	}
 
-	python_write_result write_plain(const bp::api::object &id, const std::string &data, uint64_t remote_offset) {
-		return create_result(std::move(session::write_plain(transform(id).id(), data_pointer::copy(data), remote_offset)));
+	python_write_result write_plain(const bp::api::object &id, const bp::api::object &data, uint64_t remote_offset) {
+		python_data payload(data);
+		return create_result(std::move(session::write_plain(transform(id).id(), payload.argument(), remote_offset)));
 	}
 
-	python_write_result write_commit(const bp::api::object &id, const std::string &data, uint64_t remote_offset, uint64_t csize) {
-		return create_result(std::move(session::write_commit(transform(id).id(), data_pointer::copy(data), remote_offset, csize)));
+	python_write_result write_commit(const bp::api::object &id, const bp::api::object &data, uint64_t remote_offset, uint64_t csize) {
+		python_data payload(data);
+		return create_result(std::move(session::write_commit(transform(id).id(), payload.argument(), remote_offset, csize)));
 	}
 
-	python_write_result write_cache(const bp::api::object &id, const std::string &data, long timeout) {
-		return create_result(std::move(session::write_cache(transform(id).id(), data_pointer::copy(data), timeout)));
+	python_write_result write_cache(const bp::api::object &id, const bp::api::object &data, long timeout) {
+		python_data payload(data);
+		return create_result(std::move(session::write_cache(transform(id).id(), payload.argument(), timeout)));
 	}
 
 	std::string lookup_address(const bp::api::object &id, const int group_id) {
@@ -600,19 +616,21 @@ public:
 
 	python_write_result bulk_write(const bp::api::object &datas) {
 		std::vector<dnet_io_attr> ios;
-		std::vector<std::string> wdatas;
+		std::vector<std::unique_ptr<python_data>> payloads;
+		std::vector<argument_data> wdatas;
 
 		auto datas_len = bp::len(datas);
 		ios.reserve(datas_len);
+		payloads.reserve(datas_len);
 		wdatas.reserve(datas_len);
 
 		for (bp::stl_input_iterator<bp::tuple> it(datas), end; it != end; ++it) {
 			elliptics_io_attr io_attr = convert_io_attr((*it)[0]);
 			transform_io_attr(io_attr);
 
-			bp::extract<std::string> get_data((*it)[1]);
+			payloads.emplace_back(new python_data((*it)[1]));
 
-			wdatas.push_back(get_data());
+			wdatas.push_back(payloads.back()->argument());
 			ios.push_back(io_attr);
 		}
 
@@ -736,41 +754,45 @@ public:
 
 	python_write_result write(const bp::api::object &id,
 	                          const std::string &json, uint64_t json_capacity,
-	                          const std::string &data, uint64_t data_capacity) {
+	                          const bp::api::object &data, uint64_t data_capacity) {
+		python_data payload(data);
 		return create_result(
 			newapi::session{*this}.write(transform(id).id(),
 			                             json, json_capacity,
-			                             data, data_capacity)
+			                             payload.argument(), data_capacity)
 		);
 	}
 
 	python_write_result write_prepare(const bp::api::object &id,
 	                                  const std::string &json, uint64_t json_capacity,
-	                                  const std::string &data, uint64_t data_offset, uint64_t data_capacity) {
+	                                  const bp::api::object &data, uint64_t data_offset, uint64_t data_capacity) {
+		python_data payload(data);
 		return create_result(
 			newapi::session{*this}.write_prepare(transform(id).id(),
 			                                     json, json_capacity,
-			                                     data, data_offset, data_capacity)
+			                                     payload.argument(), data_offset, data_capacity)
 		);
 	}
 
 	python_write_result write_plain(const bp::api::object &id,
 	                                const std::string &json,
-	                                const std::string &data, uint64_t data_offset) {
+	                                const bp::api::object &data, uint64_t data_offset) {
+		python_data payload(data);
 		return create_result(
 			newapi::session{*this}.write_plain(transform(id).id(),
 			                                   json,
-			                                   data, data_offset)
+			                                   payload.argument(), data_offset)
 		);
 	}
 
 	python_write_result write_commit(const bp::api::object &id,
 	                                 const std::string &json,
-	                                 const std::string &data, uint64_t data_offset, uint64_t data_commit_size) {
+	                                 const bp::api::object &data, uint64_t data_offset, uint64_t data_commit_size) {
+		python_data payload(data);
 		return create_result(
 			newapi::session{*this}.write_commit(transform(id).id(),
 			                                    json,
-			                                    data, data_offset, data_commit_size)
+			                                    payload.argument(), data_offset, data_commit_size)
 		);
 	}
 
@@ -785,7 +807,8 @@ public:
 	python_iterator_result start_iterator(const std::string &host, int port, int family, uint32_t backend_id,
 	                                      uint64_t flags,
 	                                      const bp::api::object &key_ranges,
-	                                      const bp::api::object &time_range) {
+	                                      const bp::api::object &time_range,
+	                                      const bp::api::object &predicate) {
 		auto std_key_ranges = convert_to_vector<dnet_iterator_range>(key_ranges);
 		auto std_time_range = [&] () {
 			if (time_range.ptr() == Py_None) {
@@ -798,9 +821,41 @@ public:
 
 		} ();
 
+		auto std_predicate = [&] () {
+			newapi::iterator_predicate result;
+			if (predicate.ptr() == Py_None) {
+				return result;
+			}
+
+			for (bp::stl_input_iterator<bp::tuple> it(predicate), end; it != end; ++it) {
+				const bp::tuple &item = *it;
+
+				newapi::iterator_condition condition{};
+				condition.field = bp::extract<uint32_t>(item[0]);
+				condition.op = bp::extract<uint32_t>(item[1]);
+
+				switch (condition.field) {
+				case DNET_IPRED_FIELD_JSON:
+					condition.json_key = bp::extract<std::string>(item[2]);
+					condition.json_value = bp::extract<std::string>(item[3]);
+					break;
+				case DNET_IPRED_FIELD_DATA_TIMESTAMP:
+				case DNET_IPRED_FIELD_JSON_TIMESTAMP:
+					condition.timestamp = bp::extract<const elliptics_time&>(item[2])().m_time;
+					break;
+				default:
+					condition.value = bp::extract<uint64_t>(item[2]);
+					break;
+				}
+
+				result.emplace_back(std::move(condition));
+			}
+			return result;
+		} ();
+
 		return create_result(
 			newapi::session{*this}.start_iterator(address(host, port, family), backend_id, flags,
-			                                      std_key_ranges, std_time_range)
+			                                      std_key_ranges, std_time_range, std_predicate)
 		);
 	}
 
@@ -899,7 +954,8 @@ void init_elliptics_session() {
 		"backend\n    Category for backend statistics\n"
 		"stats\n    Category for in-process runtime statistics\n"
 		"procfs\n    Category for system statistics about process\n"
-		"top\n    Category for statistics of top keys ordered by generated traffic\n")
+		"top\n    Category for statistics of top keys ordered by generated traffic\n"
+		"slow_requests\n    Category for stage latency breakdown of the slowest requests\n")
 		.value("all", elliptics_monitor_categories_all)
 		.value("cache", elliptics_monitor_categories_cache)
 		.value("io", elliptics_monitor_categories_io)
@@ -908,6 +964,7 @@ void init_elliptics_session() {
 		.value("stats", elliptics_monitor_categories_stats)
 		.value("procfs", elliptics_monitor_categories_procfs)
 		.value("top", elliptics_monitor_categories_top)
+		.value("slow_requests", elliptics_monitor_categories_slow_requests)
 	;
 
 	bp::class_<elliptics_status>("SessionStatus", bp::init<>())
@@ -1924,16 +1981,20 @@ void init_elliptics_session() {
 		     "    assert async.successful()\n")
 
 		.def("start_iterator", &newapi::elliptics_session::start_iterator,
-		     bp::args("host", "port", "family", "backend_id",
-		              "flags", "key_ranges", "time_range"),
-		     "start_iterator(host, port, family, backend_id, flags, key_ranges, time_range)\n"
+		     (bp::arg("host"), bp::arg("port"), bp::arg("family"), bp::arg("backend_id"),
+		      bp::arg("flags"), bp::arg("key_ranges"), bp::arg("time_range"),
+		      bp::arg("predicate") = bp::api::object()),
+		     "start_iterator(host, port, family, backend_id, flags, key_ranges, time_range, predicate=None)\n"
 		     "    Start iterator on the Elliptics node specified by @host, @port, @family and @backend_id."
 		     "    Return elliptics.AsyncResult.\n"
 		     "    -- host, port, family - the node where iteration should be executed\n"
 		     "    -- backend_id - id of backend where iteration should be executed\n"
 		     "    -- flags - bits set of elliptics.iterator_flags\n"
 		     "    -- key_ranges - list of elliptics.IteratorRange by which keys on the node should be filtered\n"
-		     "    -- time_range - time range by which keys on the node should be filtered\n\n"
+		     "    -- time_range - time range by which keys on the node should be filtered\n"
+		     "    -- predicate - list of conditions which iterated keys should match on the node:\n"
+		     "       (field, op, value) or (elliptics.iterator_predicate_fields.json, op, json_key, json_value),\n"
+		     "       where field is elliptics.iterator_predicate_fields and op is elliptics.iterator_predicate_ops\n\n"
 		     "    flags = elliptics.iterator_flags.key_range\n"
 		     "    range = elliptics.IteratorRange()\n"
 		     "    range.key_begin = elliptics.Id([0] * 64, 1)\n"
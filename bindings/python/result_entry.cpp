@@ -27,6 +27,8 @@
 #include "elliptics_time.h"
 #include "elliptics_io_attr.h"
 #include "py_converters.h"
+#include "gil_guard.h"
+#include "data_buffer.h"
 
 namespace bp = boost::python;
 
@@ -42,6 +44,11 @@ std::string iterator_result_response_data(iterator_result_entry result)
 	return result.reply_data().to_string();
 }
 
+bp::object iterator_result_response_data_view(iterator_result_entry result)
+{
+	return data_pointer_view(result.reply_data());
+}
+
 static elliptics_id iterator_response_get_key(dnet_iterator_response *response) {
 	return elliptics_id(response->key);
 }
@@ -55,6 +62,11 @@ std::string read_result_get_data(read_result_entry &result)
 	return result.file().to_string();
 }
 
+bp::object read_result_get_data_view(read_result_entry &result)
+{
+	return data_pointer_view(result.file());
+}
+
 elliptics_id read_result_get_id(read_result_entry &result)
 {
 	dnet_raw_id id;
@@ -165,6 +177,11 @@ std::string callback_result_data(callback_result_entry &result)
 	return result.data().to_string();
 }
 
+bp::object callback_result_data_view(callback_result_entry &result)
+{
+	return data_pointer_view(result.data());
+}
+
 std::string callback_entry_address(const callback_result_entry &result)
 {
 	return dnet_addr_string(result.address());
@@ -306,6 +323,22 @@ bp::object read_result_get_data(const newapi::read_result_entry &result) {
 	return bp::object(result.data().to_string());
 }
 
+bp::object read_result_get_json_view(const newapi::read_result_entry &result) {
+	if (result.status()) {
+		return bp::object();
+	}
+
+	return data_pointer_view(result.json());
+}
+
+bp::object read_result_get_data_view(const newapi::read_result_entry &result) {
+	if (result.status()) {
+		return bp::object();
+	}
+
+	return data_pointer_view(result.data());
+}
+
 uint64_t iterator_result_get_iterator_id(const newapi::iterator_result_entry &result) {
 	return result.iterator_id();
 }
@@ -322,6 +355,10 @@ uint64_t iterator_result_get_total_keys(const newapi::iterator_result_entry &res
 	return result.total_keys();
 }
 
+uint64_t iterator_result_get_filtered_keys(const newapi::iterator_result_entry &result) {
+	return result.filtered_keys();
+}
+
 elliptics_id iterator_result_get_key(const newapi::iterator_result_entry &result) {
 	auto key = result.key();
 	return elliptics_id(key);
@@ -343,6 +380,14 @@ std::string iterator_result_get_data(const newapi::iterator_result_entry &result
 	return result.data().to_string();
 }
 
+bp::object iterator_result_get_json_view(const newapi::iterator_result_entry &result) {
+	return data_pointer_view(result.json());
+}
+
+bp::object iterator_result_get_data_view(const newapi::iterator_result_entry &result) {
+	return data_pointer_view(result.data());
+}
+
 void iterator_container_append(newapi::iterator_result_container &container, newapi::iterator_result_entry &result) {
 	container.append(result);
 }
@@ -351,10 +396,40 @@ void iterator_container_append_old(newapi::iterator_result_container &container,
 	container.append_old(result);
 }
 
+void iterator_container_flush(newapi::iterator_result_container &container) {
+	container.flush();
+}
+
 void iterator_container_sort(newapi::iterator_result_container &container) {
+	py_allow_threads_scoped pythr;
 	container.sort();
 }
 
+std::vector<newapi::iterator_result_container *> convert_to_containers(const bp::api::object &list) {
+	std::vector<newapi::iterator_result_container *> ret;
+	for (bp::stl_input_iterator<bp::api::object> it(list), end; it != end; ++it) {
+		newapi::iterator_result_container &container = bp::extract<newapi::iterator_result_container &>(*it);
+		ret.push_back(&container);
+	}
+	return ret;
+}
+
+void iterator_container_merge(const bp::api::object &sources, const bp::api::object &destinations) {
+	auto source_containers = convert_to_containers(sources);
+	auto destination_containers = convert_to_containers(destinations);
+
+	py_allow_threads_scoped pythr;
+	newapi::iterator_result_container::merge(source_containers, destination_containers);
+}
+
+void iterator_container_diff(const bp::api::object &sources, const bp::api::object &destinations) {
+	auto source_containers = convert_to_containers(sources);
+	auto destination_containers = convert_to_containers(destinations);
+
+	py_allow_threads_scoped pythr;
+	newapi::iterator_result_container::diff(source_containers, destination_containers);
+}
+
 uint64_t iterator_container_get_count(const newapi::iterator_result_container &container) {
 	return container.m_count;
 }
@@ -391,6 +466,8 @@ void init_result_entry() {
 		.add_property("is_final", callback_result_is_final)
 		.add_property("status", callback_result_status)
 		.add_property("data", callback_result_data)
+		.add_property("data_view", callback_result_data_view,
+		              "Read-only memoryview of data, unlike data it doesn't copy the data")
 		.add_property("size", callback_result_size)
 		.add_property("error", callback_result_error)
 		.add_property("address", callback_entry_address)
@@ -407,6 +484,8 @@ void init_result_entry() {
 		              "elliptics.IteratorResultResponse which provides meta information about iterated key")
 		.add_property("response_data", iterator_result_response_data,
 		              "Data of iterated key. May be empty if elliptics.iterator_flags.data hasn't been specified for iteration.")
+		.add_property("response_data_view", iterator_result_response_data_view,
+		              "Read-only memoryview of response_data, unlike response_data it doesn't copy the data")
 	;
 
 	bp::class_<dnet_iterator_response>("IteratorResultResponse",
@@ -434,6 +513,8 @@ void init_result_entry() {
 	bp::class_<read_result_entry, bp::bases<callback_result_entry> >("ReadResultEntry")
 		.add_property("data", read_result_get_data,
 		              "Read data")
+		.add_property("data_view", read_result_get_data_view,
+		              "Read-only memoryview of read data, unlike data it doesn't copy the data")
 		.add_property("id", read_result_get_id,
 		              "elliptics.Id of read object")
 		.add_property("timestamp", read_result_get_timestamp,
@@ -561,6 +642,10 @@ void init_result_entry() {
 		              "Read json if it was requested otherwise it is empty string.")
 		.add_property("data", newapi::read_result_get_data,
 		              "Read data if it was requested otherwise it is empty string.")
+		.add_property("json_view", newapi::read_result_get_json_view,
+		              "Read-only memoryview of json, unlike json it doesn't copy the json.")
+		.add_property("data_view", newapi::read_result_get_data_view,
+		              "Read-only memoryview of data, unlike data it doesn't copy the data.")
 	;
 
 	bp::class_<newapi::iterator_result_entry, bp::bases<newapi::callback_result_entry>>("IteratorResultEntry",
@@ -578,6 +663,10 @@ void init_result_entry() {
 		.add_property("total_keys", newapi::iterator_result_get_total_keys,
 		              "Total number of keys which expected to be iterated. "
 		              "It isn't true when some filtering is on, for example, filtering by key-range.")
+		.add_property("filtered_keys", newapi::iterator_result_get_filtered_keys,
+		              "Number of keys filtered out by iterator predicate at the moment of this key iteration. "
+		              "The last result of iteration with predicate has status 1 and contains final numbers "
+		              "of iterated and filtered out keys.")
 		.add_property("key", newapi::iterator_result_get_key,
 		              "elliptics.Id of iterated key.")
 		.add_property("record_info", newapi::iterator_result_get_record_info,
@@ -588,6 +677,10 @@ void init_result_entry() {
 		              "Json of iterated key if appropriate flag was set otherwise it is empty string.")
 		.add_property("data", newapi::iterator_result_get_data,
 		              "Data of iterated key if appropriate flag was set otherwise it is empty string.")
+		.add_property("json_view", newapi::iterator_result_get_json_view,
+		              "Read-only memoryview of json, unlike json it doesn't copy the json.")
+		.add_property("data_view", newapi::iterator_result_get_data_view,
+		              "Read-only memoryview of data, unlike data it doesn't copy the data.")
 	;
 
 	bp::class_<newapi::iterator_container_item>("IteratorContainerItem",
@@ -632,9 +725,15 @@ void init_result_entry() {
 		     (bp::arg("iterator_result_entry")),
 		     "append_old(iterator_result_entry)\n"
 		     "    Appends iterator_result_entry of type elliptics.core.IteratorResultEntry to the end of the container file")
+		.def("flush", newapi::iterator_container_flush,
+		     "flush()\n"
+		     "    Writes appended items which are still buffered in memory to the container file.\n"
+		     "    It should be called before the container file is used directly, sort() and merge()\n"
+		     "    flush it implicitly.")
 		.def("sort", newapi::iterator_container_sort,
 		     "sort()\n"
-		     "    Sorts items of the container file by (key, data_timestamp, json_timestamp, data_size) tuple")
+		     "    Sorts items of the container file by key. Records of the same key are ordered like merge() compares\n"
+		     "    them: newer data_timestamp, then smaller data_size, then greater user_flags, then newer json_timestamp.")
 		.def("__len__", newapi::iterator_container_get_count,
 		     "x.__len__() <==> len(x)\n"
 		     "    Returns the number of items in the container file")
@@ -642,6 +741,23 @@ void init_result_entry() {
 		     (bp::arg("n")),
 		     "x.__getitem__(n) <==> x[n]\n"
 		     "    Returns n-th item of the container file of type elliptics.core.newapi.IteratorContainerItem")
+		.def("merge", newapi::iterator_container_merge,
+		     (bp::arg("sources"), bp::arg("destinations")),
+		     "merge(sources, destinations)\n"
+		     "    Merges sorted containers from the list @sources. For each key the newest record is appended\n"
+		     "    to the container from the list @destinations which corresponds to the source having this record.\n"
+		     "    Records are compared like elliptics_recovery.iterator.MergeData does: newer data_timestamp,\n"
+		     "    then smaller data_size, then greater user_flags wins.\n"
+		     "    Destinations should be empty and become sorted.")
+		.staticmethod("merge")
+		.def("diff", newapi::iterator_container_diff,
+		     (bp::arg("sources"), bp::arg("destinations")),
+		     "diff(sources, destinations)\n"
+		     "    Computes difference of sorted containers from the list @sources. For each key the newest record\n"
+		     "    is appended to each container from the list @destinations which corresponding source\n"
+		     "    doesn't have the key or has an older record of it. Records are compared like merge() does.\n"
+		     "    Destinations should be empty and become sorted.")
+		.staticmethod("diff")
 	;
 }
 
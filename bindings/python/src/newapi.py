@@ -247,7 +247,7 @@ class Session(elliptics.core.newapi.Session):
             backends = list(backends)
         return super(Session, self).monitor_stat(address, categories, backends)
 
-    def start_iterator(self, address, backend_id, flags, key_ranges=None, time_range=None):
+    def start_iterator(self, address, backend_id, flags, key_ranges=None, time_range=None, predicate=None):
         """Start iterator on node @address and backend @backend_id."""
         return super(Session, self).start_iterator(host=address.host,
                                                    port=address.port,
@@ -255,4 +255,5 @@ class Session(elliptics.core.newapi.Session):
                                                    backend_id=backend_id,
                                                    flags=flags,
                                                    key_ranges=key_ranges,
-                                                   time_range=time_range)
+                                                   time_range=time_range,
+                                                   predicate=predicate)
@@ -16,11 +16,17 @@
 */
 
 #include "cache.hpp"
+#include "l2_cache.hpp"
 #include "slru_cache.hpp"
+#include "snapshot.hpp"
 
 #include <blackhole/attribute.hpp>
 #include <kora/config.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+
 #include "library/backend.h"
 #include "library/protocol.hpp"
 
@@ -102,17 +108,66 @@ static size_t parse_size(const kora::config_t &value) {
 	return ret;
 }
 
+static size_t parse_compression_threshold(const kora::config_t &cache) {
+	const auto codec = cache.at<std::string>("compression", "none");
+	if (codec == "none")
+		return 0;
+	if (codec != "zlib")
+		throw elliptics::config::config_error(cache["compression"].path() + " must be \"none\" or \"zlib\"");
+
+	return cache.has("compression_threshold") ? parse_size(cache["compression_threshold"])
+	                                          : DNET_DEFAULT_CACHE_COMPRESSION_THRESHOLD;
+}
+
+// the second tier doesn't keep records larger than a share of it, so a smaller tier would drop almost every record
+static const size_t l2_min_size = 1 << 20;
+
+static size_t parse_l2_size(const kora::config_t &cache) {
+	if (!cache.has("l2_dir")) {
+		if (cache.has("l2_size"))
+			throw elliptics::config::config_error(cache["l2_size"].path() + " requires l2_dir to be specified");
+		return 0;
+	}
+
+	if (cache.at<std::string>("l2_dir").empty())
+		throw elliptics::config::config_error(cache["l2_dir"].path() + " must be non-empty");
+	if (!cache.has("l2_size"))
+		throw elliptics::config::config_error(cache.path() + ".l2_size must be specified if l2_dir is set");
+
+	const size_t size = parse_size(cache["l2_size"]);
+	if (size < l2_min_size)
+		throw elliptics::config::config_error(cache["l2_size"].path() + " must be at least " +
+		                                      std::to_string(l2_min_size) + " bytes");
+	return size;
+}
+
 cache_config cache_config::parse(const kora::config_t &cache) {
 	return {/*size*/ parse_size(cache["size"]),
 	        /*count*/ cache.at<size_t>("shards", DNET_DEFAULT_CACHES_NUMBER),
 	        /*sync_timeout*/ cache.at<unsigned>("sync_timeout", DNET_DEFAULT_CACHE_SYNC_TIMEOUT_SEC),
 	        /*pages_proportions*/ cache.at("pages_proportions",
-	                                       std::vector<size_t>(DNET_DEFAULT_CACHE_PAGES_NUMBER, 1))};
+	                                       std::vector<size_t>(DNET_DEFAULT_CACHE_PAGES_NUMBER, 1)),
+	        /*snapshot_dir*/ cache.at<std::string>("snapshot_dir", ""),
+	        /*snapshot_value_size*/ cache.has("snapshot_value_size") ? parse_size(cache["snapshot_value_size"]) : 0,
+	        /*warmup_rate*/ cache.has("warmup_rate") ? parse_size(cache["warmup_rate"]) : 0,
+	        /*fill_wait_timeout*/ cache.at<unsigned>("fill_wait_timeout",
+	                                                 DNET_DEFAULT_CACHE_FILL_WAIT_TIMEOUT_MS),
+	        /*admission_filter*/ cache.at<bool>("admission_filter", false),
+	        /*admission_sketch_width*/ cache.at<size_t>("admission_sketch_width",
+	                                                    DNET_DEFAULT_CACHE_ADMISSION_SKETCH_WIDTH),
+	        /*chunk_size*/ cache.has("chunk_size") ? parse_size(cache["chunk_size"]) : 0,
+	        /*flush_threads*/ cache.at<unsigned>("flush_threads", 1),
+	        /*compression_threshold*/ parse_compression_threshold(cache),
+	        /*l2_dir*/ cache.at<std::string>("l2_dir", ""),
+	        /*l2_size*/ parse_l2_size(cache)};
 }
 
 cache_manager::cache_manager(dnet_node *n, dnet_backend &backend, const cache_config &config)
 : m_node(n)
-, m_need_exit(false) {
+, m_backend(backend)
+, m_need_exit(false)
+, m_snapshot_value_size(config.snapshot_value_size)
+, m_warmup_rate(config.warmup_rate) {
 	size_t caches_number = config.count;
 	m_cache_pages_number = config.pages_proportions.size();
 	m_max_cache_size = config.size;
@@ -128,14 +183,41 @@ cache_manager::cache_manager(dnet_node *n, dnet_backend &backend, const cache_co
 		pages_max_sizes[i] = max_size * (config.pages_proportions[i] * 1.0 / proportionsSum);
 	}
 
+	if (!config.l2_dir.empty()) {
+		m_l2.reset(new l2_cache_t(n, backend.backend_id(),
+		                          config.l2_dir + "/cache_l2." + std::to_string(backend.backend_id()),
+		                          config.l2_size));
+		// backend works without the second tier if its file can't be created
+		if (m_l2->open())
+			m_l2.reset();
+	}
+
 	for (size_t i = 0; i < caches_number; ++i) {
 		m_caches.emplace_back(
-		        std::make_shared<slru_cache_t>(n, backend, pages_max_sizes, config.sync_timeout, m_need_exit));
+		        std::make_shared<slru_cache_t>(n, backend, pages_max_sizes, config.sync_timeout,
+		                                       config.fill_wait_timeout,
+		                                       config.admission_filter ? config.admission_sketch_width : 0,
+		                                       config.chunk_size,
+		                                       config.flush_threads,
+		                                       config.compression_threshold,
+		                                       m_l2.get(),
+		                                       m_need_exit));
+	}
+
+	if (!config.snapshot_dir.empty()) {
+		m_snapshot_path = config.snapshot_dir + "/cache_snapshot." + std::to_string(backend.backend_id());
+		load_snapshot();
 	}
 }
 
 cache_manager::~cache_manager() {
 	m_need_exit = true;
+
+	if (m_warmup.joinable())
+		m_warmup.join();
+
+	if (!m_snapshot_path.empty())
+		dump_snapshot();
 }
 
 write_response_t cache_manager::write(dnet_net_state *st,
@@ -145,8 +227,8 @@ write_response_t cache_manager::write(dnet_net_state *st,
 	return m_caches[idx(request.id)]->write(st, cmd, request, context);
 }
 
-read_response_t cache_manager::read(const unsigned char *id, uint64_t ioflags) {
-	return m_caches[idx(id)]->read(id, ioflags);
+read_response_t cache_manager::read(const unsigned char *id, uint64_t ioflags, uint64_t offset, uint64_t size) {
+	return m_caches[idx(id)]->read(id, ioflags, offset, size);
 }
 
 int cache_manager::remove(const dnet_cmd *cmd,
@@ -163,6 +245,9 @@ void cache_manager::clear() {
 	for (size_t i = 0; i < m_caches.size(); ++i) {
 		m_caches[i]->clear();
 	}
+
+	if (m_l2)
+		m_l2->clear();
 }
 
 size_t cache_manager::cache_size() const {
@@ -173,6 +258,10 @@ size_t cache_manager::cache_pages_number() const {
 	return m_cache_pages_number;
 }
 
+l2_cache_stats cache_manager::get_l2_cache_stats() const {
+	return m_l2 ? m_l2->get_stats() : l2_cache_stats();
+}
+
 cache_stats cache_manager::get_total_cache_stats() const {
 	cache_stats stats;
 	stats.pages_sizes.resize(m_cache_pages_number);
@@ -183,6 +272,27 @@ cache_stats cache_manager::get_total_cache_stats() const {
 		stats.number_of_objects_marked_for_deletion += page_stats.number_of_objects_marked_for_deletion;
 		stats.size_of_objects_marked_for_deletion += page_stats.size_of_objects_marked_for_deletion;
 		stats.size_of_objects += page_stats.size_of_objects;
+		stats.number_of_warmup_objects += page_stats.number_of_warmup_objects;
+		stats.number_of_warmed_up_objects += page_stats.number_of_warmed_up_objects;
+		stats.size_of_warmed_up_objects += page_stats.size_of_warmed_up_objects;
+		stats.number_of_skipped_warmup_objects += page_stats.number_of_skipped_warmup_objects;
+		stats.number_of_coalesced_misses += page_stats.number_of_coalesced_misses;
+		stats.number_of_fill_wait_timeouts += page_stats.number_of_fill_wait_timeouts;
+		stats.number_of_admitted_objects += page_stats.number_of_admitted_objects;
+		stats.number_of_rejected_objects += page_stats.number_of_rejected_objects;
+		stats.number_of_chunked_objects += page_stats.number_of_chunked_objects;
+		stats.number_of_chunks += page_stats.number_of_chunks;
+		stats.number_of_dirty_objects += page_stats.number_of_dirty_objects;
+		stats.size_of_dirty_objects += page_stats.size_of_dirty_objects;
+		stats.number_of_flushed_objects += page_stats.number_of_flushed_objects;
+		stats.last_flush_lag = std::max(stats.last_flush_lag, page_stats.last_flush_lag);
+		stats.last_flush_time = std::max(stats.last_flush_time, page_stats.last_flush_time);
+		stats.number_of_compressed_objects += page_stats.number_of_compressed_objects;
+		stats.size_of_compressed_data += page_stats.size_of_compressed_data;
+		stats.logical_size_of_compressed_data += page_stats.logical_size_of_compressed_data;
+		stats.number_of_incompressible_objects += page_stats.number_of_incompressible_objects;
+		stats.compression_time += page_stats.compression_time;
+		stats.decompression_time += page_stats.decompression_time;
 
 		for (size_t j = 0; j < m_cache_pages_number; ++j) {
 			stats.pages_sizes[j] += page_stats.pages_sizes[j];
@@ -211,6 +321,12 @@ void cache_manager::statistics(rapidjson::Value &value, rapidjson::Document::All
 		caches.AddMember(index.c_str(), allocator, cache_time_stats, allocator);
 	}
 	value.AddMember("caches", caches, allocator);
+
+	if (m_l2) {
+		rapidjson::Value l2_stats(rapidjson::kObjectType);
+		m_l2->get_stats().to_json(l2_stats, allocator);
+		value.AddMember("l2", l2_stats, allocator);
+	}
 }
 
 size_t cache_manager::idx(const unsigned char *id) {
@@ -219,6 +335,161 @@ size_t cache_manager::idx(const unsigned char *id) {
 	return (i ^ j) % m_caches.size();
 }
 
+bool cache_manager::need_exit() const {
+	return m_need_exit || dnet_need_exit(m_node);
+}
+
+void cache_manager::load_snapshot() {
+	const int err = read_snapshot(m_snapshot_path, m_warmup_records);
+	if (err == -ENOENT) {
+		DNET_LOG_INFO(m_node, "cache: backend: {}: snapshot {} not found, skip warm-up", m_backend.backend_id(),
+		              m_snapshot_path);
+		return;
+	} else if (err) {
+		DNET_LOG_ERROR(m_node, "cache: backend: {}: failed to read snapshot {}, records read: {}: {} [{}]",
+		               m_backend.backend_id(), m_snapshot_path, m_warmup_records.size(), strerror(-err), err);
+	}
+
+	if (m_warmup_records.empty())
+		return;
+
+	std::vector<size_t> objects_numbers(m_caches.size(), 0);
+	for (const auto &record : m_warmup_records) {
+		++objects_numbers[idx(record.id.id)];
+	}
+	for (size_t i = 0; i < m_caches.size(); ++i) {
+		m_caches[i]->start_warm_up(objects_numbers[i]);
+	}
+
+	m_warmup_processed.assign(m_warmup_records.size(), false);
+	m_warmup = std::thread(std::bind(&cache_manager::warm_up, this));
+}
+
+void cache_manager::dump_snapshot() {
+	ioremap::elliptics::util::steady_timer timer;
+
+	std::vector<snapshot_record> records;
+	for (auto &cache : m_caches) {
+		cache->snapshot(records, m_snapshot_value_size);
+	}
+
+	// warm-up was interrupted, keep not processed records to not lose them on frequent restarts
+	for (size_t i = 0; i < m_warmup_records.size(); ++i) {
+		if (!m_warmup_processed[i]) {
+			records.emplace_back(std::move(m_warmup_records[i]));
+			records.back().item = cache_item{{0, 0}, {0, 0}, 0, nullptr, nullptr};
+		}
+	}
+
+	const int err = write_snapshot(m_snapshot_path, records);
+	const auto level = err ? DNET_LOG_ERROR : DNET_LOG_INFO;
+	DNET_LOG(m_node, level, "cache: backend: {}: dumped snapshot {}, records: {}, elapsed: {} ms: {} [{}]",
+	         m_backend.backend_id(), m_snapshot_path, records.size(), timer.get_ms(), strerror(-err), err);
+}
+
+void cache_manager::warm_up() {
+	dnet_set_name("dnet_warmup_%u", m_backend.backend_id());
+
+	ioremap::elliptics::util::steady_timer timer;
+
+	local_session sess(m_backend, m_node);
+	sess.set_ioflags(DNET_IO_FLAGS_NOCACHE);
+	sess.set_cflags(DNET_FLAGS_NOCACHE);
+
+	struct warmup_entry {
+		size_t index;
+		std::string path;
+		uint64_t offset;
+		dnet_time timestamp;
+	};
+	std::vector<warmup_entry> entries;
+	entries.reserve(m_warmup_records.size());
+
+	// lookup records on disk: missed ones are skipped, others are read in order of their position on disk
+	for (size_t i = 0; i < m_warmup_records.size() && !need_exit(); ++i) {
+		const auto &record = m_warmup_records[i];
+
+		dnet_cmd cmd;
+		memset(&cmd, 0, sizeof(cmd));
+		memcpy(cmd.id.id, record.id.id, DNET_ID_SIZE);
+		cmd.id.group_id = m_backend.group_id();
+		cmd.cmd = DNET_CMD_LOOKUP;
+
+		int err = 0;
+		auto lookup = sess.lookup(cmd, &err);
+		if (err || lookup.size() < sizeof(dnet_addr) + sizeof(dnet_file_info)) {
+			m_warmup_processed[i] = true;
+			m_caches[idx(record.id.id)]->skip_warm_up();
+			continue;
+		}
+
+		const auto info = lookup.skip<dnet_addr>().data<dnet_file_info>();
+		const size_t path_size = std::min<size_t>(std::max(info->flen, 0),
+		                                          lookup.size() - sizeof(dnet_addr) - sizeof(dnet_file_info));
+		entries.push_back({i, std::string(reinterpret_cast<const char *>(info + 1), path_size), info->offset,
+		                   info->mtime});
+	}
+
+	std::sort(entries.begin(), entries.end(), [] (const warmup_entry &lhs, const warmup_entry &rhs) {
+		return std::tie(lhs.path, lhs.offset) < std::tie(rhs.path, rhs.offset);
+	});
+
+	const size_t lookup_time = timer.get_ms();
+	uint64_t read_size = 0;
+	size_t loaded = 0;
+
+	for (const auto &entry : entries) {
+		if (need_exit())
+			break;
+
+		auto &record = m_warmup_records[entry.index];
+		auto &cache = m_caches[idx(record.id.id)];
+		m_warmup_processed[entry.index] = true;
+
+		if (std::get<0>(cache->lookup(record.id.id)) == 0) {
+			cache->skip_warm_up();
+			continue;
+		}
+
+		// value from the snapshot can be used only if the record wasn't rewritten after the dump
+		if (!record.item.data || dnet_time_cmp(&record.item.timestamp, &entry.timestamp)) {
+			dnet_id id;
+			memset(&id, 0, sizeof(id));
+			memcpy(id.id, record.id.id, DNET_ID_SIZE);
+
+			ioremap::elliptics::data_pointer json, data;
+			const int err = sess.read(id, &record.item.user_flags, &json, &record.item.json_timestamp, &data,
+			                          &record.item.timestamp);
+			if (err) {
+				cache->skip_warm_up();
+				continue;
+			}
+
+			record.item.json = std::make_shared<std::string>(json.to_string());
+			record.item.data = std::make_shared<std::string>(data.to_string());
+			read_size += json.size() + data.size();
+		}
+
+		cache->warm_up(record);
+		record.item = cache_item{{0, 0}, {0, 0}, 0, nullptr, nullptr};
+		++loaded;
+
+		// keep disk load within configured budget
+		if (m_warmup_rate) {
+			const uint64_t deadline = read_size * 1000000.0 / m_warmup_rate;
+			for (uint64_t elapsed = timer.get_us(); elapsed < deadline && !need_exit(); elapsed = timer.get_us()) {
+				std::this_thread::sleep_for(std::chrono::microseconds(std::min<uint64_t>(deadline - elapsed,
+				                                                                          100000)));
+			}
+		}
+	}
+
+	DNET_LOG_INFO(m_node, "cache: backend: {}: warm-up {}: snapshot records: {}, found on disk: {}, "
+	                      "processed: {}, read: {} bytes, lookup: {} ms, total: {} ms",
+	              m_backend.backend_id(), need_exit() ? "interrupted" : "finished", m_warmup_records.size(),
+	              entries.size(), loaded, read_size, lookup_time, timer.get_ms());
+}
+
 }} /* namespace ioremap::cache */
 
 using namespace ioremap::cache;
@@ -335,19 +606,20 @@ static int dnet_cmd_cache_io_read(struct cache_manager *cache,
 	int err;
 	cache_item it;
 
-	std::tie(err, it) = cache->read(io->id, io->flags);
+	std::tie(err, it) = cache->read(io->id, io->flags, io->offset, io->size);
 	if (err) {
 		return err;
 	}
 
 	auto d = it.data;
+	const uint64_t total_size = it.total_data_size;
 
 	/*!
 	 * When offset is larger then size of the file, operation is definitely incorrect
 	 */
-	if (io->offset >= d->size()) {
+	if (io->offset >= total_size) {
 		DNET_LOG_ERROR(n, "{}: {} cache: invalid offset: offset: {}, size: {}, cached-size: {}",
-		               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), io->offset, io->size, d->size());
+		               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), io->offset, io->size, total_size);
 		return -EINVAL;
 	}
 
@@ -357,15 +629,15 @@ static int dnet_cmd_cache_io_read(struct cache_manager *cache,
 	 * This situation happens when for example we want to read first 100 bytes of
 	 * the file and it's size appears to be less then 100 bytes.
 	 */
-	io->size = std::min(io->size, d->size() - io->offset);
+	io->size = std::min(io->size, total_size - io->offset);
 
 	/*!
 	 * 0 is special value for io operation size and in this case we should read all file
 	 */
 	if (io->size == 0)
-		io->size = d->size() - io->offset;
+		io->size = total_size - io->offset;
 
-	io->total_size = d->size();
+	io->total_size = total_size;
 
 	io->timestamp = it.timestamp;
 	io->user_flags = it.user_flags;
@@ -374,7 +646,7 @@ static int dnet_cmd_cache_io_read(struct cache_manager *cache,
 	cmd_stats->handled_in_cache = 1;
 
 	cmd->flags &= ~DNET_FLAGS_NEED_ACK;
-	return dnet_send_read_data(st, cmd, io, &d->at(io->offset), -1, io->offset, 0);
+	return dnet_send_read_data(st, cmd, io, &d->at(io->offset - it.data_offset), -1, io->offset, 0);
 }
 
 static int dnet_cmd_cache_io_read_new(struct cache_manager *cache,
@@ -398,13 +670,14 @@ static int dnet_cmd_cache_io_read_new(struct cache_manager *cache,
 	int err;
 	cache_item it;
 
-	std::tie(err, it) = cache->read(cmd->id.id, request.ioflags);
+	std::tie(err, it) = cache->read(cmd->id.id, request.ioflags, request.data_offset, request.data_size);
 	if (err) {
 		return err;
 	}
 
 	auto raw_data = it.data;
 	auto raw_json = it.json;
+	const uint64_t total_size = it.total_data_size;
 
 	data_pointer json, data_p;
 
@@ -413,17 +686,17 @@ static int dnet_cmd_cache_io_read_new(struct cache_manager *cache,
 	}
 
 	if (request.read_flags & DNET_READ_FLAGS_DATA) {
-		if (request.data_offset && request.data_offset >= raw_data->size())
+		if (request.data_offset && request.data_offset >= total_size)
 			return -E2BIG;
 
-		uint64_t data_size = raw_data->size() - request.data_offset;
+		uint64_t data_size = total_size - request.data_offset;
 
 		if (request.data_size) {
 			data_size = std::min(data_size, request.data_size);
 		}
 
 		data_p = data_pointer::from_raw(*raw_data);
-		data_p = data_p.slice(request.data_offset, data_size);
+		data_p = data_p.slice(request.data_offset - it.data_offset, data_size);
 	}
 
 	auto header = serialize(dnet_read_response{
@@ -436,7 +709,7 @@ static int dnet_cmd_cache_io_read_new(struct cache_manager *cache,
 		json.size(), // read_json_size
 
 		it.timestamp, // data_timestamp
-		raw_data->size(), // data_size
+		total_size, // data_size
 		request.data_offset, // read_data_offset
 		data_p.size(), // read_data_size
 	});
@@ -522,7 +795,7 @@ static int dnet_cmd_cache_io_lookup_new(struct cache_manager *cache,
 
 		it.timestamp, // data_timestamp
 		0, // data_offset
-		it.data->size(), // data_size
+		it.total_data_size, // data_size
 	});
 
 	cmd->flags &= ~DNET_FLAGS_NEED_ACK;
@@ -20,6 +20,7 @@
 
 #include <vector>
 #include <mutex>
+#include <thread>
 #include <limits>
 #include <iostream>
 #include <stdarg.h>
@@ -69,6 +70,10 @@ struct cache_item {
 	uint64_t user_flags;
 	std::shared_ptr<std::string> data;
 	std::shared_ptr<std::string> json;
+	// @data holds range of the object's data starting from @data_offset,
+	// @total_data_size is size of the whole object's data
+	uint64_t data_offset;
+	uint64_t total_data_size;
 };
 
 class data_t : public lru_list_base_hook_t, public treap_node_t<data_t> {
@@ -88,8 +93,11 @@ public:
 	, m_remove_from_cache(false)
 	, m_only_append(false)
 	, m_removed_from_page(true)
+	, m_chunk(false)
+	, m_compressed(false)
 	, m_sync_state(sync_state_t::NOT_SYNCING)
 	, m_json()
+	, m_data_size(0)
 	{
 		memcpy(m_id.id, id, DNET_ID_SIZE);
 		dnet_empty_time(&m_timestamp);
@@ -108,9 +116,12 @@ public:
 	, m_remove_from_cache(false)
 	, m_only_append(false)
 	, m_removed_from_page(true)
+	, m_chunk(false)
+	, m_compressed(false)
 	, m_sync_state(sync_state_t::NOT_SYNCING)
 	, m_data(std::make_shared<std::string>(data.to_string()))
-	, m_json(std::make_shared<std::string>(json.to_string())) {
+	, m_json(std::make_shared<std::string>(json.to_string()))
+	, m_data_size(0) {
 		memcpy(m_id.id, id, DNET_ID_SIZE);
 		dnet_empty_time(&m_timestamp);
 
@@ -248,6 +259,27 @@ public:
 		m_removed_from_page = removed_from_page;
 	}
 
+	bool is_chunk() const {
+		return m_chunk;
+	}
+
+	// data is stored compressed, @data() returns compressed data then and it should be decompressed
+	// to @data_size() bytes. Only clean records are compressed, so compressed data is never modified
+	// and may be decompressed without the lock.
+	bool is_compressed() const {
+		return m_compressed;
+	}
+
+	size_t data_size() const {
+		return m_compressed ? m_data_size : m_data->size();
+	}
+
+	void set_data(const std::shared_ptr<std::string> &data, bool compressed, size_t data_size) {
+		m_data = data;
+		m_compressed = compressed;
+		m_data_size = data_size;
+	}
+
 	size_t size(void) const {
 		return capacity() + overhead_size();
 	}
@@ -261,8 +293,9 @@ public:
 		       (m_json ? m_json->capacity() : 0);
 	}
 
+	// item of compressed record holds compressed data
 	cache_item get_cache_item() const {
-		return {m_timestamp, m_json_timestamp, m_user_flags, m_data, m_json};
+		return {m_timestamp, m_json_timestamp, m_user_flags, m_data, m_json, 0, data_size()};
 	}
 
 	friend bool operator< (const data_t &a, const data_t &b) {
@@ -305,6 +338,11 @@ public:
 		return 0;
 	}
 
+protected:
+	void set_chunk() {
+		m_chunk = true;
+	}
+
 private:
 	size_t m_lifetime;
 	size_t m_synctime;
@@ -315,11 +353,36 @@ private:
 	bool m_remove_from_cache;
 	bool m_only_append;
 	bool m_removed_from_page;
+	bool m_chunk;
+	bool m_compressed;
 	sync_state_t m_sync_state;
 	char m_cache_page_number;
 	struct dnet_raw_id m_id;
 	std::shared_ptr<std::string> m_data;
 	std::shared_ptr<std::string> m_json;
+	// size of decompressed data
+	size_t m_data_size;
+};
+
+/*
+ * Part of the data of large object cached by chunks. Chunks of the object are placed to pages and evicted
+ * independently, they aren't in the treap and are never dirty: writes to such object are handled by
+ * the backend and update cached chunks in place.
+ */
+class chunk_t : public data_t {
+public:
+	chunk_t(const unsigned char *id, uint64_t index, const ioremap::elliptics::data_pointer &data)
+	: data_t(id, 0, ioremap::elliptics::data_pointer(), data, false)
+	, m_index(index) {
+		set_chunk();
+	}
+
+	uint64_t index() const {
+		return m_index;
+	}
+
+private:
+	uint64_t m_index;
 };
 
 typedef boost::intrusive::list<data_t, boost::intrusive::base_hook<lru_list_base_hook_t> > lru_list_t;
@@ -332,6 +395,27 @@ struct cache_stats {
 	, size_of_objects(0)
 	, number_of_objects_marked_for_deletion(0)
 	, size_of_objects_marked_for_deletion(0)
+	, number_of_warmup_objects(0)
+	, number_of_warmed_up_objects(0)
+	, size_of_warmed_up_objects(0)
+	, number_of_skipped_warmup_objects(0)
+	, number_of_coalesced_misses(0)
+	, number_of_fill_wait_timeouts(0)
+	, number_of_admitted_objects(0)
+	, number_of_rejected_objects(0)
+	, number_of_chunked_objects(0)
+	, number_of_chunks(0)
+	, number_of_dirty_objects(0)
+	, size_of_dirty_objects(0)
+	, number_of_flushed_objects(0)
+	, last_flush_lag(0)
+	, last_flush_time(0)
+	, number_of_compressed_objects(0)
+	, size_of_compressed_data(0)
+	, logical_size_of_compressed_data(0)
+	, number_of_incompressible_objects(0)
+	, compression_time(0)
+	, decompression_time(0)
 	{
 	}
 
@@ -340,6 +424,47 @@ struct cache_stats {
 	std::size_t number_of_objects_marked_for_deletion;
 	std::size_t size_of_objects_marked_for_deletion;
 
+	// warm-up from snapshot: number of objects in the snapshot, number and size of objects placed to the cache,
+	// number of objects which were not placed (removed from disk, already cached or didn't fit into page)
+	std::size_t number_of_warmup_objects;
+	std::size_t number_of_warmed_up_objects;
+	std::size_t size_of_warmed_up_objects;
+	std::size_t number_of_skipped_warmup_objects;
+
+	// number of misses which waited for concurrent fill of the same key from disk instead of reading it,
+	// and number of them which didn't get the result in time and read the key from disk by themselves
+	std::size_t number_of_coalesced_misses;
+	std::size_t number_of_fill_wait_timeouts;
+
+	// admission filter: number of records read from disk which were placed into the full cache
+	// evicting other records and number of records which were returned without caching
+	std::size_t number_of_admitted_objects;
+	std::size_t number_of_rejected_objects;
+
+	// number of large objects cached by chunks and number of their chunks in the cache,
+	// chunks are also counted in @number_of_objects and @size_of_objects
+	std::size_t number_of_chunked_objects;
+	std::size_t number_of_chunks;
+
+	// records written to the cache and not synced to disk yet
+	std::size_t number_of_dirty_objects;
+	std::size_t size_of_dirty_objects;
+	// number of records synced to disk by life-check, by how many seconds the most overdue record
+	// of the last flush missed its sync time and how long the last flush took in milliseconds
+	std::size_t number_of_flushed_objects;
+	std::size_t last_flush_lag;
+	std::size_t last_flush_time;
+
+	// records whose data is stored compressed, size of their compressed data and size of the data
+	// after decompression, number of records whose data wasn't compressed since it didn't shrink enough
+	// and total time in microseconds spent on compression and decompression
+	std::size_t number_of_compressed_objects;
+	std::size_t size_of_compressed_data;
+	std::size_t logical_size_of_compressed_data;
+	std::size_t number_of_incompressible_objects;
+	std::size_t compression_time;
+	std::size_t decompression_time;
+
 	std::vector<size_t> pages_sizes;
 	std::vector<size_t> pages_max_sizes;
 
@@ -360,9 +485,115 @@ struct cache_stats {
 			pages_max_sizes_stat.PushBack(*it, allocator);
 		}
 		value.AddMember("pages_max_sizes", pages_max_sizes_stat, allocator);
+
+		rapidjson::Value warmup_stat(rapidjson::kObjectType);
+		warmup_stat.AddMember("objects", number_of_warmup_objects, allocator);
+		warmup_stat.AddMember("loaded_objects", number_of_warmed_up_objects, allocator);
+		warmup_stat.AddMember("loaded_size", size_of_warmed_up_objects, allocator);
+		warmup_stat.AddMember("skipped_objects", number_of_skipped_warmup_objects, allocator);
+		warmup_stat.AddMember("in_progress",
+		                      number_of_warmed_up_objects + number_of_skipped_warmup_objects <
+		                              number_of_warmup_objects,
+		                      allocator);
+		value.AddMember("warmup", warmup_stat, allocator);
+
+		rapidjson::Value fills_stat(rapidjson::kObjectType);
+		fills_stat.AddMember("coalesced_misses", number_of_coalesced_misses, allocator);
+		fills_stat.AddMember("wait_timeouts", number_of_fill_wait_timeouts, allocator);
+		value.AddMember("fills", fills_stat, allocator);
+
+		rapidjson::Value admission_stat(rapidjson::kObjectType);
+		admission_stat.AddMember("accepted", number_of_admitted_objects, allocator);
+		admission_stat.AddMember("rejected", number_of_rejected_objects, allocator);
+		value.AddMember("admission", admission_stat, allocator);
+
+		rapidjson::Value chunks_stat(rapidjson::kObjectType);
+		chunks_stat.AddMember("objects", number_of_chunked_objects, allocator);
+		chunks_stat.AddMember("chunks", number_of_chunks, allocator);
+		value.AddMember("chunks", chunks_stat, allocator);
+
+		rapidjson::Value flush_stat(rapidjson::kObjectType);
+		flush_stat.AddMember("dirty_objects", number_of_dirty_objects, allocator);
+		flush_stat.AddMember("dirty_size", size_of_dirty_objects, allocator);
+		flush_stat.AddMember("flushed_objects", number_of_flushed_objects, allocator);
+		flush_stat.AddMember("lag", last_flush_lag, allocator);
+		flush_stat.AddMember("time", last_flush_time, allocator);
+		value.AddMember("flush", flush_stat, allocator);
+
+		rapidjson::Value compression_stat(rapidjson::kObjectType);
+		compression_stat.AddMember("objects", number_of_compressed_objects, allocator);
+		compression_stat.AddMember("size", size_of_compressed_data, allocator);
+		compression_stat.AddMember("logical_size", logical_size_of_compressed_data, allocator);
+		compression_stat.AddMember("incompressible_objects", number_of_incompressible_objects, allocator);
+		compression_stat.AddMember("compression_time", compression_time, allocator);
+		compression_stat.AddMember("decompression_time", decompression_time, allocator);
+		value.AddMember("compression", compression_stat, allocator);
+	}
+};
+
+// statistics of the second tier of the cache, see l2_cache_t
+struct l2_cache_stats {
+	l2_cache_stats()
+	: number_of_objects(0)
+	, size_of_objects(0)
+	, max_size(0)
+	, number_of_hits(0)
+	, number_of_misses(0)
+	, number_of_written_objects(0)
+	, number_of_dropped_objects(0)
+	, number_of_errors(0)
+	{
+	}
+
+	// records in the tier and size they occupy in the log file including headers
+	std::size_t number_of_objects;
+	std::size_t size_of_objects;
+	std::size_t max_size;
+
+	// number of misses of the memory served by the tier and number of ones which weren't
+	std::size_t number_of_hits;
+	std::size_t number_of_misses;
+
+	// number of evicted records written to the tier and number of ones which were dropped
+	// since the write queue was full or the record was too large
+	std::size_t number_of_written_objects;
+	std::size_t number_of_dropped_objects;
+
+	// number of failed reads and writes of the log file
+	std::size_t number_of_errors;
+
+	void to_json(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator) const {
+		value.AddMember("objects", number_of_objects, allocator);
+		value.AddMember("size", size_of_objects, allocator);
+		value.AddMember("max_size", max_size, allocator);
+		value.AddMember("hits", number_of_hits, allocator);
+		value.AddMember("misses", number_of_misses, allocator);
+		value.AddMember("written_objects", number_of_written_objects, allocator);
+		value.AddMember("dropped_objects", number_of_dropped_objects, allocator);
+		value.AddMember("errors", number_of_errors, allocator);
 	}
 };
 
+/*
+ * Cache record stored in the snapshot.
+ * @item.data and @item.json are null if only the key is stored.
+ */
+struct snapshot_record {
+	snapshot_record()
+	: page_number(0)
+	, lifetime(0)
+	, remove_from_disk(false)
+	, item{{0, 0}, {0, 0}, 0, nullptr, nullptr} {
+		memset(&id, 0, sizeof(id));
+	}
+
+	dnet_raw_id id;
+	size_t page_number;
+	size_t lifetime;
+	bool remove_from_disk;
+	cache_item item;
+};
+
 struct write_request {
 	write_request(unsigned char *id, struct dnet_io_attr *io, ioremap::elliptics::data_pointer &data);
 	write_request(unsigned char *id,
@@ -402,6 +633,7 @@ typedef std::tuple<write_status, int, cache_item> write_response_t;
 typedef std::tuple<int, cache_item> read_response_t;
 
 class slru_cache_t;
+class l2_cache_t;
 class cache_config;
 
 class cache_manager {
@@ -414,7 +646,9 @@ public:
 	                       const write_request &request,
 	                       dnet_access_context *context);
 
-	read_response_t read(const unsigned char *id, uint64_t ioflags);
+	// returns range [@offset, @offset + @size) of the data or the whole data if @size is 0,
+	// the returned item may hold larger range of the data
+	read_response_t read(const unsigned char *id, uint64_t ioflags, uint64_t offset = 0, uint64_t size = 0);
 
 	int remove(const dnet_cmd *cmd, ioremap::elliptics::dnet_remove_request &request, dnet_access_context *context);
 
@@ -428,16 +662,37 @@ public:
 
 	cache_stats get_total_cache_stats() const;
 
+	// returns zero stats if the second tier is disabled
+	l2_cache_stats get_l2_cache_stats() const;
+
 	void statistics(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator) const;
 
 private:
 	dnet_node *m_node;
+	dnet_backend &m_backend;
+	// second tier shared by all shards, null if disabled. It is declared before @m_caches,
+	// so it outlives shards which use it
+	std::unique_ptr<l2_cache_t> m_l2;
 	std::vector<std::shared_ptr<slru_cache_t>> m_caches;
 	size_t m_max_cache_size;
 	size_t m_cache_pages_number;
 	bool m_need_exit; // @m_need_exit is shared between slru_caches and signals them to stop
 
+	std::string m_snapshot_path;
+	size_t m_snapshot_value_size;
+	size_t m_warmup_rate;
+	// records loaded from the snapshot and flags of their processing by warm-up
+	std::vector<snapshot_record> m_warmup_records;
+	std::vector<bool> m_warmup_processed;
+	std::thread m_warmup;
+
 	size_t idx(const unsigned char *id);
+
+	bool need_exit() const;
+
+	void load_snapshot();
+	void dump_snapshot();
+	void warm_up();
 };
 
 template <typename T>
@@ -0,0 +1,62 @@
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*/
+
+#ifndef CACHE_COMPRESSION_HPP
+#define CACHE_COMPRESSION_HPP
+
+#include <memory>
+#include <string>
+
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/detail/config/zlib.hpp>
+
+namespace ioremap { namespace cache {
+
+/*
+ * Compresses @size bytes of @data by zlib with the fastest level.
+ * Returns null if compression saves less than 1/8 of @size, so such data is better stored as is.
+ */
+static inline std::shared_ptr<std::string> compress_value(const char *data, size_t size) {
+	auto compressed = std::make_shared<std::string>();
+
+	boost::iostreams::filtering_streambuf<boost::iostreams::output> out;
+	out.push(boost::iostreams::zlib_compressor(boost::iostreams::zlib::best_speed));
+	out.push(std::back_inserter(*compressed));
+	boost::iostreams::copy(boost::make_iterator_range(data, data + size), out);
+
+	if (compressed->size() > size - size / 8)
+		return nullptr;
+
+	// cache accounts capacity of strings
+	compressed->shrink_to_fit();
+	return compressed;
+}
+
+/*
+ * Decompresses @compressed data whose original size is @size, the result is allocated only once.
+ */
+static inline std::shared_ptr<std::string> decompress_value(const std::string &compressed, size_t size) {
+	auto data = std::make_shared<std::string>();
+	data->reserve(size);
+
+	boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
+	in.push(boost::iostreams::zlib_decompressor());
+	in.push(boost::make_iterator_range(compressed));
+	boost::iostreams::copy(in, std::back_inserter(*data));
+	return data;
+}
+
+}} /* namespace ioremap::cache */
+
+#endif // CACHE_COMPRESSION_HPP
@@ -0,0 +1,100 @@
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*/
+
+#ifndef FREQUENCY_SKETCH_HPP
+#define FREQUENCY_SKETCH_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "elliptics/packet.h"
+
+namespace ioremap { namespace cache {
+
+/*
+ * Approximate counter of accesses to keys (count-min sketch) used by the admission filter of the cache.
+ * Every key is counted in one 4-bit counter of each row and its frequency is the minimum of them.
+ * Once the number of counted accesses reaches 10 times the width of the sketch all counters are halved,
+ * so the sketch reflects recent popularity of keys rather than all-time one.
+ */
+class frequency_sketch_t {
+public:
+	// @width is the number of counters in a row, it is rounded up to a power of two
+	explicit frequency_sketch_t(size_t width)
+	: m_width(1)
+	, m_additions(0) {
+		while (m_width < width)
+			m_width <<= 1;
+		m_sample_size = 10 * m_width;
+		// two counters per byte
+		m_table.assign(rows * m_width / 2 + 1, 0);
+	}
+
+	void increment(const unsigned char *id) {
+		bool added = false;
+		for (size_t row = 0; row < rows; ++row) {
+			const size_t index = counter_index(id, row);
+			if (counter(index) < max_counter) {
+				m_table[index / 2] += 1 << shift(index);
+				added = true;
+			}
+		}
+
+		if (added && ++m_additions >= m_sample_size)
+			age();
+	}
+
+	unsigned estimate(const unsigned char *id) const {
+		unsigned ret = max_counter;
+		for (size_t row = 0; row < rows; ++row)
+			ret = std::min(ret, counter(counter_index(id, row)));
+		return ret;
+	}
+
+private:
+	static const size_t rows = 4;
+	static const unsigned max_counter = 15;
+
+	size_t m_width;
+	size_t m_sample_size;
+	size_t m_additions;
+	std::vector<uint8_t> m_table;
+
+	// keys are sha512 digests, so their words are used as independent hashes;
+	// the first and the last ones are skipped since they select the cache shard
+	size_t counter_index(const unsigned char *id, size_t row) const {
+		static_assert(DNET_ID_SIZE >= (rows + 2) * sizeof(uint64_t), "id is too short for the sketch");
+		uint64_t hash;
+		memcpy(&hash, id + (row + 1) * sizeof(hash), sizeof(hash));
+		return row * m_width + (hash & (m_width - 1));
+	}
+
+	static unsigned shift(size_t index) {
+		return (index & 1) * 4;
+	}
+
+	unsigned counter(size_t index) const {
+		return (m_table[index / 2] >> shift(index)) & 0xf;
+	}
+
+	void age() {
+		for (auto &counters : m_table)
+			counters = (counters >> 1) & 0x77;
+		m_additions /= 2;
+	}
+};
+
+}} /* namespace ioremap::cache */
+
+#endif // FREQUENCY_SKETCH_HPP
@@ -0,0 +1,404 @@
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*/
+
+#include "l2_cache.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <iterator>
+
+#include "compression.hpp"
+#include "library/elliptics.h"
+
+namespace ioremap { namespace cache {
+
+/*
+ * Log file is node-local, so numbers are stored in host byte order:
+ *
+ * record: id[DNET_ID_SIZE], json_size, data_size, json, data
+ *
+ * Metadata of records is kept by the in-memory index, the header is used only to verify the read record.
+ */
+struct l2_record_header {
+	uint8_t id[DNET_ID_SIZE];
+	uint64_t json_size;
+	uint64_t data_size;
+};
+
+// maximum total size of records waiting to be written, records evicted above it are dropped
+static const size_t l2_max_pending_size = 64 << 20;
+
+// records larger than this share of the log are not written, so a few large records
+// don't wipe out the whole tier
+static const size_t l2_max_record_share = 16;
+
+static int write_all(int fd, const char *data, uint64_t size, uint64_t offset) {
+	while (size) {
+		const ssize_t written = ::pwrite(fd, data, size, offset);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+
+		data += written;
+		size -= written;
+		offset += written;
+	}
+	return 0;
+}
+
+static int read_all(int fd, char *data, uint64_t size, uint64_t offset) {
+	while (size) {
+		const ssize_t read = ::pread(fd, data, size, offset);
+		if (read < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		if (read == 0)
+			return -EIO;
+
+		data += read;
+		size -= read;
+		offset += read;
+	}
+	return 0;
+}
+
+// size of memory held by the item
+static size_t item_size(const cache_item &item) {
+	return item.json->size() + item.data->size();
+}
+
+// size of the item written to the log, compressed data is written decompressed
+static uint64_t record_size(const cache_item &item, bool compressed) {
+	return sizeof(l2_record_header) + item.json->size() + (compressed ? item.total_data_size : item.data->size());
+}
+
+l2_cache_t::l2_cache_t(dnet_node *n, size_t backend_id, const std::string &path, size_t max_size)
+: m_node(n)
+, m_backend_id(backend_id)
+, m_path(path)
+, m_max_size(max_size)
+, m_fd(-1)
+, m_write_offset(0)
+, m_generation(0)
+, m_pending_size(0)
+, m_writing(false)
+, m_writing_removed(false)
+, m_need_exit(false) {
+	memset(&m_writing_id, 0, sizeof(m_writing_id));
+	m_stats.max_size = max_size;
+}
+
+l2_cache_t::~l2_cache_t() {
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_need_exit = true;
+	}
+	m_pending_event.notify_all();
+
+	if (m_writer.joinable())
+		m_writer.join();
+
+	if (m_fd >= 0) {
+		::close(m_fd);
+		::unlink(m_path.c_str());
+	}
+}
+
+int l2_cache_t::open() {
+	m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (m_fd < 0) {
+		const int err = -errno;
+		DNET_LOG_ERROR(m_node, "cache: l2: backend: {}: failed to create {}: {} [{}]",
+		               m_backend_id, m_path, strerror(-err), err);
+		return err;
+	}
+
+	m_writer = std::thread(std::bind(&l2_cache_t::writer, this));
+
+	DNET_LOG_INFO(m_node, "cache: l2: backend: {}: created {}, max size: {}", m_backend_id, m_path, m_max_size);
+	return 0;
+}
+
+void l2_cache_t::put(const unsigned char *id, const cache_item &item, bool compressed) {
+	dnet_raw_id raw_id;
+	memcpy(raw_id.id, id, DNET_ID_SIZE);
+
+	const size_t size = item_size(item);
+
+	std::lock_guard<std::mutex> guard(m_lock);
+
+	// the tier already has the same version of the record, since writes drop it from the tier
+	if (m_index.count(raw_id))
+		return;
+
+	if (record_size(item, compressed) > m_max_size / l2_max_record_share ||
+	    m_pending_size + size > l2_max_pending_size) {
+		++m_stats.number_of_dropped_objects;
+		return;
+	}
+
+	auto it = m_pending.find(raw_id);
+	if (it != m_pending.end()) {
+		m_pending_size -= item_size(it->second.item);
+		it->second = pending_t{item, compressed};
+	} else {
+		m_pending.emplace(raw_id, pending_t{item, compressed});
+		m_pending_order.push_back(raw_id);
+	}
+	m_pending_size += size;
+
+	m_pending_event.notify_one();
+}
+
+int l2_cache_t::read(const unsigned char *id,
+                     uint64_t *user_flags,
+                     ioremap::elliptics::data_pointer *json,
+                     dnet_time *json_ts,
+                     ioremap::elliptics::data_pointer *data,
+                     dnet_time *data_ts) {
+	dnet_raw_id raw_id;
+	memcpy(raw_id.id, id, DNET_ID_SIZE);
+
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	auto it = m_index.find(raw_id);
+	if (it == m_index.end()) {
+		++m_stats.number_of_misses;
+		return -ENOENT;
+	}
+	const entry_t entry = it->second;
+
+	guard.unlock();
+
+	auto buffer = ioremap::elliptics::data_pointer::allocate(entry.size);
+	int err = read_all(m_fd, buffer.data<char>(), entry.size, entry.offset);
+
+	guard.lock();
+
+	it = m_index.find(raw_id);
+	if (it == m_index.end() || it->second.generation != entry.generation) {
+		// the record was dropped and its place in the log could be overwritten during the read
+		++m_stats.number_of_misses;
+		return -ENOENT;
+	}
+
+	const auto header = buffer.data<l2_record_header>();
+	if (!err && (memcmp(header->id, id, DNET_ID_SIZE) ||
+	             header->json_size != entry.json_size ||
+	             header->data_size != entry.data_size)) {
+		err = -EIO;
+	}
+
+	if (err) {
+		++m_stats.number_of_errors;
+		++m_stats.number_of_misses;
+		erase_entry(it);
+		DNET_LOG_ERROR(m_node, "{}: cache: l2: backend: {}: failed to read record: "
+		                       "offset: {}, size: {}: {} [{}]",
+		               dnet_dump_id_str(id), m_backend_id, entry.offset, entry.size, strerror(-err), err);
+		return -ENOENT;
+	}
+
+	++m_stats.number_of_hits;
+
+	guard.unlock();
+
+	*user_flags = entry.user_flags;
+	*json_ts = entry.json_timestamp;
+	*data_ts = entry.timestamp;
+	*json = buffer.slice(sizeof(l2_record_header), entry.json_size);
+	*data = buffer.slice(sizeof(l2_record_header) + entry.json_size, entry.data_size);
+	return 0;
+}
+
+void l2_cache_t::remove(const unsigned char *id) {
+	dnet_raw_id raw_id;
+	memcpy(raw_id.id, id, DNET_ID_SIZE);
+
+	std::lock_guard<std::mutex> guard(m_lock);
+
+	auto it = m_index.find(raw_id);
+	if (it != m_index.end())
+		erase_entry(it);
+
+	auto pending_it = m_pending.find(raw_id);
+	if (pending_it != m_pending.end()) {
+		m_pending_size -= item_size(pending_it->second.item);
+		m_pending.erase(pending_it);
+	}
+
+	if (m_writing && !memcmp(m_writing_id.id, id, DNET_ID_SIZE))
+		m_writing_removed = true;
+}
+
+void l2_cache_t::clear() {
+	std::lock_guard<std::mutex> guard(m_lock);
+
+	m_index.clear();
+	m_offsets.clear();
+	m_write_offset = 0;
+
+	m_pending.clear();
+	m_pending_order.clear();
+	m_pending_size = 0;
+
+	if (m_writing)
+		m_writing_removed = true;
+
+	m_stats.number_of_objects = 0;
+	m_stats.size_of_objects = 0;
+}
+
+l2_cache_stats l2_cache_t::get_stats() const {
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_stats;
+}
+
+void l2_cache_t::writer() {
+	dnet_set_name("dnet_cache_l2_%zu", m_backend_id);
+
+	std::unique_lock<std::mutex> guard(m_lock);
+	while (true) {
+		m_pending_event.wait(guard, [this] () {
+			return m_need_exit || !m_pending_order.empty();
+		});
+		if (m_need_exit)
+			break;
+
+		const dnet_raw_id id = m_pending_order.front();
+		m_pending_order.pop_front();
+
+		auto it = m_pending.find(id);
+		// the record was removed or already written
+		if (it == m_pending.end())
+			continue;
+
+		const pending_t pending = it->second;
+		m_pending_size -= item_size(pending.item);
+		m_pending.erase(it);
+
+		write_record(guard, id, pending.item, pending.compressed);
+	}
+}
+
+void l2_cache_t::write_record(std::unique_lock<std::mutex> &guard,
+                              const dnet_raw_id &id,
+                              const cache_item &item,
+                              bool compressed) {
+	const uint64_t size = record_size(item, compressed);
+
+	if (m_write_offset + size > m_max_size)
+		m_write_offset = 0;
+
+	const uint64_t offset = m_write_offset;
+	m_write_offset += size;
+	// records are dropped before they are overwritten, so readers of them notice it
+	drop_range(offset, offset + size);
+
+	m_writing_id = id;
+	m_writing = true;
+	m_writing_removed = false;
+
+	guard.unlock();
+
+	// shards of the memory pass data of compressed records as is, so they don't decompress it under their locks
+	auto data = item.data;
+	if (compressed)
+		data = decompress_value(*data, item.total_data_size);
+
+	l2_record_header header;
+	memcpy(header.id, id.id, DNET_ID_SIZE);
+	header.json_size = item.json->size();
+	header.data_size = data->size();
+
+	int err = 0;
+	// the space for the record is reserved by the size of its decompressed data
+	if (sizeof(header) + header.json_size + header.data_size != size)
+		err = -EILSEQ;
+	if (!err)
+		err = write_all(m_fd, reinterpret_cast<const char *>(&header), sizeof(header), offset);
+	if (!err)
+		err = write_all(m_fd, item.json->data(), header.json_size, offset + sizeof(header));
+	if (!err)
+		err = write_all(m_fd, data->data(), header.data_size, offset + sizeof(header) + header.json_size);
+
+	guard.lock();
+
+	m_writing = false;
+
+	if (err) {
+		++m_stats.number_of_errors;
+		DNET_LOG_ERROR(m_node, "{}: cache: l2: backend: {}: failed to write record: "
+		                       "offset: {}, size: {}: {} [{}]",
+		               dnet_dump_id_str(id.id), m_backend_id, offset, size, strerror(-err), err);
+		return;
+	}
+
+	// the record was outdated or the tier was cleared during the write
+	if (m_writing_removed)
+		return;
+
+	auto it = m_index.find(id);
+	if (it != m_index.end())
+		erase_entry(it);
+
+	entry_t entry;
+	entry.offset = offset;
+	entry.size = size;
+	entry.json_size = header.json_size;
+	entry.data_size = header.data_size;
+	entry.user_flags = item.user_flags;
+	entry.timestamp = item.timestamp;
+	entry.json_timestamp = item.json_timestamp;
+	entry.generation = ++m_generation;
+
+	m_index.emplace(id, entry);
+	m_offsets.emplace(offset, id);
+
+	++m_stats.number_of_objects;
+	m_stats.size_of_objects += size;
+	++m_stats.number_of_written_objects;
+}
+
+void l2_cache_t::drop_range(uint64_t begin, uint64_t end) {
+	auto it = m_offsets.lower_bound(begin);
+	// the previous record may end inside the range
+	if (it != m_offsets.begin()) {
+		auto prev = std::prev(it);
+		const auto &entry = m_index.find(prev->second)->second;
+		if (entry.offset + entry.size > begin)
+			it = prev;
+	}
+
+	while (it != m_offsets.end() && it->first < end) {
+		auto entry_it = m_index.find(it->second);
+		++it;
+		erase_entry(entry_it);
+	}
+}
+
+void l2_cache_t::erase_entry(std::map<dnet_raw_id, entry_t, id_less_t>::iterator it) {
+	--m_stats.number_of_objects;
+	m_stats.size_of_objects -= it->second.size;
+	m_offsets.erase(it->second.offset);
+	m_index.erase(it);
+}
+
+}} /* namespace ioremap::cache */
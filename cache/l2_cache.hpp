@@ -0,0 +1,137 @@
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*/
+
+#ifndef CACHE_L2_CACHE_HPP
+#define CACHE_L2_CACHE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "cache.hpp"
+#include "elliptics/result_entry.hpp"
+
+namespace ioremap { namespace cache {
+
+/*
+ * Second tier of the cache placed on a fast local disk (e.g. NVMe SSD).
+ *
+ * Clean records evicted from the memory are queued and appended by the background thread to the log file,
+ * which is used as a ring buffer: when the log reaches its maximum size writing continues from its beginning
+ * and records overwritten by it are dropped from the in-memory index. Misses of the memory read records
+ * from the tier before reading them from the backend.
+ *
+ * Records are dropped from the tier by writes and removes of their keys through the cache. The log file is
+ * recreated on every enable of the backend, so content of the tier doesn't survive restarts.
+ */
+class l2_cache_t {
+public:
+	l2_cache_t(dnet_node *n, size_t backend_id, const std::string &path, size_t max_size);
+	~l2_cache_t();
+
+	// creates the log file and starts the writer, returns 0 on success, negative error code otherwise
+	int open();
+
+	// queues clean record @id evicted from the memory to be written to the tier,
+	// the record is dropped if the queue is full. If @compressed is set, data of @item is compressed
+	// and it's decompressed by the writer.
+	void put(const unsigned char *id, const cache_item &item, bool compressed);
+
+	// reads record @id from the tier, returns -ENOENT if there is no such record
+	int read(const unsigned char *id,
+	         uint64_t *user_flags,
+	         ioremap::elliptics::data_pointer *json,
+	         dnet_time *json_ts,
+	         ioremap::elliptics::data_pointer *data,
+	         dnet_time *data_ts);
+
+	// drops record @id from the tier and from the write queue, since it's outdated by write or remove
+	void remove(const unsigned char *id);
+
+	void clear();
+
+	l2_cache_stats get_stats() const;
+
+private:
+	struct entry_t {
+		uint64_t offset;
+		// size of the record in the log including its header
+		uint64_t size;
+		uint64_t json_size;
+		uint64_t data_size;
+		uint64_t user_flags;
+		dnet_time timestamp;
+		dnet_time json_timestamp;
+		// unique number of the write, reader checks it didn't change while the record was read,
+		// otherwise the record could be overwritten during the read
+		uint64_t generation;
+	};
+
+	typedef ioremap::elliptics::dnet_raw_id_less_than<> id_less_t;
+
+	dnet_node *m_node;
+	size_t m_backend_id;
+	std::string m_path;
+	uint64_t m_max_size;
+	int m_fd;
+
+	mutable std::mutex m_lock;
+	std::map<dnet_raw_id, entry_t, id_less_t> m_index;
+	// offsets of records in the log, they are dropped when the write position passes over them
+	std::map<uint64_t, dnet_raw_id> m_offsets;
+	// position in the log where the next record is written to
+	uint64_t m_write_offset;
+	uint64_t m_generation;
+
+	// records waiting to be written, @m_pending_order keeps their order and may contain ids
+	// which were already removed from @m_pending
+	struct pending_t {
+		cache_item item;
+		bool compressed;
+	};
+	std::map<dnet_raw_id, pending_t, id_less_t> m_pending;
+	std::deque<dnet_raw_id> m_pending_order;
+	size_t m_pending_size;
+	std::condition_variable m_pending_event;
+
+	// record which is being written by the writer, it's not inserted into the index
+	// if it was removed during the write
+	dnet_raw_id m_writing_id;
+	bool m_writing;
+	bool m_writing_removed;
+
+	bool m_need_exit;
+	std::thread m_writer;
+
+	mutable l2_cache_stats m_stats;
+
+	l2_cache_t(const l2_cache_t &) = delete;
+
+	void writer();
+
+	void write_record(std::unique_lock<std::mutex> &guard,
+	                  const dnet_raw_id &id,
+	                  const cache_item &item,
+	                  bool compressed);
+
+	// drops records which overlap range [@begin, @end) of the log
+	void drop_range(uint64_t begin, uint64_t end);
+
+	void erase_entry(std::map<dnet_raw_id, entry_t, id_less_t>::iterator it);
+};
+
+}} /* namespace ioremap::cache */
+
+#endif // CACHE_L2_CACHE_HPP
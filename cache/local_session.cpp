@@ -79,12 +79,15 @@ int local_session::read(const dnet_id &id,
                         ioremap::elliptics::data_pointer *json,
                         dnet_time *json_ts,
                         ioremap::elliptics::data_pointer *data,
-                        dnet_time *data_ts) {
+                        dnet_time *data_ts,
+                        uint64_t data_offset,
+                        uint64_t data_size,
+                        uint64_t *total_data_size) {
 	const uint64_t read_flags = (json ? DNET_READ_FLAGS_JSON : 0) | (data ? DNET_READ_FLAGS_DATA : 0);
 	auto packet = serialize(dnet_read_request{/*ioflags*/ m_ioflags,
 	                                          /*read_flags*/ read_flags,
-	                                          /*data_offset*/ 0,
-	                                          /*data_size*/ 0,
+	                                          /*data_offset*/ data_offset,
+	                                          /*data_size*/ data_size,
 	                                          /*deadline*/ dnet_time{0, 0}});
 
 	dnet_cmd cmd;
@@ -126,6 +129,8 @@ int local_session::read(const dnet_id &id,
 				*json_ts = response.json_timestamp;
 			if (data_ts)
 				*data_ts = response.data_timestamp;
+			if (total_data_size)
+				*total_data_size = response.data_size;
 
 			DNET_LOG_DEBUG(m_state->n, "entry in list, size: {}", req_cmd->size);
 
@@ -149,10 +154,11 @@ int local_session::read(const dnet_id &id,
 					result = data_pointer();
 				}
 
-				clear_queue();
 				*data = std::move(result);
-				return 0;
 			}
+
+			clear_queue();
+			return 0;
 		}
 	}
 
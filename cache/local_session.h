@@ -40,12 +40,19 @@ public:
 	void set_ioflags(uint32_t flags);
 	void set_cflags(uint64_t flags);
 
+	/*
+	 * Reads json and range [@data_offset, @data_offset + @data_size) of the data (up to the end if @data_size
+	 * is 0), null @json or @data means it shouldn't be read. @total_data_size is set to size of the whole data.
+	 */
 	int read(const dnet_id &id,
 	         uint64_t *user_flags,
 	         ioremap::elliptics::data_pointer *json,
 	         dnet_time *json_ts,
 	         ioremap::elliptics::data_pointer *data,
-	         dnet_time *data_ts);
+	         dnet_time *data_ts,
+	         uint64_t data_offset = 0,
+	         uint64_t data_size = 0,
+	         uint64_t *total_data_size = nullptr);
 
 	int write(const dnet_id &id, const char *data, size_t size, uint64_t user_flags, const dnet_time &timestamp);
 	int write(const dnet_id &id,
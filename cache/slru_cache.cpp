@@ -19,6 +19,8 @@
 #endif
 
 #include "slru_cache.hpp"
+#include "compression.hpp"
+#include "l2_cache.hpp"
 
 #include <deque>
 
@@ -56,6 +58,12 @@ slru_cache_t::slru_cache_t(struct dnet_node *n,
                            dnet_backend &backend,
                            const std::vector<size_t> &cache_pages_max_sizes,
                            unsigned sync_timeout,
+                           unsigned fill_wait_timeout,
+                           size_t admission_sketch_width,
+                           size_t chunk_size,
+                           unsigned flush_threads,
+                           size_t compression_threshold,
+                           l2_cache_t *l2,
                            bool &need_exit)
 : m_backend(backend)
 , m_node(n)
@@ -65,7 +73,22 @@ slru_cache_t::slru_cache_t(struct dnet_node *n,
 , m_cache_pages_lru(new lru_list_t[m_cache_pages_number])
 , m_clear_occured(false)
 , m_sync_timeout(sync_timeout)
-, m_need_exit{need_exit} {
+, m_need_exit{need_exit}
+, m_fill_wait_timeout(fill_wait_timeout)
+, m_chunk_size(chunk_size)
+, m_flush_threads(std::max(flush_threads, 1u))
+, m_l2(l2)
+, m_compression_threshold(compression_threshold)
+, m_decompression_time(0)
+, m_flush_elements(nullptr)
+, m_flush_pending(0)
+, m_flush_exit(false) {
+	if (admission_sketch_width)
+		m_admission_sketch.reset(new frequency_sketch_t(admission_sketch_width));
+	// life_check flushes one range of records by itself
+	for (unsigned i = 1; i < m_flush_threads; ++i) {
+		m_flush_workers.emplace_back(std::bind(&slru_cache_t::flush_worker, this));
+	}
 	m_lifecheck = std::thread(std::bind(&slru_cache_t::life_check, this));
 }
 
@@ -73,6 +96,14 @@ slru_cache_t::~slru_cache_t() {
 	TIMER_SCOPE("dtor");
 	DNET_LOG_NOTICE(m_node, "cache: disable: backend: {}: destructing SLRU cache", m_backend.backend_id());
 	m_lifecheck.join();
+	{
+		std::lock_guard<std::mutex> guard(m_flush_lock);
+		m_flush_exit = true;
+	}
+	m_flush_event.notify_all();
+	for (auto &worker : m_flush_workers) {
+		worker.join();
+	}
 	DNET_LOG_NOTICE(m_node, "cache: disable: backend: {}: clearing", m_backend.backend_id());
 	clear();
 	DNET_LOG_NOTICE(m_node, "cache: disable: backend: {}: destructed", m_backend.backend_id());
@@ -96,10 +127,29 @@ write_response_t slru_cache_t::write(dnet_net_state *st,
 	elliptics_unique_lock<std::mutex> guard(m_lock, m_node, "%s: CACHE WRITE: %p", dnet_dump_id_str(id), this);
 	TIMER_STOP("write.lock");
 
+	// the record in the second tier becomes outdated, it's dropped under the lock, so eviction of
+	// the previous version from the memory can't put it back to the tier
+	if (m_l2)
+		m_l2->remove(id);
+
 	TIMER_START("write.find");
 	data_t* it = m_treap.find(id);
 	TIMER_STOP("write.find");
 
+	if (m_admission_sketch)
+		m_admission_sketch->increment(id);
+
+	if (!it && m_chunk_size) {
+		dnet_raw_id raw_id;
+		memcpy(raw_id.id, id, DNET_ID_SIZE);
+		if (m_chunked_records.count(raw_id)) {
+			if (!cache_only)
+				return write_chunks(guard, st, cmd, request, context);
+			// nothing is written to disk, so the record is created from the request
+			erase_chunked_record(id);
+		}
+	}
+
 	if (!it && !cache) {
 		DNET_LOG_DEBUG(m_node, "{}: CACHE: not a cache call", dnet_dump_id_str(id));
 		return write_response_t{write_status::ERROR, -ENOTSUP, cache_item()};
@@ -121,7 +171,7 @@ write_response_t slru_cache_t::write(dnet_net_state *st,
 
 		it = populate_from_disk(guard, id, false, &err);
 
-		return write_response_t{write_status::HANDLED_IN_BACKEND, err, it->get_cache_item()};
+		return write_response_t{write_status::HANDLED_IN_BACKEND, err, get_cache_item(guard, it)};
 	}
 
 	bool new_page = false;
@@ -148,6 +198,9 @@ write_response_t slru_cache_t::write(dnet_net_state *st,
 		}
 	}
 
+	if (it->is_compressed())
+		decompress_data(it);
+
 	int err = check_cas(it, cmd, request);
 	if (err)
 		return write_response_t{write_status::ERROR, err, cache_item()};
@@ -190,6 +243,9 @@ write_response_t slru_cache_t::write(dnet_net_state *st,
 		m_cache_stats.size_of_objects_marked_for_deletion -= it->size();
 	}
 	m_cache_stats.size_of_objects -= it->size();
+	if (it->synctime()) {
+		m_cache_stats.size_of_dirty_objects -= it->size();
+	}
 
 	TIMER_START("write.modify");
 	if (update_json) {
@@ -226,8 +282,12 @@ write_response_t slru_cache_t::write(dnet_net_state *st,
 	const size_t previous_eventtime = it->eventtime();
 	const size_t current_time = time(nullptr);
 
-	if (!it->synctime() && !cache_only) {
+	if (it->synctime()) {
+		m_cache_stats.size_of_dirty_objects += it->size();
+	} else if (!cache_only) {
 		it->set_synctime(current_time + m_sync_timeout);
+		m_cache_stats.number_of_dirty_objects++;
+		m_cache_stats.size_of_dirty_objects += it->size();
 	}
 
 	if (request.cache_lifetime) {
@@ -247,7 +307,7 @@ write_response_t slru_cache_t::write(dnet_net_state *st,
 	return write_response_t{write_status::HANDLED_IN_CACHE, 0, it->get_cache_item()};
 }
 
-read_response_t slru_cache_t::read(const unsigned char *id, uint64_t ioflags) {
+read_response_t slru_cache_t::read(const unsigned char *id, uint64_t ioflags, uint64_t offset, uint64_t size) {
 	TIMER_SCOPE("read");
 
 	const bool cache = (ioflags & DNET_IO_FLAGS_CACHE);
@@ -264,13 +324,30 @@ read_response_t slru_cache_t::read(const unsigned char *id, uint64_t ioflags) {
 	auto it = m_treap.find(id);
 	TIMER_STOP("read.find");
 
+	if (m_admission_sketch)
+		m_admission_sketch->increment(id);
+
 	if (it && it->only_append()) {
 		sync_after_append(guard, true, &*it);
 		it = nullptr;
 	}
 
+	if (!it && m_chunk_size) {
+		dnet_raw_id raw_id;
+		memcpy(raw_id.id, id, DNET_ID_SIZE);
+		if (m_chunked_records.count(raw_id))
+			return read_chunks(guard, id, offset, size, cache && !cache_only, cache ? -ENOENT : -ENOTSUP);
+	}
+
+	cache_item rejected{};
+	std::shared_ptr<std::string> read_data;
 	if (!it && cache && !cache_only) {
-		it = populate_from_disk(guard, id, false, &err);
+		// concurrent misses of the same key share a single read from disk
+		if (!wait_for_fill(guard, id, &it, &rejected, &err)) {
+			if (m_chunk_size)
+				return read_chunks(guard, id, offset, size, true, -ENOENT);
+			it = populate_from_disk(guard, id, false, &err, &rejected, &read_data);
+		}
 		new_page = true;
 	}
 
@@ -288,7 +365,17 @@ read_response_t slru_cache_t::read(const unsigned char *id, uint64_t ioflags) {
 		}
 
 		move_data_between_pages(id, page_number, new_page_number, &*it);
-		return read_response_t{0, it->get_cache_item()};
+
+		if (read_data) {
+			auto item = it->get_cache_item();
+			item.data = read_data;
+			return read_response_t{0, item};
+		}
+		return read_response_t{0, get_cache_item(guard, it)};
+	}
+
+	if (!err && rejected.data) {
+		return read_response_t{0, rejected};
 	}
 
 	if (!err) {
@@ -312,6 +399,9 @@ int slru_cache_t::remove(const dnet_cmd *cmd,
 	elliptics_unique_lock<std::mutex> guard(m_lock, m_node, "%s: CACHE REMOVE: %p", dnet_dump_id_str(id), this);
 	TIMER_STOP("remove.lock");
 
+	if (m_l2)
+		m_l2->remove(id);
+
 	TIMER_START("remove.find");
 	data_t* it = m_treap.find(id);
 	TIMER_STOP("remove.find");
@@ -338,7 +428,7 @@ int slru_cache_t::remove(const dnet_cmd *cmd,
 		remove_from_disk |= it->remove_from_disk();
 		if (it->synctime() && !cache_only) {
 			size_t previous_eventtime = it->eventtime();
-			it->clear_synctime();
+			clear_synctime(it);
 
 			if (previous_eventtime != it->eventtime()) {
 				TIMER_SCOPE("remove.decrease_key");
@@ -350,6 +440,8 @@ int slru_cache_t::remove(const dnet_cmd *cmd,
 		}
 		erase_element(&(*it));
 		err = 0;
+	} else if (m_chunk_size) {
+		erase_chunked_record(id);
 	}
 
 	guard.unlock();
@@ -395,7 +487,10 @@ read_response_t slru_cache_t::lookup(const unsigned char *id) {
 	TIMER_STOP("lookup.find");
 
 	if (it) {
-		return read_response_t{0, it->get_cache_item()};
+		auto item = it->get_cache_item();
+		if (it->is_compressed())
+			item.data = std::make_shared<std::string>();
+		return read_response_t{0, item};
 	}
 
 	return read_response_t{-ENOENT, cache_item()};
@@ -431,9 +526,110 @@ void slru_cache_t::clear() {
 cache_stats slru_cache_t::get_cache_stats() const {
 	m_cache_stats.pages_sizes = m_cache_pages_sizes;
 	m_cache_stats.pages_max_sizes = m_cache_pages_max_sizes;
+	m_cache_stats.decompression_time = m_decompression_time;
 	return m_cache_stats;
 }
 
+void slru_cache_t::snapshot(std::vector<snapshot_record> &records, size_t max_value_size) {
+	// indexes of records whose data is stored compressed, it's decompressed after the lock is released
+	std::vector<size_t> compressed;
+
+	elliptics_unique_lock<std::mutex> guard(m_lock, m_node, "CACHE SNAPSHOT: %p", this);
+
+	for (size_t page_number = 0; page_number < m_cache_pages_number; ++page_number) {
+		for (const auto &obj : m_cache_pages_lru[page_number]) {
+			if (obj.only_append() || obj.remove_from_cache() || obj.is_chunk())
+				continue;
+
+			snapshot_record record;
+			record.id = obj.id();
+			record.page_number = page_number;
+			record.lifetime = obj.lifetime();
+			record.remove_from_disk = obj.remove_from_disk();
+
+			if (max_value_size && obj.data_size() + obj.json()->size() <= max_value_size) {
+				record.item = obj.get_cache_item();
+				// copy values since they are modified in place by writes, compressed data is never modified
+				if (obj.is_compressed())
+					compressed.push_back(records.size());
+				else
+					record.item.data = std::make_shared<std::string>(*record.item.data);
+				record.item.json = std::make_shared<std::string>(*record.item.json);
+			}
+
+			records.emplace_back(std::move(record));
+		}
+	}
+
+	guard.unlock();
+
+	for (auto index : compressed) {
+		auto &item = records[index].item;
+		ioremap::elliptics::util::steady_timer timer;
+		item.data = decompress_value(*item.data, item.total_data_size);
+		m_decompression_time += timer.get_us();
+	}
+}
+
+void slru_cache_t::start_warm_up(size_t objects_number) {
+	elliptics_unique_lock<std::mutex> guard(m_lock, m_node, "CACHE START WARM UP: %p", this);
+	m_cache_stats.number_of_warmup_objects += objects_number;
+}
+
+void slru_cache_t::warm_up(const snapshot_record &record) {
+	TIMER_SCOPE("warm_up");
+
+	const auto id = record.id.id;
+	const auto data = ioremap::elliptics::data_pointer::from_raw(*record.item.data);
+	const auto compressed = compress_data(data);
+
+	elliptics_unique_lock<std::mutex> guard(m_lock, m_node, "%s: CACHE WARM UP: %p", dnet_dump_id_str(id), this);
+
+	if (m_treap.find(id) || (record.lifetime && record.lifetime <= (size_t)time(nullptr))) {
+		m_cache_stats.number_of_skipped_warmup_objects++;
+		return;
+	}
+
+	std::unique_ptr<data_t> raw(new data_t(id, 0,
+	                                       ioremap::elliptics::data_pointer::from_raw(*record.item.json),
+	                                       compressed.data ? ioremap::elliptics::data_pointer() : data,
+	                                       record.remove_from_disk));
+	if (compressed.data)
+		raw->set_data(compressed.data, true, data.size());
+
+	// look for a page with enough free space starting from the one the record was dumped from
+	size_t page_number = std::min(record.page_number, m_cache_pages_number - 1);
+	for (; page_number < m_cache_pages_number; page_number = get_previous_page_number(page_number)) {
+		if (m_cache_pages_sizes[page_number] + raw->size() <= m_cache_pages_max_sizes[page_number])
+			break;
+	}
+
+	if (page_number >= m_cache_pages_number) {
+		m_cache_stats.number_of_skipped_warmup_objects++;
+		return;
+	}
+
+	raw->set_user_flags(record.item.user_flags);
+	raw->set_timestamp(record.item.timestamp);
+	raw->set_json_timestamp(record.item.json_timestamp);
+	raw->set_lifetime(record.lifetime);
+
+	const size_t size = raw->size();
+	insert_data_into_page(id, page_number, raw.get());
+	add_compression_stats(raw.get(), compressed);
+	m_treap.insert(raw.release());
+
+	m_cache_stats.number_of_objects++;
+	m_cache_stats.size_of_objects += size;
+	m_cache_stats.number_of_warmed_up_objects++;
+	m_cache_stats.size_of_warmed_up_objects += size;
+}
+
+void slru_cache_t::skip_warm_up() {
+	elliptics_unique_lock<std::mutex> guard(m_lock, m_node, "CACHE SKIP WARM UP: %p", this);
+	m_cache_stats.number_of_skipped_warmup_objects++;
+}
+
 // private:
 
 bool slru_cache_t::need_exit() const {
@@ -570,14 +766,23 @@ void slru_cache_t::move_data_between_pages(const unsigned char *id,
 data_t *slru_cache_t::create_data(const unsigned char *id,
                                   const ioremap::elliptics::data_pointer &json,
                                   const ioremap::elliptics::data_pointer &data,
-                                  bool remove_from_disk) {
+                                  bool remove_from_disk,
+                                  const compressed_data_t *compressed) {
 	TIMER_SCOPE("create_data");
 
 	size_t last_page_number = m_cache_pages_number - 1;
 
-	data_t *raw = new data_t(id, 0, json, data, remove_from_disk);
+	data_t *raw;
+	if (compressed && compressed->data) {
+		raw = new data_t(id, 0, json, ioremap::elliptics::data_pointer(), remove_from_disk);
+		raw->set_data(compressed->data, true, data.size());
+	} else {
+		raw = new data_t(id, 0, json, data, remove_from_disk);
+	}
 
 	insert_data_into_page(id, last_page_number, raw);
+	if (compressed)
+		add_compression_stats(raw, *compressed);
 
 	m_cache_stats.number_of_objects++;
 	m_cache_stats.size_of_objects += raw->size();
@@ -588,11 +793,17 @@ data_t *slru_cache_t::create_data(const unsigned char *id,
 data_t *slru_cache_t::populate_from_disk(elliptics_unique_lock<std::mutex> &guard,
                                          const unsigned char *id,
                                          bool remove_from_disk,
-                                         int *err) {
+                                         int *err,
+                                         cache_item *rejected,
+                                         std::shared_ptr<std::string> *read_data) {
 	TIMER_SCOPE("populate_from_disk");
 
-	if (guard)
-		guard.unlock();
+	if (!guard)
+		guard.lock();
+
+	auto fill = start_fill(id);
+
+	guard.unlock();
 
 	local_session sess(m_backend, m_node);
 	sess.set_ioflags(DNET_IO_FLAGS_NOCACHE);
@@ -607,13 +818,27 @@ data_t *slru_cache_t::populate_from_disk(elliptics_unique_lock<std::mutex> &guar
 	dnet_empty_time(&data_ts);
 	ioremap::elliptics::data_pointer json, data;
 
-	TIMER_START("populate_from_disk.local_read");
-	*err = sess.read(raw_id, &user_flags, &json, &json_ts, &data, &data_ts);
-	TIMER_STOP("populate_from_disk.local_read");
+	*err = -ENOENT;
+	if (m_l2) {
+		TIMER_SCOPE("populate_from_disk.l2_read");
+		*err = m_l2->read(id, &user_flags, &json, &json_ts, &data, &data_ts);
+	}
+
+	if (*err) {
+		TIMER_SCOPE("populate_from_disk.local_read");
+		*err = sess.read(raw_id, &user_flags, &json, &json_ts, &data, &data_ts);
+	}
+
+	compressed_data_t compressed;
+	if (*err == 0)
+		compressed = compress_data(data);
 
 	TIMER_START("populate_from_disk.lock");
 	guard.lock();
 	TIMER_STOP("populate_from_disk.lock");
+
+	finish_fill(id, fill, *err);
+
 	{
 		auto it = m_treap.find(id);
 		if (it) {
@@ -634,17 +859,570 @@ data_t *slru_cache_t::populate_from_disk(elliptics_unique_lock<std::mutex> &guar
 	}
 
 	if (*err == 0) {
-		auto it = create_data(id, json, data, remove_from_disk);
+		const size_t data_size = compressed.data ? compressed.data->size() : data.size();
+		if (rejected && !admit(id, data_size + json.size())) {
+			*rejected = cache_item{data_ts, json_ts, user_flags,
+			                       std::make_shared<std::string>(data.to_string()),
+			                       std::make_shared<std::string>(json.to_string()),
+			                       0, data.size()};
+			// misses waiting for this fill get the record as well
+			fill->item = *rejected;
+			return NULL;
+		}
+
+		auto it = create_data(id, json, data, remove_from_disk, &compressed);
 		it->set_user_flags(user_flags);
 		it->set_json_timestamp(json_ts);
 		it->set_timestamp(data_ts);
 
+		if (read_data && it->is_compressed())
+			*read_data = std::make_shared<std::string>(data.to_string());
+
 		return it;
 	}
 
 	return NULL;
 }
 
+bool slru_cache_t::wait_for_fill(elliptics_unique_lock<std::mutex> &guard,
+                                 const unsigned char *id,
+                                 data_t **it,
+                                 cache_item *rejected,
+                                 int *err) {
+	dnet_raw_id fill_id;
+	memcpy(fill_id.id, id, DNET_ID_SIZE);
+
+	auto fill_it = m_fills.find(fill_id);
+	if (fill_it == m_fills.end())
+		return false;
+
+	// hold the fill, since it is removed from @m_fills when finished
+	auto fill = fill_it->second;
+	++m_cache_stats.number_of_coalesced_misses;
+
+	TIMER_START("populate_from_disk.wait_for_fill");
+	const bool finished = fill->finished_event.wait_for(guard, m_fill_wait_timeout, [&fill] () {
+		return fill->finished;
+	});
+	TIMER_STOP("populate_from_disk.wait_for_fill");
+
+	if (!finished) {
+		++m_cache_stats.number_of_fill_wait_timeouts;
+		DNET_LOG_NOTICE(m_node, "{}: CACHE: fill of the record from disk hasn't finished in {} ms, "
+		                        "reading it from disk",
+		                dnet_dump_id_str(id), m_fill_wait_timeout.count());
+		return false;
+	}
+
+	if (fill->err) {
+		*err = fill->err;
+		*it = nullptr;
+		return true;
+	}
+
+	if (fill->item.data) {
+		*rejected = fill->item;
+		*it = nullptr;
+		return true;
+	}
+
+	// the record could be evicted or appended while this miss was waking up, then read it from disk
+	*it = m_treap.find(id);
+	return *it && !(*it)->only_append();
+}
+
+std::shared_ptr<slru_cache_t::fill_t> slru_cache_t::start_fill(const unsigned char *id) {
+	dnet_raw_id fill_id;
+	memcpy(fill_id.id, id, DNET_ID_SIZE);
+	auto fill = std::make_shared<fill_t>();
+	// if the fill of @id by another miss is still in progress, the newer one takes its place
+	m_fills[fill_id] = fill;
+	return fill;
+}
+
+void slru_cache_t::finish_fill(const unsigned char *id, const std::shared_ptr<fill_t> &fill, int err) {
+	dnet_raw_id fill_id;
+	memcpy(fill_id.id, id, DNET_ID_SIZE);
+
+	fill->finished = true;
+	fill->err = err;
+	auto fill_it = m_fills.find(fill_id);
+	if (fill_it != m_fills.end() && fill_it->second == fill)
+		m_fills.erase(fill_it);
+	fill->finished_event.notify_all();
+}
+
+read_response_t slru_cache_t::read_chunks(elliptics_unique_lock<std::mutex> &guard,
+                                          const unsigned char *id,
+                                          uint64_t offset,
+                                          uint64_t size,
+                                          bool populate,
+                                          int missed_err) {
+	TIMER_SCOPE("read_chunks");
+
+	dnet_raw_id raw_id;
+	memcpy(raw_id.id, id, DNET_ID_SIZE);
+
+	auto make_item = [&] (const chunked_record_t &record, std::string &&data) {
+		return cache_item{record.timestamp, record.json_timestamp, record.user_flags,
+		                  std::make_shared<std::string>(std::move(data)), record.json, offset, record.size};
+	};
+
+	// chunks covering requested range, the last one is unknown until size of the object is known
+	const uint64_t first = offset / m_chunk_size;
+	uint64_t last = size ? (offset + size - 1) / m_chunk_size : std::numeric_limits<uint64_t>::max();
+
+	bool cached = false;
+	uint64_t version = 0;
+
+	auto record_it = m_chunked_records.find(raw_id);
+	if (record_it != m_chunked_records.end()) {
+		auto &record = record_it->second;
+		// invalid offset is reported by the caller
+		if (offset >= record.size)
+			return read_response_t{0, make_item(record, std::string())};
+
+		const uint64_t end = size ? std::min(offset + size, record.size) : record.size;
+		last = (end - 1) / m_chunk_size;
+
+		bool missed = false;
+		for (uint64_t index = first; index <= last && !missed; ++index) {
+			missed = !record.chunks.count(index);
+		}
+
+		if (!missed) {
+			std::string data;
+			data.reserve(end - offset);
+			for (uint64_t index = first; index <= last; ++index) {
+				const auto &chunk_data = *record.chunks[index]->data();
+				const uint64_t chunk_offset = index * m_chunk_size;
+				const uint64_t begin = std::max(offset, chunk_offset) - chunk_offset;
+				const uint64_t chunk_end = std::min<uint64_t>(end - chunk_offset, chunk_data.size());
+				data.append(chunk_data, begin, chunk_end - begin);
+			}
+			auto item = make_item(record, std::move(data));
+
+			// promotion of chunks may evict other chunks of the object and the object itself
+			for (uint64_t index = first; index <= last; ++index) {
+				record_it = m_chunked_records.find(raw_id);
+				if (record_it == m_chunked_records.end())
+					break;
+				auto chunk_it = record_it->second.chunks.find(index);
+				if (chunk_it == record_it->second.chunks.end())
+					continue;
+
+				chunk_t *chunk = chunk_it->second;
+				const size_t page_number = chunk->cache_page_number();
+				move_data_between_pages(id, page_number, get_next_page_number(page_number), chunk);
+			}
+
+			return read_response_t{0, item};
+		}
+
+		if (!populate)
+			return read_response_t{missed_err, cache_item()};
+
+		cached = true;
+		version = record.version;
+	}
+
+	// read all chunks of the range, so the response doesn't depend on chunks evicted during the read
+	const uint64_t read_offset = first * m_chunk_size;
+	const uint64_t read_size = (last == std::numeric_limits<uint64_t>::max()) ? 0 :
+	                           (last - first + 1) * m_chunk_size;
+
+	auto fill = start_fill(id);
+
+	guard.unlock();
+
+	local_session sess(m_backend, m_node);
+	sess.set_ioflags(DNET_IO_FLAGS_NOCACHE);
+
+	dnet_id disk_id;
+	memset(&disk_id, 0, sizeof(disk_id));
+	memcpy(disk_id.id, id, DNET_ID_SIZE);
+
+	uint64_t user_flags = 0;
+	uint64_t total_size = 0;
+	dnet_time json_ts, data_ts;
+	dnet_empty_time(&json_ts);
+	dnet_empty_time(&data_ts);
+	ioremap::elliptics::data_pointer json, data;
+
+	int err = -ENOENT;
+	// the second tier keeps only whole records, so it's useful only for small objects
+	if (m_l2 && !cached && read_offset == 0) {
+		TIMER_SCOPE("read_chunks.l2_read");
+		err = m_l2->read(id, &user_flags, &json, &json_ts, &data, &data_ts);
+		total_size = data.size();
+		if (!err && total_size > m_chunk_size)
+			err = -ENOENT;
+	}
+
+	if (err) {
+		TIMER_SCOPE("read_chunks.local_read");
+		err = sess.read(disk_id, &user_flags, &json, &json_ts, &data, &data_ts,
+		                read_offset, read_size, &total_size);
+	}
+
+	// small object is cached as a whole record
+	const bool whole_record = (total_size <= m_chunk_size && read_offset == 0);
+	compressed_data_t compressed;
+	if (!err && whole_record)
+		compressed = compress_data(data);
+
+	TIMER_START("read_chunks.lock");
+	guard.lock();
+	TIMER_STOP("read_chunks.lock");
+
+	finish_fill(id, fill, err);
+
+	if (err)
+		return read_response_t{err, cache_item()};
+
+	{
+		auto it = m_treap.find(id);
+		if (it) {
+			// the object was written to the cache during the read, see populate_from_disk()
+			if (!it->only_append())
+				return read_response_t{0, get_cache_item(guard, it)};
+			erase_element(it);
+		}
+	}
+
+	if (whole_record) {
+		erase_chunked_record(id);
+
+		const size_t data_size = compressed.data ? compressed.data->size() : data.size();
+		if (!admit(id, data_size + json.size())) {
+			return read_response_t{0, cache_item{data_ts, json_ts, user_flags,
+			                                     std::make_shared<std::string>(data.to_string()),
+			                                     std::make_shared<std::string>(json.to_string()),
+			                                     0, data.size()}};
+		}
+
+		auto it = create_data(id, json, data, false, &compressed);
+		it->set_user_flags(user_flags);
+		it->set_json_timestamp(json_ts);
+		it->set_timestamp(data_ts);
+		auto item = it->get_cache_item();
+		// the response is built from read data, so it isn't decompressed
+		if (it->is_compressed())
+			item.data = std::make_shared<std::string>(data.to_string());
+		return read_response_t{0, item};
+	}
+
+	chunked_record_t disk_record;
+	disk_record.user_flags = user_flags;
+	disk_record.timestamp = data_ts;
+	disk_record.json_timestamp = json_ts;
+	disk_record.json = std::make_shared<std::string>(json.to_string());
+	disk_record.size = total_size;
+	disk_record.version = 0;
+
+	const uint64_t end = size ? std::min(offset + size, total_size) : total_size;
+	if (offset >= end)
+		return read_response_t{0, make_item(disk_record, std::string())};
+
+	auto item = make_item(disk_record, data.slice(offset - read_offset, end - offset).to_string());
+
+	record_it = m_chunked_records.find(raw_id);
+	if (record_it != m_chunked_records.end()) {
+		const auto &record = record_it->second;
+		// the object was written during the read, read data may be outdated
+		if (cached && record.version != version)
+			return read_response_t{0, item};
+
+		// the object was changed on disk bypassing the cache
+		if (record.size != total_size || dnet_time_cmp(&record.timestamp, &data_ts)) {
+			erase_chunked_record(id);
+			record_it = m_chunked_records.end();
+		}
+	} else if (cached) {
+		// all chunks of the object were evicted during the read
+		return read_response_t{0, item};
+	}
+
+	if (record_it == m_chunked_records.end()) {
+		if (!admit(id, data.size()))
+			return read_response_t{0, item};
+
+		m_chunked_records.emplace(raw_id, std::move(disk_record));
+		++m_cache_stats.number_of_chunked_objects;
+	}
+
+	for (uint64_t index = first; index * m_chunk_size < read_offset + data.size(); ++index) {
+		record_it = m_chunked_records.find(raw_id);
+		if (record_it->second.chunks.count(index))
+			continue;
+
+		const uint64_t chunk_offset = index * m_chunk_size - read_offset;
+		insert_chunk(id, index, data.slice(chunk_offset, std::min<uint64_t>(m_chunk_size,
+		                                                                    data.size() - chunk_offset)));
+	}
+
+	return read_response_t{0, item};
+}
+
+write_response_t slru_cache_t::write_chunks(elliptics_unique_lock<std::mutex> &guard,
+                                            dnet_net_state *st,
+                                            dnet_cmd *cmd,
+                                            const write_request &request,
+                                            dnet_access_context *context) {
+	TIMER_SCOPE("write_chunks");
+
+	const auto id = request.id;
+
+	dnet_raw_id raw_id;
+	memcpy(raw_id.id, id, DNET_ID_SIZE);
+
+	// reads from disk started before the write must not place their chunks
+	const uint64_t version = ++m_chunked_records[raw_id].version;
+
+	guard.unlock();
+
+	dnet_cmd_stats stats;
+	const auto &callbacks = m_backend.callbacks();
+	int err = callbacks.command_handler(st,
+	                                    callbacks.command_private,
+	                                    cmd,
+	                                    request.request_data,
+	                                    &stats,
+	                                    context);
+
+	// appends and writes by parts are not applied to chunks, they are dropped instead
+	const uint64_t not_in_place_flags = DNET_IO_FLAGS_APPEND | DNET_IO_FLAGS_PREPARE | DNET_IO_FLAGS_PLAIN_WRITE |
+	                                    DNET_IO_FLAGS_COMMIT;
+	const bool in_place = !err && !(request.ioflags & not_in_place_flags);
+
+	// the backend could set timestamps and size of the object, so its metadata is read back
+	int read_err = 0;
+	uint64_t user_flags = 0;
+	uint64_t total_size = 0;
+	dnet_time json_ts, data_ts;
+	dnet_empty_time(&json_ts);
+	dnet_empty_time(&data_ts);
+	ioremap::elliptics::data_pointer json;
+	if (in_place) {
+		TIMER_SCOPE("write_chunks.local_read");
+
+		local_session sess(m_backend, m_node);
+		sess.set_ioflags(DNET_IO_FLAGS_NOCACHE);
+
+		dnet_id disk_id;
+		memset(&disk_id, 0, sizeof(disk_id));
+		memcpy(disk_id.id, id, DNET_ID_SIZE);
+
+		read_err = sess.read(disk_id, &user_flags, &json, &json_ts, nullptr, &data_ts, 0, 0, &total_size);
+	}
+
+	TIMER_START("write_chunks.lock");
+	guard.lock();
+	TIMER_STOP("write_chunks.lock");
+
+	auto record_it = m_chunked_records.find(raw_id);
+	if (record_it == m_chunked_records.end())
+		return write_response_t{write_status::HANDLED_IN_BACKEND, err, cache_item()};
+
+	// the object was changed during the write by another write to the cache, so its chunks can't be patched
+	if (!in_place || read_err || record_it->second.version != version || m_treap.find(id)) {
+		erase_chunked_record(id);
+		return write_response_t{write_status::HANDLED_IN_BACKEND, err, cache_item()};
+	}
+
+	// reads from disk started during the write could read the previous data
+	auto &record = record_it->second;
+	++record.version;
+	record.user_flags = user_flags;
+	record.timestamp = data_ts;
+	record.json_timestamp = json_ts;
+	record.json = std::make_shared<std::string>(json.to_string());
+	record.size = total_size;
+
+	// update written parts of chunks in place, chunks whose size is changed are dropped
+	std::vector<chunk_t *> changed_chunks;
+	const uint64_t write_offset = request.data_offset;
+	const auto written = reinterpret_cast<const char *>(request.data.data());
+	for (const auto &chunk_pair : record.chunks) {
+		chunk_t *chunk = chunk_pair.second;
+		auto chunk_data = chunk->data();
+		const uint64_t chunk_offset = chunk->index() * m_chunk_size;
+		const uint64_t chunk_size = chunk_offset < record.size ?
+		                            std::min<uint64_t>(m_chunk_size, record.size - chunk_offset) : 0;
+
+		if (chunk_size != chunk_data->size()) {
+			changed_chunks.push_back(chunk);
+			continue;
+		}
+
+		const uint64_t begin = std::max(chunk_offset, write_offset);
+		const uint64_t end = std::min(chunk_offset + chunk_size, write_offset + request.data.size());
+		if (begin < end)
+			chunk_data->replace(begin - chunk_offset, end - begin,
+			                    written + (begin - write_offset), end - begin);
+	}
+
+	for (auto chunk : changed_chunks) {
+		erase_chunk(chunk);
+	}
+
+	return write_response_t{write_status::HANDLED_IN_BACKEND, 0, cache_item()};
+}
+
+void slru_cache_t::insert_chunk(const unsigned char *id,
+                                uint64_t index,
+                                const ioremap::elliptics::data_pointer &data) {
+	dnet_raw_id raw_id;
+	memcpy(raw_id.id, id, DNET_ID_SIZE);
+
+	chunk_t *chunk = new chunk_t(id, index, data);
+	// the chunk is added to the object before placing to the page, so the object isn't erased with its last
+	// chunk evicted for the new one
+	m_chunked_records[raw_id].chunks[index] = chunk;
+	insert_data_into_page(id, m_cache_pages_number - 1, chunk);
+
+	m_cache_stats.number_of_objects++;
+	m_cache_stats.size_of_objects += chunk->size();
+	m_cache_stats.number_of_chunks++;
+}
+
+void slru_cache_t::erase_chunk(chunk_t *chunk) {
+	TIMER_SCOPE("erase_chunk");
+
+	auto record_it = m_chunked_records.find(chunk->id());
+	if (record_it != m_chunked_records.end()) {
+		record_it->second.chunks.erase(chunk->index());
+		if (record_it->second.chunks.empty()) {
+			m_chunked_records.erase(record_it);
+			m_cache_stats.number_of_chunked_objects--;
+		}
+	}
+
+	m_cache_stats.number_of_objects--;
+	m_cache_stats.size_of_objects -= chunk->size();
+	m_cache_stats.number_of_chunks--;
+
+	remove_data_from_page(chunk->id().id, chunk->cache_page_number(), chunk);
+	delete chunk;
+}
+
+void slru_cache_t::erase_chunked_record(const unsigned char *id) {
+	dnet_raw_id raw_id;
+	memcpy(raw_id.id, id, DNET_ID_SIZE);
+
+	auto record_it = m_chunked_records.find(raw_id);
+	// the object is erased with its last chunk
+	while (record_it != m_chunked_records.end() && !record_it->second.chunks.empty()) {
+		erase_chunk(record_it->second.chunks.begin()->second);
+		record_it = m_chunked_records.find(raw_id);
+	}
+
+	if (record_it != m_chunked_records.end()) {
+		m_chunked_records.erase(record_it);
+		m_cache_stats.number_of_chunked_objects--;
+	}
+}
+
+void slru_cache_t::clear_synctime(data_t *obj) {
+	if (obj->synctime()) {
+		m_cache_stats.number_of_dirty_objects--;
+		m_cache_stats.size_of_dirty_objects -= obj->size();
+	}
+	obj->clear_synctime();
+}
+
+slru_cache_t::compressed_data_t slru_cache_t::compress_data(const ioremap::elliptics::data_pointer &data) const {
+	compressed_data_t ret;
+	if (!m_compression_threshold || data.size() <= m_compression_threshold)
+		return ret;
+
+	ioremap::elliptics::util::steady_timer timer;
+	ret.data = compress_value(data.data<char>(), data.size());
+	ret.time = timer.get_us();
+	ret.incompressible = !ret.data;
+	return ret;
+}
+
+void slru_cache_t::decompress_data(data_t *obj) {
+	TIMER_SCOPE("decompress_data");
+
+	ioremap::elliptics::util::steady_timer timer;
+	auto data = decompress_value(*obj->data(), obj->data_size());
+	m_decompression_time += timer.get_us();
+
+	// size of the record changes, so it is placed back to its page
+	const size_t page_number = obj->cache_page_number();
+	remove_data_from_page(obj->id().id, page_number, obj);
+	remove_compression_stats(obj);
+	m_cache_stats.size_of_objects -= obj->size();
+
+	obj->set_data(data, false, 0);
+
+	m_cache_stats.size_of_objects += obj->size();
+	insert_data_into_page(obj->id().id, page_number, obj);
+}
+
+void slru_cache_t::add_compression_stats(const data_t *obj, const compressed_data_t &compressed) {
+	m_cache_stats.compression_time += compressed.time;
+	if (compressed.incompressible)
+		m_cache_stats.number_of_incompressible_objects++;
+
+	if (obj->is_compressed()) {
+		m_cache_stats.number_of_compressed_objects++;
+		m_cache_stats.size_of_compressed_data += obj->data()->size();
+		m_cache_stats.logical_size_of_compressed_data += obj->data_size();
+	}
+}
+
+void slru_cache_t::remove_compression_stats(const data_t *obj) {
+	if (obj->is_compressed()) {
+		m_cache_stats.number_of_compressed_objects--;
+		m_cache_stats.size_of_compressed_data -= obj->data()->size();
+		m_cache_stats.logical_size_of_compressed_data -= obj->data_size();
+	}
+}
+
+cache_item slru_cache_t::get_cache_item(elliptics_unique_lock<std::mutex> &guard, const data_t *obj) {
+	auto item = obj->get_cache_item();
+	if (!obj->is_compressed())
+		return item;
+
+	// compressed data is never modified, the item holds it while it is decompressed
+	guard.unlock();
+
+	TIMER_SCOPE("decompress_data");
+	ioremap::elliptics::util::steady_timer timer;
+	item.data = decompress_value(*item.data, item.total_data_size);
+	m_decompression_time += timer.get_us();
+	return item;
+}
+
+bool slru_cache_t::admit(const unsigned char *id, size_t size) {
+	if (!m_admission_sketch)
+		return true;
+
+	const size_t last_page_number = m_cache_pages_number - 1;
+	const auto &lru = m_cache_pages_lru[last_page_number];
+	// size of the record as it would be accounted by the page
+	size += sizeof(data_t) + 2 * sizeof(std::string);
+
+	if (lru.empty() ||
+	    m_cache_pages_sizes[last_page_number] + size <= m_cache_pages_max_sizes[last_page_number])
+		return true;
+
+	const unsigned candidate_frequency = m_admission_sketch->estimate(id);
+	const unsigned victim_frequency = m_admission_sketch->estimate(lru.front().id().id);
+	if (candidate_frequency > victim_frequency) {
+		++m_cache_stats.number_of_admitted_objects;
+		return true;
+	}
+
+	++m_cache_stats.number_of_rejected_objects;
+	DNET_LOG_DEBUG(m_node, "{}: CACHE: record isn't admitted: frequency: {}, victim's frequency: {}",
+	               dnet_dump_id_str(id), candidate_frequency, victim_frequency);
+	return false;
+}
+
 bool slru_cache_t::have_enough_space(const unsigned char *id, size_t page_number, size_t reserve) {
 	(void) id;
 	return m_cache_pages_max_sizes[page_number] >= reserve;
@@ -686,6 +1464,12 @@ void slru_cache_t::resize_page(const unsigned char *id, size_t page_number, size
 				m_cache_pages_lru[page_number].erase(m_cache_pages_lru[page_number].iterator_to(*raw));
 				raw->set_removed_from_page(true);
 			} else {
+				// clean record is kept by the second tier, pages are shrunk to zero only by clear()
+				// whose records are dropped. Compressed data is decompressed by the writer of the tier.
+				if (m_l2 && max_cache_size && !raw->is_chunk() && !raw->lifetime() &&
+				    !raw->remove_from_disk()) {
+					m_l2->put(raw->id().id, raw->get_cache_item(), raw->is_compressed());
+				}
 				erase_element(raw);
 			}
 		}
@@ -695,6 +1479,11 @@ void slru_cache_t::resize_page(const unsigned char *id, size_t page_number, size
 void slru_cache_t::erase_element(data_t *obj) {
 	TIMER_SCOPE("erase");
 
+	if (obj->is_chunk()) {
+		erase_chunk(static_cast<chunk_t *>(obj));
+		return;
+	}
+
 	if (obj->will_be_erased()) {
 		if (!obj->remove_from_cache()) {
 			m_cache_stats.size_of_objects_marked_for_deletion += obj->size();
@@ -705,6 +1494,7 @@ void slru_cache_t::erase_element(data_t *obj) {
 
 	m_cache_stats.number_of_objects--;
 	m_cache_stats.size_of_objects -= obj->size();
+	remove_compression_stats(obj);
 
 	size_t page_number = obj->cache_page_number();
 	remove_data_from_page(obj->id().id, page_number, obj);
@@ -712,7 +1502,7 @@ void slru_cache_t::erase_element(data_t *obj) {
 
 	if (obj->synctime()) {
 		sync_element(obj);
-		obj->clear_synctime();
+		clear_synctime(obj);
 	}
 
 	if (obj->remove_from_cache()) {
@@ -730,9 +1520,20 @@ void slru_cache_t::sync_element(const dnet_id &raw,
                                 const dnet_time &json_ts,
                                 const std::string &data,
                                 const dnet_time &data_ts) {
+	local_session sess(m_backend, m_node);
+	sync_element(sess, raw, after_append, user_flags, json, json_ts, data, data_ts);
+}
+
+void slru_cache_t::sync_element(local_session &sess,
+                                const dnet_id &raw,
+                                bool after_append,
+                                uint64_t user_flags,
+                                const std::string &json,
+                                const dnet_time &json_ts,
+                                const std::string &data,
+                                const dnet_time &data_ts) {
 	HANDY_TIMER_SCOPE("slru_cache.sync_element");
 
-	local_session sess(m_backend, m_node);
 	sess.set_ioflags(DNET_IO_FLAGS_NOCACHE | (after_append ? DNET_IO_FLAGS_APPEND : 0));
 
 	int err = sess.write(raw, user_flags, json, json_ts, data, data_ts);
@@ -749,12 +1550,98 @@ void slru_cache_t::sync_element(data_t *obj) {
 	             obj->timestamp());
 }
 
+void slru_cache_t::flush(std::vector<data_t *> &elements) {
+	// records are flushed in order of keys, so every flush thread writes and locks contiguous range of keys
+	std::sort(elements.begin(), elements.end(), [] (const data_t *lhs, const data_t *rhs) {
+		return dnet_id_cmp_str(lhs->id().id, rhs->id().id) < 0;
+	});
+
+	const size_t threads_number = std::min<size_t>(m_flush_threads, elements.size());
+	if (threads_number <= 1) {
+		flush_range(elements, 0, elements.size());
+		return;
+	}
+
+	// the first range is flushed by the calling thread, others are passed to flush workers
+	const size_t range_size = (elements.size() + threads_number - 1) / threads_number;
+	{
+		std::lock_guard<std::mutex> guard(m_flush_lock);
+		m_flush_elements = &elements;
+		for (size_t begin = range_size; begin < elements.size(); begin += range_size) {
+			m_flush_ranges.emplace_back(begin, std::min(begin + range_size, elements.size()));
+			++m_flush_pending;
+		}
+	}
+	m_flush_event.notify_all();
+
+	flush_range(elements, 0, range_size);
+
+	std::unique_lock<std::mutex> guard(m_flush_lock);
+	m_flush_done_event.wait(guard, [this] () {
+		return m_flush_pending == 0;
+	});
+	m_flush_elements = nullptr;
+}
+
+void slru_cache_t::flush_range(const std::vector<data_t *> &elements, size_t begin, size_t end) {
+	// the session is reused for all records of the range
+	local_session sess(m_backend, m_node);
+	auto pool = m_backend.io_pool();
+	dnet_id id;
+	memset(&id, 0, sizeof(id));
+
+	for (size_t i = begin; i < end; ++i) {
+		if (m_clear_occured)
+			break;
+
+		data_t *elem = elements[i];
+		memcpy(id.id, elem->id().id, DNET_ID_SIZE);
+
+		TIMER_START("life_check.sync_iterate.dnet_oplock");
+		dnet_oplock(pool, &id);
+		TIMER_STOP("life_check.sync_iterate.dnet_oplock");
+
+		// sync_element uses local_session which always uses DNET_FLAGS_NOLOCK
+		if (elem->is_syncing()) {
+			sync_element(sess, id, elem->only_append(), elem->user_flags(), *elem->json(),
+			             elem->json_timestamp(), *elem->data(), elem->timestamp());
+			elem->set_sync_state(data_t::sync_state_t::ERASE_PHASE);
+		}
+
+		dnet_opunlock(pool, &id);
+	}
+}
+
+void slru_cache_t::flush_worker() {
+	dnet_set_name("dnet_cflush_%zu", m_backend.backend_id());
+
+	std::unique_lock<std::mutex> guard(m_flush_lock);
+	while (true) {
+		m_flush_event.wait(guard, [this] () {
+			return m_flush_exit || !m_flush_ranges.empty();
+		});
+		if (m_flush_exit)
+			break;
+
+		const auto range = m_flush_ranges.front();
+		m_flush_ranges.pop_front();
+		const auto &elements = *m_flush_elements;
+
+		guard.unlock();
+		flush_range(elements, range.first, range.second);
+		guard.lock();
+
+		if (--m_flush_pending == 0)
+			m_flush_done_event.notify_all();
+	}
+}
+
 void slru_cache_t::sync_after_append(elliptics_unique_lock<std::mutex> &guard, bool lock_guard, data_t *obj) {
 	TIMER_SCOPE("sync_after_append");
 
 	auto raw = obj->data();
 
-	obj->clear_synctime();
+	clear_synctime(obj);
 
 	dnet_id id;
 	memset(&id, 0, sizeof(id));
@@ -791,8 +1678,9 @@ void slru_cache_t::life_check(void) {
 			TIMER_SCOPE("life_check");
 
 			std::deque<struct dnet_id> remove;
-			std::deque<data_t*> elements_for_sync;
+			std::vector<data_t*> elements_for_sync;
 			size_t last_time = 0;
+			size_t flush_lag = 0;
 			dnet_id id;
 			memset(&id, 0, sizeof(id));
 
@@ -824,7 +1712,11 @@ void slru_cache_t::life_check(void) {
 					{
 						elements_for_sync.push_back(it);
 
-						it->clear_synctime();
+						// records evicted from the cache are synced at once, they have synctime 1
+						if (it->synctime() > 1)
+							flush_lag = std::max(flush_lag, time - it->synctime());
+
+						clear_synctime(it);
 						it->set_sync_state(data_t::sync_state_t::SYNC_PHASE);
 
 					        {
@@ -835,31 +1727,14 @@ void slru_cache_t::life_check(void) {
 				}
 			}
 
+			ioremap::elliptics::util::steady_timer flush_timer;
 			{
 				TIMER_SCOPE("life_check.sync_iterate");
 				HANDY_GAUGE_SET("slru_cache.life_check.sync_iterate.element_count",
 				                elements_for_sync.size());
-				auto pool = m_backend.io_pool();
-				for (data_t *elem : elements_for_sync) {
-					if (m_clear_occured)
-						break;
-
-					memcpy(id.id, elem->id().id, DNET_ID_SIZE);
-
-					TIMER_START("life_check.sync_iterate.dnet_oplock");
-					dnet_oplock(pool, &id);
-					TIMER_STOP("life_check.sync_iterate.dnet_oplock");
-
-					// sync_element uses local_session which always uses DNET_FLAGS_NOLOCK
-					if (elem->is_syncing()) {
-						sync_element(id, elem->only_append(), elem->user_flags(), *elem->json(),
-						             elem->json_timestamp(), *elem->data(), elem->timestamp());
-						elem->set_sync_state(data_t::sync_state_t::ERASE_PHASE);
-					}
-
-					dnet_opunlock(pool, &id);
-				}
+				flush(elements_for_sync);
 			}
+			const auto flush_time = flush_timer.get_ms();
 
 			{
 				TIMER_SCOPE("life_check.remove_local");
@@ -874,6 +1749,12 @@ void slru_cache_t::life_check(void) {
 				elliptics_unique_lock<std::mutex> guard(m_lock, m_node, "CACHE CLEAR PAGES: %p", this);
 				TIMER_STOP("life_check.lock");
 
+				if (!elements_for_sync.empty()) {
+					m_cache_stats.number_of_flushed_objects += elements_for_sync.size();
+					m_cache_stats.last_flush_lag = flush_lag;
+					m_cache_stats.last_flush_time = flush_time;
+				}
+
 				if (!m_clear_occured) {
 					TIMER_SCOPE("life_check.erase_iterate");
 					for (data_t *elem : elements_for_sync) {
@@ -17,20 +17,35 @@
 #ifndef SLRU_CACHE_HPP
 #define SLRU_CACHE_HPP
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <thread>
 
 #include "cache.hpp"
+#include "frequency_sketch.hpp"
+#include "elliptics/result_entry.hpp"
 
 class dnet_backend;
+class local_session;
 
 namespace ioremap { namespace cache {
 
+class l2_cache_t;
+
 class slru_cache_t {
 public:
 	slru_cache_t(struct dnet_node *n,
 	             dnet_backend &backend,
 	             const std::vector<size_t> &cache_pages_max_sizes,
 	             unsigned sync_timeout,
+	             unsigned fill_wait_timeout,
+	             size_t admission_sketch_width,
+	             size_t chunk_size,
+	             unsigned flush_threads,
+	             size_t compression_threshold,
+	             l2_cache_t *l2,
 	             bool &need_exit);
 
 	~slru_cache_t();
@@ -40,16 +55,30 @@ public:
 	                       const write_request &request,
 	                       dnet_access_context *context);
 
-	read_response_t read(const unsigned char *id, uint64_t ioflags);
+	read_response_t read(const unsigned char *id, uint64_t ioflags, uint64_t offset, uint64_t size);
 
 	int remove(const dnet_cmd *cmd, ioremap::elliptics::dnet_remove_request &request, dnet_access_context *context);
 
+	// data of compressed record isn't decompressed by lookup, the returned item has empty data then
 	read_response_t lookup(const unsigned char *id);
 
 	void clear();
 
 	cache_stats get_cache_stats() const;
 
+	// appends cached records to @records in LRU order of pages, values not larger than @max_value_size are
+	// stored as well
+	void snapshot(std::vector<snapshot_record> &records, size_t max_value_size);
+
+	// counts @objects_number objects which will be passed to warm_up() or skip_warm_up()
+	void start_warm_up(size_t objects_number);
+
+	// places @record to its page if the key isn't cached yet and the page has free space,
+	// warm-up never evicts records from the cache
+	void warm_up(const snapshot_record &record);
+
+	void skip_warm_up();
+
 private:
 	dnet_backend &m_backend;
 	struct dnet_node *m_node;
@@ -65,6 +94,71 @@ private:
 	unsigned m_sync_timeout;
 	const bool &m_need_exit;
 
+	// fill of missed record from disk in progress, concurrent misses of the same key wait for its result
+	// instead of reading the same record from disk again
+	struct fill_t {
+		fill_t() : finished(false), err(0), item() {}
+
+		std::condition_variable_any finished_event;
+		bool finished;
+		int err;
+		// record read from disk which wasn't admitted into the cache
+		cache_item item;
+	};
+	std::map<dnet_raw_id, std::shared_ptr<fill_t>, ioremap::elliptics::dnet_raw_id_less_than<>> m_fills;
+	// how long a miss waits for the fill of the same key before reading it from disk by itself
+	std::chrono::milliseconds m_fill_wait_timeout;
+
+	// frequencies of recent accesses to keys used by the admission filter, null if the filter is disabled
+	std::unique_ptr<frequency_sketch_t> m_admission_sketch;
+
+	// large object cached by chunks: its metadata and chunks which are in the cache
+	struct chunked_record_t {
+		uint64_t user_flags;
+		dnet_time timestamp;
+		dnet_time json_timestamp;
+		std::shared_ptr<std::string> json;
+		// size of the whole object's data
+		uint64_t size;
+		// incremented by every write, so reads from disk concurrent with the write don't place outdated chunks
+		uint64_t version;
+		std::map<uint64_t, chunk_t *> chunks;
+	};
+	std::map<dnet_raw_id, chunked_record_t, ioremap::elliptics::dnet_raw_id_less_than<>> m_chunked_records;
+	// objects larger than @m_chunk_size are cached by chunks, 0 disables chunking
+	size_t m_chunk_size;
+	// number of threads which sync dirty records of the shard to disk
+	unsigned m_flush_threads;
+	// life_check splits records to be synced into ranges, all but the first one are flushed by
+	// @m_flush_workers, which are started once with the shard
+	std::vector<std::thread> m_flush_workers;
+	std::mutex m_flush_lock;
+	std::condition_variable m_flush_event;
+	std::condition_variable m_flush_done_event;
+	const std::vector<data_t *> *m_flush_elements;
+	std::deque<std::pair<size_t, size_t>> m_flush_ranges;
+	// number of ranges which are queued or being flushed by workers
+	size_t m_flush_pending;
+	bool m_flush_exit;
+	// second tier shared by all shards of the backend, it receives clean records evicted from the last page
+	// and serves misses before the backend, null if disabled
+	l2_cache_t *m_l2;
+	// data of records read from disk larger than @m_compression_threshold is stored compressed, 0 disables it
+	size_t m_compression_threshold;
+	// compressed data is decompressed without the lock, so time spent on it is accounted separately
+	// from @m_cache_stats
+	std::atomic<size_t> m_decompression_time;
+
+	// result of compression of record's data done without the lock
+	struct compressed_data_t {
+		compressed_data_t() : time(0), incompressible(false) {}
+
+		// null if data wasn't compressed
+		std::shared_ptr<std::string> data;
+		size_t time;
+		bool incompressible;
+	};
+
 	slru_cache_t(const slru_cache_t &) = delete;
 
 	bool need_exit() const;
@@ -93,15 +187,81 @@ private:
 	                             size_t destination_page_number,
 	                             data_t *data);
 
+	// if @compressed is not null, the record stores compressed data from it instead of @data when there is one
 	data_t *create_data(const unsigned char *id,
 	                    const ioremap::elliptics::data_pointer &json,
 	                    const ioremap::elliptics::data_pointer &data,
-	                    bool remove_from_disk);
+	                    bool remove_from_disk,
+	                    const compressed_data_t *compressed = nullptr);
+
+	// compresses @data if compression is enabled and @data is larger than the threshold,
+	// it doesn't touch the cache, so it's called without the lock
+	compressed_data_t compress_data(const ioremap::elliptics::data_pointer &data) const;
+
+	// stores data of @obj decompressed, it's done before the data is modified
+	void decompress_data(data_t *obj);
+
+	void add_compression_stats(const data_t *obj, const compressed_data_t &compressed);
+
+	void remove_compression_stats(const data_t *obj);
+
+	// returns item of @obj with decompressed data, decompression is done after @guard is released
+	cache_item get_cache_item(elliptics_unique_lock<std::mutex> &guard, const data_t *obj);
 
+	// reads record @id from the second tier or from disk and places it into the cache,
+	// if @rejected is not null the record passes the admission filter first and
+	// when it isn't admitted null is returned and the record is reported via @rejected.
+	// If @read_data is not null and the record is stored compressed, it receives the read data,
+	// so the caller doesn't have to decompress it.
 	data_t *populate_from_disk(elliptics_unique_lock<std::mutex> &guard,
 	                           const unsigned char *id,
 	                           bool remove_from_disk,
-	                           int *err);
+	                           int *err,
+	                           cache_item *rejected = nullptr,
+	                           std::shared_ptr<std::string> *read_data = nullptr);
+
+	// waits for the fill of @id started by another miss, returns true if the fill has finished and
+	// its result is reported via @it, @rejected and @err, false if there is no such fill, it didn't finish
+	// in time or its record is already gone from the cache
+	bool wait_for_fill(elliptics_unique_lock<std::mutex> &guard,
+	                   const unsigned char *id,
+	                   data_t **it,
+	                   cache_item *rejected,
+	                   int *err);
+
+	// admission filter: decides whether record @id of @size bytes read from disk should be placed into
+	// the cache. If the last page has to evict records for it, the record is admitted only if its key
+	// is accessed more often than the key of the record which would be evicted first.
+	bool admit(const unsigned char *id, size_t size);
+
+	// registers fill of @id from disk, so concurrent misses of @id wait for it
+	std::shared_ptr<fill_t> start_fill(const unsigned char *id);
+
+	void finish_fill(const unsigned char *id, const std::shared_ptr<fill_t> &fill, int err);
+
+	// reads range of the object cached by chunks, missed chunks are read from disk if @populate is set.
+	// If the object isn't cached by chunks yet, it is cached by chunks when it's larger than chunk size and
+	// as a whole record otherwise. Returns @missed_err if some chunks are missed and @populate isn't set.
+	read_response_t read_chunks(elliptics_unique_lock<std::mutex> &guard,
+	                            const unsigned char *id,
+	                            uint64_t offset,
+	                            uint64_t size,
+	                            bool populate,
+	                            int missed_err);
+
+	// handles write to the object cached by chunks in the backend and updates cached chunks.
+	// @guard is released during the write and reading metadata of the object back.
+	write_response_t write_chunks(elliptics_unique_lock<std::mutex> &guard,
+	                              dnet_net_state *st,
+	                              dnet_cmd *cmd,
+	                              const write_request &request,
+	                              dnet_access_context *context);
+
+	void insert_chunk(const unsigned char *id, uint64_t index, const ioremap::elliptics::data_pointer &data);
+
+	void erase_chunk(chunk_t *chunk);
+
+	void erase_chunked_record(const unsigned char *id);
 
 	bool have_enough_space(const unsigned char *id, size_t page_number, size_t reserve);
 
@@ -117,8 +277,27 @@ private:
 	                  const std::string &data,
 	                  const dnet_time &data_ts);
 
+	void sync_element(local_session &sess,
+	                  const dnet_id &raw,
+	                  bool after_append,
+	                  uint64_t user_flags,
+	                  const std::string &json,
+	                  const dnet_time &json_ts,
+	                  const std::string &data,
+	                  const dnet_time &data_ts);
+
 	void sync_element(data_t *obj);
 
+	// syncs @elements to disk sorted by keys by @m_flush_threads threads
+	void flush(std::vector<data_t *> &elements);
+
+	void flush_range(const std::vector<data_t *> &elements, size_t begin, size_t end);
+
+	void flush_worker();
+
+	// makes @obj clean, all changes of synctime from non-zero value should go through it to keep dirty stats
+	void clear_synctime(data_t *obj);
+
 	void sync_after_append(elliptics_unique_lock<std::mutex> &guard, bool lock_guard, data_t *obj);
 
 	void life_check(void);
@@ -0,0 +1,154 @@
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*/
+
+#include "snapshot.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace ioremap { namespace cache {
+
+/*
+ * Snapshot is a node-local file, so all numbers are stored in host byte order:
+ *
+ * header: magic[8], version, number of records
+ * record: id[DNET_ID_SIZE], page_number, lifetime, flags,
+ *         if SNAPSHOT_RECORD_VALUE is set: user_flags, timestamp, json_timestamp, json_size, data_size, json, data
+ */
+static const char snapshot_magic[8] = {'E', 'C', 'S', 'N', 'A', 'P', 'S', 'H'};
+static const uint64_t snapshot_version = 1;
+
+enum {
+	SNAPSHOT_RECORD_REMOVE_FROM_DISK = 1 << 0,
+	SNAPSHOT_RECORD_VALUE = 1 << 1,
+};
+
+// protects from huge allocations on reading of corrupted snapshot
+static const uint64_t snapshot_max_value_size = 1ULL << 32;
+
+template <typename T>
+static void write_pod(std::ostream &out, const T &value) {
+	out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+static bool read_pod(std::istream &in, T &value) {
+	return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+static bool read_string(std::istream &in, uint64_t size, std::shared_ptr<std::string> &value) {
+	value = std::make_shared<std::string>(size, '\0');
+	return size == 0 || static_cast<bool>(in.read(&(*value)[0], size));
+}
+
+int write_snapshot(const std::string &path, const std::vector<snapshot_record> &records) {
+	const std::string tmp_path = path + ".tmp";
+
+	{
+		std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return -errno;
+
+		out.write(snapshot_magic, sizeof(snapshot_magic));
+		write_pod(out, snapshot_version);
+		write_pod(out, static_cast<uint64_t>(records.size()));
+
+		for (const auto &record : records) {
+			const auto &item = record.item;
+			const bool has_value = item.data && item.json;
+
+			uint64_t flags = 0;
+			if (record.remove_from_disk)
+				flags |= SNAPSHOT_RECORD_REMOVE_FROM_DISK;
+			if (has_value)
+				flags |= SNAPSHOT_RECORD_VALUE;
+
+			out.write(reinterpret_cast<const char *>(record.id.id), DNET_ID_SIZE);
+			write_pod(out, static_cast<uint64_t>(record.page_number));
+			write_pod(out, static_cast<uint64_t>(record.lifetime));
+			write_pod(out, flags);
+
+			if (has_value) {
+				write_pod(out, item.user_flags);
+				write_pod(out, item.timestamp);
+				write_pod(out, item.json_timestamp);
+				write_pod(out, static_cast<uint64_t>(item.json->size()));
+				write_pod(out, static_cast<uint64_t>(item.data->size()));
+				out.write(item.json->data(), item.json->size());
+				out.write(item.data->data(), item.data->size());
+			}
+		}
+
+		out.flush();
+		if (!out) {
+			const int err = errno ? -errno : -EIO;
+			out.close();
+			std::remove(tmp_path.c_str());
+			return err;
+		}
+	}
+
+	if (std::rename(tmp_path.c_str(), path.c_str()) == -1) {
+		const int err = -errno;
+		std::remove(tmp_path.c_str());
+		return err;
+	}
+
+	return 0;
+}
+
+int read_snapshot(const std::string &path, std::vector<snapshot_record> &records) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return -errno;
+
+	char magic[sizeof(snapshot_magic)];
+	uint64_t version, records_number;
+	if (!in.read(magic, sizeof(magic)) || memcmp(magic, snapshot_magic, sizeof(magic)) ||
+	    !read_pod(in, version) || version != snapshot_version || !read_pod(in, records_number)) {
+		return -EINVAL;
+	}
+
+	for (uint64_t i = 0; i < records_number; ++i) {
+		snapshot_record record;
+		uint64_t page_number, lifetime, flags;
+
+		if (!in.read(reinterpret_cast<char *>(record.id.id), DNET_ID_SIZE) || !read_pod(in, page_number) ||
+		    !read_pod(in, lifetime) || !read_pod(in, flags)) {
+			return -EINVAL;
+		}
+
+		record.page_number = page_number;
+		record.lifetime = lifetime;
+		record.remove_from_disk = flags & SNAPSHOT_RECORD_REMOVE_FROM_DISK;
+
+		if (flags & SNAPSHOT_RECORD_VALUE) {
+			auto &item = record.item;
+			uint64_t json_size, data_size;
+
+			if (!read_pod(in, item.user_flags) || !read_pod(in, item.timestamp) ||
+			    !read_pod(in, item.json_timestamp) || !read_pod(in, json_size) || !read_pod(in, data_size) ||
+			    json_size > snapshot_max_value_size || data_size > snapshot_max_value_size ||
+			    !read_string(in, json_size, item.json) || !read_string(in, data_size, item.data)) {
+				return -EINVAL;
+			}
+		}
+
+		records.emplace_back(std::move(record));
+	}
+
+	return 0;
+}
+
+}} /* namespace ioremap::cache */
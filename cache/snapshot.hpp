@@ -0,0 +1,39 @@
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*/
+
+#ifndef CACHE_SNAPSHOT_HPP
+#define CACHE_SNAPSHOT_HPP
+
+#include <string>
+#include <vector>
+
+#include "cache.hpp"
+
+namespace ioremap { namespace cache {
+
+/*
+ * Writes @records to the snapshot file @path. The file is written to temporary file first and renamed to @path,
+ * so @path always contains either previous or new complete snapshot.
+ * Returns 0 on success, negative error code otherwise.
+ */
+int write_snapshot(const std::string &path, const std::vector<snapshot_record> &records);
+
+/*
+ * Reads records from the snapshot file @path to @records.
+ * If the file is truncated or corrupted, @records contains all records read before the damaged one.
+ * Returns 0 on success, negative error code otherwise.
+ */
+int read_snapshot(const std::string &path, std::vector<snapshot_record> &records);
+
+}} /* namespace ioremap::cache */
+
+#endif // CACHE_SNAPSHOT_HPP
@@ -19,8 +19,12 @@
 
 #include "config.hpp"
 
+#include <ctype.h>
 #include <malloc.h>
+#include <sched.h>
 
+#include <algorithm>
+#include <fstream>
 #include <unordered_set>
 
 #include <blackhole/config/json.hpp>
@@ -241,6 +245,114 @@ uint64_t parse_queue_timeout(const kora::config_t &options) {
 	return queue_timeout * scale;
 }
 
+io_priority_weights parse_io_priority_weights(const kora::config_t &config, const io_priority_weights &defaults) {
+	if (!config.has("io_priority_weights"))
+		return defaults;
+
+	const auto weights = config["io_priority_weights"];
+	io_priority_weights ret;
+	for (int priority = 0; priority < DNET_IO_PRIO_MAX; ++priority) {
+		ret[priority] = weights.at<uint32_t>(dnet_io_priority_string(priority), defaults[priority]);
+		if (!ret[priority])
+			throw config_error() << weights[dnet_io_priority_string(priority)].path() << " must be positive";
+	}
+	return ret;
+}
+
+bool parse_queue_order(const kora::config_t &config, bool default_edf) {
+	if (!config.has("queue_order"))
+		return default_edf;
+
+	const auto order = config.at<std::string>("queue_order");
+	if (order == "fifo")
+		return false;
+	if (order == "edf")
+		return true;
+
+	throw config_error() << config["queue_order"].path() << " must be \"fifo\" or \"edf\"";
+}
+
+// parses number of CPU or NUMA node at @str, returns pointer right after the number or nullptr if there is no
+// number or it doesn't fit cpu_set_t (NUMA nodes are limited the same way, their number never exceeds CPUs number)
+static const char *parse_cpu_number(const char *str, int &number) {
+	if (!isdigit(*str))
+		return nullptr;
+
+	errno = 0;
+	char *end;
+	const unsigned long ret = strtoul(str, &end, 10);
+	if (errno == ERANGE || ret >= CPU_SETSIZE)
+		return nullptr;
+
+	number = ret;
+	return end;
+}
+
+// parses list of CPUs or NUMA nodes in kernel's format, e.g. "0-3,8,10-11"
+static std::vector<int> parse_cpu_list(const kora::config_t &config, const std::string &list) {
+	std::vector<int> ret;
+	std::istringstream stream(list);
+	std::string range;
+	while (std::getline(stream, range, ',')) {
+		int first, last;
+		const char *end = parse_cpu_number(range.c_str(), first);
+		if (end && *end == '-') {
+			end = parse_cpu_number(end + 1, last);
+		} else {
+			last = first;
+		}
+
+		if (!end || *end || last < first) {
+			throw config_error() << config.path() << " has invalid cpu list: \"" << list
+			                     << "\", numbers must be in [0, " << CPU_SETSIZE << ")";
+		}
+
+		for (int i = first; i <= last; ++i)
+			ret.push_back(i);
+	}
+	return ret;
+}
+
+// returns sorted union of CPUs from @cpus list and all CPUs of NUMA nodes from @numa_nodes list
+static std::vector<int> resolve_cpus(const kora::config_t &config, const std::string &cpus,
+                                     const std::string &numa_nodes) {
+	auto ret = parse_cpu_list(config, cpus);
+
+	for (int node : parse_cpu_list(config, numa_nodes)) {
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		std::string node_cpus;
+		if (!std::getline(file, node_cpus))
+			throw config_error() << config.path() << " has unknown NUMA node: " << node;
+
+		const auto list = parse_cpu_list(config, node_cpus);
+		ret.insert(ret.end(), list.begin(), list.end());
+	}
+
+	std::sort(ret.begin(), ret.end());
+	ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+	return ret;
+}
+
+std::vector<int> parse_io_cpus(const kora::config_t &config, const std::vector<int> &defaults) {
+	if (!config.has("io_cpus") && !config.has("io_numa_nodes"))
+		return defaults;
+
+	return resolve_cpus(config, config.at("io_cpus", std::string()), config.at("io_numa_nodes", std::string()));
+}
+
+static std::vector<std::vector<int>> parse_net_thread_cpus(const kora::config_t &options) {
+	const auto cpus = options.at("net_thread_cpus", std::vector<std::string>());
+	const auto numa_nodes = options.at("net_thread_numa_nodes", std::vector<std::string>());
+
+	std::vector<std::vector<int>> ret(std::max(cpus.size(), numa_nodes.size()));
+	for (size_t i = 0; i < ret.size(); ++i) {
+		ret[i] = resolve_cpus(options,
+		                      i < cpus.size() ? cpus[i] : std::string(),
+		                      i < numa_nodes.size() ? numa_nodes[i] : std::string());
+	}
+	return ret;
+}
+
 static void parse_options(config_data *data, const kora::config_t &options) {
 	if (options.has("mallopt_mmap_threshold"))
 		dnet_set_malloc_options(data, options.at<int>("mallopt_mmap_threshold"));
@@ -286,6 +398,14 @@ static void parse_options(config_data *data, const kora::config_t &options) {
 		data->cache_config = ioremap::cache::cache_config::parse(options["cache"]);
 
 	data->queue_timeout = parse_queue_timeout(options);
+	data->queue_limit = options.at<uint64_t>("queue_limit", 0);
+	data->queue_bytes_limit = options.at<uint64_t>("queue_bytes_limit", 0);
+	data->priority_weights = parse_io_priority_weights(options, {{DNET_IO_PRIO_CLIENT_WEIGHT,
+	                                                              DNET_IO_PRIO_ITERATOR_WEIGHT,
+	                                                              DNET_IO_PRIO_RECOVERY_WEIGHT}});
+	data->queue_edf = parse_queue_order(options, false);
+	data->io_cpus = parse_io_cpus(options, {});
+	data->net_thread_cpus = parse_net_thread_cpus(options);
 }
 
 extern "C" struct dnet_node *dnet_parse_config(const char *file, int mon) {
@@ -380,7 +500,10 @@ extern "C" int dnet_node_set_verbosity(struct dnet_node *node, enum dnet_log_lev
 
 static io_pool_config parse_io_pool_config(const config_data &data, const kora::config_t &config) {
 	return {config.at("io_thread_num", data.cfg_state.io_thread_num),
-	        config.at("nonblocking_io_thread_num", data.cfg_state.nonblocking_io_thread_num)};
+	        config.at("nonblocking_io_thread_num", data.cfg_state.nonblocking_io_thread_num),
+	        config::parse_io_priority_weights(config, data.priority_weights),
+	        config::parse_queue_order(config, data.queue_edf),
+	        config::parse_io_cpus(config, data.io_cpus)};
 }
 
 static uint64_t parse_queue_timeout(const config_data &data, const kora::config_t &config) {
@@ -413,6 +536,8 @@ backend_config::backend_config(const config_data &data, const kora::config_t &co
 , pool_id{config.at<std::string>("pool_id", "")}
 , pool_config(parse_io_pool_config(data, config))
 , queue_timeout{parse_queue_timeout(data, config)}
+, queue_limit{config.at<uint64_t>("queue_limit", data.queue_limit)}
+, queue_bytes_limit{config.at<uint64_t>("queue_bytes_limit", data.queue_bytes_limit)}
 , cache_config{parse_cache_config(data, config)}
 , config_backend(get_config_backend(config))
 , config_backend_buffer(config_backend.size, '\0') {
@@ -488,7 +613,8 @@ std::shared_ptr<backend_config> config_data::get_backend_config(uint32_t backend
 }
 
 io_pool_config config_data::get_io_pool_config(const std::string &pool_id) {
-	const io_pool_config default_config = {cfg_state.io_thread_num, cfg_state.nonblocking_io_thread_num};
+	const io_pool_config default_config = {cfg_state.io_thread_num, cfg_state.nonblocking_io_thread_num,
+	                                       priority_weights, queue_edf, io_cpus};
 
 	const auto &root = parse_config()->root();
 	if (!root.has("options"))
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <mutex>
 #include <vector>
 #include <sstream>
@@ -34,6 +35,32 @@ struct cache_config {
 	size_t			count;
 	unsigned		sync_timeout;
 	std::vector<size_t>	pages_proportions;
+	// directory where cache snapshot is dumped to on backend's disable and loaded from on enable,
+	// snapshot is disabled if empty
+	std::string		snapshot_dir;
+	// maximum size of record's data and json stored in the snapshot, only keys are stored if 0
+	size_t			snapshot_value_size;
+	// maximum number of bytes read from disk per second by snapshot warm-up, unlimited if 0
+	size_t			warmup_rate;
+	// time in milliseconds a miss waits for concurrent fill of the same key from disk
+	unsigned		fill_wait_timeout;
+	// whether records read from disk into the full cache pass the frequency-based admission filter
+	bool			admission_filter;
+	// number of counters in a row of the admission filter's frequency sketch of each shard
+	size_t			admission_sketch_width;
+	// objects larger than @chunk_size are cached by chunks of this size, only requested ranges of them
+	// are read from disk; objects are cached as a whole if 0
+	size_t			chunk_size;
+	// number of threads per cache shard which sync dirty records to disk
+	unsigned		flush_threads;
+	// data of records read from disk larger than @compression_threshold is stored compressed,
+	// compression is disabled if 0
+	size_t			compression_threshold;
+	// directory of the second tier of the cache on a fast local disk, records evicted from the memory are
+	// kept there and misses are served from it before the backend; the tier is disabled if empty
+	std::string		l2_dir;
+	// maximum size of the second tier's file
+	size_t			l2_size;
 
 	static cache_config parse(const kora::config_t &cache);
 };
@@ -85,11 +112,23 @@ private:
 	std::string m_message;
 };
 
+// weights of priority classes sharing io pool's queue, indexed by dnet_io_priority
+typedef std::array<uint32_t, DNET_IO_PRIO_MAX> io_priority_weights;
+
 struct io_pool_config {
 	int io_thread_num;
 	int nonblocking_io_thread_num;
+	io_priority_weights priority_weights;
+	// order requests in the pool's queues by deadlines (earliest deadline first) instead of arrival
+	bool edf;
+	// CPUs the pool's threads are bound to, empty - not bound
+	std::vector<int> cpus;
 };
 
+// returns sorted union of CPUs from "io_cpus" and CPUs of NUMA nodes from "io_numa_nodes" of @config
+// or @defaults if neither is set, throws config_error if the lists are invalid
+std::vector<int> parse_io_cpus(const kora::config_t &config, const std::vector<int> &defaults);
+
 struct config_data;
 struct backend_config {
 	backend_config(const config_data &data, const kora::config_t &config);
@@ -117,6 +156,10 @@ struct backend_config {
 
 	// timeout used for dropping request stuck in a io pool's queue
 	const uint64_t					queue_timeout;
+	// admission budget of io pool's queue: max number of queued requests (0 - io_thread_num * 1000)
+	// and max total size of their payloads in bytes (0 - unlimited)
+	const uint64_t					queue_limit;
+	const uint64_t					queue_bytes_limit;
 
 	const boost::optional<cache::cache_config>	cache_config;
 
@@ -161,6 +204,17 @@ public:
 	std::unique_ptr<monitor::monitor_config>	monitor_config;
 	// timeout used for dropping request stuck in a io pool's queue
 	uint64_t					queue_timeout;
+	// admission budget of io pool's queue used by default for all backends and for requests without backend
+	uint64_t					queue_limit;
+	uint64_t					queue_bytes_limit;
+	// weights of priority classes used by default for all io pools
+	io_priority_weights				priority_weights;
+	// earliest deadline first ordering of requests used by default for all io pools
+	bool						queue_edf;
+	// CPUs io pools' threads are bound to by default, empty - not bound
+	std::vector<int>				io_cpus;
+	// CPUs net threads are bound to: i-th thread uses (i % size)-th element, empty - not bound
+	std::vector<std::vector<int>>			net_thread_cpus;
 
 	bool						daemon_mode;
 
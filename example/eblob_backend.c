@@ -192,6 +192,35 @@ static int blob_lookup(struct eblob_backend *b, struct eblob_key *key, struct eb
 	return err;
 }
 
+/*
+ * Writes which replace the whole record's content keep its checksum in @ehdr, so compare-and-swap doesn't
+ * need to read the record. If eblob has kept the tail of the previous content (e.g. it has overwritten
+ * bigger record in place), the record's size differs from @content_size and the digest is dropped.
+ */
+int blob_drop_partial_digest(struct eblob_backend_config *c, struct eblob_key *key, struct dnet_ext_list_hdr *ehdr,
+                             uint64_t content_size, const struct eblob_write_control *wc, uint64_t flags)
+{
+	static const size_t ehdr_size = sizeof(struct dnet_ext_list_hdr);
+	int err;
+
+	if (!(ehdr->hdr_flags & DNET_EXT_HDR_FLAGS_DIGEST) || wc->total_data_size == ehdr_size + content_size)
+		return 0;
+
+	ehdr->hdr_flags &= ~DNET_EXT_HDR_FLAGS_DIGEST;
+	memset(ehdr->digest, 0, sizeof(ehdr->digest));
+
+	const struct eblob_iovec iov[1] = {
+		{ .offset = 0, .size = ehdr_size, .base = ehdr },
+	};
+
+	err = eblob_plain_writev(c->eblob, key, iov, 1, flags);
+	if (err) {
+		DNET_LOG_ERROR(c->blog, "%s: EBLOB: blob-write: failed to drop digest of partially overwritten record: "
+		                        "%s %d", dnet_dump_id_str(key->id), strerror(-err), err);
+	}
+	return err;
+}
+
 static int blob_write(struct eblob_backend_config *c, void *state,
 		struct dnet_cmd *cmd, void *data)
 {
@@ -263,6 +292,19 @@ static int blob_write(struct eblob_backend_config *c, void *state,
 		                dnet_dump_id_str(io->id), io->num + ehdr_size);
 	}
 
+	if (c->content_digest && io->size && !io->offset &&
+	    !(io->flags & (DNET_IO_FLAGS_APPEND | DNET_IO_FLAGS_PREPARE | DNET_IO_FLAGS_PLAIN_WRITE |
+	                   DNET_IO_FLAGS_COMMIT))) {
+		struct dnet_node *n = dnet_get_node_from_state(state);
+		unsigned char digest[DNET_ID_SIZE];
+
+		/* the write replaces the whole content, so its checksum is kept for compare-and-swap */
+		if (n && !dnet_checksum_data(n, data, io->size, digest, sizeof(digest))) {
+			memcpy(ehdr.digest, digest, sizeof(ehdr.digest));
+			ehdr.hdr_flags |= DNET_EXT_HDR_FLAGS_DIGEST;
+		}
+	}
+
 	if (io->size) {
 		/*
 		 * Although we have already filled ext header above (at prepare time),
@@ -285,6 +327,10 @@ static int blob_write(struct eblob_backend_config *c, void *state,
 			goto err_out_exit;
 		}
 
+		err = blob_drop_partial_digest(c, &key, &ehdr, io->size, &wc, flags);
+		if (err)
+			goto err_out_exit;
+
 		DNET_LOG_NOTICE(c->blog, "%s: EBLOB: blob-write: WRITE: Ok: offset: %" PRIu64 ", size: %" PRIu64,
 		                dnet_dump_id_str(io->id), io->offset, io->size);
 	}
@@ -620,6 +666,7 @@ static int blob_del_range_callback(struct eblob_backend_config *c, struct eblob_
 		DNET_LOG_DEBUG(c->blog, "%s: EBLOB: blob-read-range: DEL: err: %d", dnet_dump_id_str(req->record_key),
 		               err);
 	}
+	blob_metadata_cache_remove(c, req->record_key);
 
 	return err;
 }
@@ -866,6 +913,8 @@ static int eblob_backend_checksum(struct dnet_node *n, void *priv, struct dnet_i
 	struct eblob_backend *b = c->eblob;
 	struct eblob_write_control wc;
 	struct eblob_key key;
+	struct dnet_ext_list_hdr ehdr;
+	struct dnet_json_header jhdr;
 	static const size_t ehdr_size = sizeof(struct dnet_ext_list_hdr);
 	int err;
 
@@ -884,6 +933,19 @@ static int eblob_backend_checksum(struct dnet_node *n, void *priv, struct dnet_i
 			err = -EINVAL;
 			goto err_out_exit;
 		}
+
+		/*
+		 * Use checksum stored by the write which has replaced the whole content,
+		 * only records written without it are read and checksummed
+		 */
+		if (!blob_read_ext_headers(c, &key, &wc, &ehdr, &jhdr) &&
+		    (ehdr.hdr_flags & DNET_EXT_HDR_FLAGS_DIGEST) && *csize >= DNET_EXT_HDR_DIGEST_SIZE) {
+			memset(csum, 0, *csize);
+			memcpy(csum, ehdr.digest, DNET_EXT_HDR_DIGEST_SIZE);
+			*csize = DNET_EXT_HDR_DIGEST_SIZE;
+			goto err_out_exit;
+		}
+
 		wc.data_offset += ehdr_size;
 		wc.total_data_size -= ehdr_size;
 	}
@@ -933,30 +995,10 @@ static int eblob_backend_lookup(struct dnet_node *n, void *priv, struct dnet_io_
 		goto err_out_set_sizes;
 	}
 
-	/* Sanity */
-	if (size < sizeof(struct dnet_ext_list_hdr)) {
-		err = -ERANGE;
-		goto err_out_set_sizes;
-	}
-
-	err = dnet_ext_hdr_read(&ehdr, wc.data_fd, wc.data_offset);
-	if (err != 0)
-		goto err_out_set_sizes;
-
-	if (size < sizeof(ehdr) + ehdr.size) {
-		err = -ERANGE;
-		goto err_out_set_sizes;
-	}
-
-	err = dnet_read_json_header(wc.data_fd, wc.data_offset + sizeof(ehdr), ehdr.size, &jhdr);
+	err = blob_read_ext_headers(c, &key, &wc, &ehdr, &jhdr);
 	if (err)
 		goto err_out_set_sizes;
 
-	if (size < sizeof(ehdr) + ehdr.size + jhdr.capacity) {
-		err = -ERANGE;
-		goto err_out_set_sizes;
-	}
-
 	dnet_ext_hdr_to_list(&ehdr, &elist);
 
 	io->timestamp = elist.timestamp;
@@ -999,6 +1041,9 @@ static int blob_defrag_start(void *priv, enum dnet_backend_defrag_level level)
 			return -ENOTSUP;
 	}
 
+	/* defragmentation moves records, so cached headers will be dropped by location check anyway */
+	blob_metadata_cache_clear(c);
+
 	int err = eblob_start_defrag_level(c->eblob, defrag_level);
 
 	DNET_LOG_INFO(c->blog, "DEFRAG: defragmentation request: status: %d", err);
@@ -1213,12 +1258,16 @@ static int eblob_backend_command_handler(void *state,
 	struct eblob_backend_config *c = priv;
 
 	// TODO(shaitan): pass @cmd_stats to all blob_* functions and update statistics by them
+	/* commands which modify a record invalidate its cached headers after the record is written,
+	 * so headers read concurrently with the modification are not cached
+	 */
 	switch (cmd->cmd) {
 		case DNET_CMD_LOOKUP:
 			err = blob_file_info(c, state, cmd);
 			break;
 		case DNET_CMD_WRITE:
 			err = blob_write(c, state, cmd, data);
+			blob_metadata_cache_remove(c, ((struct dnet_io_attr *)data)->id);
 			break;
 		case DNET_CMD_READ:
 			err = blob_read(c, state, cmd, data, 1);
@@ -1229,6 +1278,7 @@ static int eblob_backend_command_handler(void *state,
 			break;
 		case DNET_CMD_DEL:
 			err = blob_del(c, cmd);
+			blob_metadata_cache_remove(c, cmd->id.id);
 			break;
 		case DNET_CMD_SEND:
 			err = blob_send(c, state, cmd, data);
@@ -1241,6 +1291,7 @@ static int eblob_backend_command_handler(void *state,
 			break;
 		case DNET_CMD_WRITE_NEW:
 			err = blob_write_new(c, state, cmd, data, cmd_stats, context);
+			blob_metadata_cache_remove(c, cmd->id.id);
 			break;
 		case DNET_CMD_ITERATOR_NEW:
 			err = blob_iterate(c, state, cmd, data, context);
@@ -1250,6 +1301,7 @@ static int eblob_backend_command_handler(void *state,
 			break;
 		case DNET_CMD_DEL_NEW:
 			err = blob_del_new(c, cmd, data, context);
+			blob_metadata_cache_remove(c, cmd->id.id);
 			break;
 		case DNET_CMD_BULK_READ_NEW:
 			err = blob_bulk_read_new(c, state, cmd, data, cmd_stats, context);
@@ -1438,6 +1490,38 @@ static int dnet_blob_set_bg_ioprio_data(struct dnet_config_backend *b, const cha
 	return 0;
 }
 
+static int dnet_blob_set_iterate_thread_num(struct dnet_config_backend *b,
+                                            const char *key __unused, const char *value) {
+	struct eblob_backend_config *c = b->data;
+
+	c->iterate_thread_num = strtoul(value, NULL, 0);
+	return 0;
+}
+
+static int dnet_blob_set_iterate_ordered_partition_keys(struct dnet_config_backend *b,
+                                                        const char *key __unused, const char *value) {
+	struct eblob_backend_config *c = b->data;
+
+	c->iterate_ordered_partition_keys = strtoull(value, NULL, 0);
+	return 0;
+}
+
+static int dnet_blob_set_metadata_cache_size(struct dnet_config_backend *b,
+                                             const char *key __unused, const char *value) {
+	struct eblob_backend_config *c = b->data;
+
+	c->metadata_cache_size = strtoull(value, NULL, 0);
+	return 0;
+}
+
+static int dnet_blob_set_content_digest(struct dnet_config_backend *b,
+                                        const char *key __unused, const char *value) {
+	struct eblob_backend_config *c = b->data;
+
+	c->content_digest = !strcmp(value, "true") || strtoul(value, NULL, 0) != 0;
+	return 0;
+}
+
 
 uint64_t eblob_backend_total_elements(void *priv) {
 	struct eblob_backend_config *r = priv;
@@ -1446,15 +1530,9 @@ uint64_t eblob_backend_total_elements(void *priv) {
 
 int eblob_backend_storage_stat_json(void *priv, char **json_stat, size_t *size)
 {
-	int err;
 	struct eblob_backend_config *r = priv;
 
-	err = eblob_stat_json_get(r->eblob, json_stat, size);
-	if (err) {
-		return err;
-	}
-
-	return 0;
+	return blob_storage_stat_json(r, json_stat, size);
 }
 
 static void eblob_backend_cleanup(void *priv)
@@ -1463,6 +1541,7 @@ static void eblob_backend_cleanup(void *priv)
 
 	eblob_cleanup(c->eblob);
 
+	blob_metadata_cache_destroy(c);
 	pthread_mutex_destroy(&c->last_read_lock);
 }
 
@@ -1597,6 +1676,19 @@ static int dnet_blob_config_init(struct dnet_config_backend *b, enum dnet_log_le
 
 	c->vm_total = st.vm_total * st.vm_total * 1024 * 1024;
 
+	if (!c->iterate_thread_num)
+		c->iterate_thread_num = DNET_BLOB_DEFAULT_ITERATE_THREAD_NUM;
+
+	if (!c->iterate_ordered_partition_keys)
+		c->iterate_ordered_partition_keys = DNET_BLOB_DEFAULT_ITERATE_ORDERED_PARTITION_KEYS;
+
+	err = blob_metadata_cache_create(c);
+	if (err) {
+		DNET_LOG_ERROR(c->blog, "blob: could not create metadata cache of %llu records: %d",
+		               (unsigned long long)c->metadata_cache_size, err);
+		goto err_out_eblob_cleanup;
+	}
+
 	b->cb.storage_stat_json = eblob_backend_storage_stat_json;
 	b->cb.total_elements = eblob_backend_total_elements;
 
@@ -1618,6 +1710,9 @@ static int dnet_blob_config_init(struct dnet_config_backend *b, enum dnet_log_le
 
 	return 0;
 
+err_out_eblob_cleanup:
+	eblob_cleanup(c->eblob);
+	c->eblob = NULL;
 err_out_last_read_lock_destroy:
 	pthread_mutex_destroy(&c->last_read_lock);
 err_out_exit:
@@ -1675,7 +1770,11 @@ static struct dnet_config_entry dnet_cfg_entries_blobsystem[] = {
 	{"periodic_timeout", dnet_blob_set_periodic_timeout},
 	{"backend_id", dnet_blob_set_backend_id},
 	{"bg_ioprio_class", dnet_blob_set_bg_ioprio_class},
-	{"bg_ioprio_data", dnet_blob_set_bg_ioprio_data}
+	{"bg_ioprio_data", dnet_blob_set_bg_ioprio_data},
+	{"iterate_thread_num", dnet_blob_set_iterate_thread_num},
+	{"iterate_ordered_partition_keys", dnet_blob_set_iterate_ordered_partition_keys},
+	{"metadata_cache_size", dnet_blob_set_metadata_cache_size},
+	{"content_digest", dnet_blob_set_content_digest}
 };
 
 static struct dnet_config_backend dnet_eblob_backend = {
@@ -19,11 +19,17 @@
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <algorithm>
+#include <cmath>
 #include <condition_variable>
+#include <limits>
+#include <queue>
+#include <thread>
 
 #include <blackhole/wrapper.hpp>
 
 #include "example/eblob_backend.h"
+#include "example/eblob_metadata_cache.hpp"
 
 #include "elliptics/packet.h"
 #include "elliptics/backends.h"
@@ -75,6 +81,10 @@ int dnet_blob_config_to_json(struct dnet_config_backend *b, char **json_stat, si
 	doc.AddMember("blob_size_limit", c->data.blob_size_limit, allocator);
 	doc.AddMember("defrag_time", c->data.defrag_time, allocator);
 	doc.AddMember("defrag_splay", c->data.defrag_splay, allocator);
+	doc.AddMember("iterate_thread_num", c->iterate_thread_num, allocator);
+	doc.AddMember("iterate_ordered_partition_keys", c->iterate_ordered_partition_keys, allocator);
+	doc.AddMember("metadata_cache_size", c->metadata_cache_size, allocator);
+	doc.AddMember("content_digest", bool(c->content_digest), allocator);
 
 	rapidjson::StringBuffer buffer;
 	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
@@ -119,6 +129,90 @@ int dnet_read_json_header(int fd, uint64_t offset, uint64_t size, dnet_json_head
 	return 0;
 }
 
+int blob_storage_stat_json(eblob_backend_config *c, char **json_stat, size_t *size) {
+	char *eblob_json = nullptr;
+	size_t eblob_json_size = 0;
+	int err = eblob_stat_json_get(c->eblob, &eblob_json, &eblob_json_size);
+	if (err)
+		return err;
+
+	rapidjson::Document doc;
+	doc.Parse<0>(eblob_json);
+	free(eblob_json);
+	if (doc.HasParseError() || !doc.IsObject())
+		return -EINVAL;
+
+	auto &allocator = doc.GetAllocator();
+
+	// eblob knows nothing about options of elliptics backend
+	if (doc.HasMember("config") && doc["config"].IsObject()) {
+		auto &config = doc["config"];
+		config.AddMember("iterate_thread_num", c->iterate_thread_num, allocator);
+		config.AddMember("iterate_ordered_partition_keys", c->iterate_ordered_partition_keys, allocator);
+		config.AddMember("metadata_cache_size", c->metadata_cache_size, allocator);
+		config.AddMember("content_digest", bool(c->content_digest), allocator);
+	}
+
+	if (c->metadata_cache) {
+		rapidjson::Value metadata_cache;
+		c->metadata_cache->statistics(metadata_cache, allocator);
+		doc.AddMember("metadata_cache", metadata_cache, allocator);
+	}
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	doc.Accept(writer);
+
+	*json_stat = strdup(buffer.GetString());
+	if (!*json_stat) {
+		*size = 0;
+		return -ENOMEM;
+	}
+
+	*size = strlen(*json_stat);
+	return 0;
+}
+
+/*
+ * Reads extension header and json header of the record located by @wc and checks that they fit into the record.
+ * Headers are taken from metadata cache if they were cached since the record was written or moved.
+ */
+int blob_read_ext_headers(eblob_backend_config *c, const eblob_key *key, const eblob_write_control *wc,
+                          dnet_ext_list_hdr *ehdr, dnet_json_header *jhdr) {
+	memset(ehdr, 0, sizeof(*ehdr));
+	memset(jhdr, 0, sizeof(*jhdr));
+
+	if (!(wc->flags & BLOB_DISK_CTL_EXTHDR))
+		return 0;
+
+	auto cache = c->metadata_cache;
+	if (cache && cache->get(*key, *wc, *ehdr, *jhdr))
+		return 0;
+
+	const uint64_t generation = cache ? cache->generation(*key) : 0;
+
+	if (wc->total_data_size < sizeof(*ehdr))
+		return -ERANGE;
+
+	int err = dnet_ext_hdr_read(ehdr, wc->data_fd, wc->data_offset);
+	if (err)
+		return err;
+
+	if (wc->total_data_size < sizeof(*ehdr) + ehdr->size)
+		return -ERANGE;
+
+	err = dnet_read_json_header(wc->data_fd, wc->data_offset + sizeof(*ehdr), ehdr->size, jhdr);
+	if (err)
+		return err;
+
+	if (wc->total_data_size < sizeof(*ehdr) + ehdr->size + jhdr->capacity)
+		return -ERANGE;
+
+	if (cache)
+		cache->insert(*key, generation, *wc, *ehdr, *jhdr);
+	return 0;
+}
+
 int blob_file_info_new(eblob_backend_config *c, void *state, dnet_cmd *cmd, struct dnet_access_context *context) {
 	using namespace ioremap::elliptics;
 	eblob_backend *b = c->eblob;
@@ -152,52 +246,18 @@ int blob_file_info_new(eblob_backend_config *c, void *state, dnet_cmd *cmd, stru
 	}
 
 	dnet_ext_list_hdr ehdr;
-	memset(&ehdr, 0, sizeof(ehdr));
-
 	dnet_json_header jhdr;
-	memset(&jhdr, 0, sizeof(jhdr));
-
-	if (wc.flags & BLOB_DISK_CTL_EXTHDR) {
-		if (wc.total_data_size < sizeof(ehdr)) {
-			err = -ERANGE;
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-file-info-new: invalid record: total_data_size({}) < "
-			                        "ehdr({}) : {} [{}]",
-			               dnet_dump_id(&cmd->id), wc.total_data_size, sizeof(ehdr), strerror(-err), err);
-			return err;
-		}
 
-		err = dnet_ext_hdr_read(&ehdr, wc.data_fd, wc.data_offset);
-		if (err) {
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-file-info-new: failed to read ext header: {} [{}]",
-			               dnet_dump_id(&cmd->id), strerror(-err), err);
-			return err;
-		}
-
-		if (wc.total_data_size < sizeof(ehdr) + ehdr.size) {
-			err = -ERANGE;
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-file-info-new: invalid record: total_data_size({}) < "
-			                        "ehdr({}) + json_header({}) = {} : {} [{}]",
-			               dnet_dump_id(&cmd->id), wc.total_data_size, sizeof(ehdr), ehdr.size,
-			               sizeof(ehdr) + ehdr.size, strerror(-err), err);
-			return err;
-		}
-
-		err = dnet_read_json_header(wc.data_fd, wc.data_offset + sizeof(ehdr), ehdr.size, &jhdr);
-		if(err) {
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-file-info-new: failed to read json header: {} [{}]",
-			               dnet_dump_id(&cmd->id), strerror(-err), err);
-			return err;
-		}
-
-		if (wc.total_data_size < sizeof(ehdr) + ehdr.size + jhdr.capacity) {
-			err = -ERANGE;
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-file-info-new: invalid record: total_data_size({}) < "
-			                        "ehdr({}) + json_header({}) + json capacity({}) = {} : {} [{}]",
-			               dnet_dump_id(&cmd->id), wc.total_data_size, sizeof(ehdr), ehdr.size,
-			               jhdr.capacity, sizeof(ehdr) + ehdr.size + jhdr.capacity, strerror(-err), err);
-			return err;
-		}
+	err = blob_read_ext_headers(c, &key, &wc, &ehdr, &jhdr);
+	if (err) {
+		DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-file-info-new: failed to read headers: total_data_size: {}, "
+		                        "ehdr({}) + json_header({}) + json capacity({}): {} [{}]",
+		               dnet_dump_id(&cmd->id), wc.total_data_size, sizeof(ehdr), ehdr.size, jhdr.capacity,
+		               strerror(-err), err);
+		return err;
+	}
 
+	if (wc.flags & BLOB_DISK_CTL_EXTHDR) {
 		wc.size -= sizeof(ehdr) + ehdr.size + jhdr.capacity;
 		// wc.total_data_size -= sizeof(ehdr);
 		wc.data_offset += sizeof(ehdr) + ehdr.size + jhdr.capacity;
@@ -366,57 +426,21 @@ static int blob_read_new_impl(eblob_backend_config *c,
 	};
 
 	dnet_ext_list_hdr ehdr;
-	memset(&ehdr, 0, sizeof(ehdr));
-
 	dnet_json_header jhdr;
-	memset(&jhdr, 0, sizeof(jhdr));
+
+	err = blob_read_ext_headers(c, &key, &wc, &ehdr, &jhdr);
+	if (err) {
+		DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-read-new: {}: failed to read headers: total_data_size: {}, "
+		                        "ehdr({}) + json header({}) + json capacity({}): {} [{}]",
+		               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), wc.total_data_size, sizeof(ehdr),
+		               ehdr.size, jhdr.capacity, strerror(-err), err);
+		return err;
+	}
 
 	uint64_t record_offset = 0;
 	uint64_t headers_csum_time = 0;
 
 	if (wc.flags & BLOB_DISK_CTL_EXTHDR) {
-		if (wc.total_data_size < sizeof(ehdr)) {
-			err = -ERANGE;
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-read-new: {}: invalid record: total_data_size({}) < "
-			                        "ehdr({}) : {} [{}]",
-			               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), wc.total_data_size,
-			               sizeof(ehdr), strerror(-err), err);
-			return err;
-		}
-
-		err = dnet_ext_hdr_read(&ehdr, wc.data_fd, wc.data_offset);
-		if (err) {
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-read-new: {}: failed to read ext header : {} [{}]",
-			               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), strerror(-err), err);
-			return err;
-		}
-
-		if (wc.total_data_size < sizeof(ehdr) + ehdr.size) {
-			err = -ERANGE;
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-read-new: {}: invalid record: total_data_size({}) < "
-			                        "ehdr({}) + json header({}) = {} : {} [{}]",
-			               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), wc.total_data_size,
-			               sizeof(ehdr), ehdr.size, sizeof(ehdr) + ehdr.size, strerror(-err), err);
-			return err;
-		}
-
-		err = dnet_read_json_header(wc.data_fd, wc.data_offset + sizeof(ehdr), ehdr.size, &jhdr);
-		if (err) {
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-read-new: {}: failed to read json header : {} [{}]",
-			               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), strerror(-err), err);
-			return err;
-		}
-
-		if (wc.total_data_size < sizeof(ehdr) + ehdr.size + jhdr.capacity) {
-			err = -ERANGE;
-			DNET_LOG_ERROR(c->blog, "{}: EBLOB: blob-read-new: {}: invalid record: total_data_size({}) < "
-			                        "ehdr({}) + json header({}) + json capacity({}) = {} : {} [{}]",
-			               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), wc.total_data_size,
-			               sizeof(ehdr), ehdr.size, jhdr.capacity, sizeof(ehdr) + ehdr.size + jhdr.capacity,
-			               strerror(-err), err);
-			return err;
-		}
-
 		/* verify headers' checksum only if the record has chunked checksum, otherwise
 		 * it is too heavy operation.
 		 */
@@ -636,14 +660,7 @@ int blob_write_new(eblob_backend_config *c, void *state, dnet_cmd *cmd, void *da
 		if (!record_exists)
 			return;
 
-		if (!(wc.flags & BLOB_DISK_CTL_EXTHDR))
-			return;
-
-		if (dnet_ext_hdr_read(&ehdr, wc.data_fd, wc.data_offset))
-			return;
-
-		if (ehdr.size)
-			dnet_read_json_header(wc.data_fd, wc.data_offset + sizeof(ehdr), ehdr.size, &jhdr);
+		blob_read_ext_headers(c, &key, &wc, &ehdr, &jhdr);
 	};
 
 	if (!(request.ioflags & DNET_IO_FLAGS_PREPARE) || (request.ioflags & DNET_IO_FLAGS_CAS_TIMESTAMP)) {
@@ -753,6 +770,30 @@ int blob_write_new(eblob_backend_config *c, void *state, dnet_cmd *cmd, void *da
 
 	ehdr.size = json_header.size();
 
+	/* single-shot write (prepare and commit in one request) replaces the whole content if it leaves no gaps,
+	 * so its checksum is kept for compare-and-swap
+	 */
+	static const uint64_t single_shot = DNET_IO_FLAGS_PREPARE | DNET_IO_FLAGS_COMMIT;
+	const bool whole_content = c->content_digest &&
+	                           (request.ioflags & single_shot) == single_shot &&
+	                           !(request.ioflags & DNET_IO_FLAGS_UPDATE_JSON) &&
+	                           !request.data_offset && request.data_commit_size == request.data_size &&
+	                           jhdr.capacity == request.json_size;
+	const uint64_t content_size = json_header.size() + request.json_size + request.data_size;
+	if (whole_content) {
+		auto node = dnet_get_node_from_state(state);
+		const iovec content[] = {
+			{json_header.data(), json_header.size()},
+			{data_p.data(), request.json_size},
+			{data_p.skip(request.json_size).data(), request.data_size},
+		};
+		unsigned char digest[DNET_ID_SIZE];
+		if (node && !dnet_checksum_iov(node, content, 3, digest, sizeof(digest))) {
+			memcpy(ehdr.digest, digest, sizeof(ehdr.digest));
+			ehdr.hdr_flags |= DNET_EXT_HDR_FLAGS_DIGEST;
+		}
+	}
+
 	std::vector<eblob_iovec> iov;
 	iov.reserve(3);
 	iov.emplace_back(eblob_iovec{&ehdr, sizeof(ehdr), 0});
@@ -811,6 +852,10 @@ int blob_write_new(eblob_backend_config *c, void *state, dnet_cmd *cmd, void *da
 		return err;
 	}
 
+	err = blob_drop_partial_digest(c, &key, &ehdr, content_size, &wc, flags);
+	if (err)
+		return err;
+
 	if (request.ioflags & DNET_IO_FLAGS_WRITE_NO_FILE_INFO) {
 		cmd->flags |= DNET_FLAGS_NEED_ACK;
 		return 0;
@@ -946,7 +991,8 @@ struct iterated_key_info {
 	, fd{fd}
 	, json_offset{0}
 	, data_offset{0}
-	, data_size{0} {
+	, data_size{0}
+	, buffered{false} {
 		memset(&jhdr, 0, sizeof(jhdr));
 		memset(&ehdr, 0, sizeof(ehdr));
 	}
@@ -957,7 +1003,8 @@ struct iterated_key_info {
 	, fd{fd}
 	, json_offset{0}
 	, data_offset{0}
-	, data_size{0} {
+	, data_size{0}
+	, buffered{false} {
 		memcpy(key.id, dc->key.id, DNET_ID_SIZE);
 
 		memset(&jhdr, 0, sizeof(jhdr));
@@ -972,10 +1019,223 @@ struct iterated_key_info {
 	uint64_t data_size;
 	dnet_json_header jhdr;
 	dnet_ext_list_hdr ehdr;
+	ioremap::elliptics::data_pointer json; // json read while evaluating iterator predicate
+	ioremap::elliptics::data_pointer data; // data read while buffering record of ordered iterator
+	// json and data to be sent are read into the record, @fd may be already released by eblob
+	bool buffered;
 };
 
 typedef std::function<int (std::shared_ptr<iterated_key_info> info)> iterator_callback;
 
+/*
+ * Counters shared by all workers of the iterator.
+ */
+struct iterator_counters {
+	iterator_counters()
+	: iterated_keys{0}
+	, filtered_keys{0}
+	, invalid_json_keys{0} {
+	}
+
+	std::atomic<uint64_t> iterated_keys; // number of records sent to the client
+	std::atomic<uint64_t> filtered_keys; // number of records filtered out by iterator predicate
+	std::atomic<uint64_t> invalid_json_keys; // number of filtered records whose json can't be parsed
+};
+
+static bool predicate_needs_meta(const ioremap::elliptics::dnet_iterator_request &request) {
+	return std::any_of(request.predicate.begin(), request.predicate.end(),
+	                   [] (const ioremap::elliptics::dnet_iterator_condition &condition) {
+		return condition.field != DNET_IPRED_FIELD_RECORD_FLAGS;
+	});
+}
+
+static bool predicate_needs_json(const ioremap::elliptics::dnet_iterator_request &request) {
+	return std::any_of(request.predicate.begin(), request.predicate.end(),
+	                   [] (const ioremap::elliptics::dnet_iterator_condition &condition) {
+		return condition.field == DNET_IPRED_FIELD_JSON;
+	});
+}
+
+static bool check_predicate(eblob_backend_config *c, const ioremap::elliptics::dnet_iterator_request &request) {
+	for (const auto &condition : request.predicate) {
+		if (condition.field <= DNET_IPRED_FIELD_FIRST || condition.field >= DNET_IPRED_FIELD_LAST ||
+		    condition.op <= DNET_IPRED_OP_FIRST || condition.op >= DNET_IPRED_OP_LAST) {
+			DNET_LOG_ERROR(c->blog, "EBLOB: iterator: invalid predicate condition: field: {}, op: {}",
+			               condition.field, condition.op);
+			return false;
+		}
+
+		switch (condition.field) {
+		case DNET_IPRED_FIELD_JSON:
+			if (condition.op != DNET_IPRED_OP_EQ && condition.op != DNET_IPRED_OP_NE) {
+				DNET_LOG_ERROR(c->blog, "EBLOB: iterator: json condition supports only EQ and NE: op: {}",
+				               condition.op);
+				return false;
+			}
+			break;
+		case DNET_IPRED_FIELD_DATA_TIMESTAMP:
+		case DNET_IPRED_FIELD_JSON_TIMESTAMP:
+			if (condition.op == DNET_IPRED_OP_ALL_BITS || condition.op == DNET_IPRED_OP_ANY_BITS) {
+				DNET_LOG_ERROR(c->blog, "EBLOB: iterator: timestamp condition doesn't support bit ops: op: {}",
+				               condition.op);
+				return false;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	if ((request.flags & DNET_IFLAGS_NO_META) && predicate_needs_meta(request)) {
+		DNET_LOG_ERROR(c->blog, "EBLOB: iterator: predicate uses record's metadata which is skipped by no_meta");
+		return false;
+	}
+
+	if (!request.predicate.empty()) {
+		DNET_LOG_NOTICE(c->blog, "EBLOB: iterator: using predicate with {} conditions", request.predicate.size());
+	}
+
+	return true;
+}
+
+template <typename T>
+static bool compare_iterated_value(uint32_t op, T field, T value) {
+	switch (op) {
+	case DNET_IPRED_OP_EQ:
+		return field == value;
+	case DNET_IPRED_OP_NE:
+		return field != value;
+	case DNET_IPRED_OP_LT:
+		return field < value;
+	case DNET_IPRED_OP_LE:
+		return field <= value;
+	case DNET_IPRED_OP_GT:
+		return field > value;
+	case DNET_IPRED_OP_GE:
+		return field >= value;
+	case DNET_IPRED_OP_ALL_BITS:
+		return (field & value) == value;
+	case DNET_IPRED_OP_ANY_BITS:
+		return (field & value) != 0;
+	default:
+		return false;
+	}
+}
+
+static bool compare_iterated_timestamp(uint32_t op, dnet_time field, dnet_time value) {
+	const int cmp = dnet_time_cmp(&field, &value);
+	switch (op) {
+	case DNET_IPRED_OP_EQ:
+		return cmp == 0;
+	case DNET_IPRED_OP_NE:
+		return cmp != 0;
+	case DNET_IPRED_OP_LT:
+		return cmp < 0;
+	case DNET_IPRED_OP_LE:
+		return cmp <= 0;
+	case DNET_IPRED_OP_GT:
+		return cmp > 0;
+	case DNET_IPRED_OP_GE:
+		return cmp >= 0;
+	default:
+		return false;
+	}
+}
+
+static bool compare_iterated_json(const ioremap::elliptics::dnet_iterator_condition &condition,
+                                  const rapidjson::Document &doc) {
+	const bool equal = [&] () {
+		if (!doc.IsObject() || !doc.HasMember(condition.json_key.c_str())) {
+			return false;
+		}
+
+		const auto &member = doc[condition.json_key.c_str()];
+		if (member.IsString()) {
+			return condition.json_value == std::string(member.GetString(), member.GetStringLength());
+		}
+
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		member.Accept(writer);
+		return condition.json_value == buffer.GetString();
+	} ();
+
+	return condition.op == DNET_IPRED_OP_EQ ? equal : !equal;
+}
+
+/*
+ * Evaluates iterator predicate against @info, reads record's json if predicate has json conditions.
+ * Returns negative error code if json couldn't be read, sets @matched otherwise. Record whose json
+ * can't be parsed doesn't match and is counted in @counters.invalid_json_keys.
+ */
+static int match_predicate(const eblob_backend_config *c, const ioremap::elliptics::dnet_iterator_request &request,
+                           iterator_counters &counters, iterated_key_info &info, bool &matched) {
+	using namespace ioremap::elliptics;
+
+	matched = true;
+
+	rapidjson::Document doc;
+	if (predicate_needs_json(request)) {
+		if (info.jhdr.size && info.json.empty()) {
+			info.json = data_pointer::allocate(info.jhdr.size);
+			const int err = dnet_read_ll(info.fd, info.json.data<char>(), info.json.size(), info.json_offset);
+			if (err) {
+				DNET_LOG_ERROR(c->blog, "EBLOB: iterator: {}: failed to read json for predicate: {} [{}]",
+				               dnet_dump_id_str(info.key.id), strerror(-err), err);
+				info.json = data_pointer();
+				return err;
+			}
+		}
+
+		const std::string json = info.json.to_string();
+		doc.Parse<0>(json.empty() ? "{}" : json.c_str());
+		if (doc.HasParseError()) {
+			// corrupted json of one record doesn't break the whole iteration, the record is just filtered out
+			DNET_LOG_ERROR(c->blog, "EBLOB: iterator: {}: failed to parse json for predicate, "
+			                        "record is filtered out: {}",
+			               dnet_dump_id_str(info.key.id), doc.GetParseError());
+			++counters.invalid_json_keys;
+			matched = false;
+			return 0;
+		}
+	}
+
+	for (const auto &condition : request.predicate) {
+		switch (condition.field) {
+		case DNET_IPRED_FIELD_RECORD_FLAGS:
+			matched = compare_iterated_value<uint64_t>(condition.op, info.record_flags, condition.value);
+			break;
+		case DNET_IPRED_FIELD_USER_FLAGS:
+			matched = compare_iterated_value<uint64_t>(condition.op, info.ehdr.flags, condition.value);
+			break;
+		case DNET_IPRED_FIELD_DATA_SIZE:
+			matched = compare_iterated_value<uint64_t>(condition.op, info.data_size, condition.value);
+			break;
+		case DNET_IPRED_FIELD_JSON_SIZE:
+			matched = compare_iterated_value<uint64_t>(condition.op, info.jhdr.size, condition.value);
+			break;
+		case DNET_IPRED_FIELD_DATA_TIMESTAMP:
+			matched = compare_iterated_timestamp(condition.op, info.ehdr.timestamp, condition.timestamp);
+			break;
+		case DNET_IPRED_FIELD_JSON_TIMESTAMP:
+			matched = compare_iterated_timestamp(condition.op, info.jhdr.timestamp, condition.timestamp);
+			break;
+		case DNET_IPRED_FIELD_JSON:
+			matched = compare_iterated_json(condition, doc);
+			break;
+		default:
+			matched = false;
+			break;
+		}
+
+		if (!matched) {
+			break;
+		}
+	}
+
+	return 0;
+}
+
 /*
  * \a congestion_control_monitor allows to limit amount of data sent to a remote backends simultaneously.
  */
@@ -1113,13 +1373,16 @@ static iterator_callback make_iterator_server_send_callback(eblob_backend_config
 				info->data_size, // data_size
 				0, // read_data_size
 				info->data_offset, // data_offset
-				static_cast<uint64_t>(info->fd) // blob_id
+				static_cast<uint64_t>(info->fd), // blob_id
+				0 // filtered_keys
 			});
 		};
 
 		newapi::session session(st->n);
 		session.set_exceptions_policy(session::no_exceptions);
 		session.set_filter(filters::all_final);
+		// writes made by server-send are recovery traffic and shouldn't compete with clients' requests
+		session.set_cflags(DNET_FLAGS_PRIO_RECOVERY);
 		session.set_trace_id(cmd->trace_id);
 		session.set_trace_bit(!!(cmd->flags & DNET_FLAGS_TRACE_BIT));
 		session.set_groups(request.groups);
@@ -1242,9 +1505,9 @@ static iterator_callback make_iterator_server_send_callback(eblob_backend_config
 static iterator_callback make_iterator_network_callback(eblob_backend_config *c, dnet_net_state *st,
                                                         dnet_cmd *cmd,
                                                         ioremap::elliptics::dnet_iterator_request &request,
-                                                        const dnet_iterator *it) {
+                                                        const dnet_iterator *it,
+                                                        std::shared_ptr<iterator_counters> counters) {
 	using namespace ioremap::elliptics;
-	auto counter = std::make_shared<std::atomic<uint64_t>>(0);
 	const uint64_t total_keys = eblob_total_elements(c->eblob);
 
 	return [=, &request] (std::shared_ptr<iterated_key_info> info) -> int {
@@ -1254,7 +1517,9 @@ static iterator_callback make_iterator_network_callback(eblob_backend_config *c,
 		}
 
 		data_pointer json;
-		if ((request.flags & DNET_IFLAGS_JSON) && info->jhdr.size) {
+		if ((request.flags & DNET_IFLAGS_JSON) && !info->json.empty()) {
+			json = info->json;
+		} else if ((request.flags & DNET_IFLAGS_JSON) && info->jhdr.size) {
 			json = data_pointer::allocate(info->jhdr.size);
 			const int err = dnet_read_ll(info->fd, json.data<char>(), json.size(), info->json_offset);
 			if (err) {
@@ -1271,7 +1536,7 @@ static iterator_callback make_iterator_network_callback(eblob_backend_config *c,
 			info->key, // key
 			0, // status
 
-			++(*counter), // iterated_keys
+			++counters->iterated_keys, // iterated_keys
 			total_keys, // total_keys
 
 			info->record_flags, // record_flags
@@ -1286,7 +1551,8 @@ static iterator_callback make_iterator_network_callback(eblob_backend_config *c,
 			info->data_size, // data_size
 			read_data_size, // read_data_size
 			info->data_offset, // data_offset
-			static_cast<uint64_t>(info->fd) // blob_id
+			static_cast<uint64_t>(info->fd), // blob_id
+			counters->filtered_keys.load() // filtered_keys
 		});
 
 		if (st->__need_exit) {
@@ -1295,6 +1561,21 @@ static iterator_callback make_iterator_network_callback(eblob_backend_config *c,
 			return -EINTR;
 		}
 
+		if (info->buffered) {
+			auto response = data_pointer::allocate(header.size() + json.size() + read_data_size);
+
+			memcpy(response.data(), header.data(), header.size());
+			if (!json.empty()) {
+				memcpy(response.skip(header.size()).data(), json.data(), json.size());
+			}
+			if (read_data_size) {
+				memcpy(response.skip(header.size() + json.size()).data(), info->data.data(),
+				       read_data_size);
+			}
+
+			return dnet_send_reply_threshold(st, cmd, response.data(), response.size(), 1);
+		}
+
 		auto response = data_pointer::allocate(sizeof(*cmd) + header.size() + json.size());
 
 		memcpy(response.data(), cmd, sizeof(*cmd));
@@ -1315,6 +1596,7 @@ static iterator_callback make_iterator_network_callback(eblob_backend_config *c,
 static int blob_iterate_callback_common(const eblob_backend_config *c,
                                         const ioremap::elliptics::dnet_iterator_request &request,
                                         dnet_iterator *it,
+                                        iterator_counters &counters,
                                         const eblob_disk_control *dc, int fd, uint64_t offset,
                                         iterator_callback callback) {
 	assert(dc != nullptr);
@@ -1378,6 +1660,20 @@ static int blob_iterate_callback_common(const eblob_backend_config *c,
 	info->json_offset = offset;
 	info->data_offset = offset + info->jhdr.capacity;
 
+	if (!request.predicate.empty()) {
+		bool matched = false;
+		err = match_predicate(c, request, counters, *info, matched);
+		if (err) {
+			return err;
+		}
+
+		if (!matched) {
+			/* skip key which doesn't match the predicate */
+			++counters.filtered_keys;
+			return dnet_iterator_flow_control(it);
+		}
+	}
+
 	const std::string data_ts = dnet_print_time(&info->ehdr.timestamp);
 	const std::string json_ts = dnet_print_time(&info->jhdr.timestamp);
 
@@ -1394,8 +1690,407 @@ static int blob_iterate_callback_common(const eblob_backend_config *c,
 	return dnet_iterator_flow_control(it);
 }
 
+typedef std::function<int (const eblob_disk_control *dc, int fd, uint64_t data_offset)> blob_iterate_callback;
+
+/*
+ * Runs eblob iteration restricted by @key_ranges and calls @callback for each iterated record.
+ */
+static int blob_iterate_ranges(eblob_backend_config *c, const std::vector<dnet_iterator_range> &key_ranges,
+                               const blob_iterate_callback &callback) {
+	eblob_iterate_control control;
+	memset(&control, 0, sizeof(control));
+
+	control.b = c->eblob;
+	control.log = c->data.log;
+	control.flags = EBLOB_ITERATE_FLAGS_ALL | EBLOB_ITERATE_FLAGS_READONLY;
+
+	std::vector<eblob_index_block> ranges;
+	ranges.reserve(key_ranges.size());
+
+	for (const auto &range : key_ranges) {
+		eblob_key begin, end;
+		memcpy(begin.id, range.key_begin.id, EBLOB_ID_SIZE);
+		memcpy(end.id, range.key_end.id, EBLOB_ID_SIZE);
+
+		ranges.emplace_back(eblob_index_block{begin, end, 0, 0});
+	}
+
+	control.range = ranges.data();
+	control.range_num = ranges.size();
+
+	control.priv = const_cast<blob_iterate_callback *>(&callback);
+
+	control.iterator_cb.iterator = [] (eblob_disk_control *dc, eblob_ram_control *,
+	                                   int fd, uint64_t data_offset, void *priv, void *) ->int {
+		const auto &callback = *static_cast<const blob_iterate_callback *>(priv);
+		return callback(dc, fd, data_offset);
+	};
+
+	return eblob_iterate(c->eblob, &control);
+}
+
+static uint64_t key_prefix(const dnet_raw_id &key) {
+	uint64_t prefix = 0;
+	for (size_t i = 0; i < sizeof(prefix); ++i) {
+		prefix = (prefix << 8) | key.id[i];
+	}
+	return prefix;
+}
+
+static dnet_raw_id make_partition_key(uint64_t prefix, uint8_t fill) {
+	dnet_raw_id key;
+	memset(key.id, fill, sizeof(key.id));
+	for (size_t i = sizeof(prefix); i > 0; --i) {
+		key.id[i - 1] = prefix & 0xff;
+		prefix >>= 8;
+	}
+	return key;
+}
+
+/*
+ * Splits key space covered by @key_ranges into at most @count disjoint partitions by the first 8 bytes of the key.
+ * Each partition is a list of key ranges, partitions are ordered by key and empty partitions are skipped.
+ */
+static std::vector<std::vector<dnet_iterator_range>> split_key_ranges(const std::vector<dnet_iterator_range> &key_ranges,
+                                                                      size_t count) {
+	std::vector<std::vector<dnet_iterator_range>> partitions;
+	if (key_ranges.empty() || count == 0) {
+		return partitions;
+	}
+
+	uint64_t low = std::numeric_limits<uint64_t>::max();
+	uint64_t high = 0;
+	for (const auto &range : key_ranges) {
+		low = std::min(low, key_prefix(range.key_begin));
+		high = std::max(high, key_prefix(range.key_end));
+	}
+
+	const uint64_t step = (high - low) / count + 1;
+
+	for (uint64_t begin = low; begin <= high; begin += step) {
+		const uint64_t end = (high - begin < step) ? high : begin + step - 1;
+
+		const dnet_raw_id partition_begin = make_partition_key(begin, 0x00);
+		const dnet_raw_id partition_end = make_partition_key(end, 0xff);
+
+		std::vector<dnet_iterator_range> ranges;
+		for (const auto &range : key_ranges) {
+			dnet_iterator_range intersection;
+			intersection.key_begin = dnet_id_cmp_str(range.key_begin.id, partition_begin.id) > 0
+				? range.key_begin : partition_begin;
+			intersection.key_end = dnet_id_cmp_str(range.key_end.id, partition_end.id) < 0
+				? range.key_end : partition_end;
+
+			if (dnet_id_cmp_str(intersection.key_begin.id, intersection.key_end.id) <= 0) {
+				ranges.emplace_back(intersection);
+			}
+		}
+
+		if (!ranges.empty()) {
+			partitions.emplace_back(std::move(ranges));
+		}
+
+		if (end == high) {
+			break;
+		}
+	}
+
+	return partitions;
+}
+
+typedef std::vector<std::shared_ptr<iterated_key_info>> iterated_keys_vector;
+
+/*
+ * Merges records of one partition by key.
+ * Records of each blob are iterated as a contiguous run: sorted blobs produce runs which are already ordered by key,
+ * runs from unsorted blobs are sorted in place. Then runs are k-way merged.
+ */
+static iterated_keys_vector merge_iterated_runs(iterated_keys_vector &records) {
+	auto less = [] (const std::shared_ptr<iterated_key_info> &lhs, const std::shared_ptr<iterated_key_info> &rhs) {
+		return dnet_id_cmp_str(lhs->key.id, rhs->key.id) < 0;
+	};
+
+	typedef iterated_keys_vector::iterator iterator;
+	std::vector<std::pair<iterator, iterator>> runs;
+
+	for (auto begin = records.begin(); begin != records.end();) {
+		const int fd = (*begin)->fd;
+		auto end = std::find_if(begin, records.end(), [fd] (const std::shared_ptr<iterated_key_info> &info) {
+			return info->fd != fd;
+		});
+
+		if (!std::is_sorted(begin, end, less)) {
+			std::sort(begin, end, less);
+		}
+
+		runs.emplace_back(begin, end);
+		begin = end;
+	}
+
+	if (runs.size() < 2) {
+		return std::move(records);
+	}
+
+	auto greater = [&less] (const std::pair<iterator, iterator> &lhs, const std::pair<iterator, iterator> &rhs) {
+		return less(*rhs.first, *lhs.first);
+	};
+
+	std::priority_queue<std::pair<iterator, iterator>, std::vector<std::pair<iterator, iterator>>,
+	                    decltype(greater)> heap(greater, std::move(runs));
+
+	iterated_keys_vector merged;
+	merged.reserve(records.size());
+
+	while (!heap.empty()) {
+		auto run = heap.top();
+		heap.pop();
+
+		merged.emplace_back(std::move(*run.first));
+
+		if (++run.first != run.second) {
+			heap.push(run);
+		}
+	}
+
+	return merged;
+}
+
+/*
+ * Returns the number of partitions of ordered iteration over @key_ranges, so a partition holds about
+ * @c->iterate_ordered_partition_keys records assuming keys are distributed uniformly.
+ */
+static size_t ordered_partitions_number(eblob_backend_config *c, const std::vector<dnet_iterator_range> &key_ranges,
+                                        size_t thread_num) {
+	long double share = 0;
+	for (const auto &range : key_ranges) {
+		const uint64_t width = key_prefix(range.key_end) - key_prefix(range.key_begin);
+		share += (static_cast<long double>(width) + 1) / std::pow(2.0L, 64);
+	}
+
+	const long double keys = std::min<long double>(share, 1) * eblob_total_elements(c->eblob);
+	const long double partitions = std::ceil(keys / std::max<uint64_t>(c->iterate_ordered_partition_keys, 1));
+	return std::max<size_t>(thread_num, std::min<long double>(partitions, std::numeric_limits<uint32_t>::max()));
+}
+
+/*
+ * Reads json and data of the record which are sent by the iterator, so buffered record can be sent
+ * after eblob has released its blob: the blob may be defragmented or closed by then.
+ */
+static int read_iterated_record(eblob_backend_config *c, const ioremap::elliptics::dnet_iterator_request &request,
+                                iterated_key_info &info) {
+	using namespace ioremap::elliptics;
+
+	if ((request.flags & DNET_IFLAGS_JSON) && info.json.empty() && info.jhdr.size) {
+		info.json = data_pointer::allocate(info.jhdr.size);
+		const int err = dnet_read_ll(info.fd, info.json.data<char>(), info.json.size(), info.json_offset);
+		if (err) {
+			DNET_LOG_ERROR(c->blog, "EBLOB: iterator: {}: failed to read json: {} [{}]",
+			               dnet_dump_id_str(info.key.id), strerror(-err), err);
+			return err;
+		}
+	}
+
+	if ((request.flags & DNET_IFLAGS_DATA) && info.data_size) {
+		info.data = data_pointer::allocate(info.data_size);
+		const int err = dnet_read_ll(info.fd, info.data.data<char>(), info.data.size(), info.data_offset);
+		if (err) {
+			DNET_LOG_ERROR(c->blog, "EBLOB: iterator: {}: failed to read data: {} [{}]",
+			               dnet_dump_id_str(info.key.id), strerror(-err), err);
+			return err;
+		}
+	}
+
+	info.buffered = true;
+	return 0;
+}
+
+/*
+ * Iterates backend by @c->iterate_thread_num workers.
+ *
+ * Key space is split into partitions and each worker iterates its partition via eblob with partition's
+ * key ranges. Every partition walks all blobs and skips keys out of its ranges, so without DNET_IFLAGS_ORDERED
+ * the number of partitions is bounded by the number of workers: more partitions would read blobs more times
+ * without adding parallelism. Records are sent as soon as they are read then.
+ * With DNET_IFLAGS_ORDERED worker buffers records of the partition together with their json and data,
+ * merges them by key and waits until all preceding partitions are sent. Partitions are sized by
+ * @c->iterate_ordered_partition_keys, so at most @c->iterate_thread_num partitions of bounded size
+ * are buffered at once.
+ */
+static int blob_iterate_parallel(eblob_backend_config *c, dnet_cmd *cmd,
+                                 const ioremap::elliptics::dnet_iterator_request &request,
+                                 dnet_iterator *it, iterator_counters &counters,
+                                 const iterator_callback &callback) {
+	using namespace ioremap::elliptics;
+
+	const bool ordered = request.flags & DNET_IFLAGS_ORDERED;
+	const size_t thread_num = std::max(c->iterate_thread_num, 1u);
+
+	std::vector<dnet_iterator_range> key_ranges;
+	if (request.flags & DNET_IFLAGS_KEY_RANGE) {
+		key_ranges = request.key_ranges;
+	} else {
+		dnet_iterator_range range;
+		memset(range.key_begin.id, 0x00, sizeof(range.key_begin.id));
+		memset(range.key_end.id, 0xff, sizeof(range.key_end.id));
+		key_ranges.emplace_back(range);
+	}
+
+	const auto partitions = split_key_ranges(key_ranges, ordered ? ordered_partitions_number(c, key_ranges, thread_num)
+	                                                             : thread_num);
+
+	DNET_LOG_INFO(c->blog, "EBLOB: iterator: parallel: {}: threads: {}, partitions: {}",
+	              ordered ? "ordered" : "unordered", thread_num, partitions.size());
+
+	std::atomic<size_t> next_partition{0};
+	std::atomic<int> error{0};
+
+	std::mutex emit_mutex;
+	std::condition_variable emit_cond;
+	size_t emit_partition = 0;
+
+	auto set_error = [&] (int err) {
+		int expected = 0;
+		error.compare_exchange_strong(expected, err);
+		std::unique_lock<std::mutex> lock(emit_mutex);
+		emit_cond.notify_all();
+	};
+
+	auto iterate_partition = [&] (size_t index) -> int {
+		iterated_keys_vector records;
+
+		iterator_callback partition_callback = callback;
+		if (ordered) {
+			partition_callback = [&] (std::shared_ptr<iterated_key_info> info) -> int {
+				const int err = read_iterated_record(c, request, *info);
+				if (err) {
+					return err;
+				}
+				records.emplace_back(std::move(info));
+				return 0;
+			};
+		}
+
+		int err = blob_iterate_ranges(c, partitions[index],
+			[&] (const eblob_disk_control *dc, int fd, uint64_t data_offset) -> int {
+				if (const int err = error.load()) {
+					return err;
+				}
+				return blob_iterate_callback_common(c, request, it, counters, dc, fd, data_offset,
+				                                    partition_callback);
+			});
+
+		if (err || !ordered) {
+			return err;
+		}
+
+		records = merge_iterated_runs(records);
+
+		std::unique_lock<std::mutex> lock(emit_mutex);
+		emit_cond.wait(lock, [&] { return emit_partition == index || error.load(); });
+		lock.unlock();
+
+		if ((err = error.load())) {
+			return err;
+		}
+
+		for (auto &info : records) {
+			err = callback(info);
+			if (err) {
+				return err;
+			}
+			info.reset();
+
+			// pause and cancel of the iterator are checked while buffered partition is sent
+			err = dnet_iterator_flow_control(it);
+			if (err) {
+				return err;
+			}
+		}
+
+		lock.lock();
+		++emit_partition;
+		emit_cond.notify_all();
+		return 0;
+	};
+
+	auto worker = [&] () {
+		try {
+			for (size_t index = next_partition++; index < partitions.size() && !error.load();
+			     index = next_partition++) {
+				const int err = iterate_partition(index);
+				if (err) {
+					DNET_LOG_ERROR(c->blog, "EBLOB: iterator: parallel: partition: {}/{} failed: {} [{}]",
+					               index, partitions.size(), strerror(-err), err);
+					set_error(err);
+					break;
+				}
+
+				DNET_LOG_NOTICE(c->blog, "EBLOB: iterator: parallel: partition: {}/{} completed",
+				                index, partitions.size());
+			}
+		} catch (const std::bad_alloc &) {
+			set_error(-ENOMEM);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(thread_num);
+	for (size_t i = 1; i < std::min(thread_num, partitions.size()); ++i) {
+		workers.emplace_back([&] () {
+			backend_scope backend_scope{c->data.stat_id};
+			trace_scope trace_scope{cmd->trace_id, !!(cmd->flags & DNET_FLAGS_TRACE_BIT)};
+			worker();
+		});
+	}
+
+	/* the thread which has started the iterator is one of the workers */
+	worker();
+
+	for (auto &thread : workers) {
+		thread.join();
+	}
+
+	return error.load();
+}
+
+/*
+ * Sends the last response of the iterator with predicate, which reports final counters of the iteration:
+ * counters of records' responses don't include records filtered out after the last sent one.
+ */
+static int send_iterator_summary(eblob_backend_config *c, dnet_net_state *st, dnet_cmd *cmd,
+                                 const dnet_iterator *it, const iterator_counters &counters) {
+	using namespace ioremap::elliptics;
+
+	const auto response = serialize(ioremap::elliptics::dnet_iterator_response{
+		it->id, // iterator_id
+		dnet_raw_id{{0}}, // key
+		DNET_ITERATOR_STATUS_SUMMARY, // status
+
+		counters.iterated_keys.load(), // iterated_keys
+		eblob_total_elements(c->eblob), // total_keys
+
+		0, // record_flags
+		0, // user_flags
+
+		dnet_time{0, 0}, // json_timestamp
+		0, // json_size
+		0, // json_capacity
+		0, // read_json_size
+
+		dnet_time{0, 0}, // data_timestamp
+		0, // data_size
+		0, // read_data_size
+		0, // data_offset
+		0, // blob_id
+		counters.filtered_keys.load() // filtered_keys
+	});
+
+	return dnet_send_reply(st, cmd, response.data(), response.size(), 1, /*context*/ nullptr);
+}
+
 static int blob_iterator_start(struct eblob_backend_config *c, dnet_net_state *st, dnet_cmd *cmd,
-                               ioremap::elliptics::dnet_iterator_request &request) {
+                               ioremap::elliptics::dnet_iterator_request &request,
+                               dnet_access_context *context) {
 	using namespace ioremap::elliptics;
 
 	if (request.flags & ~DNET_IFLAGS_ALL) {
@@ -1403,6 +2098,11 @@ static int blob_iterator_start(struct eblob_backend_config *c, dnet_net_state *s
 		return -ENOTSUP;
 	}
 
+	if ((request.flags & DNET_IFLAGS_ORDERED) && !(request.flags & DNET_IFLAGS_PARALLEL)) {
+		DNET_LOG_ERROR(c->blog, "EBLOB: iteration failed: DNET_IFLAGS_ORDERED requires DNET_IFLAGS_PARALLEL");
+		return -EINVAL;
+	}
+
 	if (request.type <= DNET_ITYPE_FIRST ||
 	    request.type >= DNET_ITYPE_LAST) {
 		DNET_LOG_ERROR(c->blog, "EBLOB: iteration failed: unknown iteration type: {}", request.type);
@@ -1417,27 +2117,10 @@ static int blob_iterator_start(struct eblob_backend_config *c, dnet_net_state *s
 		return -ERANGE;
 	}
 
-	eblob_iterate_control control;
-	memset(&control, 0, sizeof(control));
-
-	control.b = c->eblob;
-	control.log = c->data.log;
-	control.flags = EBLOB_ITERATE_FLAGS_ALL | EBLOB_ITERATE_FLAGS_READONLY;
-
-	std::vector<eblob_index_block> ranges;
-	ranges.reserve(request.key_ranges.size());
-
-	for (const auto &range : request.key_ranges) {
-		eblob_key begin, end;
-		memcpy(begin.id, range.key_begin.id, EBLOB_ID_SIZE);
-		memcpy(end.id, range.key_end.id, EBLOB_ID_SIZE);
-
-		ranges.emplace_back(eblob_index_block{begin, end, 0, 0});
+	if (!check_predicate(c, request)) {
+		return -EINVAL;
 	}
 
-	control.range = ranges.data();
-	control.range_num = ranges.size();
-
 	auto deleter = [&st] (dnet_iterator *p) {
 		dnet_iterator_destroy(st->n, p);
 	};
@@ -1447,6 +2130,7 @@ static int blob_iterator_start(struct eblob_backend_config *c, dnet_net_state *s
 		return -ENOMEM;
 	}
 
+	auto counters = std::make_shared<iterator_counters>();
 	iterator_callback callback;
 
 	switch (request.type) {
@@ -1455,7 +2139,7 @@ static int blob_iterator_start(struct eblob_backend_config *c, dnet_net_state *s
 			return -ENOTSUP;
 		}
 		case DNET_ITYPE_NETWORK: {
-			callback = make_iterator_network_callback(c, st, cmd, request, it.get());
+			callback = make_iterator_network_callback(c, st, cmd, request, it.get(), counters);
 			break;
 		}
 		default: {
@@ -1464,19 +2148,33 @@ static int blob_iterator_start(struct eblob_backend_config *c, dnet_net_state *s
 		}
 	}
 
-	auto common_callback = [&] (const eblob_disk_control *dc, int fd, uint64_t data_offset) -> int {
-		return blob_iterate_callback_common(c, request, it.get(), dc, fd, data_offset, callback);
-	};
+	int err;
+	if (request.flags & DNET_IFLAGS_PARALLEL) {
+		err = blob_iterate_parallel(c, cmd, request, it.get(), *counters, callback);
+	} else {
+		err = blob_iterate_ranges(c, request.key_ranges,
+			[&] (const eblob_disk_control *dc, int fd, uint64_t data_offset) -> int {
+				return blob_iterate_callback_common(c, request, it.get(), *counters, dc, fd, data_offset,
+				                                    callback);
+			});
+	}
 
-	control.priv = &common_callback;
+	DNET_LOG_INFO(c->blog, "EBLOB: iterator: sent keys: {}, filtered keys: {}, keys with invalid json: {}",
+	              counters->iterated_keys.load(), counters->filtered_keys.load(),
+	              counters->invalid_json_keys.load());
 
-	control.iterator_cb.iterator = [] (eblob_disk_control *dc, eblob_ram_control *,
-	                                   int fd, uint64_t data_offset, void *priv, void *) ->int {
-		auto callback = *static_cast<decltype(common_callback) *>(priv);
-		return callback(dc, fd, data_offset);
-	};
+	if (!err && !request.predicate.empty()) {
+		err = send_iterator_summary(c, st, cmd, it.get(), *counters);
+	}
 
-	return eblob_iterate(c->eblob, &control);
+	if (context) {
+		context->add({{"iterated_keys", counters->iterated_keys.load()},
+		              {"filtered_keys", counters->filtered_keys.load()},
+		              {"invalid_json_keys", counters->invalid_json_keys.load()},
+		             });
+	}
+
+	return err;
 }
 
 int blob_iterate(struct eblob_backend_config *c,
@@ -1507,6 +2205,7 @@ int blob_iterate(struct eblob_backend_config *c,
 		              {"type", request.type},
 		              {"flags", to_hex_string(request.flags)},
 		              {"key_ranges", request.key_ranges.size()},
+		              {"predicate", request.predicate.size()},
 		              {"groups", groups},
 		             });
 	}
@@ -1524,7 +2223,7 @@ int blob_iterate(struct eblob_backend_config *c,
 	int err = 0;
 	switch (request.action) {
 		case DNET_ITERATOR_ACTION_START:
-			err = blob_iterator_start(c, reinterpret_cast<dnet_net_state*>(state), cmd, request);
+			err = blob_iterator_start(c, reinterpret_cast<dnet_net_state*>(state), cmd, request, context);
 			break;
 		case DNET_ITERATOR_ACTION_PAUSE:
 		case DNET_ITERATOR_ACTION_CONTINUE:
@@ -1596,7 +2295,8 @@ int blob_send_new(struct eblob_backend_config *c,
 		0, // data_size
 		0, // read_data_size
 		0, // data_offset
-		0 // blob_id
+		0, // blob_id
+		0 // filtered_keys
 	};
 
 	auto send_fail_reply = [&] (int status) {
@@ -1731,6 +2431,13 @@ int blob_send_new(struct eblob_backend_config *c,
 
 	monitor.wait_completion();
 
+	// moved keys are removed from the backend, so their cached headers shouldn't outlive them
+	if (request.flags & DNET_IFLAGS_MOVE) {
+		for (const auto &key : request.keys) {
+			blob_metadata_cache_remove(c, key.id);
+		}
+	}
+
 	DNET_LOG(c->blog, err ? DNET_LOG_ERROR : DNET_LOG_INFO, "EBLOB: {} finished: {}", __func__,
 	         dnet_print_error(err));
 	return err;
@@ -1812,7 +2519,7 @@ int blob_bulk_read_new(struct eblob_backend_config *c,
 		read_stats.handle_time = timer.get_us();
 
 		backend->command_stats().command_counter(DNET_CMD_READ_NEW, cmd_copy.trans, err, /*handled_in_cache*/ 0,
-		                                         read_stats.size, read_stats.handle_time);
+		                                         read_stats.size, read_stats.handle_time, cmd_stats->queue_time);
 	}
 
 	return 0;
@@ -32,6 +32,13 @@ extern "C" {
 
 struct dnet_config_backend;
 struct dnet_cmd_stats;
+struct blob_metadata_cache;
+
+/* Default number of workers used by iterator started with DNET_IFLAGS_PARALLEL */
+#define DNET_BLOB_DEFAULT_ITERATE_THREAD_NUM	4
+
+/* Default number of records per partition buffered by iterator started with DNET_IFLAGS_ORDERED */
+#define DNET_BLOB_DEFAULT_ITERATE_ORDERED_PARTITION_KEYS	65536
 
 struct eblob_read_params {
 	int			fd;
@@ -50,9 +57,19 @@ struct eblob_backend_config {
 	int				random_access;
 	int				last_read_index;
 	struct eblob_read_params	last_reads[100];
+
+	unsigned int			iterate_thread_num;	/* number of workers used by parallel iterator */
+	uint64_t			iterate_ordered_partition_keys;	/* estimated number of records per partition
+										 * buffered by ordered parallel iterator */
+
+	uint64_t			metadata_cache_size;	/* max number of records which headers are cached, 0 disables cache */
+	struct blob_metadata_cache	*metadata_cache;
+
+	int				content_digest;		/* keep checksum of whole-content writes for checksum CAS */
 };
 
 int dnet_blob_config_to_json(struct dnet_config_backend *b, char **json_stat, size_t *size);
+int blob_storage_stat_json(struct eblob_backend_config *c, char **json_stat, size_t *size);
 
 int blob_file_info_new(struct eblob_backend_config *c, void *state, struct dnet_cmd *cmd,
                        struct dnet_access_context *context);
@@ -79,6 +96,17 @@ int blob_bulk_read_new(struct eblob_backend_config *c,
 		       struct dnet_access_context *context);
 
 int dnet_read_json_header(int fd, uint64_t offset, uint64_t size, struct dnet_json_header *jhdr);
+int blob_drop_partial_digest(struct eblob_backend_config *c, struct eblob_key *key, struct dnet_ext_list_hdr *ehdr,
+                             uint64_t content_size, const struct eblob_write_control *wc, uint64_t flags);
+int blob_read_ext_headers(struct eblob_backend_config *c, const struct eblob_key *key,
+                          const struct eblob_write_control *wc,
+                          struct dnet_ext_list_hdr *ehdr, struct dnet_json_header *jhdr);
+
+/* Metadata cache is created only if metadata_cache_size is set, all calls are no-op if it doesn't exist */
+int blob_metadata_cache_create(struct eblob_backend_config *c);
+void blob_metadata_cache_destroy(struct eblob_backend_config *c);
+void blob_metadata_cache_remove(struct eblob_backend_config *c, const unsigned char *id);
+void blob_metadata_cache_clear(struct eblob_backend_config *c);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,170 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "example/eblob_metadata_cache.hpp"
+
+#include <algorithm>
+
+#include "example/eblob_backend.h"
+
+blob_metadata_cache::blob_metadata_cache(uint64_t max_size)
+: m_max_size(max_size)
+, m_shard_max_size(std::max<uint64_t>((max_size + shards_count - 1) / shards_count, 1))
+, m_hits(0)
+, m_misses(0)
+, m_stale(0)
+, m_invalidations(0) {}
+
+blob_metadata_cache::shard &blob_metadata_cache::get_shard(const eblob_key &key) {
+	// the first bytes of the key are used by hash, so the shard is picked by the last one
+	return m_shards[key.id[EBLOB_ID_SIZE - 1] % shards_count];
+}
+
+const blob_metadata_cache::shard &blob_metadata_cache::get_shard(const eblob_key &key) const {
+	return m_shards[key.id[EBLOB_ID_SIZE - 1] % shards_count];
+}
+
+uint64_t blob_metadata_cache::generation(const eblob_key &key) const {
+	auto &shard = get_shard(key);
+
+	std::lock_guard<std::mutex> guard(shard.mutex);
+	return shard.generation;
+}
+
+bool blob_metadata_cache::get(const eblob_key &key, const eblob_write_control &wc,
+                              dnet_ext_list_hdr &ehdr, dnet_json_header &jhdr) {
+	auto &shard = get_shard(key);
+
+	std::lock_guard<std::mutex> guard(shard.mutex);
+
+	auto it = shard.records.find(key);
+	if (it == shard.records.end()) {
+		++m_misses;
+		return false;
+	}
+
+	const auto &record = *it->second;
+	if (record.data_fd != wc.data_fd ||
+	    record.data_offset != wc.data_offset ||
+	    record.total_data_size != wc.total_data_size ||
+	    record.flags != wc.flags) {
+		shard.lru.erase(it->second);
+		shard.records.erase(it);
+		++m_stale;
+		++m_misses;
+		return false;
+	}
+
+	ehdr = record.ehdr;
+	jhdr = record.jhdr;
+	shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+	++m_hits;
+	return true;
+}
+
+void blob_metadata_cache::insert(const eblob_key &key, uint64_t generation, const eblob_write_control &wc,
+                                 const dnet_ext_list_hdr &ehdr, const dnet_json_header &jhdr) {
+	auto &shard = get_shard(key);
+
+	std::lock_guard<std::mutex> guard(shard.mutex);
+	if (shard.generation != generation)
+		return;
+
+	auto it = shard.records.find(key);
+	if (it != shard.records.end()) {
+		shard.lru.erase(it->second);
+		shard.records.erase(it);
+	}
+
+	shard.lru.emplace_front(record{key, wc.data_fd, wc.data_offset, wc.total_data_size, wc.flags, ehdr, jhdr});
+	shard.records.emplace(key, shard.lru.begin());
+
+	while (shard.lru.size() > m_shard_max_size) {
+		shard.records.erase(shard.lru.back().key);
+		shard.lru.pop_back();
+	}
+}
+
+void blob_metadata_cache::remove(const eblob_key &key) {
+	auto &shard = get_shard(key);
+
+	std::lock_guard<std::mutex> guard(shard.mutex);
+	++shard.generation;
+	++m_invalidations;
+
+	auto it = shard.records.find(key);
+	if (it != shard.records.end()) {
+		shard.lru.erase(it->second);
+		shard.records.erase(it);
+	}
+}
+
+void blob_metadata_cache::clear() {
+	for (auto &shard : m_shards) {
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		++shard.generation;
+		shard.records.clear();
+		shard.lru.clear();
+	}
+}
+
+void blob_metadata_cache::statistics(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator) const {
+	uint64_t size = 0;
+	for (const auto &shard : m_shards) {
+		std::lock_guard<std::mutex> guard(shard.mutex);
+		size += shard.lru.size();
+	}
+
+	value.SetObject();
+	value.AddMember("size", size, allocator);
+	value.AddMember("max_size", m_max_size, allocator);
+	value.AddMember("hits", m_hits.load(), allocator);
+	value.AddMember("misses", m_misses.load(), allocator);
+	value.AddMember("stale", m_stale.load(), allocator);
+	value.AddMember("invalidations", m_invalidations.load(), allocator);
+}
+
+int blob_metadata_cache_create(struct eblob_backend_config *c) {
+	if (!c->metadata_cache_size)
+		return 0;
+
+	try {
+		c->metadata_cache = new blob_metadata_cache(c->metadata_cache_size);
+	} catch (const std::bad_alloc &) {
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+void blob_metadata_cache_destroy(struct eblob_backend_config *c) {
+	delete c->metadata_cache;
+	c->metadata_cache = nullptr;
+}
+
+void blob_metadata_cache_remove(struct eblob_backend_config *c, const unsigned char *id) {
+	if (!c->metadata_cache)
+		return;
+
+	eblob_key key;
+	memcpy(key.id, id, EBLOB_ID_SIZE);
+	c->metadata_cache->remove(key);
+}
+
+void blob_metadata_cache_clear(struct eblob_backend_config *c) {
+	if (c->metadata_cache)
+		c->metadata_cache->clear();
+}
@@ -0,0 +1,121 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DNET_EBLOB_METADATA_CACHE_HPP
+#define __DNET_EBLOB_METADATA_CACHE_HPP
+
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <eblob/blob.h>
+
+#include "elliptics/packet.h"
+
+#include "rapidjson/document.h"
+
+/*
+ * Bounded LRU cache of records' headers (extension header and json header) kept by eblob backend.
+ * Cached headers are used only while eblob returns the same location of the record as it had
+ * when headers were read, so records moved by defragmentation are reread from disk.
+ * Writes and removals invalidate the key, headers read concurrently with the invalidation are not cached:
+ * each shard has generation which is increased by invalidation and checked by insertion.
+ */
+class blob_metadata_cache {
+public:
+	explicit blob_metadata_cache(uint64_t max_size);
+
+	blob_metadata_cache(const blob_metadata_cache &) = delete;
+	blob_metadata_cache &operator=(const blob_metadata_cache &) = delete;
+
+	/*
+	 * Returns generation of the shard which keeps @key,
+	 * it should be taken before reading headers from disk and passed to insert()
+	 */
+	uint64_t generation(const eblob_key &key) const;
+
+	/*
+	 * Fills @ehdr and @jhdr by cached headers of @key if the record is still located where @wc points to.
+	 * Returns false if there is no such record in the cache.
+	 */
+	bool get(const eblob_key &key, const eblob_write_control &wc, dnet_ext_list_hdr &ehdr, dnet_json_header &jhdr);
+
+	/*
+	 * Caches headers of @key located by @wc, nothing is cached if the shard was invalidated after @generation
+	 */
+	void insert(const eblob_key &key, uint64_t generation, const eblob_write_control &wc,
+	            const dnet_ext_list_hdr &ehdr, const dnet_json_header &jhdr);
+
+	void remove(const eblob_key &key);
+	void clear();
+
+	void statistics(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator) const;
+
+private:
+	struct record {
+		eblob_key key;
+		// location of the record at the moment its headers were read
+		int data_fd;
+		uint64_t data_offset;
+		uint64_t total_data_size;
+		uint64_t flags;
+
+		dnet_ext_list_hdr ehdr;
+		dnet_json_header jhdr;
+	};
+
+	struct key_hash {
+		size_t operator()(const eblob_key &key) const {
+			size_t hash;
+			memcpy(&hash, key.id, sizeof(hash));
+			return hash;
+		}
+	};
+
+	struct key_equal {
+		bool operator()(const eblob_key &lhs, const eblob_key &rhs) const {
+			return !memcmp(lhs.id, rhs.id, sizeof(lhs.id));
+		}
+	};
+
+	struct shard {
+		mutable std::mutex mutex;
+		// the most recently used record is the first one
+		std::list<record> lru;
+		std::unordered_map<eblob_key, std::list<record>::iterator, key_hash, key_equal> records;
+		uint64_t generation{0};
+	};
+
+	static const size_t shards_count = 16;
+
+	shard &get_shard(const eblob_key &key);
+	const shard &get_shard(const eblob_key &key) const;
+
+	const uint64_t m_max_size;
+	const uint64_t m_shard_max_size;
+	shard m_shards[shards_count];
+
+	std::atomic<uint64_t> m_hits;
+	std::atomic<uint64_t> m_misses;
+	// lookups which have found the record moved since its headers were cached
+	std::atomic<uint64_t> m_stale;
+	std::atomic<uint64_t> m_invalidations;
+};
+
+#endif /* __DNET_EBLOB_METADATA_CACHE_HPP */
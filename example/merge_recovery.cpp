@@ -0,0 +1,356 @@
+/*
+ * This application runs merge recovery of specified groups natively: every backend in the group is iterated
+ * over key ranges which don't belong to it, such keys are moved to proper backends.
+ * It is an equivalent of `dnet_recovery merge` which doesn't depend on Python.
+ *
+ * Progress is written to <tmp-dir>/stats.json in the same format dnet_recovery uses.
+ */
+
+#include "common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <boost/program_options.hpp>
+
+#include <elliptics/cppdef.h>
+#include <elliptics/recovery.hpp>
+
+using namespace ioremap;
+namespace bpo = boost::program_options;
+
+namespace {
+
+/*
+ * Keeps stats as elliptics_recovery.stat.Stats does and periodically dumps them to json file
+ * in the format of Stats.json().
+ */
+class json_stats_file : public elliptics::recovery::stats_sink {
+public:
+	explicit json_stats_file(const std::string &path)
+	: m_path(path)
+	, m_stop(false)
+	, m_thread(&json_stats_file::update_thread, this) {
+	}
+
+	~json_stats_file() {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_stop = true;
+			m_stop_condition.notify_all();
+		}
+		m_thread.join();
+		update();
+	}
+
+	void counter(const std::string &prefix, const std::string &name, int64_t value) override {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto &counter = get(prefix).counters[name];
+		if (value > 0)
+			counter.success += value;
+		else
+			counter.failures += -value;
+	}
+
+	void set_counter(const std::string &prefix, const std::string &name, int64_t value) override {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto &counter = get(prefix).counters[name];
+		if (value > 0) {
+			counter.success = value;
+		} else if (value < 0) {
+			counter.failures = -value;
+		} else {
+			counter.success = 0;
+			counter.failures = 0;
+		}
+	}
+
+	void timer(const std::string &prefix, const std::string &name, const std::string &milestone) override {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		get(prefix).timers[name].emplace_back(milestone, std::chrono::system_clock::now());
+	}
+
+private:
+	struct counter_value {
+		counter_value() : success(0), failures(0) {}
+		int64_t success;
+		int64_t failures;
+	};
+
+	typedef std::vector<std::pair<std::string, std::chrono::system_clock::time_point>> timer_value;
+
+	struct stats {
+		std::map<std::string, counter_value> counters;
+		std::map<std::string, timer_value> timers;
+		std::map<std::string, std::unique_ptr<stats>> children;
+	};
+
+	stats &get(const std::string &prefix) {
+		stats *current = &m_root;
+		size_t begin = 0;
+		while (begin < prefix.size()) {
+			size_t end = prefix.find('\\', begin);
+			if (end == std::string::npos)
+				end = prefix.size();
+
+			auto &child = current->children[prefix.substr(begin, end - begin)];
+			if (!child)
+				child.reset(new stats);
+			current = child.get();
+			begin = end + 1;
+		}
+		return *current;
+	}
+
+	static std::string format_time(const std::chrono::system_clock::time_point &time) {
+		const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+		const time_t seconds = micros / 1000000;
+		struct tm tm;
+		localtime_r(&seconds, &tm);
+
+		char buffer[64];
+		strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+
+		std::ostringstream out;
+		out << buffer << '.' << std::setw(6) << std::setfill('0') << micros % 1000000;
+		return out.str();
+	}
+
+	static std::string format_duration(const std::chrono::system_clock::duration &duration) {
+		const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+		const auto seconds = micros / 1000000;
+
+		std::ostringstream out;
+		if (seconds >= 86400)
+			out << seconds / 86400 << (seconds >= 2 * 86400 ? " days, " : " day, ");
+		out << (seconds % 86400) / 3600 << ':'
+		    << std::setw(2) << std::setfill('0') << (seconds % 3600) / 60 << ':'
+		    << std::setw(2) << std::setfill('0') << seconds % 60 << '.'
+		    << std::setw(6) << std::setfill('0') << micros % 1000000;
+		return out.str();
+	}
+
+	static void dump(std::ostream &out, const stats &value, const std::string &indent) {
+		const std::string inner = indent + "    ";
+		bool first = true;
+		auto next = [&] (const std::string &name) {
+			out << (first ? "" : ",") << '\n' << inner << '"' << name << "\": ";
+			first = false;
+		};
+
+		out << '{';
+		for (const auto &counter : value.counters) {
+			next(counter.first);
+			const auto &c = counter.second;
+			if (c.failures) {
+				out << "{\n" << inner << "    \"successes\": " << c.success << ",\n"
+				    << inner << "    \"failures\": " << c.failures << ",\n"
+				    << inner << "    \"total\": " << c.success + c.failures << '\n' << inner << '}';
+			} else {
+				out << c.success;
+			}
+		}
+		for (const auto &timer : value.timers) {
+			next(timer.first);
+			const auto &times = timer.second;
+			out << "{\n" << inner << "    \"" << times.front().first << "\": \""
+			    << format_time(times.front().second) << '"';
+			for (size_t i = 1; i < times.size(); ++i) {
+				out << ",\n" << inner << "    \"" << times[i - 1].first << "..." << times[i].first << "\": \""
+				    << format_duration(times[i].second - times[i - 1].second) << "\",\n"
+				    << inner << "    \"" << times[i].first << "\": \"" << format_time(times[i].second) << '"';
+			}
+			out << '\n' << inner << '}';
+		}
+		for (const auto &child : value.children) {
+			next(child.first);
+			dump(out, *child.second, inner);
+		}
+		if (!first)
+			out << '\n' << indent;
+		out << '}';
+	}
+
+	void update() {
+		const std::string tmp_path = m_path + ".tmp";
+		{
+			std::ofstream out(tmp_path, std::ios::trunc);
+			std::unique_lock<std::mutex> lock(m_mutex);
+			dump(out, m_root, "");
+			out << '\n';
+		}
+		if (rename(tmp_path.c_str(), m_path.c_str()) == -1)
+			std::cerr << "Failed to rename " << tmp_path << " to " << m_path << ": " << strerror(errno) << std::endl;
+	}
+
+	void update_thread() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_stop_condition.wait_for(lock, std::chrono::seconds(1), [this] () { return m_stop; })) {
+			lock.unlock();
+			update();
+			lock.lock();
+		}
+	}
+
+	const std::string m_path;
+	stats m_root;
+	std::mutex m_mutex;
+	std::condition_variable m_stop_condition;
+	bool m_stop;
+	std::thread m_thread;
+};
+
+} /* namespace */
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> remotes;
+	std::string groups, one_node, log_file, tmp_dir, trace_id;
+	long timestamp, wait_timeout;
+	int attempts;
+	uint32_t backend_id;
+	elliptics::recovery::merge_config config;
+
+	bpo::options_description options("Merge recovery options");
+	options.add_options()
+		("help,h", "this help message")
+		("remote,r", bpo::value<std::vector<std::string>>(&remotes)->required()->composing(),
+			"remote nodes to connect, can be specified multiple times, format: addr:port:family")
+		("groups,g", bpo::value<std::string>(&groups)->required(), "groups to recover, format: 1:2:3")
+		("one-node,o", bpo::value<std::string>(&one_node),
+			"recover only keys from this node, format: addr:port:family")
+		("backend-id,i", bpo::value<uint32_t>(&backend_id), "recover only keys from this backend of --one-node")
+		("time,t", bpo::value<long>(&timestamp)->default_value(0),
+			"recover only keys modified after this timestamp (seconds since epoch)")
+		("batch-size,b", bpo::value<size_t>(&config.batch_size)->default_value(1024),
+			"number of keys server-sent by one command")
+		("pending-batches", bpo::value<size_t>(&config.max_pending_batches)->default_value(16),
+			"maximum number of batches waiting for server-send")
+		("iterator-threads", bpo::value<size_t>(&config.iterator_threads)->default_value(1),
+			"number of backends iterated simultaneously")
+		("sender-threads", bpo::value<size_t>(&config.sender_threads)->default_value(4),
+			"number of simultaneous server-send batches")
+		("attempts,a", bpo::value<int>(&attempts)->default_value(1),
+			"number of attempts of timed out server-send and remove")
+		("safe,S", "copy keys instead of moving them")
+		("dry-run,N", "only iterate keys which should be recovered")
+		("wait-timeout,w", bpo::value<long>(&wait_timeout)->default_value(60), "commands timeout in seconds")
+		("dir,D", bpo::value<std::string>(&tmp_dir)->default_value("/var/tmp/dnet_recovery_merge"),
+			"directory for stats, logs, dumps and corrupted keys")
+		("log,l", bpo::value<std::string>(&log_file)->default_value("dnet_recovery.log"),
+			"elliptics log file, relative to --dir")
+		("trace-id,T", bpo::value<std::string>(&trace_id)->default_value("0"), "trace id of recovery commands (hex)")
+		;
+
+	bpo::variables_map vm;
+	try {
+		bpo::store(bpo::command_line_parser(argc, argv).options(options).run(), vm);
+
+		if (vm.count("help")) {
+			std::cout << options << std::endl;
+			return 0;
+		}
+
+		bpo::notify(vm);
+	} catch (const std::exception &e) {
+		std::cerr << "Invalid options: " << e.what() << "\n" << options << std::endl;
+		return -1;
+	}
+
+	if (vm.count("backend-id") && one_node.empty()) {
+		std::cerr << "--backend-id requires --one-node\n" << options << std::endl;
+		return -1;
+	}
+
+	config.timestamp = dnet_time{static_cast<uint64_t>(timestamp), 0};
+	config.attempts = attempts;
+	config.safe = vm.count("safe");
+	config.dry_run = vm.count("dry-run");
+	config.timeout = wait_timeout;
+	config.trace_id = strtoull(trace_id.c_str(), NULL, 16);
+	config.tmp_dir = tmp_dir;
+	config.corrupted_keys_path = tmp_dir + "/corrupted_keys";
+
+	std::string groups_str = groups;
+	int *groups_tmp;
+	const int group_num = dnet_parse_groups((char *)groups_str.c_str(), &groups_tmp);
+	if (group_num <= 0) {
+		std::cerr << "Could not parse groups: " << groups << std::endl;
+		return -1;
+	}
+	const std::vector<int> group_ids(groups_tmp, groups_tmp + group_num);
+	free(groups_tmp);
+
+	if (mkdir(tmp_dir.c_str(), 0755) == -1 && errno != EEXIST) {
+		std::cerr << "Could not create " << tmp_dir << ": " << strerror(errno) << std::endl;
+		return -1;
+	}
+
+	bool result = true;
+	try {
+		elliptics::node node(elliptics::make_file_logger(tmp_dir + "/" + log_file, DNET_LOG_INFO));
+		node.set_timeouts(wait_timeout, wait_timeout * 2);
+		for (const auto &remote : remotes) {
+			try {
+				node.add_remote(remote);
+			} catch (const std::exception &e) {
+				std::cerr << "Could not connect to " << remote << ": " << e.what() << std::endl;
+			}
+		}
+
+		elliptics::session sess(node);
+		json_stats_file stats(tmp_dir + "/stats.json");
+		stats.timer("", "main", "started");
+
+		for (const int group : group_ids) {
+			config.group = group;
+			config.one_node = !one_node.empty();
+			config.backends.clear();
+
+			if (config.one_node) {
+				const elliptics::address address(one_node);
+				for (const auto &route : sess.get_routes()) {
+					if (route.group_id != group || !(elliptics::address(route.addr) == address))
+						continue;
+					if (vm.count("backend-id") && route.backend_id != backend_id)
+						continue;
+
+					const auto backend = std::make_pair(address, route.backend_id);
+					if (std::find(config.backends.begin(), config.backends.end(), backend) == config.backends.end())
+						config.backends.push_back(backend);
+				}
+
+				if (config.backends.empty())
+					continue;
+			}
+
+			const std::string group_prefix = "group_" + std::to_string(group);
+			std::cout << "Processing group: " << group << std::endl;
+			stats.timer(group_prefix, "group", "started");
+			result &= elliptics::recovery::run_merge_recovery(sess, config, stats);
+			stats.timer(group_prefix, "group", "finished");
+		}
+
+		stats.timer("", "main", "finished");
+	} catch (const std::exception &e) {
+		std::cerr << "Caught exception: " << e.what() << std::endl;
+		return -1;
+	}
+
+	return result ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# =============================================================================
+# This file is part of Elliptics.
+#
+# Elliptics is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Elliptics is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+# =============================================================================
+
+"""
+Samples CPUs which threads of running dnet_ioserv are scheduled on and reports for every group of threads
+(net threads, threads of each io pool) how their samples are spread across NUMA nodes and how often
+threads migrate between nodes. Run it under the same load with and without io_cpus/io_numa_nodes and
+net_thread_cpus/net_thread_numa_nodes in config to compare cross-node placement before and after.
+"""
+
+import argparse
+import glob
+import os
+import re
+import time
+from collections import defaultdict
+
+
+def parse_cpu_list(cpu_list):
+    ret = []
+    for part in cpu_list.strip().split(','):
+        if not part:
+            continue
+        if '-' in part:
+            first, last = part.split('-')
+            ret.extend(xrange(int(first), int(last) + 1))
+        else:
+            ret.append(int(part))
+    return ret
+
+
+def cpu_nodes():
+    '''returns map cpu -> NUMA node'''
+    ret = {}
+    for path in glob.glob('/sys/devices/system/node/node*/cpulist'):
+        node = int(re.search(r'node(\d+)', path).group(1))
+        with open(path) as f:
+            for cpu in parse_cpu_list(f.read()):
+                ret[cpu] = node
+    return ret
+
+
+def thread_group(name):
+    '''threads of one pool differ only by suffix with thread index'''
+    return re.sub(r'[-_]?\d+$', '', name)
+
+
+def sample(pid):
+    '''returns map tid -> (thread name, cpu it has run on last)'''
+    ret = {}
+    for task in glob.glob('/proc/{0}/task/*'.format(pid)):
+        try:
+            with open(os.path.join(task, 'comm')) as f:
+                name = f.read().strip()
+            with open(os.path.join(task, 'stat')) as f:
+                # skip "pid (comm)" since comm may contain spaces, processor is the 39th field
+                fields = f.read().rsplit(')', 1)[1].split()
+        except IOError:
+            continue
+        ret[int(os.path.basename(task))] = (name, int(fields[36]))
+    return ret
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Reports NUMA placement of dnet_ioserv threads.')
+    parser.add_argument('pid', type=int, help='pid of dnet_ioserv')
+    parser.add_argument('--duration', type=float, default=10, help='sampling duration in seconds')
+    parser.add_argument('--interval', type=float, default=0.01, help='sampling interval in seconds')
+    args = parser.parse_args()
+
+    nodes = cpu_nodes()
+    samples = defaultdict(lambda: defaultdict(int))
+    migrations = defaultdict(int)
+    last_node = {}
+
+    deadline = time.time() + args.duration
+    while time.time() < deadline:
+        for tid, (name, cpu) in sample(args.pid).iteritems():
+            group = thread_group(name)
+            node = nodes.get(cpu, -1)
+            samples[group][node] += 1
+            if tid in last_node and last_node[tid] != node:
+                migrations[group] += 1
+            last_node[tid] = node
+        time.sleep(args.interval)
+
+    print '{0:<20} {1:>10} {2:>12} {3:>11}  {4}'.format('threads', 'samples', 'cross-node %', 'migrations',
+                                                      'samples per node')
+    for group in sorted(samples):
+        per_node = samples[group]
+        total = sum(per_node.itervalues())
+        # share of samples outside of the node where the group mostly runs
+        cross = 100.0 * (total - max(per_node.itervalues())) / total
+        print '{0:<20} {1:>10} {2:>12.1f} {3:>11}  {4}'.format(
+            group, total, cross, migrations[group],
+            ', '.join('{0}: {1}'.format(node, count) for node, count in sorted(per_node.iteritems())))
+
+
+if __name__ == '__main__':
+    main()
@@ -77,6 +77,12 @@
 
 #define DNET_DEFAULT_CACHE_SYNC_TIMEOUT_SEC 30
 
+#define DNET_DEFAULT_CACHE_FILL_WAIT_TIMEOUT_MS 1000
+
+#define DNET_DEFAULT_CACHE_ADMISSION_SKETCH_WIDTH 16384
+
+#define DNET_DEFAULT_CACHE_COMPRESSION_THRESHOLD 1024
+
 #define DNET_DEFAULT_STALL_TRANSACTIONS 3
 
 #define DNET_DEFAULT_CACHES_NUMBER 16
@@ -31,6 +31,7 @@
 
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -763,6 +764,13 @@ int __attribute__((weak)) dnet_transform_node(struct dnet_node *n, const void *s
 		unsigned char *csum, int csize);
 int dnet_transform_raw(struct dnet_session *s, const void *src, uint64_t size, char *csum, unsigned int csize);
 int dnet_transform_file(struct dnet_node *n, int fd, uint64_t offset, uint64_t size, char *csum, unsigned int csize);
+int dnet_transform_node_iov(struct dnet_node *n, const struct iovec *iov, int count, char *csum, unsigned int csize);
+/*
+ * Transforms each of @count buffers described by @src within session @s,
+ * checksum of i-th buffer is written to @csum + i * @csize.
+ * It is much faster than @count calls of dnet_transform_raw() for short buffers like keys' names.
+ */
+int dnet_transform_raw_batch(struct dnet_session *s, const struct iovec *src, int count, char *csum, unsigned int csize);
 
 /*
  * Transformation implementation, currently it's sha512 hash.
@@ -879,6 +887,11 @@ const char *dnet_backend_inspect_state_string(uint32_t state);
 int dnet_checksum_file(struct dnet_node *n, const char *file, uint64_t offset, uint64_t size, void *csum, int csize);
 int dnet_checksum_fd(struct dnet_node *n, int fd, uint64_t offset, uint64_t size, void *csum, int csize);
 int dnet_checksum_data(struct dnet_node *n, const void *data, uint64_t size, unsigned char *csum, int csize);
+/*
+ * Calculates checksum of concatenation of @count buffers described by @iov,
+ * it is equal to checksum of the same data written contiguously.
+ */
+int dnet_checksum_iov(struct dnet_node *n, const struct iovec *iov, int count, unsigned char *csum, int csize);
 
 int dnet_fd_readlink(int fd, char **datap);
 
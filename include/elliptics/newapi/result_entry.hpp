@@ -46,6 +46,7 @@ public:
 
 	uint64_t iterated_keys() const;
 	uint64_t total_keys() const;
+	uint64_t filtered_keys() const;
 
 	dnet_raw_id key() const;
 	dnet_record_info record_info() const;
@@ -79,13 +80,26 @@ public:
 	: m_fd(fd), m_sorted(sorted), m_write_position(write_position) {
 		m_count = m_write_position / sizeof(iterator_container_item);
 	}
-	// Appends one result to container
+	// Appends one result to container, appended results are buffered until flush(), sort() or merge()
 	void append(const iterator_result_entry &result);
 	void append_old(const ioremap::elliptics::iterator_result_entry &result);
+	// Writes buffered results to the container file
+	void flush();
 	// Sorts container
 	void sort();
 	iterator_container_item operator [](size_t n) const;
 
+	// Merges sorted @sources: the newest record of each key is appended to the destination
+	// which corresponds to the source containing this record. Records of different sources are compared
+	// by (data_timestamp, data_size, user_flags) like recovery does it: newer timestamp, then smaller size,
+	// then greater user_flags wins.
+	static void merge(const std::vector<iterator_result_container *> &sources,
+	                  const std::vector<iterator_result_container *> &destinations);
+	// Computes difference of sorted @sources: the newest record of each key is appended to
+	// every destination which corresponding source misses the key or has an older record of it
+	static void diff(const std::vector<iterator_result_container *> &sources,
+	                 const std::vector<iterator_result_container *> &destinations);
+
 private:
 	void append_item(const iterator_container_item &item);
 
@@ -94,6 +108,9 @@ public:
 	bool m_sorted;
 	uint64_t m_count;
 	uint64_t m_write_position;
+
+private:
+	std::vector<iterator_container_item> m_buffer;
 };
 
 typedef lookup_result_entry write_result_entry;
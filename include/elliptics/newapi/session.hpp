@@ -6,6 +6,37 @@
 
 namespace ioremap { namespace elliptics { namespace newapi {
 
+/*
+ * Condition of server-side iterator predicate, see dnet_iterator_predicate_fields and dnet_iterator_predicate_ops.
+ * Integer fields are compared with \a value, timestamp fields are compared with \a timestamp.
+ * DNET_IPRED_FIELD_JSON compares top-level member \a json_key of record's json with \a json_value:
+ * string members are compared with \a json_value as is, other members are compared by their json representation.
+ */
+struct iterator_condition {
+	uint32_t field;
+	uint32_t op;
+	uint64_t value;
+	dnet_time timestamp;
+	std::string json_key;
+	std::string json_value;
+};
+
+/*
+ * Conjunction of conditions: iterated record is sent only if it matches all of them.
+ */
+typedef std::vector<iterator_condition> iterator_predicate;
+
+/*
+ * Counters of read coalescing, see session::set_read_coalescing().
+ * \a reads / \a batches is the average number of reads sent by single request.
+ */
+struct read_coalescing_stats {
+	uint64_t reads;		// reads sent within BULK_READ_NEW requests
+	uint64_t batches;	// BULK_READ_NEW requests sent
+	uint64_t keys;		// keys in sent requests, concurrent reads of the same key are sent once
+	uint64_t failovers;	// coalesced reads failed in the first group and continued by ordinary reads
+};
+
 class session: public elliptics::session {
 public:
 	explicit session(const node &);
@@ -41,6 +72,21 @@ public:
 	void set_cache_lifetime(uint64_t lifetime);
 	uint64_t get_cache_lifetime() const;
 
+	/* Enables coalescing of reads of whole records (offset and size are 0) by read_json(), read_data() and read().
+	 * Such reads are buffered per node for up to \a window_us microseconds or until \a max_keys reads are
+	 * buffered and are sent by single DNET_CMD_BULK_READ_NEW, replies are demultiplexed back to each read's result.
+	 * Only the first group is read by the bulk request, if it fails the read goes on with the rest of groups
+	 * by ordinary requests. Reads with DNET_IO_FLAGS_CACHE or DNET_IO_FLAGS_CACHE_ONLY, direct reads and
+	 * reads of keys without route are never coalesced.
+	 * Unlike ordinary read, coalesced read doesn't take the key's lock on the server: bulk request is sent
+	 * with DNET_FLAGS_NOLOCK like bulk_read() does, so it isn't serialized with concurrent writes of the key.
+	 * Each coalesced read still gets its own client access log record.
+	 * The mode is shared by the session, its copies and clones made after the call.
+	 */
+	void set_read_coalescing(size_t max_keys, uint64_t window_us);
+	void reset_read_coalescing();
+	read_coalescing_stats get_read_coalescing_stats() const;
+
 	/* Lookup information for key \a id.
 	 */
 	async_lookup_result lookup(const key &id);
@@ -117,6 +163,18 @@ public:
 	                                     const std::vector<dnet_iterator_range> &key_ranges,
 	                                     const std::tuple<dnet_time, dnet_time> &time_range);
 
+	/* Start iterator which sends only records matched \a predicate.
+	 * The predicate is evaluated by the server before any response is built,
+	 * number of filtered out records is available via iterator_result_entry::filtered_keys().
+	 * The last result of successful iteration has status DNET_ITERATOR_STATUS_SUMMARY, it doesn't describe
+	 * any key and contains final numbers of iterated and filtered out records.
+	 * A record which json can't be parsed by the json condition fails the iteration with -EINVAL.
+	 */
+	async_iterator_result start_iterator(const address &addr, uint32_t backend_id, uint64_t flags,
+	                                     const std::vector<dnet_iterator_range> &key_ranges,
+	                                     const std::tuple<dnet_time, dnet_time> &time_range,
+	                                     const iterator_predicate &predicate);
+
 	async_iterator_result server_send(const std::vector<dnet_raw_id> &keys, uint64_t flags, uint64_t chunk_size,
 	                                  const int src_group, const std::vector<int> &dst_groups);
 
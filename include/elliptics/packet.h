@@ -110,6 +110,7 @@ enum dnet_commands {
 #define DNET_MONITOR_STATS		(1<<5)				/* statistics gathered by handystats */
 #define DNET_MONITOR_PROCFS		(1<<6)				/* virtual memory statistics */
 #define DNET_MONITOR_TOP		(1<<7)				/* statistics of top keys ordered by generated traffic */
+#define DNET_MONITOR_SLOW_REQUESTS	(1<<8)				/* stage latency breakdown of the slowest requests */
 #define DNET_MONITOR_ALL		(-1)				/* all available statistics */
 
 enum dnet_backend_command {
@@ -199,6 +200,35 @@ enum dnet_backend_inspect_state {
 /* Send this request to forward node which should resend it to proper node */
 #define DNET_FLAGS_FORWARD		(1<<11)
 
+/*
+ * Priority class of the request used by server for sharing io pool between different kinds of traffic.
+ * Request without these flags belongs to client class, iterators and server-sends without them
+ * are classified by server automatically.
+ */
+#define DNET_FLAGS_PRIO_ITERATOR	(1<<12)
+#define DNET_FLAGS_PRIO_RECOVERY	(1<<13)
+
+enum dnet_io_priority {
+	DNET_IO_PRIO_CLIENT = 0,		/* user's requests */
+	DNET_IO_PRIO_ITERATOR,			/* iterators and other long-running scans */
+	DNET_IO_PRIO_RECOVERY,			/* recovery traffic: server-send and writes/removes made by recovery */
+	DNET_IO_PRIO_MAX,
+};
+
+static inline const char *dnet_io_priority_string(int priority)
+{
+	switch (priority) {
+	case DNET_IO_PRIO_CLIENT:
+		return "client";
+	case DNET_IO_PRIO_ITERATOR:
+		return "iterator";
+	case DNET_IO_PRIO_RECOVERY:
+		return "recovery";
+	default:
+		return "unknown";
+	}
+}
+
 struct flag_info
 {
 	uint64_t flag;
@@ -248,7 +278,9 @@ static inline const char *dnet_flags_dump_cflags(uint64_t flags)
 		{ DNET_FLAGS_TRACE_BIT, "tracebit" },
 		{ DNET_FLAGS_REPLY, "reply" },
 		{ DNET_FLAGS_NO_QUEUE_TIMEOUT, "no_queue_timeout"},
-		{ DNET_FLAGS_FORWARD, "forward"}
+		{ DNET_FLAGS_FORWARD, "forward"},
+		{ DNET_FLAGS_PRIO_ITERATOR, "prio_iterator"},
+		{ DNET_FLAGS_PRIO_RECOVERY, "prio_recovery"}
 	};
 
 	dnet_flags_dump_raw(buffer, sizeof(buffer), flags, infos, sizeof(infos) / sizeof(infos[0]));
@@ -894,14 +926,30 @@ enum dnet_ext_versions {
 /*! In-memory extension header */
 struct dnet_ext;
 
+/*!
+ * Flags of extension header
+ */
+enum dnet_ext_hdr_flags {
+	/*
+	 * digest keeps leading bytes of checksum of the whole record's content following the header,
+	 * it is set by writes which replace the whole content if eblob backend is configured with "content_digest"
+	 * and is dropped by any other write
+	 */
+	DNET_EXT_HDR_FLAGS_DIGEST = 1<<0,
+};
+
+/*! Number of leading bytes of content checksum kept in extension header */
+#define DNET_EXT_HDR_DIGEST_SIZE	16
+
 /*! On-disk extension list header */
 struct dnet_ext_list_hdr {
 	uint8_t			version;	/* Extension header version */
-	uint8_t			__pad1[3];	/* For future use (should be NULLed) */
+	uint8_t			hdr_flags;	/* Flags of the header, see enum dnet_ext_hdr_flags */
+	uint8_t			__pad1[2];	/* For future use (should be NULLed) */
 	uint32_t		size;		/* Size of all extensions */
 	struct dnet_time	timestamp;	/* Time stamp of record */
 	uint64_t		flags;		/* Custom flags for this record */
-	uint64_t		__pad2[2];	/* For future use (should be NULLed) */
+	uint8_t			digest[DNET_EXT_HDR_DIGEST_SIZE]; /* Content checksum if DNET_EXT_HDR_FLAGS_DIGEST is set */
 } __attribute__ ((packed));
 
 struct dnet_json_header {
@@ -956,6 +1004,17 @@ enum {
 
 #define DNET_IFLAGS_JSON		(1<<6)
 
+/*
+ * Iterate backend in parallel: key space is split into partitions which are iterated
+ * by a bounded set of backend workers, records are sent in no particular order.
+ */
+#define DNET_IFLAGS_PARALLEL		(1<<7)
+/*
+ * Used together with DNET_IFLAGS_PARALLEL: records within each partition are merged
+ * by key and partitions are sent in key order, so the whole stream is sorted by key.
+ */
+#define DNET_IFLAGS_ORDERED		(1<<8)
+
 /* Sanity */
 #define DNET_IFLAGS_ALL			(DNET_IFLAGS_DATA | \
 					 DNET_IFLAGS_KEY_RANGE | \
@@ -963,7 +1022,46 @@ enum {
 					 DNET_IFLAGS_NO_META | \
 					 DNET_IFLAGS_MOVE | \
 					 DNET_IFLAGS_OVERWRITE | \
-					 DNET_IFLAGS_JSON)
+					 DNET_IFLAGS_JSON | \
+					 DNET_IFLAGS_PARALLEL | \
+					 DNET_IFLAGS_ORDERED)
+
+/*
+ * Fields and operations of server-side iterator predicate.
+ * Each condition of the predicate compares a field of the iterated record with a value,
+ * the record is sent only if it matches all conditions of the predicate.
+ */
+enum dnet_iterator_predicate_fields {
+	DNET_IPRED_FIELD_FIRST,			/* Sanity */
+	DNET_IPRED_FIELD_RECORD_FLAGS,		/* DNET_RECORD_FLAGS_* of the record */
+	DNET_IPRED_FIELD_USER_FLAGS,		/* user-defined flags */
+	DNET_IPRED_FIELD_DATA_SIZE,		/* size of the data */
+	DNET_IPRED_FIELD_JSON_SIZE,		/* size of the json */
+	DNET_IPRED_FIELD_DATA_TIMESTAMP,	/* timestamp of the data */
+	DNET_IPRED_FIELD_JSON_TIMESTAMP,	/* timestamp of the json */
+	DNET_IPRED_FIELD_JSON,			/* top-level member of the json, supports only EQ and NE */
+	DNET_IPRED_FIELD_LAST,			/* Sanity */
+};
+
+enum dnet_iterator_predicate_ops {
+	DNET_IPRED_OP_FIRST,			/* Sanity */
+	DNET_IPRED_OP_EQ,			/* field == value */
+	DNET_IPRED_OP_NE,			/* field != value */
+	DNET_IPRED_OP_LT,			/* field < value */
+	DNET_IPRED_OP_LE,			/* field <= value */
+	DNET_IPRED_OP_GT,			/* field > value */
+	DNET_IPRED_OP_GE,			/* field >= value */
+	DNET_IPRED_OP_ALL_BITS,			/* (field & value) == value */
+	DNET_IPRED_OP_ANY_BITS,			/* (field & value) != 0 */
+	DNET_IPRED_OP_LAST,			/* Sanity */
+};
+
+/*
+ * Status of the last response of the iterator with predicate. The response doesn't describe any key,
+ * it reports final numbers of iterated and filtered keys, which are unknown to the client if the trailing
+ * records were filtered out. Like other positive statuses it marks a system response.
+ */
+#define DNET_ITERATOR_STATUS_SUMMARY		1
 
 /*
  * Defines how iterator should behave
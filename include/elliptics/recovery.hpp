@@ -0,0 +1,83 @@
+#ifndef ELLIPTICS_RECOVERY_HPP
+#define ELLIPTICS_RECOVERY_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "session.hpp"
+
+namespace ioremap { namespace elliptics { namespace recovery {
+
+/*
+ * Receiver of recovery progress.
+ * Methods mirror StatsProxy from elliptics_recovery/monitor.py: @prefix is a path of sub-stats
+ * separated by '\\' (empty prefix means root stats), positive @value of counter() increments successes,
+ * negative one - failures. Methods can be called simultaneously from several recovery threads.
+ */
+class stats_sink {
+public:
+	virtual ~stats_sink() {}
+
+	virtual void counter(const std::string &prefix, const std::string &name, int64_t value) = 0;
+	virtual void set_counter(const std::string &prefix, const std::string &name, int64_t value) = 0;
+	virtual void timer(const std::string &prefix, const std::string &name, const std::string &milestone) = 0;
+};
+
+/*
+ * Parameters of merge recovery, they match options of dnet_recovery merge.
+ */
+struct merge_config {
+	merge_config();
+
+	// group which should be recovered
+	int group;
+	// backends which keys should be moved to proper backends,
+	// all backends of the group if it's empty and @one_node is false
+	std::vector<std::pair<address, uint32_t>> backends;
+	// if true, keys are server-sent only from @backends, otherwise - from all backends of the group,
+	// nothing is recovered if @one_node is true and @backends is empty
+	bool one_node;
+	// only keys modified after @timestamp are recovered
+	dnet_time timestamp;
+
+	// number of keys server-sent by one command
+	size_t batch_size;
+	// maximum number of batches waiting for server-send, limits memory used by recovery
+	size_t max_pending_batches;
+	// number of backends iterated simultaneously
+	size_t iterator_threads;
+	// number of simultaneous server-send batches
+	size_t sender_threads;
+
+	// number of attempts of timed out server-send and remove
+	int attempts;
+	// if true, keys are copied instead of moving
+	bool safe;
+	// if true, keys are only iterated
+	bool dry_run;
+	// timeout of server-send and remove commands in seconds
+	long timeout;
+	trace_id_t trace_id;
+
+	// directory for dump of not moved keys, no dump is written if empty
+	std::string tmp_dir;
+	// file where corrupted keys are written to, no file is written if empty
+	std::string corrupted_keys_path;
+};
+
+/*
+ * Runs merge recovery of @config.group: every backend is iterated over key ranges which don't belong to it,
+ * iterated keys are moved to proper backends by copy iterator, keys which couldn't be moved are server-sent
+ * by batches, outdated and corrupted replicas are removed.
+ *
+ * Iteration and server-send run as pipeline by @config.iterator_threads and @config.sender_threads threads,
+ * so at most @config.max_pending_batches batches of keys are kept in memory.
+ * Progress is reported to @stats with the same names as Python recovery uses.
+ * Returns true if all keys were recovered.
+ */
+bool run_merge_recovery(const session &sess, const merge_config &config, stats_sink &stats);
+
+}}} /* namespace ioremap::elliptics::recovery */
+
+#endif // ELLIPTICS_RECOVERY_HPP
@@ -205,6 +205,11 @@ public:
 	void set_group_id(uint32_t group);
 
 	void transform(const session &sess) const;
+	/*!
+	 * Transforms all not yet transformed \a keys within \a sess by single call,
+	 * names are hashed in parallel, so it's much faster than transforming keys one by one.
+	 */
+	static void transform(const session &sess, const std::vector<key> &keys);
 
 private:
 	bool inited() const;
@@ -254,6 +259,10 @@ public:
 	 * Makes dnet_id be accessible by key::id() in the key \a id.
 	 */
 	void transform(const key &id) const;
+	/*!
+	 * Makes dnet_id be accessible by key::id() in all \a keys.
+	 */
+	void transform(const std::vector<key> &keys) const;
 
 	/*!
 	 * Sets \a groups to the session.
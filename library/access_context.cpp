@@ -21,6 +21,7 @@
 
 #include "elliptics/interface.h"
 #include "logger.hpp"
+#include "monitor/slow_requests.hpp"
 
 
 dnet_access_context::dnet_access_context(dnet_node *node)
@@ -28,16 +29,17 @@ dnet_access_context::dnet_access_context(dnet_node *node)
 
 dnet_access_context::~dnet_access_context() {
 	print();
+	trace();
 }
 
 
-void dnet_access_context::add(blackhole::attribute_t attribute) {
-	std::lock_guard<std::mutex> guard(mutex_);
-	attributes_.emplace_back(std::move(attribute));
+void dnet_access_context::add(const dnet_access_attribute &attribute) {
+	record_.append(attribute);
 }
-void dnet_access_context::add(std::initializer_list<blackhole::attribute_t> attributes) {
-	std::lock_guard<std::mutex> guard(mutex_);
-	attributes_.insert(attributes_.end(), attributes.begin(), attributes.end());
+void dnet_access_context::add(std::initializer_list<dnet_access_attribute> attributes) {
+	for (const auto &attribute : attributes) {
+		record_.append(attribute);
+	}
 }
 
 void dnet_access_context::increment_ref() {
@@ -46,7 +48,50 @@ void dnet_access_context::increment_ref() {
 
 void dnet_access_context::print() {
 	add({"total_time", timer_.get_us()});
-	dnet_log_access(node_, blackhole::attribute_list{attributes_.begin(), attributes_.end()});
+	dnet_access_ring_publish(node_, record_);
+}
+
+void dnet_access_context::trace_request(const dnet_cmd &cmd, const dnet_addr &addr, uint64_t time) {
+	cmd_ = cmd;
+	addr_ = addr;
+	time_before_ = time;
+	dnet_current_time(&start_);
+	traced_ = true;
+}
+
+void dnet_access_context::add_stage_time(dnet_request_stage stage, uint64_t time) {
+	stages_[stage].fetch_add(time, std::memory_order_relaxed);
+}
+
+void dnet_access_context::set_status(int status) {
+	status_ = status;
+}
+
+void dnet_access_context::set_tracer(dnet_request_tracer tracer) {
+	tracer_ = std::move(tracer);
+}
+
+void dnet_access_context::trace() {
+	if (!traced_ || !tracer_)
+		return;
+
+	ioremap::monitor::request_trace trace;
+	memset(&trace, 0, sizeof(trace));
+	trace.start = start_;
+	trace.id = cmd_.id;
+	trace.client = addr_;
+	trace.trans = cmd_.trans;
+	trace.trace_id = cmd_.trace_id;
+	trace.cflags = cmd_.flags;
+	trace.cmd = cmd_.cmd;
+	trace.backend_id = cmd_.backend_id;
+	trace.status = status_;
+	trace.total_time = time_before_ + timer_.get_us();
+	for (int stage = 0; stage < __DNET_REQUEST_STAGE_MAX; ++stage) {
+		trace.stages[stage] = stages_[stage].load(std::memory_order_relaxed);
+	}
+
+	tracer_(trace);
 }
 
 void dnet_access_context::decrement_ref() {
@@ -95,7 +140,7 @@ void dnet_access_context_add_string(struct dnet_access_context *context, const c
 	if (!context)
 		return;
 
-	context->add({name, std::string(value)});
+	context->add({name, value});
 }
 
 void dnet_access_context_add_trace_id(struct dnet_access_context *context, uint64_t value) {
@@ -104,3 +149,26 @@ void dnet_access_context_add_trace_id(struct dnet_access_context *context, uint6
 
 	context->add({"trace_id", ioremap::elliptics::to_hex_string(value)});
 }
+
+void dnet_access_context_trace_request(struct dnet_access_context *context, const struct dnet_cmd *cmd,
+                                       const struct dnet_addr *addr, uint64_t time) {
+	if (!context)
+		return;
+
+	context->trace_request(*cmd, *addr, time);
+}
+
+void dnet_access_context_add_stage_time(struct dnet_access_context *context, enum dnet_request_stage stage,
+                                        uint64_t time) {
+	if (!context)
+		return;
+
+	context->add_stage_time(stage, time);
+}
+
+void dnet_access_context_set_status(struct dnet_access_context *context, int status) {
+	if (!context)
+		return;
+
+	context->set_status(status);
+}
@@ -20,34 +20,52 @@
 #pragma once
 
 #include "elliptics/packet.h"
+#include "library/elliptics.h"
+#include "library/access_ring.h"
 
 #ifdef __cplusplus
 
 #include <atomic>
-#include <mutex>
-
-#include <blackhole/attribute.hpp>
-#include <blackhole/attributes.hpp>
+#include <functional>
 
 #include "bindings/cpp/timer.hpp"
 
 struct dnet_node;
 
+namespace ioremap { namespace monitor {
+struct request_trace;
+}} /* namespace ioremap::monitor */
+
+// receives stage breakdown of completed request, it is called via std::function since
+// the context is shared with client library which doesn't link monitor
+typedef std::function<void(const ioremap::monitor::request_trace &)> dnet_request_tracer;
+
 struct dnet_access_context {
 public:
 	explicit dnet_access_context(dnet_node *node);
 	~dnet_access_context();
 
-	// attach @attribute to the final log
-	void add(blackhole::attribute_t attribute);
-	// attach batch of @attributes gto the final log
-	void add(std::initializer_list<blackhole::attribute_t> attributes);
+	// attach @attribute to the final log, it can be called from several threads simultaneously
+	void add(const dnet_access_attribute &attribute);
+	// attach batch of @attributes to the final log
+	void add(std::initializer_list<dnet_access_attribute> attributes);
 
 	void increment_ref();
 	void decrement_ref();
+
+	// remember properties of request @cmd received from @addr, @time is spent before the context was created
+	void trace_request(const dnet_cmd &cmd, const dnet_addr &addr, uint64_t time);
+	// add @time spent on @stage
+	void add_stage_time(dnet_request_stage stage, uint64_t time);
+	// set final status of the request
+	void set_status(int status);
+	// set where the request should be traced on completion
+	void set_tracer(dnet_request_tracer tracer);
 private:
 	// print final log
 	void print();
+	// pass the request to @tracer_
+	void trace();
 
 	// we have to add reference counter since an instance is created and removed in C
 	// by various threads.
@@ -58,9 +76,19 @@ private:
 	// Timer to measure total time spent on the request.
 	ioremap::elliptics::util::steady_timer timer_;
 
-	// mutex to synchronize adding attributes from various attributes
-	std::mutex mutex_{};
-	blackhole::attributes_t attributes_{};
+	// binary record of attributes, it is passed to access log ring on the last reference removal
+	dnet_access_record record_{};
+
+	// properties of traced request, they are set by the thread which handles the request
+	bool traced_{false};
+	dnet_cmd cmd_{};
+	dnet_addr addr_{};
+	dnet_time start_{};
+	int status_{0};
+	uint64_t time_before_{0};
+	// time spent on each stage, they can be updated by network and io threads simultaneously
+	std::atomic<uint64_t> stages_[__DNET_REQUEST_STAGE_MAX]{};
+	dnet_request_tracer tracer_{};
 };
 
 extern "C" {
@@ -84,6 +112,14 @@ void dnet_access_context_add_uint(struct dnet_access_context *context, const cha
 void dnet_access_context_add_string(struct dnet_access_context *context, const char *name, const char *value);
 // Add trace_id attribute with @value
 void dnet_access_context_add_trace_id(struct dnet_access_context *context, uint64_t value);
+// Trace stages of request @cmd received from @addr, @time was spent before the context was created
+void dnet_access_context_trace_request(struct dnet_access_context *context, const struct dnet_cmd *cmd,
+                                       const struct dnet_addr *addr, uint64_t time);
+// Add @time usecs spent by the request on @stage
+void dnet_access_context_add_stage_time(struct dnet_access_context *context, enum dnet_request_stage stage,
+                                        uint64_t time);
+// Set final @status of the request
+void dnet_access_context_set_status(struct dnet_access_context *context, int status);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,273 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "access_ring.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+#include <blackhole/attribute.hpp>
+#include <blackhole/attributes.hpp>
+
+#include "common.hpp"
+#include "elliptics.h"
+#include "logger.hpp"
+
+void dnet_access_record::encode(char *buffer, const dnet_access_attribute &attribute, uint32_t name_size) {
+	const entry_header header{attribute.type, attribute.size, name_size, 0};
+	memcpy(buffer, &header, sizeof(header));
+
+	char *name = buffer + sizeof(header);
+	memcpy(name, attribute.name, name_size);
+
+	char *value = name + padded_size(name_size);
+	if (attribute.type == dnet_access_attribute::STRING)
+		memcpy(value, attribute.string, attribute.size);
+	else
+		memcpy(value, &attribute.number, sizeof(attribute.number));
+}
+
+void dnet_access_record::append(const dnet_access_attribute &attribute) {
+	const uint32_t name_size = strlen(attribute.name) + 1;
+	const size_t size = entry_size(name_size, attribute.size);
+	const size_t offset = size_.fetch_add(size, std::memory_order_relaxed);
+	if (offset + size <= capacity) {
+		encode(data_ + offset, attribute, name_size);
+		return;
+	}
+
+	// mark the end of inline part, so the reader won't take the reserved but unwritten range for an attribute
+	if (offset + sizeof(entry_header) <= capacity) {
+		const entry_header end{dnet_access_attribute::END, 0, 0, 0};
+		memcpy(data_ + offset, &end, sizeof(end));
+	}
+
+	std::lock_guard<std::mutex> guard(overflow_mutex_);
+	if (!overflow_)
+		overflow_.reset(new std::vector<char>());
+
+	const size_t overflow_offset = overflow_->size();
+	overflow_->resize(overflow_offset + size);
+	encode(overflow_->data() + overflow_offset, attribute, name_size);
+}
+
+namespace {
+
+// builds blackhole attributes from binary record, field names are kept as they were added
+struct attributes_builder {
+	blackhole::attributes_t &attributes;
+
+	void operator()(const char *name, int64_t value) {
+		attributes.emplace_back(blackhole::attribute_t{name, value});
+	}
+
+	void operator()(const char *name, uint64_t value) {
+		attributes.emplace_back(blackhole::attribute_t{name, value});
+	}
+
+	void operator()(const char *name, double value) {
+		attributes.emplace_back(blackhole::attribute_t{name, value});
+	}
+
+	void operator()(const char *name, const char *value, size_t size) {
+		attributes.emplace_back(blackhole::attribute_t{name, std::string(value, size)});
+	}
+};
+
+} /* namespace */
+
+/*
+ * Per-node set of rings of completed access log records.
+ * Each thread publishes into its own shard picked round-robin on the first use, shards are bounded
+ * multi-producer rings, so threads sharing a shard don't need locks either. Single background thread
+ * drains all shards and prints records into access log.
+ */
+struct dnet_access_ring {
+public:
+	explicit dnet_access_ring(dnet_node *node);
+	~dnet_access_ring();
+
+	// returns false if the ring of current thread is full
+	bool push(const dnet_access_record &record);
+
+private:
+	struct cell {
+		std::atomic<size_t> sequence;
+		// trace of the thread which published the record, it is restored while printing
+		uint64_t trace_id;
+		uint64_t trace_bit;
+		size_t size;
+		char data[dnet_access_record::capacity];
+	};
+
+	struct shard {
+		std::unique_ptr<cell[]> cells;
+		std::atomic<size_t> tail{0};
+		// it is touched only by draining thread
+		size_t head{0};
+	};
+
+	static const size_t shards_count = 16;
+	static const size_t cells_count = 128;
+	static constexpr std::chrono::milliseconds drain_interval{5};
+
+	// prints all records which are ready
+	void drain();
+	void print(const cell &cell);
+	void run();
+
+	dnet_node *m_node;
+	shard m_shards[shards_count];
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_need_exit;
+	std::thread m_thread;
+};
+
+constexpr std::chrono::milliseconds dnet_access_ring::drain_interval;
+
+dnet_access_ring::dnet_access_ring(dnet_node *node)
+: m_node(node)
+, m_need_exit(false) {
+	for (auto &shard : m_shards) {
+		shard.cells.reset(new cell[cells_count]);
+		for (size_t i = 0; i < cells_count; ++i) {
+			shard.cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	m_thread = std::thread([this] { run(); });
+}
+
+dnet_access_ring::~dnet_access_ring() {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_need_exit = true;
+	}
+	m_condition.notify_one();
+	m_thread.join();
+
+	drain();
+}
+
+bool dnet_access_ring::push(const dnet_access_record &record) {
+	auto &shard = m_shards[dnet_current_thread_index() % shards_count];
+
+	size_t position = shard.tail.load(std::memory_order_relaxed);
+	cell *cell;
+	while (true) {
+		cell = &shard.cells[position % cells_count];
+		const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		const intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+		if (diff == 0) {
+			if (shard.tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			position = shard.tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->trace_id = dnet_logger_get_trace_id();
+	cell->trace_bit = dnet_logger_get_trace_bit();
+	cell->size = record.size();
+	memcpy(cell->data, record.data(), cell->size);
+	cell->sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+void dnet_access_ring::drain() {
+	for (auto &shard : m_shards) {
+		while (true) {
+			auto &cell = shard.cells[shard.head % cells_count];
+			if (cell.sequence.load(std::memory_order_acquire) != shard.head + 1)
+				break;
+
+			try {
+				print(cell);
+			} catch (const std::exception &e) {
+				DNET_LOG_ERROR(m_node, "Failed to print access log: {}", e.what());
+			}
+
+			cell.sequence.store(shard.head + cells_count, std::memory_order_release);
+			++shard.head;
+		}
+	}
+}
+
+void dnet_access_ring::print(const cell &cell) {
+	blackhole::attributes_t attributes;
+	attributes_builder builder{attributes};
+	dnet_access_record::visit(cell.data, cell.size, builder);
+
+	// restore trace of the thread which completed the request, it affects filtering and trace_id attribute
+	if (cell.trace_id || cell.trace_bit)
+		dnet_logger_set_trace_id(cell.trace_id, !!cell.trace_bit);
+
+	dnet_log_access(m_node, blackhole::attribute_list{attributes.begin(), attributes.end()});
+
+	if (cell.trace_id || cell.trace_bit)
+		dnet_logger_unset_trace_id();
+}
+
+void dnet_access_ring::run() {
+	dnet_set_name("dnet_access_log");
+
+	std::unique_lock<std::mutex> guard(m_mutex);
+	while (!m_need_exit) {
+		guard.unlock();
+		drain();
+		guard.lock();
+
+		m_condition.wait_for(guard, drain_interval, [this] { return m_need_exit; });
+	}
+}
+
+static void dnet_access_record_print(dnet_node *node, const dnet_access_record &record) {
+	blackhole::attributes_t attributes;
+	attributes_builder builder{attributes};
+	record.visit(builder);
+
+	dnet_log_access(node, blackhole::attribute_list{attributes.begin(), attributes.end()});
+}
+
+void dnet_access_ring_publish(dnet_node *node, const dnet_access_record &record) {
+	if (node->access_ring && !record.overflowed() && node->access_ring->push(record))
+		return;
+
+	dnet_access_record_print(node, record);
+}
+
+int dnet_access_ring_create(struct dnet_node *n) {
+	try {
+		n->access_ring = new dnet_access_ring(n);
+		return 0;
+	} catch (const std::bad_alloc &) {
+		return -ENOMEM;
+	} catch (const std::system_error &e) {
+		DNET_LOG_ERROR(n, "Failed to start access log thread: {}", e.what());
+		return -e.code().value();
+	}
+}
+
+void dnet_access_ring_destroy(struct dnet_node *n) {
+	delete n->access_ring;
+	n->access_ring = nullptr;
+}
@@ -0,0 +1,220 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+struct dnet_node;
+
+/*
+ * Attribute of access log record. Unlike blackhole::attribute_t it owns nothing and allocates nothing:
+ * both @name and string value are copied into the record by the call which adds the attribute,
+ * so they may be released right after that. NULL name or string value is treated as an empty string.
+ */
+struct dnet_access_attribute {
+	enum value_type : uint32_t {
+		END = 0,
+		INT,
+		UINT,
+		DOUBLE,
+		STRING,
+	};
+
+	template <typename T,
+	          typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+	dnet_access_attribute(const char *name, T value)
+	: name(name ? name : ""), type(INT), size(sizeof(int64_t)) {
+		number.int_value = value;
+	}
+
+	template <typename T,
+	          typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, int>::type = 0>
+	dnet_access_attribute(const char *name, T value)
+	: name(name ? name : ""), type(UINT), size(sizeof(uint64_t)) {
+		number.uint_value = value;
+	}
+
+	template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+	dnet_access_attribute(const char *name, T value)
+	: name(name ? name : ""), type(DOUBLE), size(sizeof(double)) {
+		number.double_value = value;
+	}
+
+	dnet_access_attribute(const char *name, const char *value)
+	: name(name ? name : ""), type(STRING), size(value ? strlen(value) : 0), string(value ? value : "") {}
+
+	dnet_access_attribute(const char *name, const std::string &value)
+	: name(name ? name : ""), type(STRING), size(value.size()), string(value.data()) {}
+
+	const char *name;
+	value_type type;
+	uint32_t size;
+	union {
+		int64_t int_value;
+		uint64_t uint_value;
+		double double_value;
+	} number;
+	const char *string{""};
+};
+
+/*
+ * Binary access log record: attributes are encoded one by one as
+ * [type, size, name size, name with trailing zero and value both padded to 8 bytes] into fixed inline buffer.
+ * Attributes can be appended by several threads simultaneously without locks:
+ * each writer reserves its range of the buffer by single atomic addition.
+ * Attributes which don't fit into the buffer are spilled into heap under mutex,
+ * such records are too big for the ring and are printed synchronously.
+ *
+ * The record must be read only after all writers have finished.
+ */
+class dnet_access_record {
+public:
+	// capacity of inline buffer, it is enough for all attributes of ordinary request
+	static const size_t capacity = 1536;
+
+	void append(const dnet_access_attribute &attribute);
+
+	// size of inline part of the record
+	size_t size() const {
+		const size_t size = size_.load(std::memory_order_relaxed);
+		return size < capacity ? size : capacity;
+	}
+
+	const char *data() const { return data_; }
+
+	// whether some attributes were spilled into heap
+	bool overflowed() const { return overflow_ != nullptr; }
+
+	/*
+	 * Calls @visitor for each attribute encoded in @data of @size bytes:
+	 * visitor(name, int64_t), visitor(name, uint64_t), visitor(name, double) or visitor(name, const char *, size_t).
+	 * @name points into @data and is valid as long as @data is.
+	 */
+	template <typename Visitor>
+	static void visit(const char *data, size_t size, Visitor &&visitor);
+
+	// calls @visitor for each attribute of the record including spilled ones
+	template <typename Visitor>
+	void visit(Visitor &&visitor) const {
+		visit(data_, size(), visitor);
+		if (overflow_)
+			visit(overflow_->data(), overflow_->size(), visitor);
+	}
+
+private:
+	struct entry_header {
+		uint32_t type;
+		uint32_t size;
+		// size of the name including trailing zero
+		uint32_t name_size;
+		uint32_t reserved;
+	};
+
+	static size_t padded_size(size_t size) {
+		return (size + 7) & ~size_t(7);
+	}
+
+	static size_t entry_size(uint32_t name_size, uint32_t value_size) {
+		return sizeof(entry_header) + padded_size(name_size) + padded_size(value_size);
+	}
+
+	static void encode(char *buffer, const dnet_access_attribute &attribute, uint32_t name_size);
+
+	std::atomic<size_t> size_{0};
+	char data_[capacity];
+
+	std::mutex overflow_mutex_{};
+	std::unique_ptr<std::vector<char>> overflow_{};
+};
+
+template <typename Visitor>
+void dnet_access_record::visit(const char *data, size_t size, Visitor &&visitor) {
+	size_t offset = 0;
+	while (offset + sizeof(entry_header) <= size) {
+		entry_header header;
+		memcpy(&header, data + offset, sizeof(header));
+		if (header.type == dnet_access_attribute::END ||
+		    offset + entry_size(header.name_size, header.size) > size)
+			break;
+
+		const char *name = data + offset + sizeof(header);
+		const char *value = name + padded_size(header.name_size);
+		switch (header.type) {
+		case dnet_access_attribute::INT: {
+			int64_t number;
+			memcpy(&number, value, sizeof(number));
+			visitor(name, number);
+			break;
+		}
+		case dnet_access_attribute::UINT: {
+			uint64_t number;
+			memcpy(&number, value, sizeof(number));
+			visitor(name, number);
+			break;
+		}
+		case dnet_access_attribute::DOUBLE: {
+			double number;
+			memcpy(&number, value, sizeof(number));
+			visitor(name, number);
+			break;
+		}
+		case dnet_access_attribute::STRING:
+			visitor(name, value, size_t(header.size));
+			break;
+		}
+
+		offset += entry_size(header.name_size, header.size);
+	}
+}
+
+/*
+ * Passes completed @record to the background thread of @node which prints it to access log.
+ * If the node has no ring, the ring is full or the record is too big, the record is printed synchronously.
+ */
+void dnet_access_ring_publish(dnet_node *node, const dnet_access_record &record);
+
+extern "C" {
+#else
+struct dnet_node;
+#endif
+
+/*
+ * Creates per-node ring of access log records and starts thread which drains it into access log.
+ * It is created only for server nodes and for nodes with configured access log.
+ * Returns 0 on success or negative error code.
+ */
+int dnet_access_ring_create(struct dnet_node *n);
+/*
+ * Stops draining thread, prints all remaining records and destroys the ring.
+ * It should be called after all threads which can print access logs have been stopped.
+ */
+void dnet_access_ring_destroy(struct dnet_node *n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -33,8 +33,6 @@ public:
 	int detach(const std::string &pool_id);
 	// fill @value with all shared io pools' statistics
 	void statistics(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator);
-	// add to @queue_size and @threads_count all shared io pools' queues' sizes and number of threads.
-	void check(uint64_t &queue_size, uint64_t threads_count);
 
 private:
 	struct dnet_node							*m_node;
@@ -43,6 +41,44 @@ private:
 	std::unordered_map<std::string, std::shared_ptr<struct dnet_io_pool>>	m_pools;
 };
 
+// format @cpus as compact list, e.g. "0-3,8"
+static std::string dnet_cpus_string(const std::vector<int> &cpus) {
+	std::ostringstream ret;
+	for (size_t i = 0; i < cpus.size();) {
+		size_t j = i;
+		while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+			++j;
+
+		if (i)
+			ret << ",";
+		ret << cpus[i];
+		if (j > i)
+			ret << "-" << cpus[j];
+		i = j + 1;
+	}
+	return ret.str();
+}
+
+// bind threads of both blocking and nonblocking pools of @pool to @cpus, failure is logged but not fatal
+static void dnet_io_pool_set_affinity(struct dnet_node *node,
+                                      struct dnet_io_pool &pool,
+                                      const std::string &pool_id,
+                                      const std::vector<int> &cpus) {
+	if (cpus.empty())
+		return;
+
+	int err = dnet_work_pool_set_affinity(pool.recv_pool.pool, cpus.data(), cpus.size());
+	if (!err)
+		err = dnet_work_pool_set_affinity(pool.recv_pool_nb.pool, cpus.data(), cpus.size());
+
+	if (err) {
+		DNET_LOG_ERROR(node, "io pool {}: failed to bind threads to cpus: {}: {} [{}]",
+		               pool_id, dnet_cpus_string(cpus), strerror(-err), err);
+	} else {
+		DNET_LOG_INFO(node, "io pool {}: threads are bound to cpus: {}", pool_id, dnet_cpus_string(cpus));
+	}
+}
+
 // create (initialize and run) io pool with @pool_id and @config
 static std::shared_ptr<struct dnet_io_pool> create_io_pool(struct dnet_node *node,
                                                            const std::string &pool_id,
@@ -86,6 +122,12 @@ static std::shared_ptr<struct dnet_io_pool> create_io_pool(struct dnet_node *nod
 		return nullptr;
 	}
 
+	dnet_set_pool_priority_weights(pool->recv_pool.pool, config.priority_weights.data());
+	dnet_set_pool_priority_weights(pool->recv_pool_nb.pool, config.priority_weights.data());
+	dnet_set_pool_edf(pool->recv_pool.pool, config.edf);
+	dnet_set_pool_edf(pool->recv_pool_nb.pool, config.edf);
+	dnet_io_pool_set_affinity(node, *pool, pool_id, config.cpus);
+
 	DNET_LOG_INFO(node, "create_io_pool(pool_id: {}): pool was successfully started", pool_id);
 
 	return std::move(pool);
@@ -153,12 +195,25 @@ void dnet_io_pools_manager::statistics(rapidjson::Value &value, rapidjson::Docum
 	}
 }
 
-void dnet_io_pools_manager::check(uint64_t &queue_size, uint64_t threads_count) {
-	boost::shared_lock<boost::shared_mutex> guard(m_pools_mutex);
-	for (auto &item : m_pools) {
-		const auto &io_pool = item.second;
-		dnet_check_io_pool(io_pool.get(), &queue_size, &threads_count);
-	}
+/* check whether request @r fits into budget of @pool's queue limited by @queue_limit requests
+ * and @queue_bytes_limit bytes. Zero @queue_limit means io_thread_num * 1000 requests,
+ * zero @queue_bytes_limit means no limit on size of queued requests.
+ */
+static bool dnet_io_pool_fits_budget(struct dnet_work_pool *pool,
+                                     const struct dnet_io_req *r,
+                                     uint64_t queue_limit,
+                                     uint64_t queue_bytes_limit) {
+	const uint64_t queue_size = dnet_get_pool_queue_size(pool);
+	if (!queue_limit)
+		queue_limit = static_cast<uint64_t>(pool->num) * 1000;
+	if (queue_size >= queue_limit)
+		return false;
+
+	// request is always admitted into empty queue, so request larger than the limit is not rejected forever
+	if (queue_bytes_limit && queue_size && dnet_get_pool_queue_bytes(pool) + r->dsize > queue_bytes_limit)
+		return false;
+
+	return true;
 }
 
 static int dnet_ids_generate(struct dnet_node *n, const char *file, unsigned long long storage_free) {
@@ -562,9 +617,11 @@ dnet_backend::dnet_backend(dnet_node *node, std::shared_ptr<backend_config> conf
 , m_delay{0}
 , m_state{DNET_BACKEND_DISABLED}
 , m_last_start_err{0}
+, m_slow_requests{ioremap::monitor::create_slow_requests(node)}
 , m_cache{}
 , m_log{new blackhole::wrapper_t{get_logger(node), {{"source", "eblob"}, {"backend_id", m_config->backend_id}}}}
-, m_pool_id{} {
+, m_pool_id{}
+, m_queue_rejected{0} {
 	dnet_empty_time(&m_last_start);
 
 	memset(&m_callbacks, 0, sizeof(m_callbacks));
@@ -586,6 +643,14 @@ uint64_t dnet_backend::queue_timeout() const {
 	return m_config->queue_timeout;
 }
 
+int dnet_backend::admit_request(struct dnet_work_pool *pool, const struct dnet_io_req *r) {
+	if (dnet_io_pool_fits_budget(pool, r, m_config->queue_limit, m_config->queue_bytes_limit))
+		return 0;
+
+	++m_queue_rejected;
+	return -EBUSY;
+}
+
 void dnet_backend::set_verbosity(const dnet_log_level level) {
 	boost::shared_lock<boost::shared_mutex> guard(m_state_mutex);
 	if (m_state != DNET_BACKEND_ENABLED)
@@ -1042,6 +1107,8 @@ void dnet_backend::fill_backend_stats(rapidjson::Value &value, rapidjson::Docume
 			auto &config_value = backend["config"];
 			config_value.AddMember("group", m_config->group_id, allocator);
 			config_value.AddMember("queue_timeout", m_config->queue_timeout, allocator);
+			config_value.AddMember("queue_limit", m_config->queue_limit, allocator);
+			config_value.AddMember("queue_bytes_limit", m_config->queue_bytes_limit, allocator);
 		}
 		free(json_stat);
 	} else {
@@ -1062,6 +1129,8 @@ void dnet_backend::fill_backend_stats(rapidjson::Value &value, rapidjson::Docume
 			config_value.Parse<0>(json_stat);
 			config_value.AddMember("group", m_config->group_id, allocator);
 			config_value.AddMember("queue_timeout", m_config->queue_timeout, allocator);
+			config_value.AddMember("queue_limit", m_config->queue_limit, allocator);
+			config_value.AddMember("queue_bytes_limit", m_config->queue_bytes_limit, allocator);
 			backend.SetObject();
 			backend.AddMember("config", static_cast<rapidjson::Value &>(config_value), allocator);
 		}
@@ -1084,6 +1153,7 @@ void dnet_backend::fill_io_stats(rapidjson::Value &value, rapidjson::Document::A
 
 	rapidjson::Value io(rapidjson::kObjectType);
 	ioremap::monitor::dump_io_pool_stats(*m_pool, io, allocator);
+	io.AddMember("rejected", m_queue_rejected.load(), allocator);
 	value.AddMember("io", io, allocator);
 }
 
@@ -1101,10 +1171,20 @@ void dnet_backend::fill_commands_stats(rapidjson::Value &value, rapidjson::Docum
 		return;
 
 	rapidjson::Value commands_value(rapidjson::kObjectType);
-	m_command_stats.commands_report(nullptr, commands_value, allocator);
+	m_command_stats.commands_report(nullptr, ioremap::monitor::get_monitor_percentiles(m_node), commands_value,
+	                                allocator);
 	value.AddMember("commands", commands_value, allocator);
 }
 
+void dnet_backend::fill_slow_requests(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator) {
+	if (!m_slow_requests)
+		return;
+
+	rapidjson::Value requests;
+	m_slow_requests->statistics(requests, allocator);
+	value.AddMember("slow_requests", requests, allocator);
+}
+
 void dnet_backend::statistics(uint64_t categories,
                               rapidjson::Value &value,
                               rapidjson::Document::AllocatorType &allocator) {
@@ -1116,8 +1196,10 @@ void dnet_backend::statistics(uint64_t categories,
 		fill_io_stats(value, allocator);
 	if (categories & DNET_MONITOR_CACHE)
 		fill_cache_stats(value, allocator);
-	if (categories & DNET_MONITOR_COMMANDS)
+	if (categories & (DNET_MONITOR_COMMANDS | DNET_MONITOR_BACKEND))
 		fill_commands_stats(value, allocator);
+	if (categories & DNET_MONITOR_SLOW_REQUESTS)
+		fill_slow_requests(value, allocator);
 }
 
 dnet_backends_manager::dnet_backends_manager(struct dnet_node *node)
@@ -1306,14 +1388,6 @@ void dnet_io_pools_fill_stats(struct dnet_node *node,
 	node->io->pools_manager->statistics(value, allocator);
 }
 
-void dnet_io_pools_check(struct dnet_io_pools_manager *pools_manager, uint64_t *queue_size, uint64_t *threads_count) {
-	if (!pools_manager)
-		return;
-
-	// TODO(shaitan): it should count also individual io pools.
-	pools_manager->check(*queue_size, *threads_count);
-}
-
 int dnet_backends_init(struct dnet_node *node) {
 	std::unique_ptr<dnet_io_pools_manager> pools{new(std::nothrow) dnet_io_pools_manager(node)};
 	if (!pools) {
@@ -1330,9 +1404,36 @@ int dnet_backends_init(struct dnet_node *node) {
 	node->io->pools_manager = pools.release();
 	node->io->backends_manager = backends.release();
 
+	// node's io pool is created before config is available, so set its weights and order here
+	const auto data = dnet_node_get_config_data(node);
+	const auto &weights = data->priority_weights;
+	dnet_set_pool_priority_weights(node->io->pool.recv_pool.pool, weights.data());
+	dnet_set_pool_priority_weights(node->io->pool.recv_pool_nb.pool, weights.data());
+	dnet_set_pool_edf(node->io->pool.recv_pool.pool, data->queue_edf);
+	dnet_set_pool_edf(node->io->pool.recv_pool_nb.pool, data->queue_edf);
+	dnet_io_pool_set_affinity(node, node->io->pool, "sys", data->io_cpus);
+
 	return 0;
 }
 
+void dnet_io_bind_net_thread(struct dnet_node *node, int index) {
+	const auto data = dnet_node_get_config_data(node);
+	if (!data || data->net_thread_cpus.empty())
+		return;
+
+	const auto &cpus = data->net_thread_cpus[index % data->net_thread_cpus.size()];
+	if (cpus.empty())
+		return;
+
+	const int err = dnet_io_set_net_thread_affinity(node, index, cpus.data(), cpus.size());
+	if (err) {
+		DNET_LOG_ERROR(node, "io: failed to bind net thread {} to cpus: {}: {} [{}]",
+		               index, dnet_cpus_string(cpus), strerror(-err), err);
+	} else {
+		DNET_LOG_INFO(node, "io: net thread {} is bound to cpus: {}", index, dnet_cpus_string(cpus));
+	}
+}
+
 void dnet_backends_destroy(struct dnet_node *node) {
 	delete node->io->backends_manager;
 	delete node->io->pools_manager;
@@ -1377,6 +1478,39 @@ uint64_t dnet_backend_get_queue_timeout(struct dnet_node *node, ssize_t backend_
 	return backend->queue_timeout();
 }
 
+int dnet_backend_admit_request(struct dnet_node *node,
+                               ssize_t backend_id,
+                               struct dnet_work_pool *pool,
+                               const struct dnet_io_req *r) {
+	if (!node || !node->io || !node->io->backends_manager || !pool)
+		return 0;
+
+	if (backend_id >= 0) {
+		auto backend = node->io->backends_manager->get(backend_id);
+		if (backend)
+			return backend->admit_request(pool, r);
+	}
+
+	const auto data = dnet_node_get_config_data(node);
+	if (dnet_io_pool_fits_budget(pool, r, data->queue_limit, data->queue_bytes_limit))
+		return 0;
+
+	atomic_inc(&node->io->queue_rejected);
+	return -EBUSY;
+}
+
+void dnet_backend_trace_request(struct dnet_backend *backend, struct dnet_access_context *context) {
+	if (!context)
+		return;
+
+	auto slow_requests = backend->slow_requests();
+	if (slow_requests) {
+		context->set_tracer([slow_requests] (const ioremap::monitor::request_trace &trace) {
+			slow_requests->add(trace);
+		});
+	}
+}
+
 int dnet_backend_process_cmd_raw(struct dnet_backend *backend,
                                  struct dnet_net_state *st,
                                  struct dnet_cmd *cmd,
@@ -5,6 +5,7 @@
 
 #ifdef __cplusplus
 
+#include <atomic>
 #include <string>
 #include <mutex>
 #include <unordered_map>
@@ -65,8 +66,13 @@ public:
 	void set_delay(uint64_t delay) { m_delay = delay; }
 	// return statistics of handled by the backend commands
 	ioremap::monitor::command_stats &command_stats() { return m_command_stats; }
+	// return the slowest requests handled by the backend, it can be nullptr if tracing is disabled
+	std::shared_ptr<ioremap::monitor::slow_requests> slow_requests() const { return m_slow_requests; }
 	// return backend's queue_timeout
 	uint64_t queue_timeout() const;
+	// check whether request @r fits into admission budget of @pool's queue and count it if it doesn't.
+	// Returns 0 if the request is admitted and -EBUSY otherwise
+	int admit_request(struct dnet_work_pool *pool, const struct dnet_io_req *r);
 	// set backend's verbosity to @level
 	void set_verbosity(const dnet_log_level level);
 	// return io pool the backend is attached to
@@ -116,6 +122,8 @@ private:
 	dnet_backend_callbacks					m_callbacks;
 	// statistics collected for monitor
 	ioremap::monitor::command_stats				m_command_stats;
+	// the slowest requests handled by the backend
+	std::shared_ptr<ioremap::monitor::slow_requests>	m_slow_requests;
 	// cache. It will be nullptr if cache is disabled
 	std::unique_ptr<ioremap::cache::cache_manager>		m_cache;
 	// logger with attached backend's attributes
@@ -124,6 +132,8 @@ private:
 	std::string						m_pool_id;
 	// pointer to io pool serves the backend
 	std::shared_ptr<struct dnet_io_pool>			m_pool;
+	// number of requests rejected because of exhausted admission budget
+	std::atomic<uint64_t>					m_queue_rejected;
 
 private:
 	// change backend's state to @state and check the adequacy of this change
@@ -143,6 +153,8 @@ private:
 	void fill_cache_stats(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator);
 	// fill @value with statistics of handled by the backend commands
 	void fill_commands_stats(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator);
+	// fill @value with the slowest requests handled by the backend
+	void fill_slow_requests(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator);
 };
 
 struct dnet_backends_manager {
@@ -207,6 +219,14 @@ struct dnet_io_pool *__attribute__((weak)) dnet_backend_get_pool(struct dnet_nod
 struct dnet_work_pool_place *dnet_backend_get_place(struct dnet_node *node, ssize_t backend_id, int nonblocking);
 // return backend's queue_timeout
 uint64_t __attribute__((weak)) dnet_backend_get_queue_timeout(struct dnet_node *node, ssize_t backend_id);
+/* check whether request @r addressed to @backend_id fits into admission budget of io pool @pool.
+ * Budget of the backend is used if it exists, otherwise node-wide one is used.
+ * Returns 0 if the request is admitted and -EBUSY if the budget is exhausted.
+ */
+int __attribute__((weak)) dnet_backend_admit_request(struct dnet_node *node,
+                                                     ssize_t backend_id,
+                                                     struct dnet_work_pool *pool,
+                                                     const struct dnet_io_req *r);
 
 // update statistics for commands handled by the @backend
 void dnet_backend_command_stats_update(struct dnet_backend *backend,
@@ -214,7 +234,10 @@ void dnet_backend_command_stats_update(struct dnet_backend *backend,
                                        uint64_t size,
                                        int handled_in_cache,
                                        int err,
-                                       long diff);
+                                       long diff,
+                                       long queue_time);
+// trace stages of request with @context by @backend
+void dnet_backend_trace_request(struct dnet_backend *backend, struct dnet_access_context *context);
 // handle command by @backend
 int dnet_backend_process_cmd_raw(struct dnet_backend *backend,
                                  struct dnet_net_state *st,
@@ -231,6 +254,8 @@ int dnet_cmd_cache_io(struct dnet_backend *backend,
                       struct dnet_cmd_stats *cmd_stats,
                       struct dnet_access_context *context);
 
+// bind net thread @index to its CPUs from "net_thread_cpus" of node's config, failure is logged but not fatal
+void dnet_io_bind_net_thread(struct dnet_node *node, int index);
 // initialize backends' subsystem, but do not enable any backend
 int dnet_backends_init(struct dnet_node *node);
 // deinitialize backends' subsystem
@@ -256,12 +281,6 @@ int dnet_cmd_bulk_read_new(struct dnet_net_state *st,
                            void *data,
                            struct dnet_access_context *context);
 
-// add to @queue_size and @threads_count all io pools' queues' sizes and number of threads.
-// This is used to suspend net threads if queues are heavily filled
-void __attribute__((weak)) dnet_io_pools_check(struct dnet_io_pools_manager *pools_manager,
-                                               uint64_t *queue_size,
-                                               uint64_t *threads_count);
-
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -1,6 +1,7 @@
 #ifndef IOREMAP_ELLIPTICS_COMMON_HPP
 #define IOREMAP_ELLIPTICS_COMMON_HPP
 
+#include <atomic>
 #include <mutex>
 #include "elliptics/interface.h"
 
@@ -62,4 +63,14 @@ inline static bool operator <(const dnet_id &lhs, const dnet_id &rhs) {
 	return dnet_id_cmp(&lhs, &rhs) < 0;
 }
 
+/*
+ * Returns index of the current thread assigned round-robin on the first call,
+ * it is used to pick per-thread shard of sharded structures: dnet_current_thread_index() % shards_count
+ */
+inline size_t dnet_current_thread_index() {
+	static std::atomic<size_t> next_index(0);
+	static thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+	return index;
+}
+
 #endif // IOREMAP_ELLIPTICS_COMMON_HPP
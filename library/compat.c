@@ -17,6 +17,10 @@
  * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
@@ -65,6 +69,32 @@ long dnet_get_id(void)
 }
 #endif
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+
+int dnet_set_thread_affinity(pthread_t tid, const int *cpus, int num)
+{
+	cpu_set_t set;
+	int i;
+
+	CPU_ZERO(&set);
+	for (i = 0; i < num; ++i) {
+		if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE)
+			return -EINVAL;
+		CPU_SET(cpus[i], &set);
+	}
+
+	return -pthread_setaffinity_np(tid, sizeof(set), &set);
+}
+#else
+int dnet_set_thread_affinity(pthread_t tid __attribute__ ((unused)), const int *cpus __attribute__ ((unused)),
+		int num __attribute__ ((unused)))
+{
+	return -ENOTSUP;
+}
+#endif
+
 #ifdef HAVE_SENDFILE4_SUPPORT
 #include <sys/sendfile.h>
 int dnet_sendfile(struct dnet_net_state *st, int fd, uint64_t *offset, uint64_t size)
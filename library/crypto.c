@@ -28,6 +28,7 @@
 #include "elliptics/interface.h"
 
 #include "crypto/sha512.h"
+#include "crypto/sha512_mb.h"
 
 static void dnet_transform_final(void *dst, const void *src, unsigned int *rsize, unsigned int rs)
 {
@@ -88,6 +89,69 @@ static int dnet_local_digest_transform_file(void *priv __unused, struct dnet_ses
 	return 0;
 }
 
+static int dnet_local_digest_transform_iov(void *priv __unused, struct dnet_session *s,
+		const struct iovec *iov, int count,
+		void *dst, unsigned int *dsize, unsigned int flags __unused)
+{
+	unsigned int rs = *dsize;
+	unsigned char hash[64];
+	struct sha512_ctx ctx;
+	int i;
+
+	sha512_init_ctx(&ctx);
+
+	if (s && s->ns && s->nsize) {
+		sha512_process_bytes(s->ns, s->nsize, &ctx);
+		sha512_process_bytes("\0", 1, &ctx);
+	}
+
+	for (i = 0; i < count; ++i)
+		sha512_process_bytes(iov[i].iov_base, iov[i].iov_len, &ctx);
+	sha512_finish_ctx(&ctx, hash);
+
+	dnet_transform_final(dst, hash, dsize, rs);
+	return 0;
+}
+
+/*
+ * Number of buffers hashed by one call of sha512_buffers(), it bounds size of digests' buffer on the stack
+ */
+#define DNET_TRANSFORM_BATCH_SIZE 64
+
+static int dnet_local_digest_transform_batch(void *priv __unused, struct dnet_session *s,
+		const struct iovec *src, int count,
+		void *dst, unsigned int dsize, unsigned int flags __unused)
+{
+	unsigned char hash[DNET_TRANSFORM_BATCH_SIZE][64];
+	struct iovec prefix[2];
+	size_t prefix_count = 0;
+	unsigned int rs;
+	int i, j, batch;
+
+	if (s && s->ns && s->nsize) {
+		prefix[0].iov_base = s->ns;
+		prefix[0].iov_len = s->nsize;
+		prefix[1].iov_base = (void *)"\0";
+		prefix[1].iov_len = 1;
+		prefix_count = 2;
+	}
+
+	for (i = 0; i < count; i += batch) {
+		batch = count - i;
+		if (batch > DNET_TRANSFORM_BATCH_SIZE)
+			batch = DNET_TRANSFORM_BATCH_SIZE;
+
+		sha512_buffers(prefix, prefix_count, src + i, batch, hash);
+
+		for (j = 0; j < batch; ++j) {
+			rs = dsize;
+			dnet_transform_final((char *)dst + (size_t)(i + j) * dsize, hash[j], &rs, dsize);
+		}
+	}
+
+	return 0;
+}
+
 int dnet_digest_transform(const void *src, uint64_t size, struct dnet_id *id)
 {
 	return dnet_digest_transform_raw(src, size, id->id, DNET_ID_SIZE);
@@ -162,6 +226,8 @@ int dnet_crypto_init(struct dnet_node *n)
 
 	t->transform = dnet_local_digest_transform;
 	t->transform_file = dnet_local_digest_transform_file;
+	t->transform_iov = dnet_local_digest_transform_iov;
+	t->transform_batch = dnet_local_digest_transform_batch;
 	t->priv = NULL;
 
 	return 0;
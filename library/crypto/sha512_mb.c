@@ -0,0 +1,248 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sha512_mb.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define SHA512_MB_SIMD 1
+#endif
+
+#define SHA512_MB_BLOCK_SIZE 128
+#define SHA512_MB_MAX_LANES 8
+
+static void sha512_buffers_serial(const struct iovec *prefix, size_t prefix_count,
+		const struct iovec *messages, size_t count, void *resblocks)
+{
+	struct sha512_ctx ctx;
+	size_t i, j;
+
+	for (i = 0; i < count; ++i) {
+		sha512_init_ctx(&ctx);
+
+		for (j = 0; j < prefix_count; ++j)
+			sha512_process_bytes(prefix[j].iov_base, prefix[j].iov_len, &ctx);
+		sha512_process_bytes(messages[i].iov_base, messages[i].iov_len, &ctx);
+
+		sha512_finish_ctx(&ctx, (char *)resblocks + i * SHA512_DIGEST_SIZE);
+	}
+}
+
+#ifdef SHA512_MB_SIMD
+
+typedef uint64_t sha512_v4 __attribute__((vector_size(32)));
+typedef uint64_t sha512_v8 __attribute__((vector_size(64)));
+
+#define SHA512_MB_ROTR(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+#define SHA512_MB_S0(x) (SHA512_MB_ROTR(x, 28) ^ SHA512_MB_ROTR(x, 34) ^ SHA512_MB_ROTR(x, 39))
+#define SHA512_MB_S1(x) (SHA512_MB_ROTR(x, 14) ^ SHA512_MB_ROTR(x, 18) ^ SHA512_MB_ROTR(x, 41))
+#define SHA512_MB_s0(x) (SHA512_MB_ROTR(x, 1) ^ SHA512_MB_ROTR(x, 8) ^ ((x) >> 7))
+#define SHA512_MB_s1(x) (SHA512_MB_ROTR(x, 19) ^ SHA512_MB_ROTR(x, 61) ^ ((x) >> 6))
+
+/*
+ * Defines function @name which runs SHA512 compression of one block in every lane of vector type @vec
+ * using instruction set @isa. Word i of lane l is located at @state[i * lanes + l] and @block[i * lanes + l],
+ * words of @block are already converted to host byte order.
+ */
+#define SHA512_MB_COMPRESS(name, vec, isa)							\
+static void __attribute__((target(isa))) name(uint64_t *state, const uint64_t *block)	\
+{											\
+	vec s[8], w[16], a, b, c, d, e, f, g, h, t1, t2;				\
+	int i;										\
+											\
+	memcpy(s, state, sizeof(s));							\
+	memcpy(w, block, sizeof(w));							\
+	a = s[0]; b = s[1]; c = s[2]; d = s[3];						\
+	e = s[4]; f = s[5]; g = s[6]; h = s[7];						\
+											\
+	for (i = 0; i < 80; ++i) {							\
+		if (i >= 16)								\
+			w[i & 15] += SHA512_MB_s1(w[(i - 2) & 15]) + w[(i - 7) & 15] +	\
+				SHA512_MB_s0(w[(i - 15) & 15]);				\
+											\
+		t1 = h + SHA512_MB_S1(e) + ((e & f) ^ (~e & g)) +			\
+			sha512_round_constants[i] + w[i & 15];				\
+		t2 = SHA512_MB_S0(a) + ((a & b) ^ (a & c) ^ (b & c));			\
+											\
+		h = g; g = f; f = e; e = d + t1;					\
+		d = c; c = b; b = a; a = t1 + t2;					\
+	}										\
+											\
+	s[0] += a; s[1] += b; s[2] += c; s[3] += d;					\
+	s[4] += e; s[5] += f; s[6] += g; s[7] += h;					\
+	memcpy(state, s, sizeof(s));							\
+}
+
+SHA512_MB_COMPRESS(sha512_mb_compress_avx2, sha512_v4, "avx2")
+SHA512_MB_COMPRESS(sha512_mb_compress_avx512, sha512_v8, "avx512f")
+
+typedef void (*sha512_mb_compress_t)(uint64_t *state, const uint64_t *block);
+
+static inline uint64_t sha512_mb_load_be64(const unsigned char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return __builtin_bswap64(v);
+}
+
+static inline void sha512_mb_store_be64(unsigned char *p, uint64_t v)
+{
+	v = __builtin_bswap64(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+struct sha512_mb_lane {
+	/* message hashed in the lane, NULL if the lane is idle */
+	const struct iovec	*message;
+	unsigned char		*result;
+	/* length of the prefix and the message */
+	uint64_t		length;
+	/* index of the current block and number of blocks in padded message */
+	uint64_t		block;
+	uint64_t		blocks;
+};
+
+/*
+ * Fills @block by the current block of padded message hashed in @lane
+ */
+static void sha512_mb_message_block(const struct iovec *prefix, size_t prefix_count,
+		const struct sha512_mb_lane *lane, unsigned char *block)
+{
+	const uint64_t begin = lane->block * SHA512_MB_BLOCK_SIZE;
+	const uint64_t end = begin + SHA512_MB_BLOCK_SIZE;
+	uint64_t offset = 0, from, to;
+	size_t i;
+
+	memset(block, 0, SHA512_MB_BLOCK_SIZE);
+
+	for (i = 0; i <= prefix_count && offset < end; ++i) {
+		const struct iovec *iov = (i < prefix_count) ? &prefix[i] : lane->message;
+
+		from = (offset > begin) ? offset : begin;
+		to = (offset + iov->iov_len < end) ? offset + iov->iov_len : end;
+		if (from < to)
+			memcpy(block + (from - begin), (const char *)iov->iov_base + (from - offset), to - from);
+
+		offset += iov->iov_len;
+	}
+
+	if (lane->length >= begin && lane->length < end)
+		block[lane->length - begin] = 0x80;
+
+	if (lane->block + 1 == lane->blocks) {
+		/* 128-bit length of the message in bits */
+		sha512_mb_store_be64(block + SHA512_MB_BLOCK_SIZE - 16, lane->length >> 61);
+		sha512_mb_store_be64(block + SHA512_MB_BLOCK_SIZE - 8, lane->length << 3);
+	}
+}
+
+static void sha512_buffers_parallel(sha512_mb_compress_t compress, size_t lanes,
+		const struct iovec *prefix, size_t prefix_count,
+		const struct iovec *messages, size_t count, void *resblocks)
+{
+	uint64_t state[8 * SHA512_MB_MAX_LANES] __attribute__((aligned(64)));
+	uint64_t words[16 * SHA512_MB_MAX_LANES] __attribute__((aligned(64)));
+	unsigned char block[SHA512_MB_BLOCK_SIZE];
+	struct sha512_mb_lane lane[SHA512_MB_MAX_LANES];
+	struct sha512_ctx initial;
+	uint64_t prefix_size = 0;
+	size_t next = 0, active, l, i;
+
+	sha512_init_ctx(&initial);
+
+	for (i = 0; i < prefix_count; ++i)
+		prefix_size += prefix[i].iov_len;
+
+	/* idle lanes are compressed too, their results are just ignored */
+	memset(state, 0, sizeof(state));
+	memset(words, 0, sizeof(words));
+	memset(lane, 0, sizeof(lane));
+
+	while (1) {
+		active = 0;
+
+		for (l = 0; l < lanes; ++l) {
+			if (!lane[l].message) {
+				if (next == count)
+					continue;
+
+				lane[l].message = &messages[next];
+				lane[l].result = (unsigned char *)resblocks + next * SHA512_DIGEST_SIZE;
+				lane[l].length = prefix_size + messages[next].iov_len;
+				lane[l].block = 0;
+				lane[l].blocks = (lane[l].length + 1 + 16 + SHA512_MB_BLOCK_SIZE - 1) / SHA512_MB_BLOCK_SIZE;
+				for (i = 0; i < 8; ++i)
+					state[i * lanes + l] = initial.state[i];
+				++next;
+			}
+
+			sha512_mb_message_block(prefix, prefix_count, &lane[l], block);
+			for (i = 0; i < 16; ++i)
+				words[i * lanes + l] = sha512_mb_load_be64(block + i * 8);
+			++active;
+		}
+
+		if (!active)
+			break;
+
+		compress(state, words);
+
+		for (l = 0; l < lanes; ++l) {
+			if (!lane[l].message || ++lane[l].block != lane[l].blocks)
+				continue;
+
+			for (i = 0; i < 8; ++i)
+				sha512_mb_store_be64(lane[l].result + i * 8, state[i * lanes + l]);
+			lane[l].message = NULL;
+		}
+	}
+}
+
+#endif /* SHA512_MB_SIMD */
+
+size_t sha512_buffers_lanes(void)
+{
+#ifdef SHA512_MB_SIMD
+	if (__builtin_cpu_supports("avx512f"))
+		return 8;
+	if (__builtin_cpu_supports("avx2"))
+		return 4;
+#endif
+	return 1;
+}
+
+void sha512_buffers(const struct iovec *prefix, size_t prefix_count,
+		const struct iovec *messages, size_t count, void *resblocks)
+{
+#ifdef SHA512_MB_SIMD
+	const size_t lanes = sha512_buffers_lanes();
+
+	if (count > 1 && lanes == 8) {
+		sha512_buffers_parallel(sha512_mb_compress_avx512, lanes, prefix, prefix_count,
+				messages, count, resblocks);
+		return;
+	}
+	if (count > 1 && lanes == 4) {
+		sha512_buffers_parallel(sha512_mb_compress_avx2, lanes, prefix, prefix_count,
+				messages, count, resblocks);
+		return;
+	}
+#endif
+	sha512_buffers_serial(prefix, prefix_count, messages, count, resblocks);
+}
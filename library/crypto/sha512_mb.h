@@ -0,0 +1,50 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHA512_MB_H
+#define SHA512_MB_H
+
+#include <sys/uio.h>
+
+#include "sha512.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Computes SHA512 digests of @count independent messages in one call.
+ * Message i is concatenation of @prefix_count buffers described by @prefix (common for all messages)
+ * and the buffer described by @messages[i], its 64-byte digest is written at @resblocks + i * 64.
+ *
+ * Messages are hashed in parallel lanes of AVX2 (4 lanes) or AVX-512 (8 lanes) registers
+ * if CPU supports them, otherwise one by one as sha512_buffer() does.
+ * It pays off for many short messages like keys' names, long messages should be hashed by sha512_buffer().
+ */
+extern void sha512_buffers(const struct iovec *prefix, size_t prefix_count,
+                           const struct iovec *messages, size_t count, void *resblocks);
+
+/*
+ * Returns number of messages hashed in parallel by sha512_buffers() on this CPU: 8, 4 or 1
+ */
+extern size_t sha512_buffers_lanes(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHA512_MB_H */
@@ -716,7 +716,9 @@ int dnet_server_send_write(struct dnet_server_send_ctl *send,
 	// and will send acknowledge with error
 	//
 	// if there is no error, @dnet_file_info structure will be returned
-	ctl.cflags = 0;
+	//
+	// writes made by server-send are recovery traffic and are queued on remote nodes in recovery class
+	ctl.cflags = DNET_FLAGS_PRIO_RECOVERY;
 
 	ctl.fd = fd;
 	ctl.local_offset = data_offset;
@@ -1357,8 +1359,15 @@ static int dnet_cas_local(struct dnet_backend *backend,
 	 * case about parallel writes being made without locks.
 	 */
 
+	/*
+	 * Backend may provide only leading bytes of the checksum (e.g. a digest stored along with the record),
+	 * so only @csize bytes it has set are compared
+	 */
 	if (err == 0) {
-		if (memcmp(csum, remote_csum, DNET_ID_SIZE)) {
+		if (csize <= 0 || csize > DNET_ID_SIZE)
+			csize = DNET_ID_SIZE;
+
+		if (memcmp(csum, remote_csum, csize)) {
 			char disk_csum[DNET_ID_SIZE * 2 + 1];
 			char recv_csum[DNET_ID_SIZE * 2 + 1];
 
@@ -1534,6 +1543,8 @@ static int dnet_process_cmd_with_backend_raw(struct dnet_net_state *st,
 	if (!backend)
 		return -ENOTSUP;
 
+	dnet_backend_trace_request(backend, context);
+
 	// sleep before running a command, since for some commands ->command_handler sends reply itself,
 	// and client will not wait for this thread to finish
 	dnet_backend_sleep_delay(backend);
@@ -1657,7 +1668,7 @@ static int dnet_process_cmd_with_backend_raw(struct dnet_net_state *st,
 	}
 
 	dnet_backend_command_stats_update(backend, cmd, cmd_stats->size, cmd_stats->handled_in_cache, err,
-	                                  cmd_stats->handle_time);
+	                                  cmd_stats->handle_time, cmd_stats->queue_time);
 
 	dnet_backend_unlock_state(backend);
 	return err;
@@ -1683,6 +1694,12 @@ int dnet_process_cmd_raw(struct dnet_net_state *st,
 	HANDY_TIMER_SCOPE(recursive ? "io.cmd_recursive" : "io.cmd");
 	HANDY_TIMER_SCOPE(("io.cmd%s.%s", (recursive ? "_recursive" : ""), dnet_cmd_string(cmd->cmd)));
 
+	/* forget waits for key locks made by previous requests, only this request's ones should be traced */
+	if (context) {
+		dnet_oplock_take_wait_time();
+		dnet_monitor_trace_request(n, context);
+	}
+
 	clock_gettime(CLOCK_MONOTONIC_RAW, &start);
 
 	err = dnet_process_cmd_without_backend_raw(st, cmd, data, &cmd_stats, context);
@@ -1692,6 +1709,15 @@ int dnet_process_cmd_raw(struct dnet_net_state *st,
 	clock_gettime(CLOCK_MONOTONIC_RAW, &end);
 	cmd_stats.handle_time = DIFF_TIMESPEC(start, end);
 
+	if (context) {
+		const uint64_t lock_time = dnet_oplock_take_wait_time();
+		const uint64_t handle_time = cmd_stats.handle_time;
+
+		dnet_access_context_add_stage_time(context, DNET_REQUEST_STAGE_LOCK, lock_time);
+		dnet_access_context_add_stage_time(context, DNET_REQUEST_STAGE_BACKEND,
+		                                   handle_time > lock_time ? handle_time - lock_time : 0);
+	}
+
 	switch (cmd->cmd) {
 		case DNET_CMD_READ:
 		case DNET_CMD_WRITE:
@@ -1737,9 +1763,11 @@ int dnet_process_cmd_raw(struct dnet_net_state *st,
 	}
 
 	dnet_access_context_add_int(context, "status", err);
+	dnet_access_context_set_status(context, err);
 
 	// we must provide real error from the backend into statistics
-	dnet_monitor_stats_update(n, cmd, err, cmd_stats.handled_in_cache, cmd_stats.size, cmd_stats.handle_time);
+	dnet_monitor_stats_update(n, cmd, err, cmd_stats.handled_in_cache, cmd_stats.size, cmd_stats.handle_time,
+	                          queue_time);
 
 	HANDY_COUNTER_INCREMENT(
 	("io.cmd%s.%d.%s.%d", (recursive ? "_recursive" : ""), cmd->backend_id, dnet_cmd_string(cmd->cmd), err), 1);
@@ -2018,6 +2046,11 @@ int dnet_checksum_data(struct dnet_node *n, const void *data, uint64_t size, uns
 	return dnet_transform_node(n, data, size, csum, csize);
 }
 
+int dnet_checksum_iov(struct dnet_node *n, const struct iovec *iov, int count, unsigned char *csum, int csize)
+{
+	return dnet_transform_node_iov(n, iov, count, (char *)csum, csize);
+}
+
 int dnet_checksum_file(struct dnet_node *n, const char *file, uint64_t offset, uint64_t size, void *csum, int csize)
 {
 	int fd, err;
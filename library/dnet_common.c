@@ -57,6 +57,13 @@ int dnet_transform_file(struct dnet_node *n, int fd, uint64_t offset, uint64_t s
 	return t->transform_file(t->priv, NULL, fd, offset, size, csum, (unsigned int *)&csize, 0);
 }
 
+int dnet_transform_node_iov(struct dnet_node *n, const struct iovec *iov, int count, char *csum, unsigned int csize)
+{
+	struct dnet_transform *t = &n->transform;
+
+	return t->transform_iov(t->priv, NULL, iov, count, csum, (unsigned int *)&csize, 0);
+}
+
 int dnet_transform_raw(struct dnet_session *s, const void *src, uint64_t size, char *csum, unsigned int csize)
 {
 	struct dnet_node *n = s->node;
@@ -65,6 +72,14 @@ int dnet_transform_raw(struct dnet_session *s, const void *src, uint64_t size, c
 	return t->transform(t->priv, s, src, size, csum, &csize, 0);
 }
 
+int dnet_transform_raw_batch(struct dnet_session *s, const struct iovec *src, int count, char *csum, unsigned int csize)
+{
+	struct dnet_node *n = s->node;
+	struct dnet_transform *t = &n->transform;
+
+	return t->transform_batch(t->priv, s, src, count, csum, csize, 0);
+}
+
 int dnet_transform(struct dnet_session *s, const void *src, uint64_t size, struct dnet_id *id)
 {
 	return dnet_transform_raw(s, src, size, (char *)id->id, sizeof(id->id));
@@ -906,6 +921,27 @@ static inline void dnet_iterator_response_skip_equal_keys(const struct dnet_iter
 	*offset += resp_size;
 }
 
+/*!
+ * Number of responses accumulated by \fn dnet_iterator_response_container_diff
+ * before they are written to the diff container.
+ */
+#define DNET_ITERATOR_RESPONSE_DIFF_BUFFER_SIZE 4096
+
+/*!
+ * Converts and writes \a count buffered responses to \a fd at position \a pos
+ */
+static int dnet_iterator_response_container_write(struct dnet_iterator_response *responses,
+		size_t count, int fd, uint64_t pos)
+{
+	const ssize_t size = count * sizeof(struct dnet_iterator_response);
+	size_t i;
+
+	for (i = 0; i < count; ++i)
+		dnet_convert_iterator_response(&responses[i]);
+
+	return dnet_write_ll(fd, (const char *)responses, size, pos);
+}
+
 /*!
  * Computes difference for two containers and writes it to diff_fd.
  * Returns size of new container.
@@ -922,6 +958,8 @@ int64_t dnet_iterator_response_container_diff(int diff_fd, int left_fd, uint64_t
 	const ssize_t resp_size = sizeof(struct dnet_iterator_response);
 	uint64_t left_offset = 0, right_offset = 0;
 	int64_t diff_offset = 0, err = 0;
+	struct dnet_iterator_response *buffer;
+	size_t buffered = 0;
 
 	/* Sanity */
 	if (diff_fd < 0 || left_fd < 0 || right_fd < 0)
@@ -931,9 +969,13 @@ int64_t dnet_iterator_response_container_diff(int diff_fd, int left_fd, uint64_t
 	if (right_size % resp_size != 0)
 		return -EINVAL;
 
+	buffer = malloc(DNET_ITERATOR_RESPONSE_DIFF_BUFFER_SIZE * resp_size);
+	if (!buffer)
+		return -ENOMEM;
+
 	/* mmap both containers */
 	if ((err = dnet_data_map(&left_map)) != 0)
-		goto err;
+		goto err_free;
 	if ((err = dnet_data_map(&right_map)) != 0)
 		goto err_unmap_left;
 
@@ -971,10 +1013,14 @@ int64_t dnet_iterator_response_container_diff(int diff_fd, int left_fd, uint64_t
 			 * or same but less timestamp we add record to
 			 * differene because it should be recovered.
 			 */
-			err = dnet_iterator_response_container_append(right, diff_fd, diff_offset);
-			if (err != 0)
-				goto err_unmap_right;
-			diff_offset += resp_size;
+			buffer[buffered++] = *right;
+			if (buffered == DNET_ITERATOR_RESPONSE_DIFF_BUFFER_SIZE) {
+				err = dnet_iterator_response_container_write(buffer, buffered, diff_fd, diff_offset);
+				if (err != 0)
+					goto err_unmap_right;
+				diff_offset += buffered * resp_size;
+				buffered = 0;
+			}
 
 			dnet_iterator_response_skip_equal_keys(right_map.data, &right_offset, right_size);
 
@@ -983,15 +1029,22 @@ int64_t dnet_iterator_response_container_diff(int diff_fd, int left_fd, uint64_t
 				dnet_iterator_response_skip_equal_keys(left_map.data, &left_offset, left_size);
 		}
 		assert(left_offset <= left_size);
-		assert(diff_offset <= (int64_t)right_size);
+		assert(diff_offset + buffered * resp_size <= right_size);
 	}
 	assert(right_offset == right_size);
 
+	if (buffered) {
+		err = dnet_iterator_response_container_write(buffer, buffered, diff_fd, diff_offset);
+		if (err == 0)
+			diff_offset += buffered * resp_size;
+	}
+
 err_unmap_right:
 	dnet_data_unmap(&right_map);
 err_unmap_left:
 	dnet_data_unmap(&left_map);
-err:
+err_free:
+	free(buffer);
 	return err ? err : diff_offset;
 }
 
@@ -58,6 +58,7 @@ struct dnet_group;
 struct dnet_net_state;
 struct dnet_cmd_stats;
 struct dnet_access_context;
+struct dnet_access_ring;
 
 struct dnet_io_req {
 	struct list_head	req_entry;
@@ -78,6 +79,13 @@ struct dnet_io_req {
 	struct timespec		queue_start_ts;
 	uint64_t		queue_time;
 	uint64_t		recv_time;
+	/* time when request was found in queue with locked key, zero if it wasn't */
+	struct timespec		lock_start_ts;
+	/* part of @queue_time spent waiting for key's lock */
+	uint64_t		lock_time;
+	/* time (CLOCK_MONOTONIC_RAW) after which the request is useless, zero if it has no deadline
+	 * or its queue doesn't order requests by deadlines */
+	struct timespec		deadline_ts;
 
 	struct dnet_access_context *context;
 };
@@ -326,6 +334,12 @@ struct dnet_transform
 					void *dst, unsigned int *dsize, unsigned int flags);
 	int 			(* transform_file)(void *priv, struct dnet_session *s, int fd, uint64_t offset,
 					uint64_t size, void *dst, unsigned int *dsize, unsigned int flags);
+	/* transforms concatenation of @count buffers described by @iov */
+	int 			(* transform_iov)(void *priv, struct dnet_session *s, const struct iovec *iov, int count,
+					void *dst, unsigned int *dsize, unsigned int flags);
+	/* transforms each of @count buffers described by @src, i-th result is written at @dst + i * @dsize */
+	int 			(* transform_batch)(void *priv, struct dnet_session *s, const struct iovec *src, int count,
+					void *dst, unsigned int dsize, unsigned int flags);
 };
 
 int dnet_crypto_init(struct dnet_node *n);
@@ -335,6 +349,10 @@ struct dnet_net_io {
 	int			epoll_fd;
 	pthread_t		tid;
 	struct dnet_node	*n;
+
+	/* CPUs the thread is bound to, sockets whose packets are received on them are handled by the thread */
+	int			*cpus;
+	int			cpus_num;
 };
 
 enum dnet_work_io_mode {
@@ -371,6 +389,11 @@ static inline void list_stat_size_decrease(struct list_stat *st, int num) {
 	st->list_size -= num;
 }
 
+/* default weights of priority classes (see dnet_io_priority) sharing io pool's queue */
+#define DNET_IO_PRIO_CLIENT_WEIGHT	8
+#define DNET_IO_PRIO_ITERATOR_WEIGHT	2
+#define DNET_IO_PRIO_RECOVERY_WEIGHT	1
+
 struct dnet_request_queue;
 struct dnet_work_pool {
 	struct dnet_node		*n;
@@ -393,6 +416,10 @@ struct dnet_work_pool_place
 };
 
 void dnet_work_pool_exit(struct dnet_work_pool_place *place);
+/* Binds all threads of @pool to @num CPUs from @cpus */
+int dnet_work_pool_set_affinity(struct dnet_work_pool *pool, const int *cpus, int num);
+/* Binds net thread @index to @num CPUs from @cpus and makes it preferred for sockets received on them */
+int dnet_io_set_net_thread_affinity(struct dnet_node *n, int index, const int *cpus, int num);
 int dnet_work_pool_alloc(struct dnet_work_pool_place *place,
                          struct dnet_node *n,
                          int num,
@@ -408,8 +435,6 @@ struct dnet_io_pool {
 	struct dnet_work_pool_place	recv_pool_nb;
 };
 
-void dnet_check_io_pool(struct dnet_io_pool *io, uint64_t *queue_size, uint64_t *threads_count);
-
 struct dnet_backends_manager;
 struct dnet_io_pools_manager;
 struct dnet_io {
@@ -424,10 +449,10 @@ struct dnet_io {
 
 	struct dnet_io_pools_manager	*pools_manager;
 
-	// condition variable for waiting when io pools are able to process packets
+	// guards output_stats
 	pthread_mutex_t		full_lock;
-	pthread_cond_t		full_wait;
-	int			blocked;
+	// number of requests without backend rejected because of exhausted admission budget of node's io pool
+	atomic_t		queue_rejected;
 
 	struct list_stat	output_stats;
 };
@@ -450,6 +475,8 @@ struct dnet_config_data {
 };
 
 void dnet_config_data_destroy(struct dnet_config_data *config_data);
+/* Creates server node by @cfg_data, which is available to the node's threads from their start */
+struct dnet_node *dnet_node_create_with_config_data(struct dnet_config_data *cfg_data);
 
 struct dnet_route_list;
 struct dnet_node {
@@ -489,6 +516,8 @@ struct dnet_node {
 
 	dnet_logger		*log;
 	dnet_logger		*access_log;
+	/* completed access log records waiting to be printed to @access_log */
+	struct dnet_access_ring	*access_ring;
 
 	struct timespec		wait_ts;
 
@@ -781,6 +810,8 @@ void dnet_check_thread_stop(struct dnet_node *n);
 void dnet_reconnect_and_check_route_table(struct dnet_node *node);
 
 int dnet_set_name(const char *format, ...);
+/* Binds thread @tid to @num CPUs from @cpus */
+int dnet_set_thread_affinity(pthread_t tid, const int *cpus, int num);
 
 struct dnet_map_fd {
 	int			fd;
@@ -1000,6 +1031,17 @@ static inline const char* dnet_print_trans(const struct dnet_trans *t) {
 	return __dnet_print_trans;
 }
 
+/* Stages of request handling whose time is traced for the slowest requests */
+enum dnet_request_stage {
+	DNET_REQUEST_STAGE_RECV = 0,		/* receiving request from network */
+	DNET_REQUEST_STAGE_QUEUE,		/* waiting in io pool's queue */
+	DNET_REQUEST_STAGE_LOCK,		/* waiting for key's lock */
+	DNET_REQUEST_STAGE_BACKEND,		/* handling by backend */
+	DNET_REQUEST_STAGE_SEND_QUEUE,		/* waiting of replies in send queue */
+	DNET_REQUEST_STAGE_SEND,		/* sending replies to network */
+	__DNET_REQUEST_STAGE_MAX
+};
+
 /*
  * Statistics about handled command
  */
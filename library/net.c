@@ -717,6 +717,12 @@ int dnet_process_recv(struct dnet_net_state *st, struct dnet_io_req *r) {
 	dnet_access_context_add_uint(context, "receive_time", r->recv_time);
 	dnet_access_context_add_uint(context, "receive_queue_time", r->queue_time);
 
+	dnet_access_context_trace_request(context, cmd, &st->addr, r->recv_time + r->queue_time);
+	dnet_access_context_add_stage_time(context, DNET_REQUEST_STAGE_RECV, r->recv_time);
+	dnet_access_context_add_stage_time(context, DNET_REQUEST_STAGE_QUEUE,
+	                                   r->queue_time > r->lock_time ? r->queue_time - r->lock_time : 0);
+	dnet_access_context_add_stage_time(context, DNET_REQUEST_STAGE_LOCK, r->lock_time);
+
 	err = dnet_process_control(st, cmd, r->data);
 	if (err != -ENOTSUP) {
 		dnet_access_context_add_string(context, "access", "server/control");
@@ -860,6 +866,40 @@ void dnet_set_sockopt(struct dnet_node *n, int s)
 	fcntl(s, F_SETFL, O_NONBLOCK);
 }
 
+/*
+ * Returns net thread bound to the CPU which has received the last packet of socket @s, i.e. to the CPU
+ * handling interrupts of the socket's NIC queue, so the socket is processed on the same CPU and NUMA node.
+ * Returns -1 if there is no such thread or the kernel doesn't report the CPU.
+ */
+static int dnet_net_thread_by_incoming_cpu(struct dnet_io *io, int s)
+{
+#ifdef SO_INCOMING_CPU
+	socklen_t len = sizeof(int);
+	int cpu = -1, i, j, pos, cpus_num;
+
+	for (i = 0; i < io->net_thread_num; ++i) {
+		/* start from round-robin position to spread sockets among threads bound to the same CPU */
+		pos = (io->net_thread_pos + i) % io->net_thread_num;
+
+		/* pairs with release store in dnet_io_set_net_thread_affinity() */
+		cpus_num = __atomic_load_n(&io->net[pos].cpus_num, __ATOMIC_ACQUIRE);
+		for (j = 0; j < cpus_num; ++j) {
+			if (cpu < 0 && getsockopt(s, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len))
+				return -1;
+			if (cpu < 0)
+				return -1;
+
+			if (io->net[pos].cpus[j] == cpu)
+				return pos;
+		}
+	}
+#else
+	(void) io;
+	(void) s;
+#endif
+	return -1;
+}
+
 int dnet_setup_control_nolock(struct dnet_net_state *st)
 {
 	struct dnet_node *n = st->n;
@@ -867,8 +907,11 @@ int dnet_setup_control_nolock(struct dnet_net_state *st)
 	int err, pos;
 
 	if (st->epoll_fd == -1) {
-		pos = io->net_thread_pos;
-		if (++io->net_thread_pos >= io->net_thread_num)
+		pos = dnet_net_thread_by_incoming_cpu(io, st->read_s);
+		if (pos < 0)
+			pos = io->net_thread_pos;
+		io->net_thread_pos = pos + 1;
+		if (io->net_thread_pos >= io->net_thread_num)
 			io->net_thread_pos = 0;
 		st->epoll_fd = io->net[pos].epoll_fd;
 
@@ -1368,6 +1411,11 @@ err_out_exit:
 		dnet_access_context_add_uint(r->context, "send_time", send_time);
 		dnet_access_context_add_uint(r->context, "send_queue_time", r->queue_time);
 		dnet_access_context_add_uint(r->context, "response_size", total_size);
+
+		if (st->send_offset == total_size) {
+			dnet_access_context_add_stage_time(r->context, DNET_REQUEST_STAGE_SEND_QUEUE, r->queue_time);
+			dnet_access_context_add_stage_time(r->context, DNET_REQUEST_STAGE_SEND, send_time);
+		}
 	}
 	dnet_logger_unset_trace_id();
 
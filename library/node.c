@@ -29,6 +29,7 @@
 #include "elliptics/interface.h"
 #include "monitor/monitor.h"
 #include "library/logger.hpp"
+#include "library/access_ring.h"
 
 static struct dnet_node *dnet_node_alloc(struct dnet_config *cfg)
 {
@@ -88,6 +89,16 @@ static struct dnet_node *dnet_node_alloc(struct dnet_config *cfg)
 
 	memcpy(n->cookie, cfg->cookie, DNET_AUTH_COOKIE_SIZE);
 
+	/*
+	 * Only server nodes and clients with dedicated access log get the ring and its thread,
+	 * others print access logs synchronously, as it is done if the ring can't be created
+	 */
+	if ((cfg->flags & DNET_CFG_JOIN_NETWORK) || cfg->access_log) {
+		err = dnet_access_ring_create(n);
+		if (err)
+			DNET_ERROR(n, "Failed to create access log ring: err: %d", err);
+	}
+
 	return n;
 
 err_out_destroy_test_settings:
@@ -710,7 +721,11 @@ struct dnet_net_state *dnet_node_state(struct dnet_node *n)
 	return dnet_state_get(n->st);
 }
 
-struct dnet_node *dnet_node_create(struct dnet_config *cfg)
+/*
+ * Creates node, @cfg_data is config of server node, it is set before threads are started,
+ * so they can be set up by the config (e.g. net threads are bound to configured CPUs)
+ */
+static struct dnet_node *dnet_node_create_common(struct dnet_config *cfg, struct dnet_config_data *cfg_data)
 {
 	struct dnet_node *n;
 	int err = -ENOMEM;
@@ -791,6 +806,7 @@ struct dnet_node *dnet_node_create(struct dnet_config *cfg)
 
 	n->client_prio = cfg->client_prio;
 	n->server_prio = cfg->server_prio;
+	n->config_data = cfg_data;
 
 	err = dnet_crypto_init(n);
 	if (err)
@@ -814,6 +830,7 @@ err_out_io_exit:
 err_out_crypto_cleanup:
 	dnet_crypto_cleanup(n);
 err_out_free:
+	dnet_access_ring_destroy(n);
 	free(n);
 err_out_exit:
 	pthread_sigmask(SIG_SETMASK, &previous_sigset, NULL);
@@ -823,6 +840,16 @@ err_out_exit:
 	return NULL;
 }
 
+struct dnet_node *dnet_node_create(struct dnet_config *cfg)
+{
+	return dnet_node_create_common(cfg, NULL);
+}
+
+struct dnet_node *dnet_node_create_with_config_data(struct dnet_config_data *cfg_data)
+{
+	return dnet_node_create_common(&cfg_data->cfg_state, cfg_data);
+}
+
 int dnet_need_exit(struct dnet_node *n)
 {
 	return n->need_exit;
@@ -847,6 +874,8 @@ void dnet_node_cleanup_common_resources(struct dnet_node *n)
 	struct dnet_addr_storage *it, *atmp;
 
 	dnet_io_cleanup(n);
+	/* all threads which could complete requests are stopped, print the rest of access logs */
+	dnet_access_ring_destroy(n);
 
 	pthread_attr_destroy(&n->attr);
 
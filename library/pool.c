@@ -162,6 +162,21 @@ err_out_io_threads:
 	return err;
 }
 
+int dnet_work_pool_set_affinity(struct dnet_work_pool *pool, const int *cpus, int num)
+{
+	int i, err = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (i = 0; i < pool->num; ++i) {
+		err = dnet_set_thread_affinity(pool->wio_list[i].tid, cpus, num);
+		if (err)
+			break;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return err;
+}
+
 int dnet_work_pool_place_init(struct dnet_work_pool_place *pool)
 {
 	int err;
@@ -289,6 +304,30 @@ static void dnet_update_trans_timestamp_network(struct dnet_io_req *r)
 	}
 }
 
+/*
+ * Rejects request @r which doesn't fit into admission budget of its queue: replies -EBUSY
+ * right from the net thread and frees the request.
+ */
+static void dnet_schedule_reject(struct dnet_io_req *r, const char *thread_stat_id)
+{
+	struct dnet_net_state *st = r->st;
+	struct dnet_cmd *cmd = r->header;
+
+	dnet_log(st->n, DNET_LOG_ERROR, "%s: %s: client: %s: reject request: trans: %" PRIu64 ", cflags: %s, "
+	                                "backend_id: %d, size: %" PRIu64 ": queue is full",
+	         dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), dnet_state_dump_addr(st), cmd->trans,
+	         dnet_flags_dump_cflags(cmd->flags), cmd->backend_id, cmd->size);
+
+	FORMATTED(HANDY_COUNTER_INCREMENT, ("pool.%s.queue.rejected", thread_stat_id), 1);
+
+	/* requests without DNET_FLAGS_NEED_ACK (e.g. server-send writes) must get the error reply too */
+	cmd->flags |= DNET_FLAGS_NEED_ACK;
+	dnet_send_ack(st, cmd, -EBUSY, 0, NULL);
+
+	dnet_io_req_free(r);
+	dnet_state_put(st);
+}
+
 void dnet_schedule_io(struct dnet_node *n, struct dnet_io_req *r)
 {
 	struct dnet_work_pool_place *place = NULL;
@@ -345,6 +384,19 @@ void dnet_schedule_io(struct dnet_node *n, struct dnet_io_req *r)
 	dnet_log(n, DNET_LOG_DEBUG, "%s: %s: backend_id: %zd, place: %p, cmd->backend_id: %d",
 	         dnet_state_dump_addr(r->st), dnet_dump_id(r->header), backend_id, place, cmd->backend_id);
 
+	/*
+	 * Replies are never rejected since they complete already sent transactions,
+	 * as well as commands which are not dropped by queue timeout.
+	 * Other requests are checked against budget of the queue they are going to,
+	 * so overloaded backend rejects only its own requests and does not slow down others.
+	 */
+	if (!(cmd->flags & (DNET_FLAGS_REPLY | DNET_FLAGS_NO_QUEUE_TIMEOUT)) && n->io->backends_manager &&
+	    dnet_backend_admit_request(n, backend_id, pool, r)) {
+		pthread_mutex_unlock(&place->lock);
+		dnet_schedule_reject(r, thread_stat_id);
+		return;
+	}
+
 	dnet_push_request(pool, r);
 
 	pthread_mutex_unlock(&place->lock);
@@ -750,9 +802,6 @@ static int dnet_schedule_network_io(struct dnet_net_state *st, int send)
 		}
 	}
 
-	if (send)
-		pthread_cond_broadcast(&st->n->io->full_wait);
-
 	return err;
 }
 
@@ -790,43 +839,6 @@ err_out_exit:
 	return err;
 }
 
-static void dnet_check_work_pool_place(struct dnet_work_pool_place *place, uint64_t *queue_size, uint64_t *threads_count)
-{
-	struct dnet_work_pool *pool;
-
-	pthread_mutex_lock(&place->lock);
-	pool = place->pool;
-	if (pool) {
-		*queue_size += dnet_get_pool_queue_size(pool);
-
-		pthread_mutex_lock(&pool->lock);
-		*threads_count += pool->num;
-		pthread_mutex_unlock(&pool->lock);
-	}
-	pthread_mutex_unlock(&place->lock);
-}
-
-void dnet_check_io_pool(struct dnet_io_pool *io, uint64_t *queue_size, uint64_t *threads_count) {
-	dnet_check_work_pool_place(&io->recv_pool, queue_size, threads_count);
-	dnet_check_work_pool_place(&io->recv_pool_nb, queue_size, threads_count);
-}
-
-static int dnet_check_io(struct dnet_io *io)
-{
-	uint64_t queue_size = 0;
-	uint64_t threads_count = 0;
-
-	dnet_check_io_pool(&io->pool, &queue_size, &threads_count);
-
-	if (io->pools_manager)
-		dnet_io_pools_check(io->pools_manager, &queue_size, &threads_count);
-
-	if (queue_size <= threads_count * 1000)
-		return 1;
-
-	return 0;
-}
-
 static void dnet_shuffle_epoll_events(struct epoll_event *evs, int size) {
 	int i = 0, j = 0;
 	struct epoll_event tmp;
@@ -853,12 +865,10 @@ static void *dnet_io_process_network(void *data_)
 	int evs_size = 100;
 	struct epoll_event *evs = malloc(evs_size * sizeof(struct epoll_event));
 	struct epoll_event *evs_tmp = NULL;
-	struct timespec ts;
 	int tmp = 0;
 	int err = 0;
 	int num_events = 0;
 	int i = 0;
-	struct timespec prev_ts, curr_ts;
 
 	dnet_set_name("dnet_net");
 	dnet_logger_set_pool_id("net");
@@ -870,9 +880,6 @@ static void *dnet_io_process_network(void *data_)
 		goto err_out_exit;
 	}
 
-	// get current timestamp for future outputting "Net pool is suspended..." logging
-	clock_gettime(CLOCK_MONOTONIC_RAW, &prev_ts);
-
 	while (!n->need_exit) {
 		// check if epoll possibly has more events to process then evs_size
 		if (num_events >= evs_size) {
@@ -899,8 +906,6 @@ static void *dnet_io_process_network(void *data_)
 			break;
 		}
 
-		// tmp will counts number of send events
-		tmp = 0;
 		num_events = err;
 		// shuffles available epoll_events
 		dnet_shuffle_epoll_events(evs, num_events);
@@ -911,14 +916,9 @@ static void *dnet_io_process_network(void *data_)
 
 			if (data->fd == st->accept_s) {
 				// We have to accept new connection
-				++tmp;
 				err = dnet_state_accept_process(st, &evs[i]);
-			} else if ((evs[i].events & EPOLLOUT) || dnet_check_io(n->io)) {
-				// if this is sending event or io pool queues are not full then process it
-				++tmp;
-				err = dnet_state_net_process(st, &evs[i]);
 			} else {
-				continue;
+				err = dnet_state_net_process(st, &evs[i]);
 			}
 
 			if (err == 0)
@@ -951,27 +951,6 @@ static void *dnet_io_process_network(void *data_)
 				break;
 			}
 		}
-
-		// wait condition variable if no data has been sent and io pool queues are still full
-		if (tmp == 0 && !dnet_check_io(n->io)) {
-			clock_gettime(CLOCK_MONOTONIC_RAW, &curr_ts);
-			// print log only if previous log was written more then 1 seconds ago
-			if ((curr_ts.tv_sec - prev_ts.tv_sec) > 1) {
-				dnet_log(n, DNET_LOG_INFO, "Net pool is suspended because io pool queues is full");
-				prev_ts = curr_ts;
-			}
-			// wait condition variable - io queues has a free slot or some socket has something to send
-			pthread_mutex_lock(&n->io->full_lock);
-			n->io->blocked = 1;
-			while (!n->need_exit && !dnet_check_io(n->io)) {
-				clock_gettime(CLOCK_REALTIME, &ts);
-				ts.tv_sec += 1;
-				if (pthread_cond_timedwait(&n->io->full_wait, &n->io->full_lock, &ts) == 0)
-					break;
-			}
-			n->io->blocked = 0;
-			pthread_mutex_unlock(&n->io->full_lock);
-		}
 	}
 
 	free(evs);
@@ -1022,8 +1001,6 @@ void *dnet_io_process(void *data_) {
 		if (!r)
 			continue;
 
-		pthread_cond_broadcast(&n->io->full_wait);
-
 		FORMATTED(HANDY_COUNTER_INCREMENT, ("pool.%s.active_threads", thread_stat_id), 1);
 
 		st = r->st;
@@ -1078,13 +1055,8 @@ int dnet_io_init(struct dnet_node *n, struct dnet_config *cfg)
 		goto err_out_free;
 	}
 
-	err = pthread_cond_init(&n->io->full_wait, NULL);
-	if (err) {
-		err = -err;
-		goto err_out_free_mutex;
-	}
-
 	list_stat_init(&n->io->output_stats);
+	atomic_init(&n->io->queue_rejected, 0);
 
 	n->io->net_thread_num = cfg->net_thread_num;
 	n->io->net_thread_pos = 0;
@@ -1092,7 +1064,7 @@ int dnet_io_init(struct dnet_node *n, struct dnet_config *cfg)
 
 	err = dnet_work_pool_place_init(&n->io->pool.recv_pool);
 	if (err) {
-		goto err_out_free_cond;
+		goto err_out_free_mutex;
 	}
 
 	err = dnet_work_pool_alloc(&n->io->pool.recv_pool, n, cfg->io_thread_num, DNET_WORK_IO_MODE_BLOCKING, "sys",
@@ -1134,6 +1106,10 @@ int dnet_io_init(struct dnet_node *n, struct dnet_config *cfg)
 			dnet_log(n, DNET_LOG_ERROR, "Failed to create network processing thread: %d", err);
 			goto err_out_net_destroy;
 		}
+
+		/* bind the thread before any socket is attached to it, only server node has config */
+		if (n->config_data)
+			dnet_io_bind_net_thread(n, i);
 	}
 
 	return 0;
@@ -1153,8 +1129,6 @@ err_out_free_recv_pool:
 	dnet_work_pool_exit(&n->io->pool.recv_pool);
 err_out_cleanup_recv_place:
 	dnet_work_pool_place_cleanup(&n->io->pool.recv_pool);
-err_out_free_cond:
-	pthread_cond_destroy(&n->io->full_wait);
 err_out_free_mutex:
 	pthread_mutex_destroy(&n->io->full_lock);
 err_out_free:
@@ -1164,6 +1138,35 @@ err_out_exit:
 	return err;
 }
 
+int dnet_io_set_net_thread_affinity(struct dnet_node *n, int index, const int *cpus, int num)
+{
+	struct dnet_net_io *nio = &n->io->net[index];
+	int *copy;
+	int err;
+
+	/*
+	 * affinity is set only once when the thread is created, so cpus are never freed
+	 * while dnet_net_thread_by_incoming_cpu() reads them
+	 */
+	if (nio->cpus)
+		return -EEXIST;
+
+	err = dnet_set_thread_affinity(nio->tid, cpus, num);
+	if (err)
+		return err;
+
+	copy = malloc(num * sizeof(int));
+	if (!copy)
+		return -ENOMEM;
+	memcpy(copy, cpus, num * sizeof(int));
+
+	nio->cpus = copy;
+	/* pairs with acquire load in dnet_net_thread_by_incoming_cpu(), so @cpus are visible once @cpus_num is */
+	__atomic_store_n(&nio->cpus_num, num, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
 void dnet_io_stop(struct dnet_node *n) {
 	struct dnet_io *io = n->io;
 	int i;
@@ -1182,6 +1185,7 @@ void dnet_io_stop(struct dnet_node *n) {
 void dnet_io_cleanup(struct dnet_node *n)
 {
 	struct dnet_io *io = n->io;
+	int i;
 
 	dnet_work_pool_cleanup(&io->pool.recv_pool_nb);
 	dnet_work_pool_place_cleanup(&io->pool.recv_pool_nb);
@@ -1194,6 +1198,9 @@ void dnet_io_cleanup(struct dnet_node *n)
 
 	dnet_io_cleanup_states(n);
 
+	for (i = 0; i < io->net_thread_num; ++i)
+		free(io->net[i].cpus);
+
 	free(io);
 	n->io = NULL;
 }
@@ -307,6 +307,36 @@ inline msgpack::packer<Stream> &operator <<(msgpack::packer<Stream> &o, const dn
 	return o;
 }
 
+inline ioremap::elliptics::dnet_iterator_condition &operator >>(msgpack::object o,
+                                                                 ioremap::elliptics::dnet_iterator_condition &v) {
+	if (o.type != msgpack::type::ARRAY || o.via.array.size < 6)
+		throw msgpack::type_error();
+
+	object *p = o.via.array.ptr;
+	p[0].convert(&v.field);
+	p[1].convert(&v.op);
+	p[2].convert(&v.value);
+	p[3].convert(&v.timestamp);
+	p[4].convert(&v.json_key);
+	p[5].convert(&v.json_value);
+
+	return v;
+}
+
+template <typename Stream>
+inline msgpack::packer<Stream> &operator <<(msgpack::packer<Stream> &o,
+                                            const ioremap::elliptics::dnet_iterator_condition &v) {
+	o.pack_array(6);
+	o.pack(v.field);
+	o.pack(v.op);
+	o.pack(v.value);
+	o.pack(v.timestamp);
+	o.pack(v.json_key);
+	o.pack(v.json_value);
+
+	return o;
+}
+
 inline ioremap::elliptics::dnet_iterator_request &operator >>(msgpack::object o,
                                                               ioremap::elliptics::dnet_iterator_request &v) {
 	if (o.type != msgpack::type::ARRAY || o.via.array.size < 8)
@@ -322,13 +352,20 @@ inline ioremap::elliptics::dnet_iterator_request &operator >>(msgpack::object o,
 	p[6].convert(&std::get<1>(v.time_range));
 	p[7].convert(&v.groups);
 
+	if (o.via.array.size > 8) {
+		p[8].convert(&v.predicate);
+	} else {
+		// for older protocol
+		v.predicate.clear();
+	}
+
 	return v;
 }
 
 template <typename Stream>
 inline msgpack::packer<Stream> &operator <<(msgpack::packer<Stream> &o,
                                             const ioremap::elliptics::dnet_iterator_request &v) {
-	o.pack_array(8);
+	o.pack_array(9);
 	o.pack(v.iterator_id);
 	o.pack(v.action);
 	o.pack(v.type);
@@ -337,6 +374,7 @@ inline msgpack::packer<Stream> &operator <<(msgpack::packer<Stream> &o,
 	o.pack(std::get<0>(v.time_range));
 	o.pack(std::get<1>(v.time_range));
 	o.pack(v.groups);
+	o.pack(v.predicate);
 
 	return o;
 }
@@ -371,13 +409,19 @@ inline ioremap::elliptics::dnet_iterator_response &operator >>(msgpack::object o
 		v.blob_id = 0;
 	}
 
+	if (o.via.array.size > 16) {
+		p[16].convert(&v.filtered_keys);
+	} else {
+		v.filtered_keys = 0;
+	}
+
 	return v;
 }
 
 template <typename Stream>
 inline msgpack::packer<Stream> &operator <<(msgpack::packer<Stream> &o,
                                             const ioremap::elliptics::dnet_iterator_response &v) {
-	o.pack_array(16);
+	o.pack_array(17);
 	o.pack(v.iterator_id);
 	o.pack(v.key);
 	o.pack(v.status);
@@ -394,6 +438,7 @@ inline msgpack::packer<Stream> &operator <<(msgpack::packer<Stream> &o,
 	o.pack(v.read_data_size);
 	o.pack(v.data_offset);
 	o.pack(v.blob_id);
+	o.pack(v.filtered_keys);
 
 	return o;
 }
@@ -469,7 +514,8 @@ dnet_iterator_request::dnet_iterator_request()
 	, flags{0}
 	, key_ranges{}
 	, time_range{dnet_time{0, 0}, dnet_time{0, 0}}
-	, groups{} {
+	, groups{}
+	, predicate{} {
 }
 
 dnet_iterator_request::dnet_iterator_request(uint32_t type, uint64_t flags,
@@ -481,7 +527,8 @@ dnet_iterator_request::dnet_iterator_request(uint32_t type, uint64_t flags,
 	, flags{flags}
 	, key_ranges{key_ranges}
 	, time_range(time_range)
-	, groups{} {
+	, groups{}
+	, predicate{} {
 }
 
 
@@ -514,6 +561,169 @@ void validate_json(const std::string &json) {
 	}
 }
 
+namespace {
+
+/*
+ * Sequential reader of msgpack stream which can skip values without unpacking them
+ */
+class msgpack_walker {
+public:
+	msgpack_walker(const data_pointer &data)
+	: m_pos(data.data<unsigned char>())
+	, m_end(m_pos + data.size()) {}
+
+	// reads header of array and its @size
+	bool read_array(uint64_t &size) {
+		if (m_pos >= m_end)
+			return false;
+
+		const unsigned char tag = *m_pos++;
+		if (tag >= 0x90 && tag <= 0x9f) {
+			size = tag & 0x0f;
+			return true;
+		}
+		if (tag == 0xdc)
+			return read_be(2, size);
+		if (tag == 0xdd)
+			return read_be(4, size);
+		return false;
+	}
+
+	// reads positive integer of any width
+	bool read_uint(uint64_t &value) {
+		if (m_pos >= m_end)
+			return false;
+
+		const unsigned char tag = *m_pos++;
+		if (tag <= 0x7f) {
+			value = tag;
+			return true;
+		}
+		if (tag >= 0xcc && tag <= 0xcf)
+			return read_be(1 << (tag - 0xcc), value);
+		return false;
+	}
+
+	// skips next value including all values nested into it
+	bool skip() {
+		uint64_t pending = 1, size;
+		while (pending) {
+			--pending;
+			if (m_pos >= m_end)
+				return false;
+
+			const unsigned char tag = *m_pos++;
+			if (tag <= 0x7f || tag >= 0xe0 || tag == 0xc0 || tag == 0xc2 || tag == 0xc3) {
+				// fixint, nil, bool
+			} else if (tag <= 0x8f) {
+				pending += 2 * (tag & 0x0f);
+			} else if (tag <= 0x9f) {
+				pending += tag & 0x0f;
+			} else if (tag <= 0xbf) {
+				if (!advance(tag & 0x1f))
+					return false;
+			} else if (tag == 0xc4 || tag == 0xc5 || tag == 0xc6) {
+				// bin 8/16/32
+				if (!read_be(1 << (tag - 0xc4), size) || !advance(size))
+					return false;
+			} else if (tag == 0xd9 || tag == 0xda || tag == 0xdb) {
+				// str 8/16/32
+				if (!read_be(1 << (tag - 0xd9), size) || !advance(size))
+					return false;
+			} else if (tag == 0xc7 || tag == 0xc8 || tag == 0xc9) {
+				// ext 8/16/32: size, type and data
+				if (!read_be(1 << (tag - 0xc7), size) || !advance(size + 1))
+					return false;
+			} else if (tag == 0xca || tag == 0xcb) {
+				// float 32/64
+				if (!advance(tag == 0xca ? 4 : 8))
+					return false;
+			} else if (tag >= 0xcc && tag <= 0xd3) {
+				// uint and int 8/16/32/64
+				if (!advance(1 << ((tag - 0xcc) % 4)))
+					return false;
+			} else if (tag >= 0xd4 && tag <= 0xd8) {
+				// fixext 1/2/4/8/16: type and data
+				if (!advance(1 + (1 << (tag - 0xd4))))
+					return false;
+			} else if (tag == 0xdc || tag == 0xdd) {
+				if (!read_be(tag == 0xdc ? 2 : 4, size))
+					return false;
+				pending += size;
+			} else if (tag == 0xde || tag == 0xdf) {
+				if (!read_be(tag == 0xde ? 2 : 4, size))
+					return false;
+				pending += 2 * size;
+			} else {
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	bool read_be(size_t bytes, uint64_t &value) {
+		if (static_cast<size_t>(m_end - m_pos) < bytes)
+			return false;
+
+		value = 0;
+		for (size_t i = 0; i < bytes; ++i)
+			value = (value << 8) | *m_pos++;
+		return true;
+	}
+
+	bool advance(uint64_t bytes) {
+		if (static_cast<uint64_t>(m_end - m_pos) < bytes)
+			return false;
+
+		m_pos += bytes;
+		return true;
+	}
+
+	const unsigned char *m_pos;
+	const unsigned char *m_end;
+};
+
+} /* namespace */
+
+dnet_time deserialize_deadline(int cmd, const data_pointer &data) {
+	dnet_time deadline;
+	dnet_empty_time(&deadline);
+
+	// position of the deadline in the array packed by operator << of the request
+	size_t index;
+	switch (cmd) {
+	case DNET_CMD_READ_NEW:
+		index = 4;
+		break;
+	case DNET_CMD_WRITE_NEW:
+		index = 11;
+		break;
+	case DNET_CMD_BULK_READ_NEW:
+		index = 3;
+		break;
+	default:
+		return deadline;
+	}
+
+	msgpack_walker walker(data);
+	uint64_t size, tsec, tnsec;
+	// older protocol may have no deadline
+	if (!walker.read_array(size) || size <= index)
+		return deadline;
+
+	for (size_t i = 0; i < index; ++i) {
+		if (!walker.skip())
+			return deadline;
+	}
+
+	if (walker.read_array(size) && size == 2 && walker.read_uint(tsec) && walker.read_uint(tnsec)) {
+		deadline.tsec = tsec;
+		deadline.tnsec = tnsec;
+	}
+	return deadline;
+}
+
 #define DEFINE_HEADER(TYPE) \
 template data_pointer serialize<TYPE>(const TYPE &); \
 template void deserialize(const data_pointer &data, TYPE &value, size_t &offset);
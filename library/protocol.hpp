@@ -93,6 +93,20 @@ struct dnet_bulk_read_request {
 	dnet_time deadline;
 };
 
+/*
+ * Condition of server-side iterator predicate, see dnet_iterator_predicate_fields and dnet_iterator_predicate_ops.
+ * Integer fields are compared with @value, timestamp fields are compared with @timestamp.
+ * DNET_IPRED_FIELD_JSON compares top-level member @json_key of record's json with @json_value.
+ */
+struct dnet_iterator_condition {
+	uint32_t field;
+	uint32_t op;
+	uint64_t value;
+	dnet_time timestamp;
+	std::string json_key;
+	std::string json_value;
+};
+
 struct dnet_iterator_request {
 	dnet_iterator_request();
 	dnet_iterator_request(uint32_t type, uint64_t flags,
@@ -106,6 +120,7 @@ struct dnet_iterator_request {
 	std::vector<dnet_iterator_range> key_ranges;
 	std::tuple<dnet_time, dnet_time> time_range;
 	std::vector<uint32_t> groups;
+	std::vector<dnet_iterator_condition> predicate;
 };
 
 struct dnet_iterator_response {
@@ -129,6 +144,8 @@ struct dnet_iterator_response {
 	uint64_t read_data_size;
 	uint64_t data_offset;
 	uint64_t blob_id;
+
+	uint64_t filtered_keys;
 };
 
 struct dnet_server_send_request {
@@ -152,6 +169,13 @@ void deserialize(const data_pointer &data, T &value) {
 
 void validate_json(const std::string &json);
 
+/*
+ * Returns client's deadline of request of @cmd (DNET_CMD_READ_NEW, DNET_CMD_WRITE_NEW or DNET_CMD_BULK_READ_NEW)
+ * packed at the beginning of @data. Only the deadline is read, other fields are skipped without unpacking,
+ * so it is cheap enough for the network thread. Returns empty time if the request has no deadline or is malformed.
+ */
+dnet_time deserialize_deadline(int cmd, const data_pointer &data);
+
 }} // namespace ioremap::elliptics
 
 #endif // ELLIPTICS_PROTOCOL_HPP
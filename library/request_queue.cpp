@@ -1,5 +1,7 @@
 #include "request_queue.h"
 
+#include <algorithm>
+
 #include <blackhole/attribute.hpp>
 
 #include "murmurhash.h"
@@ -7,6 +9,7 @@
 #include "example/config.hpp"
 #include "logger.hpp"
 #include "library/backend.h"
+#include "library/protocol.hpp"
 
 static size_t dnet_id_hash(const dnet_id &key) {
 	return MurmurHash64A(reinterpret_cast<const char *>(&key), sizeof(key.id) + sizeof(key.group_id), 0);
@@ -16,10 +19,148 @@ static bool dnet_id_equal(const dnet_id &lhs, const dnet_id &rhs) {
 	return !dnet_id_cmp(&lhs, &rhs);
 }
 
+/*
+ * Time spent by the current thread waiting in lock_key(), it is taken by dnet_oplock_take_wait_time()
+ */
+static thread_local uint64_t oplock_wait_time = 0;
+
+/*
+ * Returns priority class of the request: explicitly set by client or derived from the command
+ */
+static int dnet_io_req_priority(const dnet_io_req *req) {
+	auto cmd = static_cast<const dnet_cmd *>(req->header);
+
+	if (cmd->flags & DNET_FLAGS_PRIO_RECOVERY)
+		return DNET_IO_PRIO_RECOVERY;
+	if (cmd->flags & DNET_FLAGS_PRIO_ITERATOR)
+		return DNET_IO_PRIO_ITERATOR;
+	if (cmd->flags & DNET_FLAGS_REPLY)
+		return DNET_IO_PRIO_CLIENT;
+
+	switch (cmd->cmd) {
+	case DNET_CMD_ITERATOR:
+	case DNET_CMD_ITERATOR_NEW:
+		return DNET_IO_PRIO_ITERATOR;
+	case DNET_CMD_SEND:
+	case DNET_CMD_SEND_NEW:
+		return DNET_IO_PRIO_RECOVERY;
+	default:
+		return DNET_IO_PRIO_CLIENT;
+	}
+}
+
+static void dnet_io_req_mark_locked(dnet_io_req *req) {
+	if (!req->lock_start_ts.tv_sec && !req->lock_start_ts.tv_nsec)
+		clock_gettime(CLOCK_MONOTONIC_RAW, &req->lock_start_ts);
+}
+
+static timespec dnet_timespec_add(const timespec &ts, uint64_t nsecs) {
+	static const uint64_t second = 1000000000;
+
+	const uint64_t sum = ts.tv_nsec + nsecs;
+	return timespec{static_cast<time_t>(ts.tv_sec + sum / second), static_cast<long>(sum % second)};
+}
+
+static bool dnet_timespec_empty(const timespec &ts) {
+	return !ts.tv_sec && !ts.tv_nsec;
+}
+
+static bool dnet_timespec_before(const timespec &lhs, const timespec &rhs) {
+	return lhs.tv_sec < rhs.tv_sec || (lhs.tv_sec == rhs.tv_sec && lhs.tv_nsec < rhs.tv_nsec);
+}
+
+/*
+ * Returns deadline set by client in the request, empty time if it isn't set or the command doesn't support it.
+ * It is called on the network thread, so only the deadline is read from the request, malformed request
+ * will be rejected by the command itself, it just has no deadline here.
+ */
+static dnet_time dnet_io_req_client_deadline(const dnet_io_req *req) {
+	using namespace ioremap::elliptics;
+
+	auto cmd = static_cast<const dnet_cmd *>(req->header);
+	return deserialize_deadline(cmd->cmd, data_pointer::from_raw(req->data, req->dsize));
+}
+
+/*
+ * Returns deadline of the request: the earliest of client's deadline and the end of queue timeout,
+ * empty time if the request has neither of them. Should be called after @queue_start_ts is set.
+ */
+static timespec dnet_io_req_deadline(const dnet_io_req *req) {
+	auto cmd = static_cast<const dnet_cmd *>(req->header);
+	timespec deadline{0, 0};
+
+	// replies and commands with DNET_FLAGS_NO_QUEUE_TIMEOUT are never dropped
+	if (cmd->flags & (DNET_FLAGS_NO_QUEUE_TIMEOUT | DNET_FLAGS_REPLY))
+		return deadline;
+
+	auto node = req->st->n;
+	const uint64_t timeout = (cmd->backend_id < 0) ? dnet_node_get_queue_timeout(node)
+	                                               : dnet_backend_get_queue_timeout(node, cmd->backend_id);
+	if (timeout)
+		deadline = dnet_timespec_add(req->queue_start_ts, timeout * 1000);
+
+	auto client_deadline = dnet_io_req_client_deadline(req);
+	if (dnet_time_is_empty(&client_deadline))
+		return deadline;
+
+	// client's deadline is wall-clock time, convert it to the clock of the queue
+	dnet_time current;
+	dnet_current_time(&current);
+
+	timespec ts = req->queue_start_ts;
+	if (dnet_time_before(&current, &client_deadline)) {
+		const uint64_t left = (client_deadline.tsec - current.tsec) * 1000000000 +
+		                      client_deadline.tnsec - current.tnsec;
+		ts = dnet_timespec_add(ts, left);
+	}
+
+	if (dnet_timespec_empty(deadline) || dnet_timespec_before(ts, deadline))
+		deadline = ts;
+	return deadline;
+}
+
+/*
+ * Inserts @req into @queue ordered by deadlines, requests without deadline are kept at the tail in order of arrival
+ */
+static void dnet_io_req_insert_by_deadline(dnet_io_req *req, struct list_head *queue) {
+	if (dnet_timespec_empty(req->deadline_ts)) {
+		list_add_tail(&req->req_entry, queue);
+		return;
+	}
+
+	// deadlines mostly grow with arrival, so look for the place from the tail
+	dnet_io_req *it;
+	list_for_each_entry_reverse(it, queue, req_entry) {
+		if (!dnet_timespec_empty(it->deadline_ts) && !dnet_timespec_before(req->deadline_ts, it->deadline_ts))
+			break;
+	}
+	// @it is either the last request with earlier or equal deadline or the head of @queue
+	list_add(&req->req_entry, &it->req_entry);
+}
+
 dnet_request_queue::dnet_request_queue()
-: m_queue_size(0)
+: m_vtime(0)
+, m_queue_size(0)
+, m_queue_bytes(0)
+, m_edf(false)
+, m_dropped(0)
+, m_late(0)
 , m_locked_keys(1, &dnet_id_hash, &dnet_id_equal) {
-	INIT_LIST_HEAD(&m_queue);
+	const uint32_t weights[DNET_IO_PRIO_MAX] = {
+		DNET_IO_PRIO_CLIENT_WEIGHT,
+		DNET_IO_PRIO_ITERATOR_WEIGHT,
+		DNET_IO_PRIO_RECOVERY_WEIGHT,
+	};
+
+	for (int i = 0; i < DNET_IO_PRIO_MAX; ++i) {
+		auto &cls = m_classes[i];
+		INIT_LIST_HEAD(&cls.queue);
+		cls.weight = weights[i];
+		cls.vtime = 0;
+		cls.size = 0;
+		cls.dequeued = 0;
+		cls.wait_time = 0;
+	}
 }
 
 dnet_request_queue::~dnet_request_queue()
@@ -29,9 +170,11 @@ dnet_request_queue::~dnet_request_queue()
 	}
 
 	struct dnet_io_req *r, *tmp;
-	list_for_each_entry_safe(r, tmp, &m_queue, req_entry) {
-		list_del(&r->req_entry);
-		dnet_io_req_free(r);
+	for (auto &cls : m_classes) {
+		list_for_each_entry_safe(r, tmp, &cls.queue, req_entry) {
+			list_del(&r->req_entry);
+			dnet_io_req_free(r);
+		}
 	}
 }
 
@@ -39,37 +182,71 @@ void dnet_request_queue::push_request(dnet_io_req *req)
 {
 	clock_gettime(CLOCK_MONOTONIC_RAW, &req->queue_start_ts);
 
+	const bool edf = m_edf;
+	if (edf)
+		req->deadline_ts = dnet_io_req_deadline(req);
+
 	{
 		std::unique_lock<std::mutex> lock(m_queue_mutex);
-		list_add_tail(&req->req_entry, &m_queue);
+		auto &cls = m_classes[dnet_io_req_priority(req)];
+		/* idle class doesn't accumulate credit: it competes from the current virtual time */
+		if (list_empty(&cls.queue))
+			cls.vtime = std::max(cls.vtime, m_vtime);
+		if (edf)
+			dnet_io_req_insert_by_deadline(req, &cls.queue);
+		else
+			list_add_tail(&req->req_entry, &cls.queue);
+		++cls.size;
 		++m_queue_size;
+		m_queue_bytes += req->dsize;
 	}
 	m_queue_wait.notify_one();
 }
 
 dnet_io_req *dnet_request_queue::pop_request(dnet_work_io *wio, const char *thread_stat_id)
 {
+	LIST_HEAD(evicted);
+
 	auto r = [&]() {
 		std::unique_lock<std::mutex> lock(m_queue_mutex);
 
+		if (m_edf)
+			evict_expired(&evicted);
+
 		auto r = take_request(wio, thread_stat_id);
 		if (!r) {
 			m_queue_wait.wait_for(lock, std::chrono::seconds(1));
+			if (m_edf)
+				evict_expired(&evicted);
 			r = take_request(wio, thread_stat_id);
 		}
 
 		if (r) {
 			list_del_init(&r->req_entry);
 			--m_queue_size;
+			m_queue_bytes -= r->dsize;
 
 			timespec ts;
 			clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
 			r->queue_time = DIFF_TIMESPEC(r->queue_start_ts, ts);
+
+			auto &cls = m_classes[dnet_io_req_priority(r)];
+			--cls.size;
+			++cls.dequeued;
+			cls.wait_time += r->queue_time;
+			if (r->lock_start_ts.tv_sec || r->lock_start_ts.tv_nsec)
+				r->lock_time = DIFF_TIMESPEC(r->lock_start_ts, ts);
 		}
 
 		return r;
 	}();
 
+	dnet_io_req *evicted_req, *tmp;
+	list_for_each_entry_safe(evicted_req, tmp, &evicted, req_entry) {
+		list_del(&evicted_req->req_entry);
+		drop_expired(evicted_req, thread_stat_id);
+	}
+
 	if (!r)
 		return nullptr;
 
@@ -104,6 +281,7 @@ dnet_io_req *dnet_request_queue::pop_request(dnet_work_io *wio, const char *thre
 	if (!expired)
 		return r;
 
+	++m_dropped;
 	FORMATTED(HANDY_COUNTER_INCREMENT, ("pool.%s.queue.dropped", thread_stat_id), 1);
 	{
 		ioremap::elliptics::trace_scope trace_scope{cmd->trace_id, cmd->flags & DNET_FLAGS_TRACE_BIT};
@@ -114,8 +292,6 @@ dnet_io_req *dnet_request_queue::pop_request(dnet_work_io *wio, const char *thre
 		               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), dnet_state_dump_addr(r->st),
 		               cmd->trans, dnet_flags_dump_cflags(cmd->flags), r->queue_time, timeout, st->__need_exit);
 	}
-	pthread_cond_broadcast(&node->io->full_wait);
-
 	release_request(r);
 	dnet_io_req_free(r);
 	dnet_state_put(st);
@@ -127,8 +303,7 @@ dnet_io_req *dnet_request_queue::take_request(dnet_work_io *wio, const char *thr
 {
 	FORMATTED(HANDY_TIMER_SCOPE, ("pool.%s.search_trans_time", thread_stat_id));
 
-	dnet_work_pool *pool = wio->pool;
-	dnet_io_req *it, *tmp;
+	dnet_io_req *it;
 	uint64_t trans;
 
 	/*
@@ -167,9 +342,39 @@ dnet_io_req *dnet_request_queue::take_request(dnet_work_io *wio, const char *thr
 		return it;
 	}
 
+	/* look through priority classes in order of their virtual time, i.e. the most underserved class first */
+	priority_class *classes[DNET_IO_PRIO_MAX];
+	for (int i = 0; i < DNET_IO_PRIO_MAX; ++i) {
+		classes[i] = &m_classes[i];
+	}
+	std::stable_sort(classes, classes + DNET_IO_PRIO_MAX, [] (const priority_class *lhs, const priority_class *rhs) {
+		return lhs->vtime < rhs->vtime;
+	});
+
 	std::unique_lock<std::mutex> lock(m_locks_mutex);
 
-	list_for_each_entry_safe(it, tmp, &m_queue, req_entry) {
+	for (auto cls : classes) {
+		if (list_empty(&cls->queue))
+			continue;
+
+		it = take_request(wio, &cls->queue);
+		if (it) {
+			m_vtime = cls->vtime;
+			cls->vtime += 1.0 / cls->weight;
+			return it;
+		}
+	}
+
+	return nullptr;
+}
+
+dnet_io_req *dnet_request_queue::take_request(dnet_work_io *wio, struct list_head *queue)
+{
+	dnet_work_pool *pool = wio->pool;
+	dnet_io_req *it, *tmp;
+	uint64_t trans;
+
+	list_for_each_entry_safe(it, tmp, queue, req_entry) {
 		auto cmd = reinterpret_cast<const dnet_cmd *>(it->header);
 
 		/* This is not a transaction reply, process it right now */
@@ -186,6 +391,8 @@ dnet_io_req *dnet_request_queue::take_request(dnet_work_io *wio, const char *thr
 				it_lock->second = lock_entry;
 				return it;
 			} else {
+				dnet_io_req_mark_locked(it);
+
 				auto lock_entry = it_lock->second;
 				dnet_work_io *owner = lock_entry->owner;
 				/* if key is already locked by other pool thread, then move it to request_list of this thread */
@@ -216,6 +423,66 @@ dnet_io_req *dnet_request_queue::take_request(dnet_work_io *wio, const char *thr
 	return nullptr;
 }
 
+void dnet_request_queue::evict_expired(struct list_head *expired)
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+
+	for (auto &cls : m_classes) {
+		dnet_io_req *r, *tmp;
+		list_for_each_entry_safe(r, tmp, &cls.queue, req_entry) {
+			/* requests are ordered by deadlines and ones without deadline are at the tail,
+			 * so all expired requests are at the head */
+			if (dnet_timespec_empty(r->deadline_ts) || !dnet_timespec_before(r->deadline_ts, ts))
+				break;
+
+			list_move_tail(&r->req_entry, expired);
+			--cls.size;
+			--m_queue_size;
+			m_queue_bytes -= r->dsize;
+			r->queue_time = DIFF_TIMESPEC(r->queue_start_ts, ts);
+		}
+	}
+}
+
+void dnet_request_queue::drop_expired(dnet_io_req *req, const char *thread_stat_id)
+{
+	HANDY_COUNTER_DECREMENT("io.input.queue.size", 1);
+
+	FORMATTED(HANDY_COUNTER_DECREMENT, ("pool.%s.queue.size", thread_stat_id), 1);
+	FORMATTED(HANDY_TIMER_STOP, ("pool.%s.queue.wait_time", thread_stat_id), (uint64_t)req);
+	FORMATTED(HANDY_COUNTER_INCREMENT, ("pool.%s.queue.dropped", thread_stat_id), 1);
+	++m_dropped;
+
+	auto cmd = static_cast<dnet_cmd *>(req->header);
+	auto st = req->st;
+	{
+		ioremap::elliptics::trace_scope trace_scope{cmd->trace_id, cmd->flags & DNET_FLAGS_TRACE_BIT};
+		ioremap::elliptics::backend_scope backend_scope{cmd->backend_id};
+
+		DNET_LOG_ERROR(st->n, "{}: {}: client: {}: evict expired request: trans: {}, cflags: {}, "
+		                      "queue_time: {} usecs",
+		               dnet_dump_id(&cmd->id), dnet_cmd_string(cmd->cmd), dnet_state_dump_addr(st),
+		               cmd->trans, dnet_flags_dump_cflags(cmd->flags), req->queue_time);
+	}
+
+	/* evicted request has never been taken, so its key isn't locked */
+	dnet_io_req_free(req);
+	dnet_state_put(st);
+}
+
+void dnet_request_queue::complete_request(const dnet_io_req *req)
+{
+	if (!dnet_timespec_empty(req->deadline_ts)) {
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+		if (dnet_timespec_before(req->deadline_ts, ts))
+			++m_late;
+	}
+
+	release_request(req);
+}
+
 void dnet_request_queue::release_request(const dnet_io_req *req)
 {
 	auto cmd = reinterpret_cast<const dnet_cmd *>(req->header);
@@ -227,17 +494,29 @@ void dnet_request_queue::release_request(const dnet_io_req *req)
 
 void dnet_request_queue::lock_key(const dnet_id *id)
 {
+	timespec start{0, 0};
+
 	std::unique_lock<std::mutex> lock(m_locks_mutex);
 	while (1) {
 		auto it = m_locked_keys.find(*id);
 		if (it == m_locked_keys.end())
 			break;
 
+		if (!start.tv_sec && !start.tv_nsec)
+			clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
 		auto lock_entry = it->second;
 		lock_entry->unlock_event.wait_for(lock, std::chrono::seconds(1));
 	}
 	auto lock_entry = take_lock_entry(nullptr);
 	m_locked_keys.emplace(*id, lock_entry);
+	lock.unlock();
+
+	if (start.tv_sec || start.tv_nsec) {
+		timespec end;
+		clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+		oplock_wait_time += DIFF_TIMESPEC(start, end);
+	}
 }
 
 void dnet_request_queue::unlock_key(const dnet_id *id)
@@ -288,6 +567,38 @@ size_t dnet_request_queue::size() const {
 	return m_queue_size;
 }
 
+size_t dnet_request_queue::bytes() const {
+	return m_queue_bytes;
+}
+
+void dnet_request_queue::set_weights(const uint32_t *weights) {
+	std::unique_lock<std::mutex> lock(m_queue_mutex);
+	for (int i = 0; i < DNET_IO_PRIO_MAX; ++i) {
+		m_classes[i].weight = std::max(weights[i], 1u);
+	}
+}
+
+void dnet_request_queue::set_edf(bool edf) {
+	m_edf = edf;
+}
+
+bool dnet_request_queue::edf() const {
+	return m_edf;
+}
+
+uint64_t dnet_request_queue::dropped() const {
+	return m_dropped;
+}
+
+uint64_t dnet_request_queue::late() const {
+	return m_late;
+}
+
+dnet_request_queue::class_stats dnet_request_queue::get_class_stats(int priority) const {
+	const auto &cls = m_classes[priority];
+	return {cls.size, cls.dequeued, cls.wait_time};
+}
+
 void dnet_request_queue::notify_all() {
 	m_queue_wait.notify_all();
 }
@@ -330,7 +641,7 @@ struct dnet_io_req *dnet_pop_request(struct dnet_work_io *wio, const char *threa
 }
 
 void dnet_release_request(struct dnet_work_io *wio, const struct dnet_io_req *req) {
-	wio->pool->request_queue->release_request(req);
+	wio->pool->request_queue->complete_request(req);
 }
 
 void dnet_oplock(struct dnet_io_pool *pool, const struct dnet_id *id) {
@@ -341,10 +652,28 @@ void dnet_opunlock(struct dnet_io_pool *pool, const struct dnet_id *id) {
 	pool->recv_pool.pool->request_queue->unlock_key(id);
 }
 
+uint64_t dnet_oplock_take_wait_time() {
+	const uint64_t time = oplock_wait_time;
+	oplock_wait_time = 0;
+	return time;
+}
+
 size_t dnet_get_pool_queue_size(struct dnet_work_pool *pool) {
 	return pool->request_queue->size();
 }
 
+size_t dnet_get_pool_queue_bytes(struct dnet_work_pool *pool) {
+	return pool->request_queue->bytes();
+}
+
+void dnet_set_pool_priority_weights(struct dnet_work_pool *pool, const uint32_t *weights) {
+	pool->request_queue->set_weights(weights);
+}
+
+void dnet_set_pool_edf(struct dnet_work_pool *pool, int edf) {
+	pool->request_queue->set_edf(edf);
+}
+
 void *dnet_request_queue_create() {
 	return new(std::nothrow) dnet_request_queue();
 }
@@ -20,6 +20,10 @@ struct dnet_locks_entry
 /*
  * dnet_request_queue is queue of requests with specific key locking semantics: its pop_request()
  * lookups first request with non-locked key in queue, locks this key and returns the request.
+ * Requests are split into priority classes (see dnet_io_priority) which share the queue by weighted fair
+ * queueing: while all classes are backlogged, they are served in proportion of their weights.
+ * Optionally requests of each class are ordered by their deadlines (earliest deadline first) instead of arrival,
+ * in this mode expired requests are evicted from the queue before they are taken by pool threads.
  * Also it provides methods for specific key lock/unlock mechanism and provides internal statistics.
  */
 class dnet_request_queue
@@ -46,6 +50,10 @@ public:
 	 * Releases request's /a req key from /a m_locked_keys
 	 */
 	void release_request(const dnet_io_req *req);
+	/*!
+	 * Accounts request \a req processed by pool thread and releases its key
+	 */
+	void complete_request(const dnet_io_req *req);
 
 	/*!
 	 * Saves key identified by /a id into /a m_locked_keys or waits until key will be unlocked (by calling release_request() or unlock_key())
@@ -61,17 +69,65 @@ public:
 	 * Returns size of the queue
 	 */
 	size_t size() const;
+	/*!
+	 * Returns total size of payloads of requests in the queue
+	 */
+	size_t bytes() const;
 
 	/*!
 	 * Notify all waiters (threads)
 	 */
 	void notify_all();
 
+	/*!
+	 * Sets weights of priority classes, \a weights should contain DNET_IO_PRIO_MAX values
+	 */
+	void set_weights(const uint32_t *weights);
+	/*!
+	 * Enables or disables earliest deadline first ordering of requests
+	 */
+	void set_edf(bool edf);
+	bool edf() const;
+
+	/*!
+	 * Returns number of requests dropped from the queue because of expired deadline or queue timeout
+	 */
+	uint64_t dropped() const;
+	/*!
+	 * Returns number of requests which were processed but completed after their deadlines
+	 */
+	uint64_t late() const;
+
+	struct class_stats {
+		// number of requests of the class in the queue
+		size_t size;
+		// number of requests of the class taken from the queue and total time they have spent in it
+		uint64_t dequeued;
+		uint64_t wait_time;
+	};
+
+	/*!
+	 * Returns statistics of priority class \a priority
+	 */
+	class_stats get_class_stats(int priority) const;
+
 private:
 	/*
 	 * Returns first available request with non-locked key from /a m_queue and saves request's key into /a m_locked_keys
 	 */
 	dnet_io_req *take_request(dnet_work_io *wio, const char *thread_stat_id);
+	/*
+	 * Returns first available request from \a queue of one priority class
+	 */
+	dnet_io_req *take_request(dnet_work_io *wio, struct list_head *queue);
+	/*
+	 * Moves requests with expired deadlines from all priority classes to \a expired
+	 */
+	void evict_expired(struct list_head *expired);
+	/*
+	 * Accounts and frees request \a req evicted from the queue by evict_expired()
+	 */
+	void drop_expired(dnet_io_req *req, const char *thread_stat_id);
 	/*!
 	 * Removes key identified by /a id from /a m_locked_keys
 	 */
@@ -86,11 +142,29 @@ private:
 	void put_lock_entry(dnet_locks_entry *entry);
 
 private:
-	struct list_head m_queue;
+	struct priority_class {
+		struct list_head queue;
+		uint32_t weight;
+		// virtual finish time of the last taken request of the class
+		double vtime;
+
+		std::atomic_size_t size;
+		std::atomic<uint64_t> dequeued;
+		std::atomic<uint64_t> wait_time;
+	};
+
+	priority_class m_classes[DNET_IO_PRIO_MAX];
+	// virtual time of the queue: start time of the last taken request
+	double m_vtime;
 	std::mutex m_queue_mutex;
 	std::condition_variable m_queue_wait;
 
 	std::atomic_size_t m_queue_size;
+	std::atomic_size_t m_queue_bytes;
+
+	std::atomic_bool m_edf;
+	std::atomic<uint64_t> m_dropped;
+	std::atomic<uint64_t> m_late;
 
 	typedef std::unordered_map<dnet_id, dnet_locks_entry *, size_t(*)(const dnet_id&), bool(*)(const dnet_id&, const dnet_id&)> locked_keys_t;
 	locked_keys_t m_locked_keys;
@@ -124,9 +198,16 @@ struct dnet_io_req *dnet_pop_request(struct dnet_work_io *wio, const char *threa
 void dnet_release_request(struct dnet_work_io *wio, const struct dnet_io_req *req);
 
 size_t dnet_get_pool_queue_size(struct dnet_work_pool *pool);
+size_t dnet_get_pool_queue_bytes(struct dnet_work_pool *pool);
+/* Sets weights of priority classes of @pool's queue, @weights should contain DNET_IO_PRIO_MAX values */
+void dnet_set_pool_priority_weights(struct dnet_work_pool *pool, const uint32_t *weights);
+/* Enables earliest deadline first ordering of @pool's queue if @edf is not zero */
+void dnet_set_pool_edf(struct dnet_work_pool *pool, int edf);
 
 void dnet_oplock(struct dnet_io_pool *pool, const struct dnet_id *id);
 void dnet_opunlock(struct dnet_io_pool *pool, const struct dnet_id *id);
+/* Returns time in usecs the current thread has waited in dnet_oplock() since previous call */
+uint64_t dnet_oplock_take_wait_time(void);
 
 #ifdef __cplusplus
 } // extern "C"
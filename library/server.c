@@ -101,12 +101,10 @@ struct dnet_node *dnet_server_node_create(struct dnet_config_data *cfg_data)
 	sigaddset(&sigset, SIGQUIT);
 	pthread_sigmask(SIG_BLOCK, &sigset, &previous_sigset);
 
-	n = dnet_node_create(cfg);
+	n = dnet_node_create_with_config_data(cfg_data);
 	if (!n)
 		goto err_out_exit;
 
-	n->config_data = cfg_data;
-
 	err = dnet_backends_init(n);
 	if (err)
 		goto err_out_node_destroy;
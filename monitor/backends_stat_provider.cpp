@@ -44,7 +44,8 @@ backends_stat_provider::backends_stat_provider(struct dnet_node *node)
 void backends_stat_provider::statistics(const request &request,
                                         rapidjson::Value &value,
                                         rapidjson::Document::AllocatorType &allocator) const {
-	if (!(request.categories & (DNET_MONITOR_IO | DNET_MONITOR_CACHE | DNET_MONITOR_BACKEND)))
+	if (!(request.categories & (DNET_MONITOR_IO | DNET_MONITOR_CACHE | DNET_MONITOR_BACKEND |
+	                            DNET_MONITOR_SLOW_REQUESTS)))
 		return;
 
 	m_node->io->backends_manager->statistics(request, value, allocator);
@@ -57,9 +58,11 @@ void dnet_backend_command_stats_update(struct dnet_backend *backend,
                                        uint64_t size,
                                        int handled_in_cache,
                                        int err,
-                                       long diff) {
+                                       long diff,
+                                       long queue_time) {
 	if (!backend)
 		return;
 
-	backend->command_stats().command_counter(cmd->cmd, cmd->trans, err, handled_in_cache, size, diff);
+	backend->command_stats().command_counter(cmd->cmd, cmd->trans, err, handled_in_cache, size, diff,
+	                                         queue_time);
 }
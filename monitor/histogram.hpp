@@ -0,0 +1,170 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DNET_MONITOR_HISTOGRAM_HPP
+#define __DNET_MONITOR_HISTOGRAM_HPP
+
+#include <atomic>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace ioremap { namespace monitor {
+
+/*!
+ * \internal
+ *
+ * Layout of log-linear (HDR-style) latency histogram.
+ * Values below 2^sub_bucket_bits have their own buckets, every next power of two is split
+ * into 2^sub_bucket_bits equal buckets, so width of a bucket never exceeds 1/8 of its lower bound.
+ * Values are measured in microseconds, everything above 2^max_exponent usecs (~19 hours)
+ * falls into the last bucket.
+ */
+struct histogram_layout {
+	static const int sub_bucket_bits = 3;
+	static const uint64_t sub_bucket_count = 1 << sub_bucket_bits;
+	static const int max_exponent = 36;
+	static const size_t bucket_count = (max_exponent - sub_bucket_bits + 1) * sub_bucket_count;
+
+	static size_t bucket_index(uint64_t value) {
+		if (value < sub_bucket_count)
+			return value;
+
+		const uint64_t max_value = (1ULL << max_exponent) - 1;
+		if (value > max_value)
+			value = max_value;
+
+		const int exponent = 63 - __builtin_clzll(value);
+		const int shift = exponent - sub_bucket_bits;
+		const uint64_t sub_bucket = (value >> shift) & (sub_bucket_count - 1);
+		return (shift + 1) * sub_bucket_count + sub_bucket;
+	}
+
+	/*!
+	 * Returns the highest value which falls into bucket \a index
+	 */
+	static uint64_t bucket_upper_bound(size_t index) {
+		if (index < sub_bucket_count)
+			return index;
+
+		const int shift = index / sub_bucket_count - 1;
+		const uint64_t sub_bucket = index % sub_bucket_count;
+		return ((sub_bucket_count + sub_bucket + 1) << shift) - 1;
+	}
+};
+
+/*!
+ * \internal
+ *
+ * Plain copy of latency histogram used for merging shards and calculating percentiles.
+ */
+class histogram_snapshot {
+public:
+	histogram_snapshot() : m_count(0), m_max(0) {
+		m_buckets.fill(0);
+	}
+
+	uint64_t count() const { return m_count; }
+	uint64_t max() const { return m_max; }
+	bool has_data() const { return m_count != 0; }
+
+	void add(size_t index, uint64_t count) {
+		m_buckets[index] += count;
+		m_count += count;
+	}
+
+	void update_max(uint64_t value) {
+		if (value > m_max)
+			m_max = value;
+	}
+
+	/*!
+	 * Returns value which is not less than \a percentile percents of recorded values,
+	 * \a percentile should be within [0, 100].
+	 */
+	uint64_t percentile(double percentile) const {
+		if (!m_count)
+			return 0;
+
+		uint64_t target = std::ceil(percentile / 100. * m_count);
+		if (target == 0)
+			target = 1;
+
+		uint64_t seen = 0;
+		for (size_t i = 0; i < m_buckets.size(); ++i) {
+			seen += m_buckets[i];
+			if (seen >= target) {
+				const uint64_t value = histogram_layout::bucket_upper_bound(i);
+				return value < m_max ? value : m_max;
+			}
+		}
+		return m_max;
+	}
+
+private:
+	std::array<uint64_t, histogram_layout::bucket_count> m_buckets;
+	uint64_t m_count;
+	uint64_t m_max;
+};
+
+/*!
+ * \internal
+ *
+ * Log-linear latency histogram which can be updated simultaneously from several threads without locks.
+ * It is meant to be used as a shard touched mostly by a single thread, so relaxed atomics are enough
+ * and readers may see slightly inconsistent but never torn values.
+ */
+class latency_histogram {
+public:
+	latency_histogram() {
+		clear();
+	}
+
+	void clear() {
+		for (auto &bucket : m_buckets)
+			bucket.store(0, std::memory_order_relaxed);
+		m_max.store(0, std::memory_order_relaxed);
+	}
+
+	void record(uint64_t value) {
+		m_buckets[histogram_layout::bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t max = m_max.load(std::memory_order_relaxed);
+		while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+		}
+	}
+
+	/*!
+	 * Adds content of the histogram to \a snapshot
+	 */
+	void merge_to(histogram_snapshot &snapshot) const {
+		for (size_t i = 0; i < m_buckets.size(); ++i) {
+			const uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+			if (count)
+				snapshot.add(i, count);
+		}
+		snapshot.update_max(m_max.load(std::memory_order_relaxed));
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, histogram_layout::bucket_count> m_buckets;
+	std::atomic<uint64_t> m_max;
+};
+
+}} /* namespace ioremap::monitor */
+
+#endif /* __DNET_MONITOR_HISTOGRAM_HPP */
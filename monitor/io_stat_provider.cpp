@@ -60,22 +60,52 @@ void io_stat_provider::statistics(const request &request,
 
 	rapidjson::Value states(rapidjson::kObjectType);
 	value.AddMember("states", fill_states_stats(m_node, states, allocator), allocator);
-	value.AddMember("blocked", m_node->io->blocked == 1, allocator);
+	value.AddMember("rejected", atomic_read(&m_node->io->queue_rejected), allocator);
 
 	rapidjson::Value pools(rapidjson::kObjectType);
 	dnet_io_pools_fill_stats(m_node, pools, allocator);
 	value.AddMember("pools", pools, allocator);
 }
 
+// fill @value with statistics of every priority class of @pool's queue
+static void dump_priorities_stats(struct dnet_work_pool *pool,
+                                  rapidjson::Value &value,
+                                  rapidjson::Document::AllocatorType &allocator) {
+	rapidjson::Value priorities(rapidjson::kObjectType);
+	for (int priority = 0; priority < DNET_IO_PRIO_MAX; ++priority) {
+		const auto stats = pool->request_queue->get_class_stats(priority);
+
+		rapidjson::Value priority_value(rapidjson::kObjectType);
+		priority_value.AddMember("current_size", stats.size, allocator);
+		priority_value.AddMember("dequeued", stats.dequeued, allocator);
+		priority_value.AddMember("wait_time", stats.wait_time, allocator);
+		priorities.AddMember(dnet_io_priority_string(priority), priority_value, allocator);
+	}
+	value.AddMember("priorities", priorities, allocator);
+}
+
+// fill @value with statistics of deadlines of requests in @pool's queue
+static void dump_deadlines_stats(struct dnet_work_pool *pool,
+                                 rapidjson::Value &value,
+                                 rapidjson::Document::AllocatorType &allocator) {
+	value.AddMember("order", pool->request_queue->edf() ? "edf" : "fifo", allocator);
+	value.AddMember("dropped", pool->request_queue->dropped(), allocator);
+	value.AddMember("late", pool->request_queue->late(), allocator);
+}
+
 void dump_io_pool_stats(struct dnet_io_pool &io_pool,
                         rapidjson::Value &value,
                         rapidjson::Document::AllocatorType &allocator) {
 	rapidjson::Value blocking(rapidjson::kObjectType);
 	blocking.AddMember("current_size", dnet_get_pool_queue_size(io_pool.recv_pool.pool), allocator);
+	dump_priorities_stats(io_pool.recv_pool.pool, blocking, allocator);
+	dump_deadlines_stats(io_pool.recv_pool.pool, blocking, allocator);
 	value.AddMember("blocking", blocking, allocator);
 
 	rapidjson::Value nonblocking(rapidjson::kObjectType);
 	nonblocking.AddMember("current_size", dnet_get_pool_queue_size(io_pool.recv_pool_nb.pool), allocator);
+	dump_priorities_stats(io_pool.recv_pool_nb.pool, nonblocking, allocator);
+	dump_deadlines_stats(io_pool.recv_pool_nb.pool, nonblocking, allocator);
 	value.AddMember("nonblocking", nonblocking, allocator);
 }
 
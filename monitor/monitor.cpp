@@ -30,6 +30,7 @@
 
 #include "library/elliptics.h"
 #include "library/logger.hpp"
+#include "library/access_context.h"
 #include "io_stat_provider.hpp"
 #include "backends_stat_provider.hpp"
 #include "procfs_provider.hpp"
@@ -55,6 +56,32 @@ monitor_config* get_monitor_config(struct dnet_node *n) {
 	return dnet_node_get_config_data(n)->monitor_config.get();
 }
 
+static const std::vector<double> &default_percentiles() {
+	static const std::vector<double> percentiles{50, 90, 99, 99.9};
+	return percentiles;
+}
+
+const std::vector<double> &get_monitor_percentiles(struct dnet_node *n) {
+	const auto monitor = get_monitor_config(n);
+	return monitor ? monitor->percentiles : default_percentiles();
+}
+
+std::shared_ptr<slow_requests> create_slow_requests(struct dnet_node *n) {
+	size_t length = DNET_DEFAULT_MONITOR_SLOW_REQUESTS_LENGTH;
+	int period = DNET_DEFAULT_MONITOR_SLOW_REQUESTS_PERIOD;
+
+	const auto monitor = get_monitor_config(n);
+	if (monitor) {
+		length = monitor->slow_requests_length;
+		period = monitor->slow_requests_period;
+	}
+
+	if (!length || period <= 0)
+		return nullptr;
+
+	return std::make_shared<slow_requests>(length, period);
+}
+
 std::unique_ptr<monitor_config> monitor_config::parse(const kora::config_t &monitor) {
 	std::unique_ptr<monitor_config> cfg{new monitor_config()};
 
@@ -69,6 +96,32 @@ std::unique_ptr<monitor_config> monitor_config::parse(const kora::config_t &moni
 		cfg->has_top = (cfg->top_length > 0) && (cfg->events_size > 0) && (cfg->period_in_seconds > 0);
 	}
 
+	cfg->slow_requests_length = DNET_DEFAULT_MONITOR_SLOW_REQUESTS_LENGTH;
+	cfg->slow_requests_period = DNET_DEFAULT_MONITOR_SLOW_REQUESTS_PERIOD;
+	if (monitor.has("slow_requests")) {
+		const auto slow_requests = monitor["slow_requests"];
+		cfg->slow_requests_length = slow_requests.at<size_t>("length", DNET_DEFAULT_MONITOR_SLOW_REQUESTS_LENGTH);
+		cfg->slow_requests_period = slow_requests.at<int>("period_in_seconds",
+		                                                  DNET_DEFAULT_MONITOR_SLOW_REQUESTS_PERIOD);
+	}
+
+	cfg->snapshot_max_age_ms = DNET_DEFAULT_MONITOR_SNAPSHOT_MAX_AGE_MS;
+	cfg->snapshot_history = DNET_DEFAULT_MONITOR_SNAPSHOT_HISTORY;
+	if (monitor.has("snapshots")) {
+		const auto snapshots = monitor["snapshots"];
+		cfg->snapshot_max_age_ms = snapshots.at<unsigned int>("max_age_ms",
+		                                                      DNET_DEFAULT_MONITOR_SNAPSHOT_MAX_AGE_MS);
+		cfg->snapshot_history = snapshots.at<size_t>("history", DNET_DEFAULT_MONITOR_SNAPSHOT_HISTORY);
+	}
+
+	cfg->percentiles = monitor.at("percentiles", default_percentiles());
+	for (const auto &percentile : cfg->percentiles) {
+		if (percentile < 0 || percentile > 100) {
+			throw ioremap::elliptics::config::config_error() << monitor["percentiles"].path()
+			                                                 << " must be within [0, 100]";
+		}
+	}
+
 	if (monitor.has("handystats"))
 		cfg->handystats = kora::to_json(monitor.underlying_object());
 	return cfg;
@@ -178,6 +231,25 @@ static void init_top_provider(struct dnet_node *n) {
 	}
 }
 
+static void init_slow_requests_provider(struct dnet_node *n) {
+	try {
+		const auto monitor = get_monitor(n);
+		if (!monitor)
+			return;
+
+		auto requests = monitor->get_statistics().get_slow_requests();
+		if (requests) {
+			add_provider(n, new slow_requests_provider(requests), "slow_requests");
+			DNET_LOG_INFO(n, "monitor: slow requests provider loaded: length: {}, period: {}",
+			              requests->length(), requests->period());
+		} else {
+			DNET_LOG_INFO(n, "monitor: slow requests provider is disabled");
+		}
+	} catch (const std::exception &e) {
+		DNET_LOG_ERROR(n, "monitor: failed to initialize slow_requests_provider: {}", e.what());
+	}
+}
+
 }} /* namespace ioremap::monitor */
 
 int dnet_monitor_init(struct dnet_node *n, struct dnet_config *cfg) {
@@ -199,6 +271,7 @@ int dnet_monitor_init(struct dnet_node *n, struct dnet_config *cfg) {
 	ioremap::monitor::init_backends_stat_provider(n);
 	ioremap::monitor::init_procfs_provider(n);
 	ioremap::monitor::init_top_provider(n);
+	ioremap::monitor::init_slow_requests_provider(n);
 
 	return 0;
 }
@@ -216,11 +289,13 @@ void dnet_monitor_stats_update(struct dnet_node *n,
                                const int err,
                                const int cache,
                                const uint32_t size,
-                               const unsigned long time) {
+                               const unsigned long time,
+                               const unsigned long queue_time) {
 	try {
 		auto real_monitor = ioremap::monitor::get_monitor(n);
 		if (real_monitor) {
-			real_monitor->get_statistics().command_counter(cmd->cmd, cmd->trans, err, cache, size, time);
+			real_monitor->get_statistics().command_counter(cmd->cmd, cmd->trans, err, cache, size, time,
+			                                               queue_time);
 			auto top_stats = real_monitor->get_statistics().get_top_stats();
 			if (top_stats) {
 				top_stats->update_stats(cmd, size);
@@ -231,6 +306,22 @@ void dnet_monitor_stats_update(struct dnet_node *n,
 	}
 }
 
+void dnet_monitor_trace_request(struct dnet_node *n, struct dnet_access_context *context) {
+	if (!context)
+		return;
+
+	auto real_monitor = ioremap::monitor::get_monitor(n);
+	if (!real_monitor)
+		return;
+
+	auto slow_requests = real_monitor->get_statistics().get_slow_requests();
+	if (slow_requests) {
+		context->set_tracer([slow_requests] (const ioremap::monitor::request_trace &trace) {
+			slow_requests->add(trace);
+		});
+	}
+}
+
 int dnet_monitor_process_cmd(struct dnet_net_state *orig, struct dnet_cmd *cmd, void *data) {
 	if (cmd->size < sizeof(dnet_monitor_stat_request)) {
 		DNET_LOG_DEBUG(orig->n, "monitor: {}: {}: process MONITOR_STAT, invalid size: {}, expected: >= {}",
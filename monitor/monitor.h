@@ -29,6 +29,7 @@ extern "C" {
 
 struct dnet_node;
 struct dnet_config;
+struct dnet_access_context;
 
 /*!
  * \internal
@@ -57,10 +58,20 @@ void dnet_monitor_exit(struct dnet_node *n);
  * \a cache - flag which shows was the command executed by cache
  * \a size - size of data that takes a part in command execution
  * \a time - time spended on command execution
+ * \a queue_time - time spended by command in queue before execution
  */
 void dnet_monitor_stats_update(struct dnet_node *n, const struct dnet_cmd *cmd,
                                const int err, const int cache,
-                               const uint32_t size, const unsigned long time);
+                               const uint32_t size, const unsigned long time,
+                               const unsigned long queue_time);
+
+/*!
+ * \internal
+ *
+ * Makes request of \a context be traced by node-level ring of the slowest requests,
+ * backend replaces it by its own ring if the request is handled by backend
+ */
+void dnet_monitor_trace_request(struct dnet_node *n, struct dnet_access_context *context);
 
 int dnet_monitor_process_cmd(struct dnet_net_state *orig, struct dnet_cmd *cmd, void *data);
 
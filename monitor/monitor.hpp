@@ -21,6 +21,7 @@
 #define __DNET_MONITOR_MONITOR_HPP
 
 #include "server.hpp"
+#include "slow_requests.hpp"
 #include "statistics.hpp"
 
 struct dnet_node;
@@ -38,6 +39,16 @@ struct monitor_config {
 	size_t		events_size;
 	int		period_in_seconds;
 	std::string	handystats;
+	// percentiles of commands latencies reported by monitor
+	std::vector<double>	percentiles;
+	// number of the slowest requests kept by node and each backend, 0 disables tracing
+	size_t		slow_requests_length;
+	// time window of the slowest requests
+	int		slow_requests_period;
+	// maximum age of cached statistics reports in milliseconds, 0 disables caching
+	unsigned int	snapshot_max_age_ms;
+	// number of the latest reports kept for building deltas, 0 disables deltas
+	size_t		snapshot_history;
 
 	static std::unique_ptr<monitor_config> parse(const kora::config_t &monitor);
 };
@@ -81,6 +92,18 @@ private:
 monitor *get_monitor(struct dnet_node *n);
 monitor_config *get_monitor_config(struct dnet_node *n);
 
+/*
+ * Returns percentiles of commands latencies which should be reported,
+ * defaults are used if monitor isn't configured
+ */
+const std::vector<double> &get_monitor_percentiles(struct dnet_node *n);
+
+/*
+ * Creates storage of the slowest requests configured for node @n,
+ * returns nullptr if tracing of slow requests is disabled
+ */
+std::shared_ptr<slow_requests> create_slow_requests(struct dnet_node *n);
+
 void add_provider(struct dnet_node *n, stat_provider *provider, const std::string &name);
 void remove_provider(struct dnet_node *n, const std::string &name);
 
@@ -220,7 +220,8 @@ request handler::parse_request() {
 		{"/backend", DNET_MONITOR_BACKEND},
 		{"/stats", DNET_MONITOR_STATS},
 		{"/procfs", DNET_MONITOR_PROCFS},
-		{"/top", DNET_MONITOR_TOP}
+		{"/top", DNET_MONITOR_TOP},
+		{"/slow_requests", DNET_MONITOR_SLOW_REQUESTS}
 	};
 
 	request req;
@@ -245,6 +246,17 @@ request handler::parse_request() {
 		return request();
 	}
 
+	const auto since_item = m_http_request.query().find("since");
+	if (since_item != m_http_request.query().end()) {
+		try {
+			req.since = std::stoull(since_item->second);
+		} catch (...) {
+			DNET_LOG_ERROR(m_monitor.node(), "monitor: http-server: Can't parse snapshot id: {}",
+			               since_item->second);
+			return request();
+		}
+	}
+
 	const auto backends_item = m_http_request.query().find("backends");
 	if (backends_item != m_http_request.query().end()) {
 		std::string id_list = backends_item->second;
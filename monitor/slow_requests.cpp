@@ -0,0 +1,259 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "slow_requests.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#include "elliptics/interface.h"
+#include "library/logger.hpp"
+
+namespace ioremap { namespace monitor {
+
+/*
+ * Slot of the ring. Request is stored as array of atomic words, so concurrent copying of a slot
+ * being rewritten isn't a data race, readers detect such copies by @sequence and retry.
+ */
+struct slow_requests::slot {
+	static const size_t words_count = (sizeof(request_trace) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	// odd while the slot is being written
+	std::atomic<uint64_t>	sequence;
+	// total time of kept request, 0 if the slot is empty
+	std::atomic<uint64_t>	total_time;
+	// time when kept request was added
+	std::atomic<time_t>	added;
+	std::atomic<uint64_t>	words[words_count];
+
+	slot() : sequence(0), total_time(0), added(0) {
+		for (auto &word : words)
+			word.store(0, std::memory_order_relaxed);
+	}
+
+	void store(const request_trace &trace) {
+		uint64_t buffer[words_count] = {};
+		memcpy(buffer, &trace, sizeof(trace));
+		for (size_t i = 0; i < words_count; ++i)
+			words[i].store(buffer[i], std::memory_order_relaxed);
+	}
+
+	void load(request_trace &trace) const {
+		uint64_t buffer[words_count];
+		for (size_t i = 0; i < words_count; ++i)
+			buffer[i] = words[i].load(std::memory_order_relaxed);
+		memcpy(&trace, buffer, sizeof(trace));
+	}
+};
+
+slow_requests::slow_requests(size_t length, int period_in_seconds)
+: m_length(length)
+, m_period_in_seconds(period_in_seconds)
+, m_slots(new slot[length])
+, m_threshold(0)
+, m_threshold_deadline(0) {}
+
+slow_requests::~slow_requests() = default;
+
+void slow_requests::add(const request_trace &trace) {
+	const time_t now = time(nullptr);
+	if (trace.total_time <= m_threshold.load(std::memory_order_relaxed) &&
+	    now < m_threshold_deadline.load(std::memory_order_relaxed))
+		return;
+
+	/*
+	 * Replace the fastest or expired request. If the chosen slot has been changed by another thread,
+	 * search again, but give up after few attempts: it is only statistics.
+	 */
+	for (int attempt = 0; attempt < 3; ++attempt) {
+		size_t victim = m_length;
+		uint64_t victim_sequence = 0;
+		uint64_t victim_time = trace.total_time;
+
+		for (size_t i = 0; i < m_length; ++i) {
+			const auto &slot = m_slots[i];
+			const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if (sequence & 1)
+				continue;
+
+			uint64_t time = slot.total_time.load(std::memory_order_relaxed);
+			if (slot.added.load(std::memory_order_relaxed) + m_period_in_seconds <= now)
+				time = 0;
+
+			if (time < victim_time) {
+				victim = i;
+				victim_sequence = sequence;
+				victim_time = time;
+				if (!time)
+					break;
+			}
+		}
+
+		// all kept requests are slower
+		if (victim == m_length)
+			break;
+
+		auto &slot = m_slots[victim];
+		if (!slot.sequence.compare_exchange_strong(victim_sequence, victim_sequence + 1,
+		                                           std::memory_order_acq_rel))
+			continue;
+
+		slot.store(trace);
+		slot.total_time.store(trace.total_time, std::memory_order_relaxed);
+		slot.added.store(now, std::memory_order_relaxed);
+		slot.sequence.store(victim_sequence + 2, std::memory_order_release);
+		break;
+	}
+
+	update_threshold(now);
+}
+
+void slow_requests::update_threshold(time_t now) {
+	uint64_t threshold = std::numeric_limits<uint64_t>::max();
+	time_t deadline = std::numeric_limits<time_t>::max();
+
+	for (size_t i = 0; i < m_length; ++i) {
+		const auto &slot = m_slots[i];
+		const uint64_t time = slot.total_time.load(std::memory_order_relaxed);
+		const time_t expires = slot.added.load(std::memory_order_relaxed) + m_period_in_seconds;
+
+		// there is a free slot, so any request should be accepted
+		if (!time || expires <= now) {
+			threshold = 0;
+			break;
+		}
+
+		threshold = std::min(threshold, time);
+		deadline = std::min(deadline, expires);
+	}
+
+	m_threshold.store(threshold, std::memory_order_relaxed);
+	m_threshold_deadline.store(deadline, std::memory_order_relaxed);
+}
+
+std::vector<request_trace> slow_requests::get() const {
+	const time_t now = time(nullptr);
+	std::vector<request_trace> result;
+	result.reserve(m_length);
+
+	for (size_t i = 0; i < m_length; ++i) {
+		const auto &slot = m_slots[i];
+		request_trace trace;
+		uint64_t time;
+		time_t added;
+
+		while (true) {
+			const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if (sequence & 1) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			slot.load(trace);
+			time = slot.total_time.load(std::memory_order_relaxed);
+			added = slot.added.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+				break;
+		}
+
+		if (time && added + m_period_in_seconds > now)
+			result.emplace_back(trace);
+	}
+
+	std::sort(result.begin(), result.end(), [] (const request_trace &lhs, const request_trace &rhs) {
+		return lhs.total_time > rhs.total_time;
+	});
+	return result;
+}
+
+static const char *stage_name(int stage) {
+	static const char *names[__DNET_REQUEST_STAGE_MAX] = {
+		"recv",
+		"queue",
+		"lock",
+		"backend",
+		"send_queue",
+		"send",
+	};
+	return names[stage];
+}
+
+static void add_string(const char *name,
+                       const std::string &string,
+                       rapidjson::Value &stat_value,
+                       rapidjson::Document::AllocatorType &allocator) {
+	rapidjson::Value value(string.c_str(), allocator);
+	stat_value.AddMember(name, value, allocator);
+}
+
+static void request_trace_json(const request_trace &trace,
+                               rapidjson::Value &stat_value,
+                               rapidjson::Document::AllocatorType &allocator) {
+	add_string("id", dnet_dump_id_str_full(trace.id.id), stat_value, allocator);
+	stat_value.AddMember("group", trace.id.group_id, allocator);
+	stat_value.AddMember("cmd", dnet_cmd_string(trace.cmd), allocator);
+	stat_value.AddMember("trans", trace.trans, allocator);
+	add_string("trace_id", ioremap::elliptics::to_hex_string(trace.trace_id), stat_value, allocator);
+	add_string("cflags", dnet_flags_dump_cflags(trace.cflags), stat_value, allocator);
+	add_string("client", dnet_addr_string(&trace.client), stat_value, allocator);
+	stat_value.AddMember("backend_id", trace.backend_id, allocator);
+	stat_value.AddMember("status", trace.status, allocator);
+	add_string("time", dnet_print_time(&trace.start), stat_value, allocator);
+	stat_value.AddMember("total_time", trace.total_time, allocator);
+
+	rapidjson::Value stages(rapidjson::kObjectType);
+	for (int stage = 0; stage < __DNET_REQUEST_STAGE_MAX; ++stage) {
+		stages.AddMember(stage_name(stage), trace.stages[stage], allocator);
+	}
+	stat_value.AddMember("stages", stages, allocator);
+}
+
+void slow_requests::statistics(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator) const {
+	const auto requests = get();
+
+	value.SetArray();
+	value.Reserve(requests.size(), allocator);
+	for (const auto &trace : requests) {
+		rapidjson::Value trace_value(rapidjson::kObjectType);
+		request_trace_json(trace, trace_value, allocator);
+		value.PushBack(trace_value, allocator);
+	}
+}
+
+slow_requests_provider::slow_requests_provider(std::shared_ptr<slow_requests> requests)
+: m_requests(requests) {}
+
+void slow_requests_provider::statistics(const request &request,
+                                        rapidjson::Value &value,
+                                        rapidjson::Document::AllocatorType &allocator) const {
+	if (!(request.categories & DNET_MONITOR_SLOW_REQUESTS))
+		return;
+
+	value.SetObject();
+	value.AddMember("length", m_requests->length(), allocator);
+	value.AddMember("period_in_seconds", m_requests->period(), allocator);
+
+	rapidjson::Value requests;
+	m_requests->statistics(requests, allocator);
+	value.AddMember("requests", requests, allocator);
+}
+
+}} /* namespace ioremap::monitor */
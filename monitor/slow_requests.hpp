@@ -0,0 +1,129 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DNET_MONITOR_SLOW_REQUESTS_HPP
+#define __DNET_MONITOR_SLOW_REQUESTS_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+#include "library/elliptics.h"
+#include "stat_provider.hpp"
+
+/*
+ * Default number of the slowest requests kept by each backend and by node
+ */
+#define DNET_DEFAULT_MONITOR_SLOW_REQUESTS_LENGTH 50
+
+/*
+ * Default time window in seconds during which a request is kept among the slowest ones, 300s = 5 minutes
+ */
+#define DNET_DEFAULT_MONITOR_SLOW_REQUESTS_PERIOD 300
+
+namespace ioremap { namespace monitor {
+
+/*!
+ * \internal
+ *
+ * Breakdown of time spent by a request on each stage of its handling, all times are in microseconds.
+ */
+struct request_trace {
+	// time when the request was received
+	dnet_time	start;
+	dnet_id		id;
+	dnet_addr	client;
+	uint64_t	trans;
+	uint64_t	trace_id;
+	uint64_t	cflags;
+	int32_t		cmd;
+	int32_t		backend_id;
+	int32_t		status;
+	uint64_t	total_time;
+	uint64_t	stages[__DNET_REQUEST_STAGE_MAX];
+};
+
+/*!
+ * \internal
+ *
+ * Keeps \a length the slowest requests completed during last \a period_in_seconds seconds.
+ * Requests can be added from several threads simultaneously without locks:
+ * each slot of the ring is guarded by its own sequence counter, a writer claims a slot by
+ * incrementing the counter to odd value, readers retry if the counter has changed while they copied the slot.
+ * Requests faster than the fastest kept one are rejected by single atomic load.
+ */
+class slow_requests {
+public:
+	slow_requests(size_t length, int period_in_seconds);
+	~slow_requests();
+
+	slow_requests(const slow_requests &) = delete;
+	slow_requests &operator=(const slow_requests &) = delete;
+
+	size_t length() const { return m_length; }
+	int period() const { return m_period_in_seconds; }
+
+	/*!
+	 * Adds \a trace to the ring if it is slower than any of kept requests
+	 */
+	void add(const request_trace &trace);
+
+	/*!
+	 * Returns kept requests sorted from the slowest to the fastest
+	 */
+	std::vector<request_trace> get() const;
+
+	/*!
+	 * Fills \a value by array of kept requests
+	 */
+	void statistics(rapidjson::Value &value, rapidjson::Document::AllocatorType &allocator) const;
+
+private:
+	struct slot;
+
+	// updates minimal time which request should exceed to be added
+	void update_threshold(time_t now);
+
+	const size_t m_length;
+	const int m_period_in_seconds;
+	std::unique_ptr<slot[]> m_slots;
+
+	// requests with total time not exceeding the threshold are skipped until the deadline
+	std::atomic<uint64_t> m_threshold;
+	std::atomic<time_t> m_threshold_deadline;
+};
+
+/*!
+ * Provider of the slowest requests which were handled without backend
+ */
+class slow_requests_provider : public stat_provider {
+public:
+	slow_requests_provider(std::shared_ptr<slow_requests> requests);
+
+	void statistics(const request &request,
+	                rapidjson::Value &value,
+	                rapidjson::Document::AllocatorType &allocator) const override;
+
+private:
+	std::shared_ptr<slow_requests> m_requests;
+};
+
+}} /* namespace ioremap::monitor */
+
+#endif /* __DNET_MONITOR_SLOW_REQUESTS_HPP */
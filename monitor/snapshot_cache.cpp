@@ -0,0 +1,306 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+#include "monitor/compress.hpp"
+
+namespace ioremap { namespace monitor {
+
+/*
+ * Maximum number of different requests which reports are cached, the least recently used one is evicted
+ */
+static const size_t max_entries_count = 64;
+
+struct snapshot_cache::snapshot {
+	uint64_t id;
+	std::chrono::steady_clock::time_point created;
+	std::string compressed;
+	// deep copy of the report, it is kept only if deltas were requested for the entry
+	rapidjson::Document json;
+};
+
+struct snapshot_cache::entry {
+	// it is held while the report is rebuilt, so the same report isn't built simultaneously
+	std::mutex mutex;
+	// the latest snapshots, the newest is the last one
+	std::deque<std::shared_ptr<snapshot>> history;
+	std::chrono::steady_clock::time_point last_access;
+	// set by the first request with "since", reports aren't copied for deltas until that
+	bool deltas_requested = false;
+};
+
+static std::string convert_report(const rapidjson::Value &report) {
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+	report.Accept(writer);
+	return compress(buffer.GetString());
+}
+
+/*
+ * rapidjson used by elliptics can't copy values, and strings of a report can reference
+ * temporary buffers, so the report is copied with all its strings to be kept
+ */
+static void copy_value(const rapidjson::Value &source, rapidjson::Value &destination,
+                       rapidjson::Document::AllocatorType &allocator) {
+	switch (source.GetType()) {
+	case rapidjson::kNullType:
+		destination.SetNull();
+		break;
+	case rapidjson::kFalseType:
+	case rapidjson::kTrueType:
+		destination.SetBool(source.IsTrue());
+		break;
+	case rapidjson::kObjectType:
+		destination.SetObject();
+		for (auto it = source.MemberBegin(); it != source.MemberEnd(); ++it) {
+			rapidjson::Value value;
+			copy_value(it->value, value, allocator);
+			destination.AddMember(it->name.GetString(), allocator, value, allocator);
+		}
+		break;
+	case rapidjson::kArrayType:
+		destination.SetArray();
+		destination.Reserve(source.Size(), allocator);
+		for (rapidjson::SizeType i = 0; i < source.Size(); ++i) {
+			rapidjson::Value value;
+			copy_value(source[i], value, allocator);
+			destination.PushBack(value, allocator);
+		}
+		break;
+	case rapidjson::kStringType:
+		destination.SetString(source.GetString(), source.GetStringLength(), allocator);
+		break;
+	case rapidjson::kNumberType:
+		if (source.IsInt())
+			destination.SetInt(source.GetInt());
+		else if (source.IsUint())
+			destination.SetUint(source.GetUint());
+		else if (source.IsInt64())
+			destination.SetInt64(source.GetInt64());
+		else if (source.IsUint64())
+			destination.SetUint64(source.GetUint64());
+		else
+			destination.SetDouble(source.GetDouble());
+		break;
+	}
+}
+
+static bool equal_values(const rapidjson::Value &lhs, const rapidjson::Value &rhs);
+
+/*
+ * Looks for member @name in object @value, members of reports built by the same code usually
+ * have the same order, so the member at @hint position is checked first
+ */
+static const rapidjson::Value *find_member(const rapidjson::Value &value, const char *name, size_t hint) {
+	const auto begin = value.MemberBegin();
+	const size_t count = value.MemberEnd() - begin;
+	if (hint < count && !strcmp(begin[hint].name.GetString(), name))
+		return &begin[hint].value;
+
+	return value.HasMember(name) ? &value[name] : nullptr;
+}
+
+static bool equal_objects(const rapidjson::Value &lhs, const rapidjson::Value &rhs) {
+	if (lhs.MemberEnd() - lhs.MemberBegin() != rhs.MemberEnd() - rhs.MemberBegin())
+		return false;
+
+	size_t index = 0;
+	for (auto it = lhs.MemberBegin(); it != lhs.MemberEnd(); ++it, ++index) {
+		const auto other = find_member(rhs, it->name.GetString(), index);
+		if (!other || !equal_values(it->value, *other))
+			return false;
+	}
+	return true;
+}
+
+static bool equal_values(const rapidjson::Value &lhs, const rapidjson::Value &rhs) {
+	if (lhs.GetType() != rhs.GetType())
+		return false;
+
+	switch (lhs.GetType()) {
+	case rapidjson::kNullType:
+	case rapidjson::kFalseType:
+	case rapidjson::kTrueType:
+		return true;
+	case rapidjson::kObjectType:
+		return equal_objects(lhs, rhs);
+	case rapidjson::kArrayType:
+		if (lhs.Size() != rhs.Size())
+			return false;
+		for (rapidjson::SizeType i = 0; i < lhs.Size(); ++i) {
+			if (!equal_values(lhs[i], rhs[i]))
+				return false;
+		}
+		return true;
+	case rapidjson::kStringType:
+		return lhs.GetStringLength() == rhs.GetStringLength() &&
+		       !memcmp(lhs.GetString(), rhs.GetString(), lhs.GetStringLength());
+	case rapidjson::kNumberType:
+		if (lhs.IsUint64() && rhs.IsUint64())
+			return lhs.GetUint64() == rhs.GetUint64();
+		if (lhs.IsInt64() && rhs.IsInt64())
+			return lhs.GetInt64() == rhs.GetInt64();
+		return lhs.GetDouble() == rhs.GetDouble();
+	}
+	return false;
+}
+
+/*
+ * Fills @delta by members of object @current which differ from members of object @base:
+ * nested objects are compared recursively, other values are included as is,
+ * members missed in @current are included as null.
+ */
+static void object_delta(const rapidjson::Value &current, const rapidjson::Value &base, rapidjson::Value &delta,
+                         rapidjson::Document::AllocatorType &allocator) {
+	delta.SetObject();
+
+	size_t index = 0;
+	for (auto it = current.MemberBegin(); it != current.MemberEnd(); ++it, ++index) {
+		const char *name = it->name.GetString();
+		const auto other = find_member(base, name, index);
+		if (other && equal_values(it->value, *other))
+			continue;
+
+		rapidjson::Value value;
+		if (other && it->value.IsObject() && other->IsObject())
+			object_delta(it->value, *other, value, allocator);
+		else
+			copy_value(it->value, value, allocator);
+		delta.AddMember(name, allocator, value, allocator);
+	}
+
+	index = 0;
+	for (auto it = base.MemberBegin(); it != base.MemberEnd(); ++it, ++index) {
+		const char *name = it->name.GetString();
+		if (!find_member(current, name, index)) {
+			rapidjson::Value value;
+			delta.AddMember(name, allocator, value, allocator);
+		}
+	}
+}
+
+snapshot_cache::snapshot_cache(std::chrono::milliseconds max_age, size_t history)
+: m_max_age(max_age)
+, m_history(history)
+/* ids are started from current time, so ids received from previous instance of the node won't match */
+, m_last_id(std::chrono::duration_cast<std::chrono::microseconds>(
+	std::chrono::system_clock::now().time_since_epoch()).count()) {}
+
+std::string snapshot_cache::get(const request &request, const builder_t &builder) {
+	auto entry = get_entry(request);
+
+	std::shared_ptr<snapshot> current, base;
+	{
+		std::lock_guard<std::mutex> guard(entry->mutex);
+
+		if (request.since)
+			entry->deltas_requested = true;
+		const bool deltas = m_history && entry->deltas_requested;
+
+		const auto now = std::chrono::steady_clock::now();
+		if (!entry->history.empty() && now - entry->history.back()->created < m_max_age &&
+		    (!deltas || entry->history.back()->json.IsObject())) {
+			current = entry->history.back();
+		} else {
+			current = build(builder, deltas);
+			entry->history.emplace_back(current);
+			while (entry->history.size() > (deltas ? m_history : 1)) {
+				entry->history.pop_front();
+			}
+		}
+
+		if (request.since && deltas) {
+			for (const auto &snapshot : entry->history) {
+				if (snapshot->id == request.since && snapshot->json.IsObject()) {
+					base = snapshot;
+					break;
+				}
+			}
+		}
+	}
+
+	if (base)
+		return delta(*current, *base);
+	return current->compressed;
+}
+
+std::shared_ptr<snapshot_cache::entry> snapshot_cache::get_entry(const request &request) {
+	std::vector<uint32_t> backends_ids(request.backends_ids.begin(), request.backends_ids.end());
+	std::sort(backends_ids.begin(), backends_ids.end());
+
+	std::string key = std::to_string(request.categories);
+	for (const auto &backend_id : backends_ids) {
+		key += ',';
+		key += std::to_string(backend_id);
+	}
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	auto &entry = m_entries[key];
+	if (!entry) {
+		entry = std::make_shared<snapshot_cache::entry>();
+
+		if (m_entries.size() > max_entries_count) {
+			auto oldest = m_entries.end();
+			for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+				if (it->second != entry &&
+				    (oldest == m_entries.end() || it->second->last_access < oldest->second->last_access))
+					oldest = it;
+			}
+			m_entries.erase(oldest);
+		}
+	}
+	entry->last_access = std::chrono::steady_clock::now();
+	return entry;
+}
+
+std::shared_ptr<snapshot_cache::snapshot> snapshot_cache::build(const builder_t &builder, bool keep_json) {
+	auto result = std::make_shared<snapshot>();
+	result->id = ++m_last_id;
+
+	rapidjson::Document report;
+	report.SetObject();
+	builder(report);
+	report.AddMember("snapshot_id", result->id, report.GetAllocator());
+
+	result->created = std::chrono::steady_clock::now();
+	result->compressed = convert_report(report);
+	if (keep_json)
+		copy_value(report, result->json, result->json.GetAllocator());
+	return result;
+}
+
+std::string snapshot_cache::delta(const snapshot &current, const snapshot &base) const {
+	rapidjson::Document report;
+	auto &allocator = report.GetAllocator();
+
+	object_delta(current.json, base.json, report, allocator);
+	if (current.id == base.id)
+		report.AddMember("snapshot_id", current.id, allocator);
+	report.AddMember("base_snapshot_id", base.id, allocator);
+	return convert_report(report);
+}
+
+}} /* namespace ioremap::monitor */
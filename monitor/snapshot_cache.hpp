@@ -0,0 +1,88 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DNET_MONITOR_SNAPSHOT_CACHE_HPP
+#define __DNET_MONITOR_SNAPSHOT_CACHE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "rapidjson/document.h"
+
+#include "stat_provider.hpp"
+
+/*
+ * By default snapshots are rebuilt on each request
+ */
+#define DNET_DEFAULT_MONITOR_SNAPSHOT_MAX_AGE_MS 0
+
+/*
+ * Default number of the latest snapshots kept for each request for building deltas
+ */
+#define DNET_DEFAULT_MONITOR_SNAPSHOT_HISTORY 4
+
+namespace ioremap { namespace monitor {
+
+/*!
+ * \internal
+ *
+ * Cache of compressed json reports built for each combination of categories and backends.
+ * Report is rebuilt only if the cached one is older than \a max_age, concurrent requests
+ * of the same report wait for the one being built instead of building it again.
+ *
+ * Each report has unique snapshot id. If request contains id of one of \a history latest snapshots,
+ * only values changed since that snapshot are returned as JSON merge patch (RFC 7386):
+ * changed objects contain only changed members, removed members are set to null.
+ * Building a delta requires a deep copy of each report, so reports are copied and kept only after
+ * the first request with snapshot id of the same categories and backends, till then the latest one is kept.
+ */
+class snapshot_cache {
+public:
+	typedef std::function<void(rapidjson::Document &report)> builder_t;
+
+	snapshot_cache(std::chrono::milliseconds max_age, size_t history);
+
+	/*!
+	 * Returns compressed json report for \a request, \a builder fills the report if it should be rebuilt
+	 */
+	std::string get(const request &request, const builder_t &builder);
+
+private:
+	struct snapshot;
+	struct entry;
+
+	std::shared_ptr<entry> get_entry(const request &request);
+	std::shared_ptr<snapshot> build(const builder_t &builder, bool keep_json);
+	std::string delta(const snapshot &current, const snapshot &base) const;
+
+	const std::chrono::milliseconds m_max_age;
+	const size_t m_history;
+	std::atomic<uint64_t> m_last_id;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::string, std::shared_ptr<entry>> m_entries;
+};
+
+}} /* namespace ioremap::monitor */
+
+#endif /* __DNET_MONITOR_SNAPSHOT_CACHE_HPP */
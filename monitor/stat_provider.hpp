@@ -31,9 +31,11 @@ namespace ioremap { namespace monitor {
 struct request {
 	uint64_t categories;
 	std::unordered_set<uint32_t> backends_ids;
+	// id of snapshot received by client earlier, if set only changes since it are requested
+	uint64_t since;
 
-	request(): categories(0) {}
-	request(uint64_t req_categories): categories(req_categories) {}
+	request(): categories(0), since(0) {}
+	request(uint64_t req_categories): categories(req_categories), since(0) {}
 };
 
 /*!
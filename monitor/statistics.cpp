@@ -19,12 +19,14 @@
 
 #include "statistics.hpp"
 
+#include <algorithm>
+
 #include <blackhole/attribute.hpp>
 
 #include "monitor.hpp"
 #include "cache/cache.hpp"
 #include "elliptics/backends.h"
-#include "monitor/compress.hpp"
+#include "library/common.hpp"
 
 //FIXME: elliptics uses rather modified version of rapidjson
 // which is partially incompatible with a stock version used by
@@ -60,6 +62,43 @@ static void source_stat_json(const source_counter &source_stat,
 	stat_value.AddMember("internal", internal_stat, allocator);
 }
 
+static std::string percentile_name(double percentile) {
+	std::ostringstream out;
+	out << "p" << percentile;
+	auto name = out.str();
+	std::replace(name.begin(), name.end(), '.', '_');
+	return name;
+}
+
+static void histogram_json(const histogram_snapshot &histogram,
+                           const std::vector<double> &percentiles,
+                           rapidjson::Value &stat_value,
+                           rapidjson::Document::AllocatorType &allocator) {
+	stat_value.AddMember("count", histogram.count(), allocator);
+	stat_value.AddMember("max", histogram.max(), allocator);
+	for (const auto &percentile : percentiles) {
+		rapidjson::Value value(histogram.percentile(percentile));
+		stat_value.AddMember(percentile_name(percentile).c_str(), allocator, value, allocator);
+	}
+}
+
+static void latency_stat_json(const latency_snapshots &latencies,
+                              const std::vector<double> &percentiles,
+                              rapidjson::Value &stat_value,
+                              rapidjson::Document::AllocatorType &allocator) {
+	rapidjson::Value queue_time(rapidjson::kObjectType);
+	histogram_json(latencies.queue_time, percentiles, queue_time, allocator);
+	stat_value.AddMember("queue_time", queue_time, allocator);
+
+	rapidjson::Value handle_time(rapidjson::kObjectType);
+	histogram_json(latencies.handle_time, percentiles, handle_time, allocator);
+	stat_value.AddMember("handle_time", handle_time, allocator);
+
+	rapidjson::Value total_time(rapidjson::kObjectType);
+	histogram_json(latencies.total_time, percentiles, total_time, allocator);
+	stat_value.AddMember("total_time", total_time, allocator);
+}
+
 static void dnet_stat_count_json(const dnet_stat_count &counter, rapidjson::Value &stat_value,
 		rapidjson::Document::AllocatorType &allocator) {
 	stat_value.AddMember("successes", counter.count, allocator);
@@ -78,13 +117,24 @@ static void node_stat_json(dnet_node *n, int cmd, rapidjson::Value &stat_value,
 }
 
 static void cmd_stat_json(dnet_node *node, int cmd, const command_counters &cmd_stat,
+		const command_latencies &cmd_latencies, const std::vector<double> &percentiles,
 		rapidjson::Value &stat_value, rapidjson::Document::AllocatorType &allocator) {
 	rapidjson::Value cache_stat(rapidjson::kObjectType);
 	source_stat_json(cmd_stat.cache, cache_stat, allocator);
+	if (cmd_latencies.cache.has_data()) {
+		rapidjson::Value latency_stat(rapidjson::kObjectType);
+		latency_stat_json(cmd_latencies.cache, percentiles, latency_stat, allocator);
+		cache_stat.AddMember("latency", latency_stat, allocator);
+	}
 	stat_value.AddMember("cache", cache_stat, allocator);
 
 	rapidjson::Value disk_stat(rapidjson::kObjectType);
 	source_stat_json(cmd_stat.disk, disk_stat, allocator);
+	if (cmd_latencies.disk.has_data()) {
+		rapidjson::Value latency_stat(rapidjson::kObjectType);
+		latency_stat_json(cmd_latencies.disk, percentiles, latency_stat, allocator);
+		disk_stat.AddMember("latency", latency_stat, allocator);
+	}
 	stat_value.AddMember("disk", disk_stat, allocator);
 
 	/*
@@ -97,12 +147,20 @@ static void cmd_stat_json(dnet_node *node, int cmd, const command_counters &cmd_
 	}
 }
 
-static void single_client_stat_json(dnet_net_state *st, rapidjson::Value &stat_value,
+/*
+ * Counters of client state copied under @state_lock
+ */
+struct client_stat {
+	dnet_addr		addr;
+	dnet_stat_count		stat[__DNET_CMD_MAX];
+};
+
+static void single_client_stat_json(const client_stat &client, rapidjson::Value &stat_value,
 		rapidjson::Document::AllocatorType &allocator) {
 	for (int i = 1; i < __DNET_CMD_MAX; ++i) {
-		if (st->stat[i].count != 0 || st->stat[i].err != 0) {
+		if (client.stat[i].count != 0 || client.stat[i].err != 0) {
 			rapidjson::Value cmd_stat(rapidjson::kObjectType);
-			dnet_stat_count_json(st->stat[i], cmd_stat, allocator);
+			dnet_stat_count_json(client.stat[i], cmd_stat, allocator);
 			stat_value.AddMember(dnet_cmd_string(i), allocator, cmd_stat, allocator);
 		}
 	}
@@ -111,13 +169,19 @@ static void single_client_stat_json(dnet_net_state *st, rapidjson::Value &stat_v
 static void clients_stat_json(dnet_node *n, rapidjson::Value &stat_value,
 		rapidjson::Document::AllocatorType &allocator) {
 	struct dnet_net_state *st;
+	std::vector<client_stat> clients;
 
+	/*
+	 * Only copy counters under the lock, json is built after releasing it,
+	 * so monitor doesn't block adding and removing states for long.
+	 */
 	pthread_mutex_lock(&n->state_lock);
 	try {
 		list_for_each_entry(st, &n->empty_state_list, node_entry) {
-			rapidjson::Value client_stat(rapidjson::kObjectType);
-			single_client_stat_json(st, client_stat, allocator);
-			stat_value.AddMember(dnet_addr_string(&st->addr), allocator, client_stat, allocator);
+			clients.emplace_back();
+			auto &client = clients.back();
+			client.addr = st->addr;
+			memcpy(client.stat, st->stat, sizeof(client.stat));
 		}
 	} catch(std::exception &e) {
 		pthread_mutex_unlock(&n->state_lock);
@@ -129,14 +193,121 @@ static void clients_stat_json(dnet_node *n, rapidjson::Value &stat_value,
 		throw;
 	}
 	pthread_mutex_unlock(&n->state_lock);
+
+	for (const auto &client : clients) {
+		rapidjson::Value client_stat(rapidjson::kObjectType);
+		single_client_stat_json(client, client_stat, allocator);
+		stat_value.AddMember(dnet_addr_string(&client.addr), allocator, client_stat, allocator);
+	}
 }
 
+/*
+ * Counters and latencies of one command collected by one shard
+ */
+struct command_stats::shard {
+	struct counters {
+		std::atomic<uint64_t>	successes;
+		std::atomic<uint64_t>	failures;
+		std::atomic<uint64_t>	size;
+		std::atomic<uint64_t>	time;
+
+		void clear() {
+			successes.store(0, std::memory_order_relaxed);
+			failures.store(0, std::memory_order_relaxed);
+			size.store(0, std::memory_order_relaxed);
+			time.store(0, std::memory_order_relaxed);
+		}
+
+		void merge_to(ext_counter &counter) const {
+			counter.counter.successes += successes.load(std::memory_order_relaxed);
+			counter.counter.failures += failures.load(std::memory_order_relaxed);
+			counter.size += size.load(std::memory_order_relaxed);
+			counter.time += time.load(std::memory_order_relaxed);
+		}
+	};
+
+	struct source {
+		counters		outside;
+		counters		internal;
+		latency_histogram	queue_time;
+		latency_histogram	handle_time;
+		latency_histogram	total_time;
+
+		void clear() {
+			outside.clear();
+			internal.clear();
+			queue_time.clear();
+			handle_time.clear();
+			total_time.clear();
+		}
+
+		void merge_to(source_counter &counter, latency_snapshots &latencies) const {
+			outside.merge_to(counter.outside);
+			internal.merge_to(counter.internal);
+			queue_time.merge_to(latencies.queue_time);
+			handle_time.merge_to(latencies.handle_time);
+			total_time.merge_to(latencies.total_time);
+		}
+	};
+
+	source	cache;
+	source	disk;
+
+	shard() {
+		clear();
+	}
+
+	void clear() {
+		cache.clear();
+		disk.clear();
+	}
+};
+
 command_stats::command_stats()
-: m_cmd_stats(__DNET_CMD_MAX) {}
+: m_shards(new std::atomic<shard *>[shards_count * __DNET_CMD_MAX]) {
+	for (size_t i = 0; i < shards_count * __DNET_CMD_MAX; ++i) {
+		m_shards[i].store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+command_stats::~command_stats() {
+	for (size_t i = 0; i < shards_count * __DNET_CMD_MAX; ++i) {
+		delete m_shards[i].load(std::memory_order_relaxed);
+	}
+}
 
 void command_stats::clear() {
-	std::unique_lock<std::mutex> guard(m_cmd_stats_mutex);
-	memset(m_cmd_stats.data(), 0, sizeof(m_cmd_stats.front()) * m_cmd_stats.size());
+	for (size_t i = 0; i < shards_count * __DNET_CMD_MAX; ++i) {
+		auto shard = m_shards[i].load(std::memory_order_acquire);
+		if (shard)
+			shard->clear();
+	}
+}
+
+command_stats::shard &command_stats::get_shard(const int cmd) {
+	auto &place = m_shards[cmd * shards_count + dnet_current_thread_index() % shards_count];
+
+	auto current = place.load(std::memory_order_acquire);
+	if (current)
+		return *current;
+
+	std::unique_ptr<shard> allocated(new shard);
+	if (place.compare_exchange_strong(current, allocated.get(), std::memory_order_acq_rel))
+		return *allocated.release();
+
+	// another thread of the same shard has already allocated it
+	return *current;
+}
+
+void command_stats::merge(const int cmd, command_counters &counters, command_latencies &latencies) const {
+	for (size_t i = 0; i < shards_count; ++i) {
+		auto shard = m_shards[cmd * shards_count + i].load(std::memory_order_acquire);
+		if (!shard)
+			continue;
+
+		shard->cache.merge_to(counters.cache, latencies.cache);
+		shard->disk.merge_to(counters.disk, latencies.disk);
+	}
 }
 
 void command_stats::command_counter(const int orig_cmd,
@@ -144,34 +315,40 @@ void command_stats::command_counter(const int orig_cmd,
                                  const int err,
                                  const int cache,
                                  const uint64_t size,
-                                 const unsigned long time)
+                                 const unsigned long time,
+                                 const unsigned long queue_time)
 {
 	int cmd = orig_cmd;
 
 	if (cmd >= __DNET_CMD_MAX || cmd <= 0)
 		cmd = DNET_CMD_UNKNOWN;
 
-	auto &place = cache ? m_cmd_stats[cmd].cache : m_cmd_stats[cmd].disk;
+	auto &shard = get_shard(cmd);
+	auto &place = cache ? shard.cache : shard.disk;
 	auto &source = trans ? place.outside : place.internal;
-	auto &counter = err ? source.counter.failures : source.counter.successes;
+	auto &counter = err ? source.failures : source.successes;
 
-	std::unique_lock<std::mutex> guard(m_cmd_stats_mutex);
-	++counter;
-	source.size += size;
-	source.time += time;
+	counter.fetch_add(1, std::memory_order_relaxed);
+	source.size.fetch_add(size, std::memory_order_relaxed);
+	source.time.fetch_add(time, std::memory_order_relaxed);
+
+	place.queue_time.record(queue_time);
+	place.handle_time.record(time);
+	place.total_time.record(queue_time + time);
 }
 
 void command_stats::commands_report(dnet_node *node,
+                                    const std::vector<double> &percentiles,
                                     rapidjson::Value &stat_value,
                                     rapidjson::Document::AllocatorType &allocator) const {
-	std::unique_lock<std::mutex> guard(m_cmd_stats_mutex);
-	auto tmp_stats = m_cmd_stats;
-	guard.unlock();
-
 	for (int i = 1; i < __DNET_CMD_MAX; ++i) {
-		if (tmp_stats[i].has_data()) {
+		command_counters counters;
+		command_latencies latencies;
+		merge(i, counters, latencies);
+
+		if (counters.has_data()) {
 			rapidjson::Value cmd_stat(rapidjson::kObjectType);
-			cmd_stat_json(node, i, tmp_stats[i], cmd_stat, allocator);
+			cmd_stat_json(node, i, counters, latencies, percentiles, cmd_stat, allocator);
 			stat_value.AddMember(dnet_cmd_string(i), allocator, cmd_stat, allocator);
 		}
 	}
@@ -182,18 +359,33 @@ void statistics::command_counter(const int cmd,
                                  const int err,
                                  const int cache,
                                  const uint64_t size,
-                                 const unsigned long time)
+                                 const unsigned long time,
+                                 const unsigned long queue_time)
 {
-	m_command_stats.command_counter(cmd, trans, err, cache, size, time);
+	m_command_stats.command_counter(cmd, trans, err, cache, size, time, queue_time);
 }
 
-statistics::statistics(monitor& mon, struct dnet_config *cfg) : m_monitor(mon)
+static std::chrono::milliseconds get_snapshot_max_age(struct dnet_node *n) {
+	const auto monitor_cfg = get_monitor_config(n);
+	return std::chrono::milliseconds(monitor_cfg ? monitor_cfg->snapshot_max_age_ms
+	                                             : DNET_DEFAULT_MONITOR_SNAPSHOT_MAX_AGE_MS);
+}
+
+static size_t get_snapshot_history(struct dnet_node *n) {
+	const auto monitor_cfg = get_monitor_config(n);
+	return monitor_cfg ? monitor_cfg->snapshot_history : DNET_DEFAULT_MONITOR_SNAPSHOT_HISTORY;
+}
+
+statistics::statistics(monitor& mon, struct dnet_config *cfg)
+: m_monitor(mon)
+, m_snapshots(get_snapshot_max_age(mon.node()), get_snapshot_history(mon.node()))
 {
 	(void) cfg;
 	const auto monitor_cfg = get_monitor_config(mon.node());
 	if (monitor_cfg && monitor_cfg->has_top) {
 		m_top_stats = std::make_shared<top_stats>(monitor_cfg->top_length, monitor_cfg->events_size, monitor_cfg->period_in_seconds);
 	}
+	m_slow_requests = create_slow_requests(mon.node());
 }
 
 void statistics::add_provider(stat_provider *stat, const std::string &name)
@@ -202,19 +394,16 @@ void statistics::add_provider(stat_provider *stat, const std::string &name)
 	m_stat_providers.insert(make_pair(name, std::shared_ptr<stat_provider>(stat)));
 }
 
-inline std::string convert_report(const rapidjson::Document &report)
+std::string statistics::report(const request &request)
 {
-	rapidjson::StringBuffer buffer;
-	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-	report.Accept(writer);
-	return compress(buffer.GetString());
+	return m_snapshots.get(request, [&] (rapidjson::Document &report) {
+		collect(request, report);
+	});
 }
 
-std::string statistics::report(const request &request)
+void statistics::collect(const request &request, rapidjson::Document &report)
 {
-	rapidjson::Document report;
 	DNET_LOG_INFO(m_monitor.node(), "monitor: collecting statistics for categories: {:x}", request.categories);
-	report.SetObject();
 	auto &allocator = report.GetAllocator();
 
 	dnet_time time;
@@ -231,7 +420,8 @@ std::string statistics::report(const request &request)
 
 	if (request.categories & DNET_MONITOR_COMMANDS) {
 		rapidjson::Value commands_value(rapidjson::kObjectType);
-		m_command_stats.commands_report(m_monitor.node(), commands_value, allocator);
+		m_command_stats.commands_report(m_monitor.node(), get_monitor_percentiles(m_monitor.node()),
+		                                commands_value, allocator);
 
 		rapidjson::Value clients_stat(rapidjson::kObjectType);
 		clients_stat_json(m_monitor.node(), clients_stat, allocator);
@@ -262,7 +452,6 @@ std::string statistics::report(const request &request)
 
 	DNET_LOG_DEBUG(m_monitor.node(), "monitor: finished generating json statistics for categories: {:x}",
 	               request.categories);
-	return convert_report(report);
 }
 
 }} /* namespace ioremap::monitor */
@@ -25,12 +25,17 @@
 #include <sstream>
 #include <thread>
 #include <map>
+#include <memory>
+#include <vector>
 
 #include "rapidjson/document.h"
 
 #include "library/elliptics.h"
 
+#include "histogram.hpp"
 #include "monitor.h"
+#include "slow_requests.hpp"
+#include "snapshot_cache.hpp"
 #include "stat_provider.hpp"
 #include "top.hpp"
 
@@ -85,6 +90,31 @@ struct command_counters {
 	}
 };
 
+/*!
+ * \internal
+ *
+ * Merged latency histograms of commands handled by cache or disk
+ */
+struct latency_snapshots {
+	histogram_snapshot	queue_time;
+	histogram_snapshot	handle_time;
+	histogram_snapshot	total_time;
+
+	bool has_data() const {
+		return total_time.has_data();
+	}
+};
+
+/*!
+ * \internal
+ *
+ * Latencies that connected with each command
+ */
+struct command_latencies {
+	latency_snapshots	cache;
+	latency_snapshots	disk;
+};
+
 /*!
  * \internal
  *
@@ -92,10 +122,16 @@ struct command_counters {
  * This structure can be embedded into each backend and also into @statistics class
  * to maintain global command counters.
  *
+ * Counters and latency histograms are split into shards, each thread updates its own shard
+ * by relaxed atomic operations without any lock. Shards are merged on report.
  */
 class command_stats {
 public:
 	command_stats();
+	~command_stats();
+
+	command_stats(const command_stats &) = delete;
+	command_stats &operator=(const command_stats &) = delete;
 
 	void clear();
 
@@ -107,32 +143,52 @@ public:
 	 * \a cache - flag which shows was the command executed by cache
 	 * \a size - size of data that takes a part in command execution
 	 * \a time - time spended on command execution
+	 * \a queue_time - time spended by command in queue before execution
 	 */
 	void command_counter(const int cmd, const uint64_t trans, const int err, const int cache,
-	                     const uint64_t size, const unsigned long time);
+	                     const uint64_t size, const unsigned long time, const unsigned long queue_time);
 
 	/*!
 	 * Fills \a a stat_value by commands statistics and returns it
+	 * \a percentiles - percentiles of latencies that should be reported
 	 * \a allocator - document allocator that is required by rapidjson
 	 */
 	void commands_report(dnet_node *node,
+	                     const std::vector<double> &percentiles,
 	                     rapidjson::Value &stat_value,
 	                     rapidjson::Document::AllocatorType &allocator) const;
 
 private:
+	struct shard;
+
+	/*!
+	 * \internal
+	 *
+	 * Number of shards, threads are spread over shards in round-robin manner
+	 */
+	static const size_t shards_count = 16;
+
 	/*!
 	 * \internal
 	 *
-	 * Lock for controlling access to commands statistics
+	 * Returns shard of \a cmd for the current thread, allocates it at first access
 	 */
-	mutable std::mutex m_cmd_stats_mutex;
+	shard &get_shard(const int cmd);
 
 	/*!
 	 * \internal
 	 *
-	 * Commands statistics
+	 * Merges all shards of \a cmd into \a counters and \a latencies
 	 */
-	std::vector<command_counters> m_cmd_stats;
+	void merge(const int cmd, command_counters &counters, command_latencies &latencies) const;
+
+	/*!
+	 * \internal
+	 *
+	 * Commands statistics: shards_count shards for each command, shards are allocated
+	 * on demand and freed only by destructor
+	 */
+	std::unique_ptr<std::atomic<shard *>[]> m_shards;
 };
 
 /*!
@@ -155,9 +211,9 @@ public:
 	/*!
 	 * \internal
 	 *
-	 * Generates and returns json statistics for @request
-	 * For that statistics will interview all external statistics provider
-	 * which supports this @request
+	 * Returns compressed json statistics for @request
+	 * Statistics are taken from the cache of snapshots and rebuilt only if the cached one is too old,
+	 * only changes are returned if @request refers to one of the latest snapshots
 	 */
 	std::string report(const request &request);
 
@@ -171,9 +227,10 @@ public:
 	 * \a cache - flag which shows was the command executed by cache
 	 * \a size - size of data that takes a part in command execution
 	 * \a time - time spended on command execution
+	 * \a queue_time - time spended by command in queue before execution
 	 */
 	void command_counter(const int cmd, const uint64_t trans, const int err, const int cache,
-	                     const uint64_t size, const unsigned long time);
+	                     const uint64_t size, const unsigned long time, const unsigned long queue_time);
 
 	/*!
 	 * \internal
@@ -185,7 +242,24 @@ public:
 
 	typedef std::shared_ptr<top_stats> top_stats_ptr;
 	top_stats_ptr get_top_stats() const { return m_top_stats; }
+
+	/*!
+	 * \internal
+	 *
+	 * Returns the slowest requests which were handled without backend,
+	 * nullptr if tracing of slow requests is disabled
+	 */
+	std::shared_ptr<slow_requests> get_slow_requests() const { return m_slow_requests; }
 private:
+	/*!
+	 * \internal
+	 *
+	 * Fills @report by statistics for @request
+	 * For that statistics will interview all external statistics provider
+	 * which supports this @request
+	 */
+	void collect(const request &request, rapidjson::Document &report);
+
 	/*!
 	 * \internal
 	 *
@@ -217,6 +291,15 @@ private:
 	std::map<std::string, std::shared_ptr<stat_provider>> m_stat_providers;
 
 	top_stats_ptr m_top_stats;
+
+	std::shared_ptr<slow_requests> m_slow_requests;
+
+	/*!
+	 * \internal
+	 *
+	 * Cache of the latest reports
+	 */
+	snapshot_cache m_snapshots;
 };
 
 }} /* namespace ioremap::monitor */
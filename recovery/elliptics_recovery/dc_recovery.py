@@ -119,15 +119,18 @@ class KeyRecover(object):
         self.missed_groups = list(missed_groups)
 
         self.read_session = elliptics.newapi.Session(node)
+        self.read_session.cflags |= elliptics.command_flags.prio_recovery
         self.read_session.trace_id = ctx.trace_id
         self.read_session.set_filter(elliptics.filters.all)
 
         self.write_session = elliptics.newapi.Session(node)
+        self.write_session.cflags |= elliptics.command_flags.prio_recovery
         self.write_session.trace_id = ctx.trace_id
         self.write_session.set_checker(elliptics.checkers.all)
         self.write_session.ioflags |= elliptics.io_flags.cas_timestamp
 
         self.remove_session = elliptics.newapi.Session(node)
+        self.remove_session.cflags |= elliptics.command_flags.prio_recovery
         self.remove_session.trace_id = ctx.trace_id
         self.remove_session.set_filter(elliptics.filters.all_final)
         self.remove_session.ioflags |= elliptics.io_flags.cas_timestamp
@@ -193,6 +193,7 @@ class ServerSendRecovery(object):
         self.buckets = BucketsManager(ctx)
 
         self.session = elliptics.newapi.Session(node)
+        self.session.cflags |= elliptics.command_flags.prio_recovery
         self.session.trace_id = ctx.trace_id
         self.session.exceptions_policy = elliptics.exceptions_policy.no_exceptions
         self.session.timeout = 60
@@ -86,6 +86,10 @@ class IteratorResult(object):
     def append_old(self, record):
         self.container.append_old(record)
 
+    def flush(self):
+        """Writes buffered results to the file"""
+        self.container.flush()
+
     def sort(self):
         """Sorts results"""
         self.container.sort()
@@ -99,22 +103,15 @@ class IteratorResult(object):
             If results is empty - skipping merge stage
             If results contains diffs only for 1 node - nothing to merge just copy this diffs
             Otherwise:
-                for each node creates tuple (value, iterator, result) and combines it in the list:
-                    Value - record from the top of node diffs.
-                    Iterator - iterator of node diffs.
-                    results - resulting container of merged diffs.
-                1.  Goes through tuples and find tuple with minimum key and maximum timestamp in value
-                2.  Value from the tuple appends in corresponding result container.
-                3.  Goes through tuples again and for tuple with a key equal to minimum key,
-                    gets new record from iterator while it key == minimum or end of node diffs is reached.
-                4.  If for some tuple all node diffs are processed - adds number of the tuple into remove list
-                5.  After that removes from tuple list all tuples from remove list
-                6.  Repeats step 1-6 while tuple list isn't empty
+                for each node creates resulting container and merges all diffs natively:
+                for each key the newest record is appended into resulting container
+                of the node which diff has this record.
         """
         results = [d for d in results if d and len(d) != 0]
         if len(results) == 1:
             import shutil
             diff = results[0]
+            diff.flush()
             filename = os.path.join(tmp_dir, mk_container_name(diff.address, diff.backend_id, "merge_"))
             shutil.copyfile(diff.filename, filename)
             return [cls.load_filename(filename,
@@ -131,37 +128,19 @@ class IteratorResult(object):
 
     @classmethod
     def __merge__(cls, results, tmp_dir):
-        import heapq
         ret = []
-        heap = []
         for d in results:
-            try:
-                filename = os.path.join(tmp_dir, mk_container_name(d.address, d.backend_id, "merge_"))
-                heapq.heappush(heap,
-                               MergeData(d,
-                                         IteratorResult.from_filename(filename,
-                                                                      address=d.address,
-                                                                      backend_id=d.backend_id,
-                                                                      group_id=d.group_id,
-                                                                      tmp_dir=tmp_dir,
-                                                                      leave_file=True
-                                                                      )))
-            except StopIteration:
-                pass
-
-        while len(heap):
-            min_data = heapq.heappop(heap)
-            min_data.container.append_rr(min_data.value)
-            same_datas = [min_data]
-            while len(heap) and min_data.value.key == heap[0].value.key:
-                same_datas.append(heapq.heappop(heap))
-            for i in same_datas:
-                try:
-                    i.next()
-                    heapq.heappush(heap, i)
-                except StopIteration:
-                    ret.append(i.container)
-
+            filename = os.path.join(tmp_dir, mk_container_name(d.address, d.backend_id, "merge_"))
+            ret.append(IteratorResult.from_filename(filename,
+                                                    address=d.address,
+                                                    backend_id=d.backend_id,
+                                                    group_id=d.group_id,
+                                                    tmp_dir=tmp_dir,
+                                                    leave_file=True
+                                                    ))
+
+        elliptics.core.newapi.IteratorResultContainer.merge([d.container for d in results],
+                                                            [r.container for r in ret])
         return ret
 
     @classmethod
@@ -219,6 +198,7 @@ class Iterator(object):
 
     def __init__(self, node, group, separately=False, trace_id=0):
         self.session = elliptics.newapi.Session(node)
+        self.session.cflags |= elliptics.command_flags.prio_recovery
         self.session.groups = [group]
         self.session.trace_id = trace_id
         self.separately = separately
@@ -319,6 +299,9 @@ class Iterator(object):
                 self._on_key_response(results, record, address, backend_id)
             end = time.time()
 
+            for result in results.values():
+                result.flush()
+
             elapsed_time = records.elapsed_time()
             self.log.debug("Time spended for iterator: {0}/{1}".format(elapsed_time.tsec, elapsed_time.tnsec))
             yield (iterated_keys, total_keys, positive_responses, negative_responses, start, end)
@@ -432,7 +415,7 @@ class MergeRecoveryIterator(Iterator):
 
 class MergeData(object):
     """
-    Assist class for IteratorResult.__merge__
+    Assist class for merging iterator results
     """
 
     def __init__(self, result, container):
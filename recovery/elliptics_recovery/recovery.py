@@ -94,6 +94,7 @@ def main(options, args):
     ctx.custom_recover = options.custom_recover
     ctx.no_meta = options.no_meta and (options.timestamp is None)
     ctx.no_server_send = options.no_server_send
+    ctx.native = options.native
     ctx.user_flags_set = frozenset(int(user_flags) for user_flags in options.user_flags_set)
 
     try:
@@ -431,6 +432,9 @@ def run(args=None):
                             'if there is no network connection between groups'))
     parser.add_option('--user-flags', action='append', dest='user_flags_set', default=[],
                       help='Recover key if at least one replica has user_flags from specified user_flags_set')
+    parser.add_option('--native', action="store_true", dest="native", default=False,
+                      help=('Run merge recovery by native engine which iterates and server-sends keys '
+                            'by a pipeline of threads within one process. It ignores --nprocess'))
     parser.add_option('--data-flow-rate', action='store', dest='data_flow_rate', default=10,
                       help=('Expected execution speed for an I/O operation: server-send/read/write/etc. '
                             '[default: %default] Mb'))
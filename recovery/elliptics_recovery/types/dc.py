@@ -284,6 +284,7 @@ def process_uncommitted(ctx, results):
                                  io_thread_num=1,
                                  remotes=ctx.remotes)
     session = elliptics.newapi.Session(node)
+    session.cflags |= elliptics.command_flags.prio_recovery
     session.trace_id = ctx.trace_id
     session.exceptions_policy = elliptics.exceptions_policy.no_exceptions
     session.set_filter(elliptics.filters.all_final)
@@ -542,6 +543,7 @@ def lookup_keys(ctx):
                                  io_thread_num=1,
                                  remotes=ctx.remotes)
     session = elliptics.newapi.Session(node)
+    session.cflags |= elliptics.command_flags.prio_recovery
     session.trace_id = ctx.trace_id
     session.exceptions_policy = elliptics.exceptions_policy.no_exceptions
     session.set_filter(elliptics.filters.all_final)
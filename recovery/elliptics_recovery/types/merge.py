@@ -122,6 +122,52 @@ def process_node_backend(ctx, address, backend_id, group, ranges):
         return False
 
 
+def process_group_native(ctx, group, group_routes):
+    """
+    Recovers @group by native merge recovery from elliptics.core:
+    iteration and server-send are done by threads of one process without GIL.
+    """
+    try:
+        log.debug("Processing group: {0} by native merge recovery".format(group))
+        elog = elliptics.Logger(ctx.log_file, int(ctx.log_level), True)
+        node = elliptics_create_node(address=ctx.address,
+                                     elog=elog,
+                                     wait_timeout=ctx.wait_timeout,
+                                     remotes=ctx.remotes,
+                                     io_thread_num=4)
+
+        config = elliptics.core.MergeRecoveryConfig()
+        config.group = group
+        config.one_node = ctx.one_node
+        if ctx.one_node:
+            has_backends = False
+            for address, backend_id in group_routes.addresses_with_backends():
+                if address != ctx.address:
+                    continue
+                if ctx.backend_id is not None and backend_id != ctx.backend_id:
+                    continue
+                config.add_backend(address.host, address.port, address.family, backend_id)
+                has_backends = True
+            if not has_backends:
+                log.warning("There is no backends to recover in group: {0}, skipping this group".format(group))
+                return True
+        config.timestamp = ctx.timestamp.to_etime()
+        config.batch_size = ctx.batch_size
+        config.attempts = ctx.attempts
+        config.safe = ctx.safe
+        config.dry_run = ctx.dry_run
+        config.timeout = ctx.wait_timeout
+        config.trace_id = ctx.trace_id
+        if ctx.dump_keys:
+            config.tmp_dir = ctx.tmp_dir
+        config.corrupted_keys_path = ctx.corrupted_keys.name
+        return elliptics.core.merge_recovery(node, config, ctx.stats)
+    except Exception as e:
+        log.error("Native merge recovery of group: {0} failed: {1}, traceback: {2}"
+                  .format(group, repr(e), traceback.format_exc()))
+        return False
+
+
 def get_ranges(ctx, group):
     ranges = dict()
     routes = ctx.routes.filter_by_group(group)
@@ -187,6 +233,11 @@ def main(ctx):
             group_stats.timer('group', 'finished')
             continue
 
+        if ctx.native:
+            ret &= process_group_native(ctx, group, group_routes)
+            group_stats.timer('group', 'finished')
+            continue
+
         ranges = get_ranges(ctx, group)
 
         if ranges is None or not len(ranges):
@@ -239,6 +290,7 @@ class ServerSendRecovery(object):
         self.routes = ctx.routes.filter_by_groups([group])
         self.backends = self._prepare_backends(ctx, group, address, backend_id)
         self.session = elliptics.Session(node)
+        self.session.cflags |= elliptics.command_flags.prio_recovery
         self.session.exceptions_policy = elliptics.exceptions_policy.no_exceptions
         self.session.set_filter(elliptics.filters.all)
         self.session.timeout = 60
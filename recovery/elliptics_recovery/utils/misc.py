@@ -70,7 +70,7 @@ def elliptics_create_session(node=None, group=None, cflags=elliptics.command_fla
     log.debug("Creating session: {0}@{1}.{2}".format(node, group, cflags))
     session = elliptics.Session(node)
     session.groups = [group]
-    session.cflags = cflags
+    session.cflags = cflags | elliptics.command_flags.prio_recovery
     session.trace_id = trace_id
     return session
 
@@ -188,6 +188,7 @@ class DirectOperation(object):
     def __init__(self, address, backend_id, id, group, ctx, node, callback):
         # creates new session
         self.session = elliptics.Session(node)
+        self.session.cflags |= elliptics.command_flags.prio_recovery
         # turns off exceptions
         self.session.exceptions_policy = elliptics.core.exceptions_policy.no_exceptions
         # makes session direct to the address
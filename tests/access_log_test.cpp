@@ -0,0 +1,272 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+#include <boost/program_options.hpp>
+
+#define BOOST_TEST_NO_MAIN
+#define BOOST_TEST_ALTERNATIVE_INIT_API
+#include <boost/test/included/unit_test.hpp>
+
+#include "test_base.hpp"
+#include "library/access_ring.h"
+#include "library/logger.hpp"
+
+using namespace ioremap::elliptics;
+namespace bu = boost::unit_test;
+
+namespace tests {
+
+// collects attributes of the record as "name=value" strings
+struct record_collector {
+	std::vector<std::string> attributes;
+
+	void operator()(const char *name, int64_t value) {
+		attributes.emplace_back(std::string(name) + "=" + std::to_string(value));
+	}
+
+	void operator()(const char *name, uint64_t value) {
+		attributes.emplace_back(std::string(name) + "=" + std::to_string(value) + "u");
+	}
+
+	void operator()(const char *name, double value) {
+		attributes.emplace_back(std::string(name) + "=" + std::to_string(value));
+	}
+
+	void operator()(const char *name, const char *value, size_t size) {
+		attributes.emplace_back(std::string(name) + "=" + std::string(value, size));
+	}
+};
+
+static std::vector<std::string> collect(const dnet_access_record &record) {
+	record_collector collector;
+	record.visit(collector);
+	return collector.attributes;
+}
+
+static void test_record_encode_visit() {
+	std::unique_ptr<dnet_access_record> record(new dnet_access_record);
+
+	// names and values are not literals and are released before the record is visited
+	{
+		std::string name = "int";
+		record->append({name.c_str(), int64_t(-5)});
+		name = "uint";
+		record->append({name.c_str(), uint64_t(5)});
+		name = "double";
+		record->append({name.c_str(), 0.5});
+		name = "string";
+		std::string value = "value";
+		record->append({name.c_str(), value.c_str()});
+		name = "std::string";
+		record->append({name.c_str(), value});
+		name.assign(name.size(), 'x');
+		value.assign(value.size(), 'x');
+	}
+	record->append({"empty", ""});
+
+	BOOST_REQUIRE(!record->overflowed());
+	BOOST_REQUIRE_LE(record->size(), dnet_access_record::capacity);
+
+	const std::vector<std::string> expected{
+		"int=-5", "uint=5u", "double=" + std::to_string(0.5), "string=value", "std::string=value", "empty="
+	};
+	const auto attributes = collect(*record);
+	BOOST_REQUIRE_EQUAL_COLLECTIONS(attributes.begin(), attributes.end(), expected.begin(), expected.end());
+}
+
+static void test_record_null_values() {
+	std::unique_ptr<dnet_access_record> record(new dnet_access_record);
+	record->append({nullptr, int64_t(1)});
+	record->append({"null", (const char *)nullptr});
+
+	const std::vector<std::string> expected{"=1", "null="};
+	const auto attributes = collect(*record);
+	BOOST_REQUIRE_EQUAL_COLLECTIONS(attributes.begin(), attributes.end(), expected.begin(), expected.end());
+}
+
+static void test_record_overflow() {
+	std::unique_ptr<dnet_access_record> record(new dnet_access_record);
+	const std::string value(100, 'v');
+
+	std::vector<std::string> expected;
+	for (size_t i = 0; i < 3 * dnet_access_record::capacity / value.size(); ++i) {
+		const auto name = "attribute_" + std::to_string(i);
+		record->append({name.c_str(), value});
+		expected.emplace_back(name + "=" + value);
+	}
+
+	BOOST_REQUIRE(record->overflowed());
+	BOOST_REQUIRE_LE(record->size(), dnet_access_record::capacity);
+
+	// spilled attributes follow inline ones, so the order is kept for the single writer
+	const auto attributes = collect(*record);
+	BOOST_REQUIRE_EQUAL_COLLECTIONS(attributes.begin(), attributes.end(), expected.begin(), expected.end());
+}
+
+static void test_record_concurrent_append() {
+	std::unique_ptr<dnet_access_record> record(new dnet_access_record);
+	const size_t threads_count = 8;
+	const size_t attributes_count = 50;
+
+	std::vector<std::thread> threads;
+	for (size_t thread = 0; thread < threads_count; ++thread) {
+		threads.emplace_back([&record, thread] () {
+			for (size_t i = 0; i < attributes_count; ++i) {
+				const auto name = std::to_string(thread) + "_" + std::to_string(i);
+				record->append({name.c_str(), uint64_t(i)});
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	BOOST_REQUIRE(record->overflowed());
+
+	std::vector<std::string> expected;
+	for (size_t thread = 0; thread < threads_count; ++thread) {
+		for (size_t i = 0; i < attributes_count; ++i) {
+			expected.emplace_back(std::to_string(thread) + "_" + std::to_string(i) + "=" + std::to_string(i) + "u");
+		}
+	}
+	std::sort(expected.begin(), expected.end());
+
+	auto attributes = collect(*record);
+	std::sort(attributes.begin(), attributes.end());
+	BOOST_REQUIRE_EQUAL_COLLECTIONS(attributes.begin(), attributes.end(), expected.begin(), expected.end());
+}
+
+// counts lines of @path which contain all @patterns
+static size_t count_lines(const std::string &path, const std::vector<std::string> &patterns) {
+	std::ifstream stream(path);
+	size_t count = 0;
+	std::string line;
+	while (std::getline(stream, line)) {
+		bool matched = true;
+		for (const auto &pattern : patterns) {
+			matched = matched && line.find(pattern) != std::string::npos;
+		}
+		count += matched;
+	}
+	return count;
+}
+
+/*
+ * Sends much more requests than the ring of the server can hold and checks that each of them is printed
+ * into access log exactly once: either by the draining thread or synchronously when the ring is full.
+ */
+static void test_ring_prints_all_records(session &s, const nodes_data *setup) {
+	const size_t requests_count = 5000;
+	const trace_id_t trace_id = 0xac0e55;
+	s.set_trace_id(trace_id);
+
+	std::vector<async_write_result> results;
+	for (size_t i = 0; i < requests_count; ++i) {
+		results.emplace_back(s.write_data("test_ring_prints_all_records_" + std::to_string(i), "data", 0));
+	}
+	for (auto &result : results) {
+		ELLIPTICS_REQUIRE(async, std::move(result));
+	}
+
+	const auto &access_path = setup->nodes.front().config().access_path;
+	const std::vector<std::string> patterns{"access=server", "cmd=WRITE", "trace_id=" + to_hex_string(trace_id)};
+
+	size_t printed = 0;
+	for (size_t attempt = 0; attempt < 100; ++attempt) {
+		printed = count_lines(access_path, patterns);
+		if (printed >= requests_count)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+	BOOST_REQUIRE_EQUAL(printed, requests_count);
+}
+
+static nodes_data::ptr configure_test_setup(const std::string &path) {
+	auto server = server_config::default_value();
+	server.backends[0]("enable", true)("group", 1);
+
+	start_nodes_config config(bu::results_reporter::get_stream(), {server}, path);
+	config.fork = true;
+
+	return start_nodes(config);
+}
+
+static bool register_tests(const nodes_data *setup) {
+	auto n = setup->node->get_native();
+
+	ELLIPTICS_TEST_CASE_NOARGS(test_record_encode_visit);
+	ELLIPTICS_TEST_CASE_NOARGS(test_record_null_values);
+	ELLIPTICS_TEST_CASE_NOARGS(test_record_overflow);
+	ELLIPTICS_TEST_CASE_NOARGS(test_record_concurrent_append);
+	ELLIPTICS_TEST_CASE(test_ring_prints_all_records, use_session(n, {1}), setup);
+
+	return true;
+}
+
+static nodes_data::ptr configure_test_setup_from_args(int argc, char *argv[]) {
+	namespace bpo = boost::program_options;
+
+	bpo::variables_map vm;
+	bpo::options_description generic("Test options");
+
+	std::string path;
+
+	generic.add_options()
+		("help", "This help message")
+		("path", bpo::value(&path), "Path where to store everything")
+		;
+
+	bpo::store(bpo::parse_command_line(argc, argv, generic), vm);
+	bpo::notify(vm);
+
+	if (vm.count("help")) {
+		std::cerr << generic;
+		return nullptr;
+	}
+
+	return configure_test_setup(path);
+}
+
+} /* namespace tests */
+
+/*
+ * Common test initialization routine.
+ */
+namespace {
+std::shared_ptr<tests::nodes_data> setup;
+bool init_func() {
+	return tests::register_tests(setup.get());
+}
+}
+
+int main(int argc, char *argv[]) {
+	srand(time(nullptr));
+
+	// we own our test setup
+	setup = tests::configure_test_setup_from_args(argc, argv);
+
+	int result = bu::unit_test_main(init_func, argc, argv);
+
+	// disassemble setup explicitly, to be sure about where its lifetime ends
+	setup.reset();
+
+	return result;
+}
@@ -19,6 +19,7 @@
 #include "library/backend.h"
 
 #include "library/backend.h"
+#include "monitor/statistics.hpp"
 
 #include <list>
 #include <stdexcept>
@@ -34,15 +35,91 @@ using namespace boost::unit_test;
 
 namespace tests {
 
+constexpr int group = 5;
+constexpr int backend_id = 0;
+
+constexpr int group_with_admission = 6;
+constexpr int backend_with_admission = 1;
+
+constexpr int group_with_chunks = 7;
+constexpr int backend_with_chunks = 2;
+
+constexpr int group_with_flush = 8;
+constexpr int backend_with_flush = 3;
+
+constexpr int group_with_l2 = 9;
+constexpr int backend_with_l2 = 4;
+
+constexpr int group_with_compression = 10;
+constexpr int backend_with_compression = 5;
+
 static nodes_data::ptr configure_test_setup(const std::string &path)
 {
-	start_nodes_config start_config(results_reporter::get_stream(), std::vector<server_config>({
-		server_config::default_value().apply_options(config_data()
-			("group", 5)
-			("cache_size", "100K")
-			("cache_shards", 1)
+	auto server = server_config::default_value().apply_options(config_data()
+		("group", group)
+		("cache_size", "100K")
+		("cache_shards", 1)
+		("cache_snapshot_dir", path)
+		("cache_snapshot_value_size", "1K")
+	);
+
+	// cache features which change its behaviour are enabled only at backends of their tests
+	server.backends.resize(6, server.backends.front());
+	server.backends[0]
+		("backend_id", backend_id)
+	;
+	server.backends[1]
+		("backend_id", backend_with_admission)
+		("group", group_with_admission)
+		("cache", config_data()
+			("size", "100K")
+			("shards", 1)
+			("admission_filter", true)
+		)
+	;
+	server.backends[2]
+		("backend_id", backend_with_chunks)
+		("group", group_with_chunks)
+		("cache", config_data()
+			("size", "100K")
+			("shards", 1)
+			("chunk_size", "4K")
+		)
+	;
+	server.backends[3]
+		("backend_id", backend_with_flush)
+		("group", group_with_flush)
+		("cache", config_data()
+			("size", "100K")
+			("shards", 1)
+			("sync_timeout", 1)
+			("flush_threads", 4)
 		)
-	}), path);
+	;
+	// only clean records are evicted to the second tier, so they are synced quickly
+	server.backends[4]
+		("backend_id", backend_with_l2)
+		("group", group_with_l2)
+		("cache", config_data()
+			("size", "100K")
+			("shards", 1)
+			("sync_timeout", 1)
+			("l2_dir", path)
+			("l2_size", "1M")
+		)
+	;
+	server.backends[5]
+		("backend_id", backend_with_compression)
+		("group", group_with_compression)
+		("cache", config_data()
+			("size", "100K")
+			("shards", 1)
+			("compression", "zlib")
+			("compression_threshold", "1K")
+		)
+	;
+
+	start_nodes_config start_config(results_reporter::get_stream(), std::vector<server_config>({server}), path);
 
 	return start_nodes(start_config);
 }
@@ -287,6 +364,343 @@ static void test_cache_lru_eviction(session &sess, const nodes_data *setup)
 
 /*! \} */ //test_cache_lru_eviction group
 
+/*
+ * Checks that records cached before backend's restart are loaded into the cache from snapshot after it.
+ */
+static void test_cache_snapshot(session &sess, const nodes_data *setup)
+{
+	const auto &server = setup->nodes[0];
+	dnet_node *node = server.get_native();
+	auto backend = node->io->backends_manager->get(0);
+	const size_t records_number = 10;
+	const std::string data("snapshot data");
+
+	backend->cache()->clear();
+	for (size_t id = 0; id < records_number; ++id) {
+		ELLIPTICS_REQUIRE(write_result,
+		                  sess.write_cache(key("snapshot " + boost::lexical_cast<std::string>(id)), data, 3000));
+	}
+
+	ELLIPTICS_REQUIRE(disable_result, sess.disable_backend(server.remote(), 0));
+	ELLIPTICS_REQUIRE(enable_result, sess.enable_backend(server.remote(), 0));
+
+	auto cache = backend->cache();
+	auto stats = cache->get_total_cache_stats();
+	for (size_t i = 0; i < 100; ++i) {
+		stats = cache->get_total_cache_stats();
+		if (stats.number_of_warmed_up_objects + stats.number_of_skipped_warmup_objects >=
+		    stats.number_of_warmup_objects)
+			break;
+		usleep(100 * 1000);
+	}
+
+	BOOST_REQUIRE_EQUAL(stats.number_of_warmup_objects, records_number);
+	BOOST_REQUIRE_EQUAL(stats.number_of_warmed_up_objects, records_number);
+	BOOST_REQUIRE_EQUAL(stats.number_of_objects, records_number);
+
+	sess.set_ioflags(DNET_IO_FLAGS_CACHE | DNET_IO_FLAGS_CACHE_ONLY);
+	for (size_t id = 0; id < records_number; ++id) {
+		ELLIPTICS_COMPARE_REQUIRE(read_result,
+		                          sess.read_data(key("snapshot " + boost::lexical_cast<std::string>(id)), 0, 0),
+		                          data);
+	}
+}
+
+// returns number of records read by the backend's cache from disk
+static uint64_t cache_disk_reads(dnet_backend *backend)
+{
+	rapidjson::Document commands;
+	commands.SetObject();
+	backend->command_stats().commands_report(nullptr, {}, commands, commands.GetAllocator());
+	if (!commands.HasMember("READ_NEW"))
+		return 0;
+	// cache reads records from disk by internal READ_NEW bypassing the cache
+	return commands["READ_NEW"]["disk"]["internal"]["successes"].GetUint64();
+}
+
+/*
+ * Checks that concurrent reads of the same key missed in the cache are coalesced into the single fill:
+ * the backend's delay holds the fill from disk while other readers miss the key.
+ */
+static void test_cache_coalesced_misses(session &sess, const nodes_data *setup)
+{
+	const auto &server = setup->nodes[0];
+	auto backend = server.get_native()->io->backends_manager->get(0);
+	auto cache = backend->cache();
+	const size_t readers_number = 10;
+	const std::string data("coalesced misses data");
+	key k("coalesced misses key");
+
+	// write the record to disk only, so the cache misses it
+	auto disk_sess = sess.clone();
+	disk_sess.set_ioflags(0);
+	ELLIPTICS_REQUIRE(write_result, disk_sess.write_data(k, data, 0));
+
+	cache->clear();
+	const auto stats_before = cache->get_total_cache_stats();
+	const auto disk_reads_before = cache_disk_reads(backend.get());
+
+	// the delay is slept by every request and by the fill's read from disk, so readers which have slept it
+	// find the fill in progress. Readers don't lock the key, so they are handled concurrently.
+	ELLIPTICS_REQUIRE(delay_result, sess.set_delay(server.remote(), 0, 300));
+	auto readers_sess = sess.clone();
+	readers_sess.set_cflags(DNET_FLAGS_NOLOCK);
+
+	std::vector<async_read_result> results;
+	for (size_t i = 0; i < readers_number; ++i) {
+		results.emplace_back(readers_sess.read_data(k, 0, 0));
+	}
+	for (auto &result : results) {
+		ELLIPTICS_COMPARE_REQUIRE(read_result, std::move(result), data);
+	}
+
+	ELLIPTICS_REQUIRE(reset_delay_result, sess.set_delay(server.remote(), 0, 0));
+
+	const auto stats = cache->get_total_cache_stats();
+	BOOST_REQUIRE_EQUAL(stats.number_of_objects, 1);
+	BOOST_REQUIRE_GT(stats.number_of_coalesced_misses - stats_before.number_of_coalesced_misses, 0);
+	BOOST_REQUIRE_EQUAL(stats.number_of_fill_wait_timeouts, stats_before.number_of_fill_wait_timeouts);
+	BOOST_REQUIRE_EQUAL(cache_disk_reads(backend.get()) - disk_reads_before, 1);
+}
+
+/*
+ * Checks that reads of a scan over keys not cached yet don't evict records from the full cache:
+ * records of the scan aren't admitted but are read, and a key read repeatedly is admitted.
+ */
+static void test_cache_admission(session &sess, const nodes_data *setup)
+{
+	dnet_node *node = setup->nodes[0].get_native();
+	auto cache = node->io->backends_manager->get(backend_with_admission)->cache();
+	const std::string data(1024, 'a');
+	const size_t records_number = 2 * cache->cache_size() / data.size();
+	auto record_key = [] (size_t id) {
+		return key("admission " + boost::lexical_cast<std::string>(id));
+	};
+
+	// write records to disk only, so reads fill the cache
+	auto disk_sess = sess.clone();
+	disk_sess.set_ioflags(0);
+	for (size_t id = 0; id < records_number; ++id) {
+		ELLIPTICS_REQUIRE(write_result, disk_sess.write_data(record_key(id), data, 0));
+	}
+
+	cache->clear();
+	const auto stats_before = cache->get_total_cache_stats();
+
+	for (size_t id = 0; id < records_number; ++id) {
+		ELLIPTICS_COMPARE_REQUIRE(read_result, sess.read_data(record_key(id), 0, 0), data);
+	}
+
+	auto stats = cache->get_total_cache_stats();
+	BOOST_REQUIRE_GT(stats.number_of_rejected_objects, stats_before.number_of_rejected_objects);
+	BOOST_REQUIRE_LT(stats.number_of_objects, records_number);
+
+	auto cache_only_sess = sess.clone();
+	cache_only_sess.set_ioflags(DNET_IO_FLAGS_CACHE | DNET_IO_FLAGS_CACHE_ONLY);
+	const auto last_key = record_key(records_number - 1);
+	ELLIPTICS_REQUIRE_ERROR(not_cached_result, cache_only_sess.read_data(last_key, 0, 0), -ENOENT);
+
+	// the second access makes the key more frequent than the least recently used record read once
+	ELLIPTICS_COMPARE_REQUIRE(read_result, sess.read_data(last_key, 0, 0), data);
+
+	stats = cache->get_total_cache_stats();
+	BOOST_REQUIRE_GT(stats.number_of_admitted_objects, stats_before.number_of_admitted_objects);
+	ELLIPTICS_COMPARE_REQUIRE(cached_result, cache_only_sess.read_data(last_key, 0, 0), data);
+}
+
+/*
+ * Checks that only chunks covering requested ranges of large object are read into the cache
+ * and writes to the object update its cached chunks.
+ */
+static void test_cache_chunks(session &sess, const nodes_data *setup)
+{
+	dnet_node *node = setup->nodes[0].get_native();
+	auto cache = node->io->backends_manager->get(backend_with_chunks)->cache();
+	const size_t chunk_size = 4096;
+	std::string data(16 * chunk_size, 'a');
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] += i % 26;
+	}
+	key k("chunks key");
+
+	auto disk_sess = sess.clone();
+	disk_sess.set_ioflags(DNET_IO_FLAGS_NOCACHE);
+	ELLIPTICS_REQUIRE(write_result, disk_sess.write_data(k, data, 0));
+
+	cache->clear();
+
+	const size_t offset = 2 * chunk_size + 100;
+	ELLIPTICS_COMPARE_REQUIRE(read_result, sess.read_data(k, offset, 100), data.substr(offset, 100));
+
+	auto stats = cache->get_total_cache_stats();
+	BOOST_REQUIRE_EQUAL(stats.number_of_chunked_objects, 1);
+	BOOST_REQUIRE_EQUAL(stats.number_of_chunks, 1);
+
+	// range crossing the border of chunks
+	ELLIPTICS_COMPARE_REQUIRE(border_read_result, sess.read_data(k, chunk_size - 100, 200),
+	                          data.substr(chunk_size - 100, 200));
+
+	stats = cache->get_total_cache_stats();
+	BOOST_REQUIRE_EQUAL(stats.number_of_chunks, 3);
+
+	ELLIPTICS_REQUIRE(patch_result, sess.write_data(k, std::string("patch"), offset + 50));
+
+	ELLIPTICS_REQUIRE(disk_read_result, disk_sess.read_data(k, offset, 100));
+	const std::string patched = disk_read_result.get_one().file().to_string();
+
+	auto cache_only_sess = sess.clone();
+	cache_only_sess.set_ioflags(DNET_IO_FLAGS_CACHE | DNET_IO_FLAGS_CACHE_ONLY);
+	ELLIPTICS_COMPARE_REQUIRE(cached_read_result, cache_only_sess.read_data(k, offset, 100), patched);
+}
+
+/*
+ * Checks that records written to the cache are accounted as dirty until they are flushed to disk.
+ */
+static void test_cache_flush(session &sess, const nodes_data *setup)
+{
+	dnet_node *node = setup->nodes[0].get_native();
+	auto cache = node->io->backends_manager->get(backend_with_flush)->cache();
+	const size_t records_number = 100;
+	const std::string data("flush data");
+	auto record_key = [] (size_t id) {
+		return key("flush " + boost::lexical_cast<std::string>(id));
+	};
+
+	cache->clear();
+	const auto stats_before = cache->get_total_cache_stats();
+
+	for (size_t id = 0; id < records_number; ++id) {
+		ELLIPTICS_REQUIRE(write_result, sess.write_data(record_key(id), data, 0));
+	}
+
+	auto stats = cache->get_total_cache_stats();
+	for (size_t i = 0; i < 100; ++i) {
+		stats = cache->get_total_cache_stats();
+		if (stats.number_of_dirty_objects == 0 &&
+		    stats.number_of_flushed_objects - stats_before.number_of_flushed_objects >= records_number)
+			break;
+		usleep(100 * 1000);
+	}
+
+	BOOST_REQUIRE_EQUAL(stats.number_of_dirty_objects, 0);
+	BOOST_REQUIRE_EQUAL(stats.size_of_dirty_objects, 0);
+	BOOST_REQUIRE_GE(stats.number_of_flushed_objects - stats_before.number_of_flushed_objects, records_number);
+
+	auto disk_sess = sess.clone();
+	disk_sess.set_ioflags(DNET_IO_FLAGS_NOCACHE);
+	for (size_t id = 0; id < records_number; ++id) {
+		ELLIPTICS_COMPARE_REQUIRE(read_result, disk_sess.read_data(record_key(id), 0, 0), data);
+	}
+}
+
+static void test_cache_l2(session &sess, const nodes_data *setup)
+{
+	dnet_node *node = setup->nodes[0].get_native();
+	auto cache = node->io->backends_manager->get(backend_with_l2)->cache();
+	const size_t records_number = 50;
+	const std::string data(1000, 'l');
+	auto record_key = [] (const std::string &prefix, size_t id) {
+		return key(prefix + boost::lexical_cast<std::string>(id));
+	};
+
+	// only clean records are evicted to the second tier, so records are synced before they are evicted
+	auto wait_for_flush = [&] () {
+		for (size_t i = 0; i < 100 && cache->get_total_cache_stats().number_of_dirty_objects; ++i) {
+			usleep(100 * 1000);
+		}
+		BOOST_REQUIRE_EQUAL(cache->get_total_cache_stats().number_of_dirty_objects, 0);
+	};
+	auto evict = [&] () {
+		for (size_t id = 0; id < 3 * records_number; ++id) {
+			ELLIPTICS_REQUIRE(write_result, sess.write_data(record_key("l2 evict ", id), data, 0));
+		}
+	};
+
+	cache->clear();
+	const auto stats_before = cache->get_l2_cache_stats();
+
+	for (size_t id = 0; id < records_number; ++id) {
+		ELLIPTICS_REQUIRE(write_result, sess.write_data(record_key("l2 ", id), data, 0));
+	}
+	wait_for_flush();
+	evict();
+
+	// records are written to the tier in background
+	auto stats = cache->get_l2_cache_stats();
+	for (size_t i = 0; i < 100 && stats.number_of_objects < records_number; ++i) {
+		usleep(100 * 1000);
+		stats = cache->get_l2_cache_stats();
+	}
+	BOOST_REQUIRE_GE(stats.number_of_objects, records_number);
+	BOOST_REQUIRE_LE(stats.size_of_objects, stats.max_size);
+
+	for (size_t id = 0; id < records_number; ++id) {
+		ELLIPTICS_COMPARE_REQUIRE(read_result, sess.read_data(record_key("l2 ", id), 0, 0), data);
+	}
+
+	stats = cache->get_l2_cache_stats();
+	BOOST_REQUIRE_GE(stats.number_of_hits - stats_before.number_of_hits, records_number);
+
+	// write drops outdated record from the tier, so the new data is read after its eviction
+	const std::string new_data(1000, 'n');
+	ELLIPTICS_REQUIRE(write_result, sess.write_data(record_key("l2 ", 0), new_data, 0));
+	wait_for_flush();
+	evict();
+	ELLIPTICS_COMPARE_REQUIRE(read_result, sess.read_data(record_key("l2 ", 0), 0, 0), new_data);
+
+	cache->clear();
+	BOOST_REQUIRE_EQUAL(cache->get_l2_cache_stats().number_of_objects, 0);
+}
+
+/*
+ * Checks that records read from disk are stored compressed unless they are incompressible
+ * and writes to compressed records modify their decompressed data.
+ */
+static void test_cache_compression(session &sess, const nodes_data *setup)
+{
+	dnet_node *node = setup->nodes[0].get_native();
+	auto cache = node->io->backends_manager->get(backend_with_compression)->cache();
+	std::string data;
+	while (data.size() < 3000) {
+		data += "{\"key\": \"value\", \"number\": 12345}, ";
+	}
+	std::string random_data(3000, '\0');
+	for (auto &c : random_data) {
+		c = rand();
+	}
+	key k("compression key");
+	key random_k("compression random key");
+
+	auto disk_sess = sess.clone();
+	disk_sess.set_ioflags(DNET_IO_FLAGS_NOCACHE);
+	ELLIPTICS_REQUIRE(write_result, disk_sess.write_data(k, data, 0));
+	ELLIPTICS_REQUIRE(random_write_result, disk_sess.write_data(random_k, random_data, 0));
+
+	cache->clear();
+	const auto stats_before = cache->get_total_cache_stats();
+
+	ELLIPTICS_COMPARE_REQUIRE(read_result, sess.read_data(k, 0, 0), data);
+	ELLIPTICS_COMPARE_REQUIRE(random_read_result, sess.read_data(random_k, 0, 0), random_data);
+
+	auto stats = cache->get_total_cache_stats();
+	BOOST_REQUIRE_EQUAL(stats.number_of_compressed_objects, 1);
+	BOOST_REQUIRE_EQUAL(stats.logical_size_of_compressed_data, data.size());
+	BOOST_REQUIRE_LT(stats.size_of_compressed_data, data.size());
+	BOOST_REQUIRE_EQUAL(stats.number_of_incompressible_objects - stats_before.number_of_incompressible_objects, 1);
+
+	auto cache_only_sess = sess.clone();
+	cache_only_sess.set_ioflags(DNET_IO_FLAGS_CACHE | DNET_IO_FLAGS_CACHE_ONLY);
+	ELLIPTICS_COMPARE_REQUIRE(cached_read_result, cache_only_sess.read_data(k, 0, 0), data);
+
+	ELLIPTICS_REQUIRE(patch_result, sess.write_data(k, std::string("patch"), 10));
+	data.replace(10, 5, "patch");
+
+	stats = cache->get_total_cache_stats();
+	BOOST_REQUIRE_EQUAL(stats.number_of_compressed_objects, 0);
+	BOOST_REQUIRE_EQUAL(stats.size_of_compressed_data, 0);
+	ELLIPTICS_COMPARE_REQUIRE(patched_read_result, cache_only_sess.read_data(k, 0, 0), data);
+}
+
 std::string generate_data(size_t length)
 {
 	std::string data;
@@ -309,6 +723,15 @@ bool register_tests(const nodes_data *setup)
 	ELLIPTICS_TEST_CASE(test_cache_overflow, use_session(n, {5}, 0, DNET_IO_FLAGS_CACHE), setup);
 	ELLIPTICS_TEST_CASE(test_cache_lru_eviction,
 	                    use_session(n, {5}, 0, DNET_IO_FLAGS_CACHE | DNET_IO_FLAGS_CACHE_ONLY), setup);
+	ELLIPTICS_TEST_CASE(test_cache_snapshot, use_session(n, {5}, 0, DNET_IO_FLAGS_CACHE), setup);
+	ELLIPTICS_TEST_CASE(test_cache_coalesced_misses, use_session(n, {5}, 0, DNET_IO_FLAGS_CACHE), setup);
+	ELLIPTICS_TEST_CASE(test_cache_admission,
+	                    use_session(n, {group_with_admission}, 0, DNET_IO_FLAGS_CACHE), setup);
+	ELLIPTICS_TEST_CASE(test_cache_chunks, use_session(n, {group_with_chunks}, 0, DNET_IO_FLAGS_CACHE), setup);
+	ELLIPTICS_TEST_CASE(test_cache_flush, use_session(n, {group_with_flush}, 0, DNET_IO_FLAGS_CACHE), setup);
+	ELLIPTICS_TEST_CASE(test_cache_l2, use_session(n, {group_with_l2}, 0, DNET_IO_FLAGS_CACHE), setup);
+	ELLIPTICS_TEST_CASE(test_cache_compression,
+	                    use_session(n, {group_with_compression}, 0, DNET_IO_FLAGS_CACHE), setup);
 
 	return true;
 }
@@ -0,0 +1,189 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/program_options.hpp>
+
+#define BOOST_TEST_NO_MAIN
+#define BOOST_TEST_ALTERNATIVE_INIT_API
+#include <boost/test/included/unit_test.hpp>
+
+#include "elliptics/newapi/session.hpp"
+
+#include "test_base.hpp"
+
+using namespace ioremap::elliptics;
+namespace bu = boost::unit_test;
+
+namespace tests {
+
+static const int group_id = 1;
+
+static dnet_id checksum(session &s, const std::string &data) {
+	dnet_id csum;
+	memset(&csum, 0, sizeof(csum));
+	s.transform(data, csum);
+	return csum;
+}
+
+/*
+ * Overwrites the leading bytes of the record's data on disk, so the checksum recomputed over the content
+ * doesn't match the checksum of written data anymore.
+ */
+static void corrupt_data(const std::string &path, uint64_t data_offset) {
+	auto fd = open(path.c_str(), O_RDWR, 0644);
+	BOOST_REQUIRE(fd > 0);
+
+	constexpr char injection[] = "inj";
+	BOOST_REQUIRE_EQUAL(pwrite(fd, injection, sizeof(injection), data_offset), sizeof(injection));
+
+	close(fd);
+}
+
+static std::string read_data(session &s, const std::string &id) {
+	ELLIPTICS_REQUIRE(async, s.read_data(id, 0, 0));
+	return async.get_one().file().to_string();
+}
+
+/*
+ * Whole-content write keeps the digest, so compare-and-swap compares against it instead of
+ * recomputing the checksum over the (corrupted) content.
+ */
+static void test_cas_uses_stored_digest(session &s) {
+	const std::string id = "test_cas_uses_stored_digest";
+	const std::string data = "test_cas_uses_stored_digest data";
+
+	ELLIPTICS_REQUIRE(write_result, s.write_data(id, data, 0));
+	auto result = write_result.get_one();
+	corrupt_data(result.file_path(), result.file_info()->offset);
+
+	ELLIPTICS_REQUIRE(cas_result, s.write_cas(id, std::string("new data"), checksum(s, data), 0));
+}
+
+/*
+ * Single-shot WRITE_NEW keeps the digest too. Json is empty, so the content is data only.
+ */
+static void test_write_new_digest(session &s) {
+	const std::string id = "test_write_new_digest";
+	const std::string data = "test_write_new_digest data";
+
+	newapi::session new_session(s);
+	ELLIPTICS_REQUIRE(write_result, new_session.write(id, std::string(), 0, data, 0));
+	auto result = write_result.get_one();
+	corrupt_data(result.path(), result.record_info().data_offset);
+
+	ELLIPTICS_REQUIRE(cas_result, s.write_cas(id, std::string("new data"), checksum(s, data), 0));
+}
+
+/*
+ * Writes which don't replace the whole content must drop the digest: compare-and-swap then works
+ * against the actual content, not against the checksum of the previous whole-content write.
+ */
+static void test_partial_overwrite_drops_digest(session &s) {
+	const std::string id = "test_partial_overwrite_drops_digest";
+	const std::string data = "0123456789";
+
+	// write at offset
+	ELLIPTICS_REQUIRE(write_result, s.write_data(id, data, 0));
+	ELLIPTICS_REQUIRE(offset_result, s.write_data(id, std::string("xx"), 2));
+
+	auto content = read_data(s, id);
+	BOOST_REQUIRE_EQUAL(content, "01xx456789");
+	ELLIPTICS_REQUIRE_ERROR(stale_result, s.write_cas(id, data, checksum(s, data), 0), -EBADFD);
+	ELLIPTICS_REQUIRE(cas_result, s.write_cas(id, data, checksum(s, content), 0));
+
+	// shrinking overwrite: if eblob keeps the tail of the previous content, the digest of the write is dropped
+	ELLIPTICS_REQUIRE(shrink_result, s.write_data(id, std::string("abc"), 0));
+
+	content = read_data(s, id);
+	BOOST_REQUIRE_NE(content, data);
+	ELLIPTICS_REQUIRE_ERROR(shrink_stale_result,
+	                        s.write_cas(id, std::string("new data"), checksum(s, data), 0), -EBADFD);
+	ELLIPTICS_REQUIRE(shrink_cas_result, s.write_cas(id, std::string("new data"), checksum(s, content), 0));
+}
+
+static nodes_data::ptr configure_test_setup(const std::string &path) {
+	auto server = server_config::default_value();
+	server.backends[0]("enable", true)("group", group_id)("content_digest", true);
+
+	start_nodes_config config(bu::results_reporter::get_stream(), {server}, path);
+	config.fork = true;
+
+	return start_nodes(config);
+}
+
+static bool register_tests(const nodes_data *setup) {
+	auto n = setup->node->get_native();
+
+	ELLIPTICS_TEST_CASE(test_cas_uses_stored_digest, use_session(n, {group_id}));
+	ELLIPTICS_TEST_CASE(test_write_new_digest, use_session(n, {group_id}));
+	ELLIPTICS_TEST_CASE(test_partial_overwrite_drops_digest, use_session(n, {group_id}));
+
+	return true;
+}
+
+static nodes_data::ptr configure_test_setup_from_args(int argc, char *argv[]) {
+	namespace bpo = boost::program_options;
+
+	bpo::variables_map vm;
+	bpo::options_description generic("Test options");
+
+	std::string path;
+
+	generic.add_options()
+		("help", "This help message")
+		("path", bpo::value(&path), "Path where to store everything")
+		;
+
+	bpo::store(bpo::parse_command_line(argc, argv, generic), vm);
+	bpo::notify(vm);
+
+	if (vm.count("help")) {
+		std::cerr << generic;
+		return nullptr;
+	}
+
+	return configure_test_setup(path);
+}
+
+} /* namespace tests */
+
+/*
+ * Common test initialization routine.
+ */
+namespace {
+std::shared_ptr<tests::nodes_data> setup;
+bool init_func() {
+	return tests::register_tests(setup.get());
+}
+}
+
+int main(int argc, char *argv[]) {
+	srand(time(nullptr));
+
+	// we own our test setup
+	setup = tests::configure_test_setup_from_args(argc, argv);
+
+	int result = bu::unit_test_main(init_func, argc, argv);
+
+	// disassemble setup explicitly, to be sure about where its lifetime ends
+	setup.reset();
+
+	return result;
+}
@@ -0,0 +1,100 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures throughput of SHA512 used for keys' transformation and checksums:
+ * serial and multi-buffer hashing of many short keys and single-stream hashing of large buffer.
+ * It isn't a test, so it is built but isn't run by test targets.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "library/crypto/sha512.h"
+#include "library/crypto/sha512_mb.h"
+
+namespace {
+
+template <typename Func>
+double measure(size_t iterations, Func func) {
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i) {
+		func();
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+void bench_keys(size_t key_size, size_t keys_count, size_t iterations) {
+	std::vector<std::string> keys(keys_count);
+	std::vector<iovec> messages(keys_count);
+	for (size_t i = 0; i < keys_count; ++i) {
+		keys[i].resize(key_size);
+		for (auto &c : keys[i]) {
+			c = 'a' + rand() % 26;
+		}
+		messages[i] = iovec{const_cast<char *>(keys[i].data()), keys[i].size()};
+	}
+
+	std::vector<char> hashes(keys_count * SHA512_DIGEST_SIZE);
+
+	const double serial = measure(iterations, [&] {
+		for (size_t i = 0; i < keys_count; ++i) {
+			sha512_buffer(keys[i].data(), keys[i].size(), hashes.data() + i * SHA512_DIGEST_SIZE);
+		}
+	});
+
+	const double batch = measure(iterations, [&] {
+		sha512_buffers(nullptr, 0, messages.data(), keys_count, hashes.data());
+	});
+
+	const double total = keys_count * iterations;
+	printf("keys: size: %4zu, serial: %10.0f keys/s, batch (%zu lanes): %10.0f keys/s, speedup: %.2f\n",
+	       key_size, total / serial, sha512_buffers_lanes(), total / batch, serial / batch);
+}
+
+void bench_stream(size_t size, size_t iterations) {
+	std::vector<char> data(size);
+	for (auto &c : data) {
+		c = rand();
+	}
+
+	char hash[SHA512_DIGEST_SIZE];
+	const double elapsed = measure(iterations, [&] {
+		sha512_buffer(data.data(), data.size(), hash);
+	});
+
+	printf("stream: size: %zu, %.1f MB/s\n", size, size * iterations / elapsed / (1 << 20));
+}
+
+} /* namespace */
+
+int main(int argc, char *argv[])
+{
+	const size_t keys_count = argc > 1 ? strtoul(argv[1], nullptr, 0) : 10000;
+	const size_t iterations = argc > 2 ? strtoul(argv[2], nullptr, 0) : 100;
+
+	for (size_t key_size : {16, 40, 100, 200, 1000}) {
+		bench_keys(key_size, keys_count, iterations);
+	}
+
+	bench_stream(64 << 20, 4);
+	return 0;
+}
@@ -14,9 +14,12 @@
  */
 
 #include <memory>
+#include <string>
+#include <vector>
 #include <cstdio>
 #include "test_base.hpp"
 #include "library/crypto/sha512.h"
+#include "library/crypto/sha512_mb.h"
 
 #define BOOST_TEST_NO_MAIN
 #define BOOST_TEST_ALTERNATIVE_INIT_API
@@ -96,9 +99,63 @@ static void test_sha512_file_cross_memory()
 	}
 }
 
+/*
+ * Hashes batches of random messages by sha512_buffers() with and without common prefix
+ * and checks that every digest is equal to the one calculated by sha512_ctx functions.
+ * Lengths of messages cover both single-block and multi-block messages, so lanes finish at different steps.
+ */
+static void test_sha512_buffers_cross_serial()
+{
+	const size_t num_iter = 100;
+	const size_t max_count = 100;
+	const size_t max_size = 400;
+
+	std::vector<std::string> data;
+	std::vector<iovec> messages;
+	std::vector<char> hashes;
+	char hash[64];
+	struct sha512_ctx ctx;
+
+	char ns[] = "namespace";
+	char separator[] = "";
+	const iovec prefix[] = {{ns, sizeof(ns) - 1}, {separator, 1}};
+
+	for (size_t i = 0; i < num_iter; ++i) {
+		const size_t count = rand() % max_count + 1;
+		const size_t prefix_count = (i % 2) ? 2 : 0;
+
+		data.resize(count);
+		messages.resize(count);
+		hashes.resize(count * sizeof(hash));
+
+		for (size_t j = 0; j < count; ++j) {
+			data[j].resize(rand() % max_size);
+			for (auto &c : data[j]) {
+				c = rand();
+			}
+			messages[j] = iovec{const_cast<char *>(data[j].data()), data[j].size()};
+		}
+
+		sha512_buffers(prefix, prefix_count, messages.data(), count, hashes.data());
+
+		for (size_t j = 0; j < count; ++j) {
+			sha512_init_ctx(&ctx);
+			for (size_t k = 0; k < prefix_count; ++k)
+				sha512_process_bytes(prefix[k].iov_base, prefix[k].iov_len, &ctx);
+			sha512_process_bytes(data[j].data(), data[j].size(), &ctx);
+			sha512_finish_ctx(&ctx, hash);
+
+			BOOST_REQUIRE_MESSAGE(memcmp(hashes.data() + j * sizeof(hash), hash, sizeof(hash)) == 0,
+				"sha512_buffers() differs from sha512_finish_ctx(): lanes: " << sha512_buffers_lanes() <<
+				", message size: " << data[j].size() << ", prefix count: " << prefix_count);
+		}
+	}
+}
+
 bool register_tests()
 {
 	ELLIPTICS_TEST_CASE_NOARGS(test_sha512_file_cross_memory);
+	ELLIPTICS_TEST_CASE_NOARGS(test_sha512_buffers_cross_serial);
 
 	return true;
 }
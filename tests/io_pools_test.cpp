@@ -1,5 +1,8 @@
 #include <fstream>
 
+#include <sched.h>
+
+#include <kora/config.hpp>
 #include <kora/dynamic.hpp>
 
 #include <boost/program_options.hpp>
@@ -9,6 +12,7 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include "test_base.hpp"
+#include "example/config.hpp"
 
 using namespace tests;
 namespace bu = boost::unit_test;
@@ -148,7 +152,8 @@ static void test_empy_node(ioremap::elliptics::newapi::session &s) {
 }
 
 static void add_backends_to_config(const nodes_data *setup,
-                                   std::vector<std::tuple<uint32_t, std::string>> backends_to_add) {
+                                   std::vector<std::tuple<uint32_t, std::string>> backends_to_add,
+                                   const kora::dynamic_t::object_t &options = kora::dynamic_t::object_t()) {
 	auto config_path = setup->nodes.front().config_path();
 
 	auto config = [&config_path]() {
@@ -181,6 +186,8 @@ static void add_backends_to_config(const nodes_data *setup,
 		backend["group"] = backend_to_group(backend_id);
 		if (!pool_id.empty())
 			backend["pool_id"] = pool_id;
+		for (const auto &option : options)
+			backend[option.first] = option.second;
 		backends.as_array().emplace_back(std::move(backend));
 	}
 
@@ -327,6 +334,100 @@ static void test_backends_with_delay(ioremap::elliptics::newapi::session &s, con
 	setup->nodes.front().config().write(setup->nodes.front().config_path());
 }
 
+static std::vector<int> parse_io_cpus(const std::string &cpus, const std::string &numa_nodes = std::string()) {
+	kora::dynamic_t::object_t options;
+	if (!cpus.empty())
+		options["io_cpus"] = cpus;
+	if (!numa_nodes.empty())
+		options["io_numa_nodes"] = numa_nodes;
+	return ioremap::elliptics::config::parse_io_cpus(kora::config_t("options", options), {});
+}
+
+static void test_parse_cpu_list() {
+	using ioremap::elliptics::config::config_error;
+
+	auto check = [] (const std::string &list, const std::vector<int> &expected) {
+		const auto cpus = parse_io_cpus(list);
+		BOOST_REQUIRE_EQUAL_COLLECTIONS(cpus.begin(), cpus.end(), expected.begin(), expected.end());
+	};
+
+	check("7", {7});
+	check("0-3,8,10-11", {0, 1, 2, 3, 8, 10, 11});
+	// the result is sorted and has no duplicates
+	check("5,1-2,2", {1, 2, 5});
+	check(std::to_string(CPU_SETSIZE - 1), {CPU_SETSIZE - 1});
+
+	const std::vector<std::string> invalid_lists{
+		"a", "-1", "1-", "-", "3-1", "1,,2", " 1", "1 ", "1-2-3", "0x1",
+		// out of cpu_set_t
+		std::to_string(CPU_SETSIZE),
+		"0-" + std::to_string(CPU_SETSIZE),
+		"4294967296",
+		"99999999999999999999999999",
+	};
+	for (const auto &list : invalid_lists) {
+		BOOST_REQUIRE_THROW(parse_io_cpus(list), config_error);
+	}
+}
+
+static void test_parse_numa_nodes() {
+	using ioremap::elliptics::config::config_error;
+
+	// node0 is present if the kernel is built with NUMA support, even on a single-node machine
+	std::ifstream file("/sys/devices/system/node/node0/cpulist");
+	std::string node_cpus;
+	if (!std::getline(file, node_cpus)) {
+		BOOST_TEST_MESSAGE("NUMA nodes are not available, skip the test");
+		return;
+	}
+
+	auto expected = parse_io_cpus(node_cpus);
+	auto cpus = parse_io_cpus(std::string(), "0");
+	BOOST_REQUIRE_EQUAL_COLLECTIONS(cpus.begin(), cpus.end(), expected.begin(), expected.end());
+
+	// CPUs of NUMA nodes are merged with the CPUs list
+	expected.push_back(CPU_SETSIZE - 1);
+	cpus = parse_io_cpus(std::to_string(CPU_SETSIZE - 1), "0,0");
+	BOOST_REQUIRE_EQUAL_COLLECTIONS(cpus.begin(), cpus.end(), expected.begin(), expected.end());
+
+	// unknown node
+	BOOST_REQUIRE_THROW(parse_io_cpus(std::string(), std::to_string(CPU_SETSIZE - 1)), config_error);
+	// invalid list of nodes
+	BOOST_REQUIRE_THROW(parse_io_cpus(std::string(), std::to_string(CPU_SETSIZE)), config_error);
+	BOOST_REQUIRE_THROW(parse_io_cpus(std::string(), "0-"), config_error);
+}
+
+/*
+ * Binding threads to CPUs which are out of the process cpuset fails. It must not be fatal:
+ * the backend is enabled and its pool's threads handle requests unbound.
+ */
+static void test_affinity_failure(ioremap::elliptics::newapi::session &s, const nodes_data *setup) {
+	const auto backend = std::make_tuple(1, "");
+	const auto backend_id = std::get<0>(backend);
+
+	kora::dynamic_t::object_t options;
+	options["io_cpus"] = std::to_string(CPU_SETSIZE - 1);
+	add_backends_to_config(setup, {backend}, options);
+
+	enable_backend(s, setup, backend_id);
+	check_statistics(s, {backend}, {});
+
+	{
+		auto read_session = s.clone();
+		read_session.set_groups({backend_to_group(backend_id)});
+		read_session.set_timeout(5);
+		auto async = read_session.read_data({"non-existent-key"}, 0, 0);
+		async.wait();
+		BOOST_REQUIRE_EQUAL(async.error().code(), -ENOENT);
+	}
+
+	remove_backend(s, setup, backend_id);
+	check_statistics(s, {}, {});
+
+	// revert on-disk config to original one
+	setup->nodes.front().config().write(setup->nodes.front().config_path());
+}
+
 bool register_tests(const nodes_data *setup) {
 	auto n = setup->node->get_native();
 
@@ -355,6 +456,12 @@ bool register_tests(const nodes_data *setup) {
 	// test affecting backend's delay on other backends which share the same pool
 	ELLIPTICS_TEST_CASE(test_backends_with_delay, use_session(n), setup);
 
+	// test parsing of io pool's CPUs and NUMA nodes
+	ELLIPTICS_TEST_CASE_NOARGS(test_parse_cpu_list);
+	ELLIPTICS_TEST_CASE_NOARGS(test_parse_numa_nodes);
+	// test that failed binding of io pool's threads to CPUs is not fatal
+	ELLIPTICS_TEST_CASE(test_affinity_failure, use_session(n), setup);
+
 	return true;
 }
 
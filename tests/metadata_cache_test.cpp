@@ -0,0 +1,249 @@
+/*
+ * This file is part of Elliptics.
+ *
+ * Elliptics is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Elliptics is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Elliptics.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <kora/dynamic.hpp>
+
+#include <boost/program_options.hpp>
+
+#define BOOST_TEST_NO_MAIN
+#define BOOST_TEST_ALTERNATIVE_INIT_API
+#include <boost/test/included/unit_test.hpp>
+
+#include "elliptics/newapi/session.hpp"
+#include "example/eblob_metadata_cache.hpp"
+
+#include "test_base.hpp"
+
+using namespace ioremap::elliptics;
+namespace bu = boost::unit_test;
+
+namespace tests {
+
+static const int group_id = 1;
+static const uint32_t backend_id = 0;
+
+static eblob_key make_key(uint8_t value) {
+	eblob_key key;
+	memset(key.id, value, sizeof(key.id));
+	return key;
+}
+
+static eblob_write_control make_location(int fd, uint64_t offset) {
+	eblob_write_control wc;
+	memset(&wc, 0, sizeof(wc));
+	wc.data_fd = fd;
+	wc.data_offset = offset;
+	wc.total_data_size = 100;
+	return wc;
+}
+
+static void test_cache_invalidation() {
+	blob_metadata_cache cache(100);
+
+	const auto key = make_key(1);
+	const auto wc = make_location(10, 0);
+
+	dnet_ext_list_hdr ehdr, cached_ehdr;
+	dnet_json_header jhdr, cached_jhdr;
+	memset(&ehdr, 0, sizeof(ehdr));
+	memset(&jhdr, 0, sizeof(jhdr));
+	ehdr.timestamp.tsec = 1;
+	jhdr.size = 10;
+
+	BOOST_REQUIRE(!cache.get(key, wc, cached_ehdr, cached_jhdr));
+
+	cache.insert(key, cache.generation(key), wc, ehdr, jhdr);
+	BOOST_REQUIRE(cache.get(key, wc, cached_ehdr, cached_jhdr));
+	BOOST_REQUIRE_EQUAL(cached_ehdr.timestamp.tsec, 1);
+	BOOST_REQUIRE_EQUAL(cached_jhdr.size, 10);
+
+	// removal drops the key
+	cache.remove(key);
+	BOOST_REQUIRE(!cache.get(key, wc, cached_ehdr, cached_jhdr));
+
+	// headers read before the removal aren't cached
+	const auto generation = cache.generation(key);
+	cache.remove(key);
+	cache.insert(key, generation, wc, ehdr, jhdr);
+	BOOST_REQUIRE(!cache.get(key, wc, cached_ehdr, cached_jhdr));
+
+	// moved record isn't served from the cache
+	cache.insert(key, cache.generation(key), wc, ehdr, jhdr);
+	BOOST_REQUIRE(!cache.get(key, make_location(10, 4096), cached_ehdr, cached_jhdr));
+	BOOST_REQUIRE(!cache.get(key, wc, cached_ehdr, cached_jhdr));
+
+	// clear drops all keys
+	const auto other_key = make_key(2);
+	cache.insert(key, cache.generation(key), wc, ehdr, jhdr);
+	cache.insert(other_key, cache.generation(other_key), wc, ehdr, jhdr);
+	cache.clear();
+	BOOST_REQUIRE(!cache.get(key, wc, cached_ehdr, cached_jhdr));
+	BOOST_REQUIRE(!cache.get(other_key, wc, cached_ehdr, cached_jhdr));
+}
+
+static kora::dynamic_t::object_t metadata_cache_stats(newapi::session &s, const nodes_data *setup) {
+	ELLIPTICS_REQUIRE(async, s.monitor_stat(setup->nodes.front().remote(), DNET_MONITOR_BACKEND));
+	BOOST_REQUIRE_EQUAL(async.get().size(), 1);
+
+	std::istringstream stream(async.get().front().statistics());
+	auto statistics = kora::dynamic::read_json(stream);
+	return statistics.as_object()["backends"]
+		.as_object()[std::to_string(backend_id)]
+		.as_object()["backend"]
+		.as_object()["metadata_cache"].as_object();
+}
+
+static void write_key(newapi::session &s, const key &id, const dnet_time &timestamp) {
+	auto session = s.clone();
+	session.set_timestamp(timestamp);
+	ELLIPTICS_REQUIRE(async, session.write(id, std::string("{\"key\":\"value\"}"), 0, std::string("data"), 0));
+}
+
+static dnet_time lookup_timestamp(newapi::session &s, const key &id) {
+	ELLIPTICS_REQUIRE(async, s.lookup(id));
+	auto results = async.get();
+	BOOST_REQUIRE_EQUAL(results.size(), 1);
+	return results.front().record_info().data_timestamp;
+}
+
+/*
+ * Overwritten record is located at the same place if it fits, so the cache must be invalidated by the write itself
+ */
+static void test_write_invalidates(newapi::session &s, const nodes_data *setup) {
+	const key id{std::string("test_write_invalidates")};
+
+	dnet_time first{1, 0}, second{2, 0};
+	write_key(s, id, first);
+
+	// the first lookup fills the cache, the second one is served from it
+	BOOST_REQUIRE_EQUAL(lookup_timestamp(s, id).tsec, first.tsec);
+	const auto hits = metadata_cache_stats(s, setup)["hits"].as_uint();
+	BOOST_REQUIRE_EQUAL(lookup_timestamp(s, id).tsec, first.tsec);
+	BOOST_REQUIRE_GT(metadata_cache_stats(s, setup)["hits"].as_uint(), hits);
+
+	write_key(s, id, second);
+	BOOST_REQUIRE_EQUAL(lookup_timestamp(s, id).tsec, second.tsec);
+}
+
+static void test_remove_range_invalidates(newapi::session &s, const nodes_data *setup) {
+	const size_t keys_count = 16;
+	const size_t number_index = 5;
+
+	dnet_id begin;
+	memset(&begin, 0x42, sizeof(begin));
+	begin.group_id = group_id;
+	begin.id[number_index] = 0;
+
+	dnet_id end = begin;
+	end.id[number_index] = keys_count;
+
+	for (size_t i = 0; i < keys_count; ++i) {
+		dnet_id id = begin;
+		id.id[number_index] = i;
+		write_key(s, key{id}, dnet_time{1, 0});
+		lookup_timestamp(s, key{id});
+	}
+
+	auto stats = metadata_cache_stats(s, setup);
+	const auto size = stats["size"].as_uint();
+	const auto invalidations = stats["invalidations"].as_uint();
+	BOOST_REQUIRE_GE(size, keys_count);
+
+	dnet_io_attr io;
+	memset(&io, 0, sizeof(io));
+	memcpy(io.id, begin.id, sizeof(io.id));
+	memcpy(io.parent, end.id, sizeof(io.parent));
+
+	session old_session(s.get_native_node());
+	old_session.set_groups({group_id});
+	ELLIPTICS_REQUIRE(async, old_session.remove_data_range(io, group_id));
+
+	stats = metadata_cache_stats(s, setup);
+	BOOST_REQUIRE_EQUAL(stats["size"].as_uint(), size - keys_count);
+	BOOST_REQUIRE_GE(stats["invalidations"].as_uint(), invalidations + keys_count);
+}
+
+static nodes_data::ptr configure_test_setup(const std::string &path) {
+	auto server = server_config::default_value();
+	// metadata cache is disabled by default, only this test's backend has it
+	server.backends[0]("enable", true)("group", group_id)("metadata_cache_size", 1000);
+
+	start_nodes_config config(bu::results_reporter::get_stream(), {server}, path);
+	config.fork = true;
+
+	return start_nodes(config);
+}
+
+static bool register_tests(const nodes_data *setup) {
+	auto n = setup->node->get_native();
+
+	ELLIPTICS_TEST_CASE_NOARGS(test_cache_invalidation);
+	ELLIPTICS_TEST_CASE(test_write_invalidates, use_session(n, {group_id}), setup);
+	ELLIPTICS_TEST_CASE(test_remove_range_invalidates, use_session(n, {group_id}), setup);
+
+	return true;
+}
+
+static nodes_data::ptr configure_test_setup_from_args(int argc, char *argv[]) {
+	namespace bpo = boost::program_options;
+
+	bpo::variables_map vm;
+	bpo::options_description generic("Test options");
+
+	std::string path;
+
+	generic.add_options()
+		("help", "This help message")
+		("path", bpo::value(&path), "Path where to store everything")
+		;
+
+	bpo::store(bpo::parse_command_line(argc, argv, generic), vm);
+	bpo::notify(vm);
+
+	if (vm.count("help")) {
+		std::cerr << generic;
+		return nullptr;
+	}
+
+	return configure_test_setup(path);
+}
+
+} /* namespace tests */
+
+/*
+ * Common test initialization routine.
+ */
+namespace {
+std::shared_ptr<tests::nodes_data> setup;
+bool init_func() {
+	return tests::register_tests(setup.get());
+}
+}
+
+int main(int argc, char *argv[]) {
+	srand(time(nullptr));
+
+	// we own our test setup
+	setup = tests::configure_test_setup_from_args(argc, argv);
+
+	int result = bu::unit_test_main(init_func, argc, argv);
+
+	// disassemble setup explicitly, to be sure about where its lifetime ends
+	setup.reset();
+
+	return result;
+}
@@ -1,3 +1,7 @@
+#include <functional>
+#include <map>
+#include <set>
+
 #include <boost/program_options.hpp>
 
 #define BOOST_TEST_NO_MAIN
@@ -23,7 +27,11 @@ nodes_data::ptr configure_test_setup(const std::string &path) {
 		return tests::server_config::default_value().apply_options(c);
 	};
 
-	auto configs = {server_config(tests::config_data()("group", 1)),
+	// small partitions of ordered parallel iterator, so the iterator buffers and sends many of them
+	auto iterated_server = server_config(tests::config_data()("group", 1));
+	iterated_server.backends.front()("iterate_ordered_partition_keys", 4);
+
+	auto configs = {iterated_server,
 	                server_config(tests::config_data()("group", 2)),
 	                server_config(tests::config_data()("group", 3))};
 
@@ -520,6 +528,105 @@ void test_iterator_no_meta(const ioremap::elliptics::newapi::session &session) {
 }
 
 
+void test_iterator_parallel(const ioremap::elliptics::newapi::session &session, uint64_t flags) {
+	auto s = session.clone();
+	s.set_trace_id(rand());
+	s.set_groups({constants::src_group});
+
+	static const auto time_range = std::make_tuple(dnet_time{0, 0}, dnet_time{0, 0});
+	auto async = s.start_iterator(get_setup()->nodes[0].remote(), 0, flags, {}, time_range);
+
+	std::map<dnet_raw_id, size_t, ioremap::elliptics::dnet_raw_id_less_than<>> indexes;
+	for (size_t index = 0; index < constants::numberof::all; ++index) {
+		indexes.emplace(record{s, index}.raw_key(), index);
+	}
+
+	std::vector<dnet_raw_id> keys;
+	for (const auto &result: async) {
+		BOOST_REQUIRE_EQUAL(result.status(), 0);
+		BOOST_REQUIRE_EQUAL(result.total_keys(), constants::numberof::all);
+		BOOST_REQUIRE_LE(result.iterated_keys(), constants::numberof::all);
+
+		const auto record_info = result.record_info();
+		BOOST_REQUIRE_BITWISE_EQUAL(record_info.user_flags, constants::user_flags);
+
+		auto it = indexes.find(result.key());
+		BOOST_REQUIRE(it != indexes.end());
+		const record record{s, it->second};
+		if (flags & DNET_IFLAGS_JSON) {
+			BOOST_REQUIRE_EQUAL(result.json().to_string(), record.json());
+		}
+		if (flags & DNET_IFLAGS_DATA) {
+			BOOST_REQUIRE_EQUAL(result.data().to_string(),
+			                    record.is_committed() ? record.data() : std::string());
+		}
+
+		keys.emplace_back(result.key());
+	}
+
+	BOOST_REQUIRE_EQUAL(keys.size(), constants::numberof::all);
+
+	ioremap::elliptics::dnet_raw_id_less_than<> less;
+	if (flags & DNET_IFLAGS_ORDERED) {
+		BOOST_REQUIRE(std::is_sorted(keys.begin(), keys.end(), less));
+	}
+
+	std::set<dnet_raw_id, ioremap::elliptics::dnet_raw_id_less_than<>> unique_keys(keys.begin(), keys.end());
+	BOOST_REQUIRE_EQUAL(unique_keys.size(), constants::numberof::all);
+
+	for (size_t index = 0; index < constants::numberof::all; ++index) {
+		const record record{s, index};
+		BOOST_REQUIRE(unique_keys.count(record.raw_key()));
+	}
+}
+
+void test_iterator_with_predicate(const ioremap::elliptics::newapi::session &session,
+                                  const ioremap::elliptics::newapi::iterator_predicate &predicate,
+                                  const std::function<bool (size_t)> &expected) {
+	auto s = session.clone();
+	s.set_trace_id(rand());
+	s.set_groups({constants::src_group});
+
+	static const auto time_range = std::make_tuple(dnet_time{0, 0}, dnet_time{0, 0});
+	auto async = s.start_iterator(get_setup()->nodes[0].remote(), 0, 0, {}, time_range, predicate);
+
+	size_t expected_count = 0;
+	for (size_t index = 0; index < constants::numberof::all; ++index) {
+		if (expected(index)) {
+			++expected_count;
+		}
+	}
+
+	size_t index = 0;
+	size_t count = 0;
+	bool summary = false;
+	for (const auto &result: async) {
+		BOOST_REQUIRE(!summary);
+		if (result.status() == DNET_ITERATOR_STATUS_SUMMARY) {
+			// final counters include records filtered out after the last sent one
+			summary = true;
+			BOOST_REQUIRE_EQUAL(result.iterated_keys(), expected_count);
+			BOOST_REQUIRE_EQUAL(result.filtered_keys(), constants::numberof::all - expected_count);
+			continue;
+		}
+
+		for (; index < constants::numberof::all && !expected(index); ++index) {
+		}
+		BOOST_REQUIRE_LT(index, constants::numberof::all);
+
+		const record record{s, index++};
+
+		BOOST_REQUIRE_EQUAL(result.key(), record.raw_key());
+		BOOST_REQUIRE_EQUAL(result.status(), 0);
+		BOOST_REQUIRE_EQUAL(result.iterated_keys(), ++count);
+		BOOST_REQUIRE_EQUAL(result.filtered_keys(), index - count);
+		BOOST_REQUIRE_EQUAL(result.total_keys(), constants::numberof::all);
+	}
+
+	BOOST_REQUIRE_EQUAL(count, expected_count);
+	BOOST_REQUIRE(summary);
+}
+
 bool register_tests(const tests::nodes_data *setup) {
 	using namespace tests;
 
@@ -548,6 +655,38 @@ bool register_tests(const tests::nodes_data *setup) {
 
 	ELLIPTICS_TEST_CASE(test_iterator_no_meta, use_session(n));
 
+	{
+		using ioremap::elliptics::newapi::iterator_condition;
+		using ioremap::elliptics::newapi::iterator_predicate;
+		// all keys have the same user_flags
+		ELLIPTICS_TEST_CASE(test_iterator_with_predicate, use_session(n),
+		                    iterator_predicate{iterator_condition{DNET_IPRED_FIELD_USER_FLAGS, DNET_IPRED_OP_ALL_BITS,
+		                                        constants::user_flags, dnet_time{0, 0}, "", ""}},
+		                    [] (size_t) { return true; });
+		// no keys without user_flags
+		ELLIPTICS_TEST_CASE(test_iterator_with_predicate, use_session(n),
+		                    iterator_predicate{iterator_condition{DNET_IPRED_FIELD_USER_FLAGS, DNET_IPRED_OP_EQ,
+		                                        0, dnet_time{0, 0}, "", ""}},
+		                    [] (size_t) { return false; });
+		// keys written with timestamp in [10, 20)
+		ELLIPTICS_TEST_CASE(test_iterator_with_predicate, use_session(n),
+		                    iterator_predicate{iterator_condition{DNET_IPRED_FIELD_DATA_TIMESTAMP, DNET_IPRED_OP_GE,
+		                                        0, dnet_time{10, 0}, "", ""},
+		                     iterator_condition{DNET_IPRED_FIELD_DATA_TIMESTAMP, DNET_IPRED_OP_LT,
+		                                        0, dnet_time{20, 0}, "", ""}},
+		                    [] (size_t index) { return index >= 10 && index < 20; });
+		// the only key which json has "index" equal to "5"
+		ELLIPTICS_TEST_CASE(test_iterator_with_predicate, use_session(n),
+		                    iterator_predicate{iterator_condition{DNET_IPRED_FIELD_JSON, DNET_IPRED_OP_EQ,
+		                                        0, dnet_time{0, 0}, "index", "5"}},
+		                    [] (size_t index) { return index == 5; });
+	}
+
+	ELLIPTICS_TEST_CASE(test_iterator_parallel, use_session(n), DNET_IFLAGS_PARALLEL);
+	ELLIPTICS_TEST_CASE(test_iterator_parallel, use_session(n), DNET_IFLAGS_PARALLEL | DNET_IFLAGS_ORDERED);
+	ELLIPTICS_TEST_CASE(test_iterator_parallel, use_session(n),
+	                    DNET_IFLAGS_PARALLEL | DNET_IFLAGS_ORDERED | DNET_IFLAGS_JSON | DNET_IFLAGS_DATA);
+
 	/* TODO:
 	 * * iterate with time range and json
 	 * * iterate with time range and data
@@ -1626,6 +1626,67 @@ void test_bulk_read(const ioremap::elliptics::newapi::session &session) {
 	set_delay_for_groups(s, {delay_group}, 0);
 }
 
+void test_read_coalescing(const ioremap::elliptics::newapi::session &session) {
+	const static size_t NUM_KEYS = 50;
+
+	auto s = session.clone();
+	s.set_trace_id(rand());
+
+	/* All keys are written to the first group except the last one which is written to the second group,
+	 * so its coalesced read fails in the first group and is continued by ordinary read.
+	 */
+	std::vector<ioremap::elliptics::key> keys;
+	std::vector<std::string> datas;
+	for (size_t i = 0; i < NUM_KEYS; ++i) {
+		keys.emplace_back("coalesced_key_" + std::to_string(i));
+		datas.emplace_back("coalesced_data_" + std::to_string(i));
+
+		s.set_groups({i + 1 < NUM_KEYS ? groups[0] : groups[1]});
+		auto async = s.write(keys.back(), "", 0, datas.back(), 0);
+		async.wait();
+		BOOST_REQUIRE_EQUAL(async.error().code(), 0);
+	}
+
+	s.set_groups({groups[0], groups[1]});
+	s.set_read_coalescing(8, 10000);
+
+	std::vector<ioremap::elliptics::newapi::async_read_result> results;
+	for (const auto &key : keys) {
+		results.emplace_back(s.read_data(key, 0, 0));
+	}
+	/* concurrent read of the same key */
+	results.emplace_back(s.read_data(keys.front(), 0, 0));
+	/* read of part of the record isn't coalesced */
+	results.emplace_back(s.read_data(keys.back(), 1, 0));
+	/* read of nonexistent key fails in both groups */
+	results.emplace_back(s.read_data(std::string{"coalesced_nonexistent_key"}, 0, 0));
+
+	for (size_t i = 0; i < NUM_KEYS; ++i) {
+		auto read_results = results[i].get();
+		BOOST_REQUIRE_EQUAL(results[i].error().code(), 0);
+		BOOST_REQUIRE_EQUAL(read_results.size(), 1);
+		BOOST_REQUIRE_EQUAL(read_results[0].data().to_string(), datas[i]);
+	}
+
+	auto duplicate = results[NUM_KEYS].get();
+	BOOST_REQUIRE_EQUAL(duplicate.size(), 1);
+	BOOST_REQUIRE_EQUAL(duplicate[0].data().to_string(), datas.front());
+
+	auto partial = results[NUM_KEYS + 1].get();
+	BOOST_REQUIRE_EQUAL(partial.size(), 1);
+	BOOST_REQUIRE_EQUAL(partial[0].data().to_string(), datas.back().substr(1));
+
+	auto &nonexistent = results[NUM_KEYS + 2];
+	nonexistent.wait();
+	BOOST_REQUIRE_EQUAL(nonexistent.error().code(), -ENOENT);
+
+	const auto stats = s.get_read_coalescing_stats();
+	BOOST_REQUIRE_EQUAL(stats.reads, NUM_KEYS + 2);
+	BOOST_REQUIRE(stats.keys <= stats.reads);
+	BOOST_REQUIRE(stats.batches < stats.reads);
+	BOOST_REQUIRE_EQUAL(stats.failovers, 2);
+}
+
 bool register_tests(const nodes_data *setup) {
 	record record{
 		std::string{"key"},
@@ -1670,6 +1731,7 @@ bool register_tests(const nodes_data *setup) {
 
 		if (!in_cache) {
 			ELLIPTICS_TEST_CASE(test_bulk_read, use_session(n, {}, 0, ioflags));
+			ELLIPTICS_TEST_CASE(test_read_coalescing, use_session(n, {}, 0, ioflags));
 		}
 
 		record.json = R"json({
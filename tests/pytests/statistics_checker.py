@@ -112,6 +112,18 @@ class MonitorStatsChecker:
             assert len(cache_json['pages_max_sizes']) == 1
             for i, value in enumerate(cache_json['pages_sizes']):
                 assert 0 <= value <= cache_json['pages_max_sizes'][i]
+            assert 0 <= cache_json['fills']['wait_timeouts'] <= cache_json['fills']['coalesced_misses']
+            assert cache_json['admission']['accepted'] >= 0
+            assert cache_json['admission']['rejected'] >= 0
+            assert 0 <= cache_json['chunks']['objects'] <= cache_json['chunks']['chunks'] <= cache_json['objects']
+            assert 0 <= cache_json['flush']['dirty_objects'] <= cache_json['objects']
+            assert 0 <= cache_json['flush']['dirty_size'] <= cache_json['size']
+            assert cache_json['flush']['flushed_objects'] >= 0
+            assert 0 <= cache_json['compression']['objects'] <= cache_json['objects']
+            assert 0 <= cache_json['compression']['size'] <= cache_json['compression']['logical_size']
+            assert cache_json['compression']['incompressible_objects'] >= 0
+            assert cache_json['compression']['compression_time'] >= 0
+            assert cache_json['compression']['decompression_time'] >= 0
 
         for backend_id in self.json_stat['backends']:
             if self.json_stat['backends'][backend_id] is None:
@@ -121,6 +133,14 @@ class MonitorStatsChecker:
             assert len(cache_json['caches']) == 16
             for cache_id in cache_json['caches']:
                 check_counters(cache_json['caches'][cache_id])
+            if 'l2' in cache_json:
+                l2_json = cache_json['l2']
+                assert 0 <= l2_json['size'] <= l2_json['max_size']
+                assert 0 <= l2_json['objects'] <= l2_json['written_objects']
+                assert l2_json['hits'] >= 0
+                assert l2_json['misses'] >= 0
+                assert l2_json['dropped_objects'] >= 0
+                assert l2_json['errors'] >= 0
 
     def __check_io_stat(self):
         '''full check of io statistics in json'''
@@ -128,11 +148,19 @@ class MonitorStatsChecker:
         def check_queue(queue_json):
             '''checks queue statistics'''
             assert queue_json['current_size'] >= 0
+            for priority in queue_json.get('priorities', {}).values():
+                assert priority['current_size'] >= 0
+                assert priority['dequeued'] >= 0
+                assert priority['wait_time'] >= 0
+            if 'order' in queue_json:
+                assert queue_json['order'] in ('fifo', 'edf')
+                assert queue_json['dropped'] >= 0
+                assert queue_json['late'] >= 0
         io = self.json_stat['io']
         check_queue(io['blocking'])
         check_queue(io['nonblocking'])
         check_queue(io['output'])
-        assert io['blocked'] == False
+        assert io['rejected'] >= 0
 
         for state in io['states']:
             state_io = io['states'][state]
@@ -148,6 +176,7 @@ class MonitorStatsChecker:
             io = self.json_stat['backends'][backend_id]['io']
             check_queue(io['blocking'])
             check_queue(io['nonblocking'])
+            assert io['rejected'] >= 0
 
     def __check_commands_stat(self):
         '''full check of commands statistics in json'''
@@ -234,9 +263,20 @@ class MonitorStatsChecker:
             assert config['blob_size_limit'] >= 0
             assert config['defrag_time'] >= 0
             assert config['defrag_splay'] >= 0
+            assert config['iterate_thread_num'] > 0
+            assert config['iterate_ordered_partition_keys'] > 0
+            assert config['metadata_cache_size'] >= 0
+            assert config['content_digest'] in (True, False)
             assert config['group'] >= 0
             assert config['group'] == self.backends_groups[int(backend_id)]
 
+            if 'metadata_cache' in backend:
+                metadata_cache = backend['metadata_cache']
+                assert 0 <= metadata_cache['size'] <= metadata_cache['max_size']
+                assert metadata_cache['hits'] >= 0
+                assert metadata_cache['misses'] >= metadata_cache['stale'] >= 0
+                assert metadata_cache['invalidations'] >= 0
+
             vfs = backend['vfs']
             assert vfs['bsize'] > 0
             assert vfs['frsize'] > 0
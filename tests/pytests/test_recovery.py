@@ -169,7 +169,7 @@ def corrupt_key(session, key):
 
 def recovery(one_node, remotes, backend_id, address, groups,
              rtype, log_file, tmp_dir, no_server_send=False, dump_file=None, no_meta=False,
-             user_flags_set=(), expected_ret_code=0, chunk_size=1024):
+             user_flags_set=(), expected_ret_code=0, chunk_size=1024, native=False):
     '''
     Imports dnet_recovery tools and executes merge recovery. Checks result of merge.
     '''
@@ -208,6 +208,8 @@ def recovery(one_node, remotes, backend_id, address, groups,
         args += ['dc']
     if no_server_send:
         args += ['--no-server-send']
+    if native and rtype == RECOVERY.MERGE:
+        args += ['--native']
     for user_flags in user_flags_set:
         args += ['--user-flags', user_flags]
 
@@ -216,8 +218,10 @@ def recovery(one_node, remotes, backend_id, address, groups,
     cleanup_logger()
 
 
-@pytest.fixture(scope="class", params=[('use_server_send', False), ('no_server_send', True)],
-                ids=['use_server_send', 'no_server_send'])
+@pytest.fixture(scope="class", params=[('use_server_send', False, False),
+                                       ('no_server_send', True, False),
+                                       ('native_merge', False, True)],
+                ids=['use_server_send', 'no_server_send', 'native_merge'])
 def use_server_send(request):
     return request.param
 
@@ -382,7 +386,8 @@ class TestRecovery:
                  no_meta=True,
                  log_file='merge_2_backends.log',
                  tmp_dir='merge_2_backends_{}'.format(use_server_send[0]),
-                 no_server_send=use_server_send[1])
+                 no_server_send=use_server_send[1],
+                 native=use_server_send[2])
 
         session.groups = (scope.test_group,)
         check_data(scope, session, self.keys, self.datas, self.timestamp)
@@ -427,7 +432,8 @@ class TestRecovery:
                  log_file='merge_from_dump_3_backends.log',
                  tmp_dir='merge_from_dump_3_backends_{}'.format(use_server_send[0]),
                  dump_file=dump_filename,
-                 no_server_send=use_server_send[1])
+                 no_server_send=use_server_send[1],
+                 native=use_server_send[2])
 
         session.groups = (scope.test_group,)
         check_data(scope, session, self.keys, self.datas, self.timestamp)
@@ -460,7 +466,8 @@ class TestRecovery:
                  rtype=RECOVERY.MERGE,
                  log_file='merge_one_group.log',
                  tmp_dir='merge_one_group_{}'.format(use_server_send[0]),
-                 no_server_send=use_server_send[1])
+                 no_server_send=use_server_send[1],
+                 native=use_server_send[2])
 
         session.groups = (scope.test_group,)
         check_data(scope, session, self.keys, self.datas, self.timestamp)
@@ -1042,7 +1049,8 @@ class TestMerge:
                  no_meta=False,
                  log_file='merge_with_uncommitted_keys.log',
                  tmp_dir='merge_with_uncommitted_keys_{}'.format(use_server_send[0]),
-                 no_server_send=use_server_send[1])
+                 no_server_send=use_server_send[1],
+                 native=use_server_send[2])
 
     @pytest.mark.usefixtures("servers")
     def test_check(self, simple_node):
@@ -18,7 +18,14 @@ sys.path.insert(0, "")  # for running from cmake
 from conftest import make_session
 import pytest
 import md5
+import os
+import heapq
+import random
+import struct
+import tempfile
+import threading
 import elliptics
+from elliptics_recovery.iterator import MergeData
 
 
 def format_result(node, backend, result, counter):
@@ -106,6 +113,166 @@ def invert_ranges(ranges):
     return convert_ranges(inverted_ranges)
 
 
+# layout of newapi::iterator_container_item: key, status, record_flags, user_flags, json_timestamp,
+# json_size, json_capacity, data_timestamp, data_size, data_offset, blob_id
+CONTAINER_ITEM_FORMAT = '<64si4xQQQQQQQQQQQ'
+CONTAINER_ITEM_SIZE = struct.calcsize(CONTAINER_ITEM_FORMAT)
+
+
+def make_container_item(key, data_timestamp, data_size, user_flags=0, json_timestamp=0):
+    return (key, 0, 0, user_flags, json_timestamp, 0, 0, 0, data_timestamp, 0, data_size, 0, 0)
+
+
+def make_container(items, is_sorted=False):
+    '''
+    Writes @items made by make_container_item() to temporary file and returns the file and container of it.
+    '''
+    container_file = tempfile.TemporaryFile()
+    container_file.write(''.join(struct.pack(CONTAINER_ITEM_FORMAT, *item) for item in items))
+    container_file.flush()
+    container = elliptics.core.newapi.IteratorResultContainer(container_file.fileno(),
+                                                              is_sorted,
+                                                              len(items) * CONTAINER_ITEM_SIZE)
+    return container_file, container
+
+
+def read_container_items(container_file):
+    container_file.seek(0)
+    data = container_file.read()
+    assert len(data) % CONTAINER_ITEM_SIZE == 0
+    return [struct.unpack_from(CONTAINER_ITEM_FORMAT, data, offset)
+            for offset in xrange(0, len(data), CONTAINER_ITEM_SIZE)]
+
+
+def test_container_sort():
+    '''
+    Sorts container which is large enough to be sorted by radix pass and parallel sort of buckets.
+    Checks that the result is ordered by (key, -data_timestamp, data_size, -user_flags, -json_timestamp),
+    so the first record of a key is the one which wins merge.
+    '''
+    random.seed(0)
+    keys = [os.urandom(64) for _ in xrange(50000)]
+    # duplicate keys with different metadata
+    keys += random.sample(keys, 50000)
+    items = [make_container_item(key,
+                                 data_timestamp=random.randint(0, 10),
+                                 data_size=random.randint(0, 10),
+                                 user_flags=random.randint(0, 10),
+                                 json_timestamp=random.randint(0, 10))
+             for key in keys]
+
+    container_file, container = make_container(items)
+    container.sort()
+
+    order = lambda item: (item[0], -item[8], item[10], -item[3], -item[4])
+    assert [order(item) for item in read_container_items(container_file)] == \
+        sorted(order(item) for item in items)
+
+
+class ContainerResult(object):
+    '''
+    Wraps container to be walked by MergeData like iterator results of @index-th node.
+    '''
+    def __init__(self, container, index):
+        self.container = container
+        self.address = self.group_id = self.backend_id = index
+
+    def __iter__(self):
+        return iter(self.container)
+
+
+def make_sorted_sources(seed):
+    '''
+    Makes 3 sorted containers with overlapping keys, timestamps and sizes collide a lot,
+    user_flags break ties between sources. Returns the containers and the number of unique keys.
+    '''
+    random.seed(seed)
+    keys = [os.urandom(64) for _ in xrange(1000)]
+    sources = []
+    for index in xrange(3):
+        items = [make_container_item(key,
+                                     data_timestamp=random.randint(0, 3),
+                                     data_size=random.randint(0, 3),
+                                     user_flags=index)
+                 for key in random.sample(keys, 700) + random.sample(keys, 100)]
+        container_file, container = make_container(items)
+        container.sort()
+        sources.append((container_file, container))
+    return sources, len(set(keys))
+
+
+def merge_data_walk(sources):
+    '''
+    Walks over sorted containers by heapq of MergeData which python recovery uses.
+    Yields MergeData of the newest record of each key and the list of MergeData of each source
+    positioned at the key (None if the source misses the key).
+    '''
+    heap = []
+    for index, (_, container) in enumerate(sources):
+        heapq.heappush(heap, MergeData(ContainerResult(container, index), index))
+    while heap:
+        newest = heapq.heappop(heap)
+        same = [newest]
+        while heap and heap[0].key == newest.key:
+            same.append(heapq.heappop(heap))
+        merged = [None] * len(sources)
+        for data in same:
+            merged[data.container] = data
+        yield newest, merged
+        for data in same:
+            try:
+                data.next()
+                heapq.heappush(heap, data)
+            except StopIteration:
+                pass
+
+
+def container_items_meta(container):
+    item_meta = lambda item: (str(item.key), item.data_timestamp.tsec, item.data_size, item.user_flags)
+    return [item_meta(container[i]) for i in xrange(len(container))]
+
+
+def test_container_merge():
+    '''
+    Merges sorted containers natively and by heapq walk over MergeData which python recovery used,
+    checks that the same record of each key wins and is appended to the same destination.
+    '''
+    sources, num_keys = make_sorted_sources(1)
+
+    expected = [[] for _ in sources]
+    for newest, _ in merge_data_walk(sources):
+        expected[newest.container].append(newest.value)
+
+    destinations = [make_container([]) for _ in sources]
+    elliptics.core.newapi.IteratorResultContainer.merge([c for _, c in sources], [c for _, c in destinations])
+
+    for (_, destination), expected_items in zip(destinations, expected):
+        assert container_items_meta(destination) == container_items_meta(expected_items)
+    assert sum(len(d) for _, d in destinations) == num_keys
+
+
+def test_container_diff():
+    '''
+    Computes difference of sorted containers natively and by heapq walk over MergeData,
+    checks that the newest record of each key is appended to every destination which source
+    misses the key or has an older record of it.
+    '''
+    sources, _ = make_sorted_sources(2)
+
+    expected = [[] for _ in sources]
+    for newest, merged in merge_data_walk(sources):
+        for index, data in enumerate(merged):
+            if data is None or newest < data:
+                expected[index].append(newest.value)
+
+    destinations = [make_container([]) for _ in sources]
+    elliptics.core.newapi.IteratorResultContainer.diff([c for _, c in sources], [c for _, c in destinations])
+
+    for (_, destination), expected_items in zip(destinations, expected):
+        assert container_items_meta(destination) == container_items_meta(expected_items)
+    assert any(len(d) for _, d in destinations)
+
+
 @pytest.mark.trylast
 class TestSession:
     '''
@@ -260,3 +427,62 @@ class TestSession:
             time_end=end_time)
 
         check_iterator_results(node, backend, iterator, session, node_id, True)
+
+    @pytest.mark.usefixtures("servers")
+    def test_iterate_batch_and_container(self, simple_node):
+        '''
+        Runs iterator on first node/backend twice: receives results by batches via connect_batch
+        and appends them natively to IteratorResultContainer via connect_container.
+        Checks that both ways get the same records.
+        '''
+        session = make_session(node=simple_node,
+                               test_name='TestSession.test_iterate_batch_and_container')
+        session.groups = session.routes.groups()
+        node_id, node, backend = iter(session.routes.get_unique_routes()[0])
+
+        def start_iterator():
+            return session.start_iterator(
+                id=node_id,
+                ranges=[],
+                type=elliptics.iterator_types.network,
+                flags=elliptics.iterator_flags.default,
+                time_begin=elliptics.Time(0, 0),
+                time_end=elliptics.Time(2 ** 64 - 1, 2 ** 64 - 1))
+
+        batches = []
+        errors = []
+        finished = threading.Event()
+
+        def on_final(error):
+            errors.append(error)
+            finished.set()
+
+        start_iterator().connect_batch(batches.append, on_final, count=10, window=0)
+        assert finished.wait(60)
+        assert errors[-1].code == 0
+        assert all(len(batch) <= 10 for batch in batches)
+        keys = sorted(str(r.response.key) for batch in batches for r in batch if r.response.status == 0)
+
+        finished.clear()
+        with tempfile.TemporaryFile() as container_file:
+            container = elliptics.core.newapi.IteratorResultContainer(container_file.fileno())
+            start_iterator().connect_container(container, on_final)
+            assert finished.wait(60)
+            assert errors[-1].code == 0
+
+            # container is flushed before the final handler is called
+            assert os.fstat(container_file.fileno()).st_size == len(keys) * CONTAINER_ITEM_SIZE
+            assert len(container) == len(keys)
+            assert sorted(str(container[i].key) for i in xrange(len(container))) == keys
+
+        with tempfile.TemporaryFile() as container_file:
+            appended = elliptics.core.newapi.IteratorResultContainer(container_file.fileno())
+            for result in start_iterator():
+                if result.response.status == 0:
+                    appended.append_old(result)
+            assert len(appended) == len(keys)
+
+            # buffered records are readable before they are written to the file
+            assert sorted(str(appended[i].key) for i in xrange(len(appended))) == keys
+            appended.flush()
+            assert os.fstat(container_file.fileno()).st_size == len(keys) * CONTAINER_ITEM_SIZE
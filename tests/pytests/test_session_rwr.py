@@ -206,6 +206,35 @@ class TestSession:
         checked_bulk_write(session, dict.fromkeys(keys, 'data'), data)
         checked_bulk_read(session, keys, data)
 
+    @pytest.mark.usefixtures("servers")
+    def test_write_read_buffers(self, simple_node):
+        session = make_session(node=simple_node,
+                               test_name='TestSession.test_write_read_buffers')
+        groups = session.routes.groups()
+        session.groups = groups
+
+        key = 'buffers key'
+        data = 'buffer data ' * 1000
+
+        for payload in (bytearray(data), memoryview(data), buffer(data)):
+            checked_write(session, key, payload)
+            checked_read(session, key, data)
+
+        checked_write(session, key, data)
+        results = session.read_data(key).get()
+        view = results[0].data_view
+        assert type(view) == memoryview
+        assert view.readonly
+        assert view.tobytes() == data
+
+        # memoryview holds the read buffer, so it outlives the result
+        view = view[7:11]
+        del results
+        assert view.tobytes() == data[7:11]
+
+        checked_bulk_write(session, [(k, bytearray(data)) for k in ['buffers key 1', 'buffers key 2']], data)
+        checked_bulk_read(session, ['buffers key 1', 'buffers key 2'], data)
+
     @pytest.mark.usefixtures("servers")
     def test_write_cas(self, simple_node):
         session = make_session(node=simple_node,
@@ -229,6 +258,11 @@ class TestSession:
         check_write_results(results, len(session.groups), ndata, session)
         checked_read(session, key, ndata)
 
+        # checksum of outdated data should not pass compare-and-swap
+        with pytest.raises(elliptics.Error):
+            session.write_cas(key, data1, session.transform(data2)).get()
+        checked_read(session, key, ndata)
+
     @pytest.mark.usefixtures("servers")
     def test_prepare_write_commit(self, simple_node):
         session = make_session(node=simple_node,
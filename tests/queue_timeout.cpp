@@ -21,6 +21,13 @@
 
 #include <boost/program_options.hpp>
 
+#include <kora/dynamic.hpp>
+
+#include "elliptics/newapi/session.hpp"
+
+#include <chrono>
+#include <thread>
+
 using namespace ioremap::elliptics;
 using namespace boost::unit_test;
 
@@ -32,6 +39,15 @@ constexpr int backend_id = 1;
 constexpr int group_with_overridden_queue_timeout = 2;
 constexpr int backend_with_overridden_queue_timeout = 2;
 
+constexpr int group_with_queue_limit = 3;
+constexpr int backend_with_queue_limit = 3;
+
+constexpr int group_with_priorities = 4;
+constexpr int backend_with_priorities = 4;
+
+constexpr int group_with_edf = 5;
+constexpr int backend_with_edf = 5;
+
 static nodes_data::ptr configure_test_setup(const std::string &path) {
 	std::vector<server_config> servers {
 		[] () {
@@ -44,7 +60,7 @@ static nodes_data::ptr configure_test_setup(const std::string &path) {
 				("queue_timeout", "1")
 			;
 
-			ret.backends.resize(2, ret.backends.front());
+			ret.backends.resize(5, ret.backends.front());
 
 			ret.backends[0]
 				("backend_id", backend_id)
@@ -57,6 +73,26 @@ static nodes_data::ptr configure_test_setup(const std::string &path) {
 				("group", group_with_overridden_queue_timeout)
 				("queue_timeout", "2")
 			;
+			ret.backends[2]
+				("backend_id", backend_with_queue_limit)
+				("enable", true)
+				("group", group_with_queue_limit)
+				("queue_timeout", "10")
+				("queue_limit", 1)
+			;
+			ret.backends[3]
+				("backend_id", backend_with_priorities)
+				("enable", true)
+				("group", group_with_priorities)
+				("queue_timeout", "10")
+			;
+			ret.backends[4]
+				("backend_id", backend_with_edf)
+				("enable", true)
+				("group", group_with_edf)
+				("queue_timeout", "10")
+				("queue_order", "edf")
+			;
 			return ret;
 		} ()
 	};
@@ -184,6 +220,198 @@ static void test_overridden_queue_timeout(session &s, const nodes_data *setup) {
 
 }
 
+/* The test validates admission budget of backend's io queue limited to 1 request:
+ * * write test keys to the backend with queue limit and to the ordinary backend
+ * * set 1 second delay to the backend with queue limit
+ * * send the first read which will hold the only io thread of the backend on the delay
+ * * send the second read which will wait in the queue and the third one which should be rejected with -EBUSY
+ *   because the queue is full
+ * * send lookup without DNET_FLAGS_NEED_ACK which should be rejected with -EBUSY reply as well
+ * * check that the ordinary backend is not affected by overloaded neighbour and handles read immediately
+ * * check that there is no aftereffect.
+ */
+static void test_queue_limit(session &s, const nodes_data *setup) {
+	// check that test have only one node
+	BOOST_REQUIRE(setup->nodes.size() == 1);
+
+	std::string key = "queue limit test key";
+	std::string data = "queue limit test data";
+
+	auto ordinary = s.clone();
+	ordinary.set_groups({group});
+
+	ELLIPTICS_REQUIRE(async_write, s.write_data(key, data, 0));
+	ELLIPTICS_REQUIRE(async_ordinary_write, ordinary.write_data(key, data, 0));
+
+	const auto &node = setup->nodes.front();
+	s.set_delay(node.remote(), backend_with_queue_limit, 1000).get();
+
+	s.set_timeout(5);
+	// first read command. It will hold the only io thread of the backend on the delay.
+	auto async = s.read_data(key, 0, 0);
+	// give the io thread time to take the first command from the queue
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	// second read command. It will occupy the only slot in the queue.
+	auto async_queued = s.read_data(key, 0, 0);
+	// third read command. It should be rejected since the queue is full.
+	auto async_rejected = s.read_data(key, 0, 0);
+	// lookup without DNET_FLAGS_NEED_ACK. It should be rejected too and the reply should be sent anyway.
+	dnet_id id;
+	memset(&id, 0, sizeof(id));
+	s.transform(key, id);
+	id.group_id = s.get_groups().front();
+	auto async_rejected_no_ack = s.request_single_cmd(transport_control(id, DNET_CMD_LOOKUP, 0));
+	{
+		ELLIPTICS_REQUIRE_ERROR(res, std::move(async_rejected), -EBUSY);
+	} {
+		ELLIPTICS_REQUIRE_ERROR(res, std::move(async_rejected_no_ack), -EBUSY);
+	} {
+		// the ordinary backend should handle the request while its neighbour is overloaded
+		ordinary.set_timeout(1);
+		ELLIPTICS_COMPARE_REQUIRE(res, ordinary.read_data(key, 0, 0), data);
+	} {
+		ELLIPTICS_COMPARE_REQUIRE(res, std::move(async), data);
+	} {
+		ELLIPTICS_COMPARE_REQUIRE(res, std::move(async_queued), data);
+	}
+
+	s.set_delay(node.remote(), backend_with_queue_limit, 0).get();
+	// there should be no aftereffect, so next read request should be succeeded
+	ELLIPTICS_COMPARE_REQUIRE(res, s.read_data(key, 0, 0), data);
+}
+
+/* The test validates that client requests are not stuck behind recovery ones in io queue:
+ * * set 300 ms delay to the backend with the only io thread
+ * * send read with recovery priority which will hold the io thread and 2 more recovery reads which will wait
+ *   in the queue
+ * * send read with default (client) priority
+ * * check that client read is handled before queued recovery reads despite it was sent after them.
+ */
+static void test_priorities(session &s, const nodes_data *setup) {
+	// check that test have only one node
+	BOOST_REQUIRE(setup->nodes.size() == 1);
+
+	std::string key = "priorities test key";
+	std::string data = "priorities test data";
+
+	ELLIPTICS_REQUIRE(async_write, s.write_data(key, data, 0));
+
+	const auto &node = setup->nodes.front();
+	s.set_delay(node.remote(), backend_with_priorities, 300).get();
+	s.set_timeout(10);
+
+	auto recovery = s.clone();
+	recovery.set_cflags(DNET_FLAGS_PRIO_RECOVERY);
+
+	auto async_first = recovery.read_data(key, 0, 0);
+	// give the io thread time to take the first command from the queue
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	auto async_second = recovery.read_data(key, 0, 0);
+	auto async_third = recovery.read_data(key, 0, 0);
+	auto async_client = s.read_data(key, 0, 0);
+
+	ELLIPTICS_COMPARE_REQUIRE(res, std::move(async_client), data);
+	// client read should overtake recovery reads queued before it
+	BOOST_REQUIRE(!async_second.ready());
+	BOOST_REQUIRE(!async_third.ready());
+
+	ELLIPTICS_COMPARE_REQUIRE(first, std::move(async_first), data);
+	ELLIPTICS_COMPARE_REQUIRE(second, std::move(async_second), data);
+	ELLIPTICS_COMPARE_REQUIRE(third, std::move(async_third), data);
+
+	s.set_delay(node.remote(), backend_with_priorities, 0).get();
+}
+
+// returns the number of requests dropped by io queues of @backend_id before execution
+static uint64_t dropped_requests(newapi::session &s, const nodes_data *setup, uint32_t backend_id) {
+	ELLIPTICS_REQUIRE(async, s.monitor_stat(setup->nodes.front().remote(), DNET_MONITOR_IO | DNET_MONITOR_BACKEND));
+	BOOST_REQUIRE_EQUAL(async.get().size(), 1);
+
+	std::istringstream stream(async.get().front().statistics());
+	auto statistics = kora::dynamic::read_json(stream);
+	auto &io = statistics.as_object()["backends"]
+		.as_object()[std::to_string(backend_id)]
+		.as_object()["io"].as_object();
+	return io["blocking"].as_object()["dropped"].as_uint() + io["nonblocking"].as_object()["dropped"].as_uint();
+}
+
+static std::string read_data(newapi::async_read_result &&async) {
+	async.wait();
+	BOOST_REQUIRE_MESSAGE(!async.error(), "read failed: " + async.error().message());
+	return async.get_one().data().to_string();
+}
+
+/* The test validates earliest deadline first ordering of backend's io queue. Only READ_NEW, WRITE_NEW and
+ * BULK_READ_NEW carry client's deadline, so the test uses new api:
+ * * set 500 ms delay to the backend with the only io thread
+ * * send read which will hold the io thread and read with 10 seconds deadline which will wait in the queue
+ * * send read with 3 seconds deadline
+ * * check that the read with earlier deadline is handled before the read sent before it
+ * * send read with 1 second deadline while the io thread is held by 1,5 seconds delay and check that it is
+ *   evicted from the queue without execution and there is no aftereffect.
+ */
+static void test_edf(session &s, const nodes_data *setup) {
+	// check that test have only one node
+	BOOST_REQUIRE(setup->nodes.size() == 1);
+
+	std::string key = "edf test key";
+	std::string data = "edf test data";
+
+	ELLIPTICS_REQUIRE(async_write, s.write_data(key, data, 0));
+
+	const auto &node = setup->nodes.front();
+	s.set_delay(node.remote(), backend_with_edf, 500).get();
+
+	newapi::session ordinary(s);
+	ordinary.set_timeout(10);
+	auto urgent = ordinary.clone();
+	urgent.set_timeout(3);
+
+	{
+		auto async_first = ordinary.read_data(key, 0, 0);
+		// give the io thread time to take the first command from the queue
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		auto async_second = ordinary.read_data(key, 0, 0);
+		auto async_urgent = urgent.read_data(key, 0, 0);
+
+		BOOST_REQUIRE_EQUAL(read_data(std::move(async_urgent)), data);
+		// read with earlier deadline should overtake read queued before it
+		BOOST_REQUIRE(!async_second.ready());
+
+		BOOST_REQUIRE_EQUAL(read_data(std::move(async_first)), data);
+		BOOST_REQUIRE_EQUAL(read_data(std::move(async_second)), data);
+	}
+
+	{
+		s.set_delay(node.remote(), backend_with_edf, 1500).get();
+
+		const auto dropped = dropped_requests(ordinary, setup, backend_with_edf);
+
+		auto expiring = ordinary.clone();
+		expiring.set_timeout(1);
+
+		auto async_first = ordinary.read_data(key, 0, 0);
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		// the read expires while it waits in the queue and it should be evicted without execution
+		auto async_expired = expiring.read_data(key, 0, 0);
+
+		BOOST_REQUIRE_EQUAL(read_data(std::move(async_first)), data);
+		async_expired.wait();
+
+		// the io thread evicts expired requests before it takes the next one
+		uint64_t current = dropped;
+		for (size_t attempt = 0; attempt < 50 && current == dropped; ++attempt) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			current = dropped_requests(ordinary, setup, backend_with_edf);
+		}
+		BOOST_REQUIRE_EQUAL(current, dropped + 1);
+	}
+
+	s.set_delay(node.remote(), backend_with_edf, 0).get();
+	// there should be no aftereffect, so next read request should be succeeded
+	BOOST_REQUIRE_EQUAL(read_data(ordinary.read_data(key, 0, 0)), data);
+}
+
 static bool register_tests(const nodes_data *setup) {
 	auto n = setup->node->get_native();
 
@@ -191,6 +419,9 @@ static bool register_tests(const nodes_data *setup) {
 	ELLIPTICS_TEST_CASE(test_overridden_queue_timeout,
 	                    use_session(n, {group_with_overridden_queue_timeout}, 0, 0),
 	                    setup);
+	ELLIPTICS_TEST_CASE(test_queue_limit, use_session(n, {group_with_queue_limit}, 0, 0), setup);
+	ELLIPTICS_TEST_CASE(test_priorities, use_session(n, {group_with_priorities}, 0, 0), setup);
+	ELLIPTICS_TEST_CASE(test_edf, use_session(n, {group_with_edf}, 0, 0), setup);
 
 	return true;
 }
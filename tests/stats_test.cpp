@@ -16,6 +16,8 @@
 #include "test_base.hpp"
 #include "monitor/event_stats.hpp"
 #include "monitor/monitor.hpp"
+#include "monitor/compress.hpp"
+#include "monitor/snapshot_cache.hpp"
 
 #define BOOST_TEST_NO_MAIN
 #define BOOST_TEST_ALTERNATIVE_INIT_API
@@ -426,6 +428,230 @@ static void test_frequent_access()
 			      "then keys with more frequent access must be in top");
 }
 
+/************************
+ Test latency histograms
+ ************************/
+static void test_latency_histogram_percentiles()
+{
+	ioremap::monitor::latency_histogram histogram;
+	for (uint64_t value = 1; value <= 10000; ++value) {
+		histogram.record(value);
+	}
+
+	ioremap::monitor::histogram_snapshot snapshot;
+	histogram.merge_to(snapshot);
+
+	BOOST_REQUIRE_EQUAL(snapshot.count(), 10000);
+	BOOST_REQUIRE_EQUAL(snapshot.max(), 10000);
+	BOOST_REQUIRE_EQUAL(snapshot.percentile(100), 10000);
+
+	// percentile can't be less than real value and exceeds it by at most 1/8
+	for (double percentile : {50., 90., 99., 99.9}) {
+		const uint64_t exact = percentile * 100;
+		const uint64_t value = snapshot.percentile(percentile);
+		BOOST_CHECK_GE(value, exact);
+		BOOST_CHECK_LE(value, exact + exact / 8);
+	}
+}
+
+static void test_command_stats_shards_merge()
+{
+	const size_t threads_count = 8;
+	const unsigned long commands_count = 1000;
+
+	ioremap::monitor::command_stats stats;
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < threads_count; ++i) {
+		threads.emplace_back([&stats, commands_count] () {
+			for (unsigned long time = 1; time <= commands_count; ++time) {
+				stats.command_counter(DNET_CMD_READ, /*trans*/ 1, /*err*/ 0, /*cache*/ 0, /*size*/ 1,
+				                      time, /*queue_time*/ 0);
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	rapidjson::Document report;
+	report.SetObject();
+	stats.commands_report(nullptr, {99}, report, report.GetAllocator());
+
+	const auto &disk = report["READ"]["disk"];
+	BOOST_REQUIRE_EQUAL(disk["outside"]["successes"].GetUint64(), threads_count * commands_count);
+	BOOST_REQUIRE_EQUAL(disk["outside"]["size"].GetUint64(), threads_count * commands_count);
+
+	const auto &handle_time = disk["latency"]["handle_time"];
+	BOOST_REQUIRE_EQUAL(handle_time["count"].GetUint64(), threads_count * commands_count);
+	BOOST_REQUIRE_EQUAL(handle_time["max"].GetUint64(), commands_count);
+	BOOST_REQUIRE_GE(handle_time["p99"].GetUint64(), 990);
+	BOOST_REQUIRE_EQUAL(disk["latency"]["queue_time"]["max"].GetUint64(), 0);
+
+	stats.clear();
+	rapidjson::Document cleared;
+	cleared.SetObject();
+	stats.commands_report(nullptr, {99}, cleared, cleared.GetAllocator());
+	BOOST_REQUIRE(!cleared.HasMember("READ"));
+}
+
+/*************************
+ Test the slowest requests
+ *************************/
+static ioremap::monitor::request_trace make_request_trace(uint64_t total_time)
+{
+	ioremap::monitor::request_trace trace;
+	memset(&trace, 0, sizeof(trace));
+	trace.cmd = DNET_CMD_READ;
+	trace.trans = total_time;
+	trace.total_time = total_time;
+	trace.stages[DNET_REQUEST_STAGE_BACKEND] = total_time;
+	return trace;
+}
+
+static void test_slow_requests_keeps_slowest()
+{
+	const size_t length = 10;
+	ioremap::monitor::slow_requests requests(length, 300);
+
+	for (uint64_t time = 1; time <= 100; ++time) {
+		requests.add(make_request_trace(time));
+	}
+	// faster requests should be rejected
+	requests.add(make_request_trace(5));
+
+	const auto result = requests.get();
+	BOOST_REQUIRE_EQUAL(result.size(), length);
+	for (size_t i = 0; i < length; ++i) {
+		BOOST_REQUIRE_EQUAL(result[i].total_time, 100 - i);
+		BOOST_REQUIRE_EQUAL(result[i].trans, 100 - i);
+		BOOST_REQUIRE_EQUAL(result[i].stages[DNET_REQUEST_STAGE_BACKEND], 100 - i);
+	}
+}
+
+static void test_slow_requests_concurrent_add()
+{
+	const size_t length = 16;
+	const size_t threads_count = 8;
+	const uint64_t requests_count = 10000;
+
+	ioremap::monitor::slow_requests requests(length, 300);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < threads_count; ++i) {
+		threads.emplace_back([&requests, i, threads_count, requests_count] () {
+			for (uint64_t time = i + 1; time <= requests_count; time += threads_count) {
+				requests.add(make_request_trace(time));
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	// concurrent writers may lose a race for a slot, but kept requests should never be torn
+	const auto result = requests.get();
+	BOOST_REQUIRE_EQUAL(result.size(), length);
+	for (const auto &trace : result) {
+		BOOST_REQUIRE_EQUAL(trace.trans, trace.total_time);
+		BOOST_REQUIRE_EQUAL(trace.stages[DNET_REQUEST_STAGE_BACKEND], trace.total_time);
+	}
+}
+
+/************************
+ Test snapshots of reports
+ ************************/
+static void test_snapshot_cache_delta()
+{
+	ioremap::monitor::snapshot_cache cache(std::chrono::milliseconds(0), 4);
+
+	int counter = 0;
+	auto builder = [&counter] (rapidjson::Document &report) {
+		auto &allocator = report.GetAllocator();
+		rapidjson::Value commands(rapidjson::kObjectType);
+		commands.AddMember("changed", counter, allocator);
+		commands.AddMember("same", 1, allocator);
+		report.AddMember("commands", commands, allocator);
+		if (counter == 0) {
+			rapidjson::Value removed(rapidjson::kObjectType);
+			report.AddMember("removed", removed, allocator);
+		}
+	};
+
+	ioremap::monitor::request request(DNET_MONITOR_COMMANDS);
+	rapidjson::Document first;
+	first.Parse<0>(ioremap::monitor::decompress(cache.get(request, builder)).c_str());
+	BOOST_REQUIRE(first.HasMember("snapshot_id"));
+
+	// reports aren't kept for deltas until the first request with snapshot id
+	request.since = first["snapshot_id"].GetUint64();
+	rapidjson::Document full;
+	full.Parse<0>(ioremap::monitor::decompress(cache.get(request, builder)).c_str());
+	BOOST_REQUIRE(!full.HasMember("base_snapshot_id"));
+	BOOST_REQUIRE_EQUAL(full["commands"]["changed"].GetInt(), 0);
+
+	counter = 1;
+	request.since = full["snapshot_id"].GetUint64();
+	rapidjson::Document delta;
+	delta.Parse<0>(ioremap::monitor::decompress(cache.get(request, builder)).c_str());
+	BOOST_REQUIRE_EQUAL(delta["base_snapshot_id"].GetUint64(), request.since);
+	BOOST_REQUIRE_EQUAL(delta["commands"]["changed"].GetInt(), 1);
+	BOOST_REQUIRE(!delta["commands"].HasMember("same"));
+	BOOST_REQUIRE(delta["removed"].IsNull());
+
+	// unknown snapshot leads to full report
+	request.since = 1;
+	rapidjson::Document unknown;
+	unknown.Parse<0>(ioremap::monitor::decompress(cache.get(request, builder)).c_str());
+	BOOST_REQUIRE(!unknown.HasMember("base_snapshot_id"));
+	BOOST_REQUIRE(unknown["commands"].HasMember("same"));
+}
+
+static void test_snapshot_cache_max_age()
+{
+	ioremap::monitor::snapshot_cache cache(std::chrono::milliseconds(300), 4);
+
+	std::atomic<int> builds(0);
+	auto builder = [&builds] (rapidjson::Document &report) {
+		// slow builder lets concurrent requests catch the report being built
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		report.AddMember("builds", ++builds, report.GetAllocator());
+	};
+
+	auto snapshot_id = [&cache, &builder] (const ioremap::monitor::request &request) {
+		rapidjson::Document report;
+		report.Parse<0>(ioremap::monitor::decompress(cache.get(request, builder)).c_str());
+		return report["snapshot_id"].GetUint64();
+	};
+
+	const ioremap::monitor::request commands(DNET_MONITOR_COMMANDS);
+
+	// concurrent requests of the same report are served by the single build
+	std::vector<uint64_t> ids(8);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < ids.size(); ++i) {
+		threads.emplace_back([&ids, &snapshot_id, &commands, i] () {
+			ids[i] = snapshot_id(commands);
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+	BOOST_REQUIRE_EQUAL(builds, 1);
+	BOOST_REQUIRE(std::all_of(ids.begin(), ids.end(), [&ids] (uint64_t id) { return id == ids.front(); }));
+
+	// report younger than max_age is served from the cache
+	BOOST_REQUIRE_EQUAL(snapshot_id(commands), ids.front());
+	BOOST_REQUIRE_EQUAL(builds, 1);
+
+	// other combination of categories has its own report
+	snapshot_id(ioremap::monitor::request(DNET_MONITOR_IO));
+	BOOST_REQUIRE_EQUAL(builds, 2);
+
+	// outdated report is rebuilt
+	std::this_thread::sleep_for(std::chrono::milliseconds(400));
+	BOOST_REQUIRE_GT(snapshot_id(commands), ids.front());
+	BOOST_REQUIRE_EQUAL(builds, 3);
+}
+
 bool register_tests(const nodes_data *setup)
 {
 	ELLIPTICS_TEST_CASE(test_top_statistics_existence, setup);
@@ -441,6 +667,12 @@ bool register_tests(const nodes_data *setup)
 	ELLIPTICS_TEST_CASE_NOARGS(test_event_weight_attenuation);
 	ELLIPTICS_TEST_CASE_NOARGS(test_frequent_access_among_heavy_keys);
 	ELLIPTICS_TEST_CASE_NOARGS(test_frequent_access);
+	ELLIPTICS_TEST_CASE_NOARGS(test_latency_histogram_percentiles);
+	ELLIPTICS_TEST_CASE_NOARGS(test_command_stats_shards_merge);
+	ELLIPTICS_TEST_CASE_NOARGS(test_slow_requests_keeps_slowest);
+	ELLIPTICS_TEST_CASE_NOARGS(test_slow_requests_concurrent_add);
+	ELLIPTICS_TEST_CASE_NOARGS(test_snapshot_cache_delta);
+	ELLIPTICS_TEST_CASE_NOARGS(test_snapshot_cache_max_age);
 
 	return true;
 }